@@ -14,9 +14,11 @@
 #include "graphics/animation.hpp"
 
 #include "kernel/blob_serialization.hpp"
+#include "kernel/data_format.hpp"
 #include "kernel/file.hpp"
 #include "kernel/memory.hpp"
 #include "kernel/numerics.hpp"
+#include "kernel/profiler.hpp"
 
 #include "cglm/struct/mat4.h"
 
@@ -26,6 +28,8 @@
 #include "generated/debug_gpu_text.bhfx2.h"
 
 // Compiler ///////////////////////////////////////////////////////////////
+static cstring                      s_shader_output_folder = "..//bin//data";
+
 static void compile_resources( cstring root, bool force_compilation ) {
 
     hydra::directory_change( root );
@@ -34,8 +38,35 @@ static void compile_resources( cstring root, bool force_compilation ) {
 
     hprint( "Executing from path %s\n", directory.path );
 
-    hfx::hfx_compile( "..//data//articles//GpuDrivenText//pixel_art.hfx", "..//bin//data//pixel_art.bhfx2", hfx::CompileOptions_VulkanStandard, "..//source//Articles//GpuDrivenText//generated", force_compilation );
-    hfx::hfx_compile( "..//data//articles//GpuDrivenText//debug_gpu_text.hfx", "..//bin//data//debug_gpu_text.bhfx2", hfx::CompileOptions_VulkanStandard, "..//source//Articles//GpuDrivenText//generated", force_compilation );
+    // Data types are generated as blob serializable structs.
+    cstring simple_data_header = "..//source//Articles//GpuDrivenText//generated//simple_data.h";
+    if ( force_compilation || !hydra::file_exists( simple_data_header ) ) {
+        hdf::hdf_generate( "..//data//source//SimpleData.hdf", simple_data_header, hdf::GenerateOptions_Blob, &hydra::MemoryService::instance()->system_allocator );
+    }
+
+    char layout_table_path[ 512 ];
+    snprintf( layout_table_path, 512, "%s//%s", s_shader_output_folder, hfx::k_layout_table_filename );
+
+    // Dependency files written by a previous build know which outputs changed, the layout table is updated with them.
+    if ( !force_compilation && hydra::file_exists( layout_table_path ) ) {
+        hfx::hfx_build_outdated( s_shader_output_folder );
+        return;
+    }
+
+    hfx::CompileRequest requests[ 2 ];
+    requests[ 0 ].input_filename = "..//data//articles//GpuDrivenText//pixel_art.hfx";
+    requests[ 0 ].output_filename = "..//bin//data//pixel_art.bhfx2";
+    requests[ 1 ].input_filename = "..//data//articles//GpuDrivenText//debug_gpu_text.hfx";
+    requests[ 1 ].output_filename = "..//bin//data//debug_gpu_text.bhfx2";
+
+    for ( u32 i = 0; i < ArraySize( requests ); ++i ) {
+        requests[ i ].options = hfx::CompileOptions_VulkanStandard;
+        requests[ i ].cpp_generated_folder = "..//source//Articles//GpuDrivenText//generated";
+        requests[ i ].force_rebuild = force_compilation;
+    }
+
+    hfx::hfx_compile_batch( requests, ArraySize( requests ) );
+    hfx::hfx_generate_layout_table( s_shader_output_folder, layout_table_path );
 }
 
 // Sprite /////////////////////////////////////////////////////////////////
@@ -124,6 +155,10 @@ struct hg04 : public hydra::GameApplication {
     hydra::gfx::Texture*            dither_texture_4x4;
     hydra::gfx::Texture*            dither_texture_8x8;
 
+    hydra::StringId                 sprites_marker;
+    hydra::StringId                 apply_main_marker;
+    hydra::StringId                 write_gpu_text_marker;
+
 }; // struct HG04
 
 void hg04::create( const hydra::ApplicationConfiguration& configuration ) {
@@ -132,12 +167,20 @@ void hg04::create( const hydra::ApplicationConfiguration& configuration ) {
 
     hydra::Allocator* allocator = &hydra::MemoryService::instance()->system_allocator;
 
+    // Layouts shared by all the shaders of the build, created before loading them.
+    char layout_table_path[ 512 ];
+    snprintf( layout_table_path, 512, "%s//%s", s_shader_output_folder, hfx::k_layout_table_filename );
+    renderer->load_resource_layout_table( layout_table_path );
+
     shader_manager.init( allocator, renderer );
     gpu_profiler.init( allocator, 100 );
     animation_system.init( allocator );
     sprites.init( allocator, 8 );
     sprite_batch.init( renderer, allocator );
 
+    sprites_marker = hydra::string_id_intern( "Sprites" );
+    apply_main_marker = hydra::string_id_intern( "Apply Main" );
+    write_gpu_text_marker = hydra::string_id_intern( "Write GPU text" );
 
     using namespace hydra::gfx;
     // Create constant buffer
@@ -243,6 +286,7 @@ bool hg04::main_loop() {
         handle_begin_frame();
 
         // Logic //////////////////////////////////////////////////////////
+        hydra::CPUProfiler::instance()->begin_scope( "Logic" );
         delta_time = glm_clamp( delta_time, 0.0f, 0.25f );
 
         static f32 timer = 0.f;
@@ -281,6 +325,7 @@ bool hg04::main_loop() {
         }
 
         cloud_system.update( delta_time );
+        hydra::CPUProfiler::instance()->end_scope();
         
         // IMGUI //////////////////////////////////////////////////////////
         static bool s_use_fullscreen_gpu_font = false;
@@ -319,6 +364,11 @@ bool hg04::main_loop() {
         }
         ImGui::End();
 
+        if ( ImGui::Begin( "CPU" ) ) {
+            hydra::CPUProfiler::instance()->imgui_draw();
+        }
+        ImGui::End();
+
         hydra::MemoryService::instance()->imgui_draw();
 
         pixel_art::sprite_forward::vert::LocalConstants* constants = ( pixel_art::sprite_forward::vert::LocalConstants* )renderer->map_buffer( pixel_art_local_constants_cb );
@@ -334,6 +384,7 @@ bool hg04::main_loop() {
         }
 
         // Collect sprites.
+        hydra::CPUProfiler::instance()->begin_scope( "Sprite batch" );
         sprite_batch.begin( *renderer, main_camera );
         // Set common material. Texture is the only thing changing,
         // but it is encoded in the sprite instance data.
@@ -344,19 +395,20 @@ bool hg04::main_loop() {
             sprite_batch.add( sprite );
         }
         sprite_batch.end( *renderer );
+        hydra::CPUProfiler::instance()->end_scope();
 
         // Rendering /////////////////////////////////////////////////////
-        hydra::gfx::CommandBuffer* cb = renderer->get_command_buffer( hydra::gfx::QueueType::Graphics, true );
+        hydra::gfx::CommandBuffer* cb = renderer->get_command_buffer( 0, hydra::gfx::QueueType::Graphics, true );
 
         u64 sort_key = 0;
-        cb->push_marker( "Frame" );
+        cb->push_marker( frame_marker );
         cb->clear( sort_key, .1f, .1f, .1f, 1.f );
         cb->clear_depth_stencil( sort_key++, 1.0f, 0 );
         cb->fill_buffer( debug_gpu_font_ub->handle, 0, 64, 0 );
 
         // Draw the sprites and the background! ////////////////////////////        
         {
-            cb->push_marker( "Sprites" );
+            cb->push_marker( sprites_marker );
             hydra::gfx::ExecutionBarrier barrier;
             barrier.reset().add_memory_barrier( { debug_gpu_font_ub->handle } );
             barrier.set( hydra::gfx::PipelineStage::ComputeShader, hydra::gfx::PipelineStage::VertexShader );
@@ -403,7 +455,7 @@ bool hg04::main_loop() {
 
         {
             // Pass through from main rt to swapchain
-            cb->push_marker( "Apply Main" );
+            cb->push_marker( apply_main_marker );
             cb->barrier( forward_stage->barrier.set( hydra::gfx::PipelineStage::RenderTarget, hydra::gfx::PipelineStage::FragmentShader ) );
             cb->bind_pass( sort_key++, renderer->gpu->swapchain_pass );
 
@@ -416,7 +468,7 @@ bool hg04::main_loop() {
 
         // Draw fullscreen debug text or sprite based
         {
-            cb->push_marker( "Write GPU text" );
+            cb->push_marker( write_gpu_text_marker );
             if ( s_use_fullscreen_gpu_font ) {
                 cb->bind_pipeline( sort_key++, debug_gpu_font_material->passes[ gpu_text::pass_fullscreen ].pipeline );
                 cb->bind_resource_list( sort_key++, &debug_gpu_font_material->passes[ gpu_text::pass_fullscreen ].resource_list, 1, 0, 0 );
@@ -432,9 +484,12 @@ bool hg04::main_loop() {
 
         gpu_profiler.update( *renderer->gpu );
 
-        imgui->render( renderer, *cb );
-        renderer->queue_command_buffer( cb );
-        renderer->end_frame();
+        {
+            hy_cpu_profile_scope( "Present" );
+            imgui->render( renderer, *cb );
+            renderer->queue_command_buffer( cb );
+            renderer->end_frame();
+        }
     }
 
     return true;
@@ -574,7 +629,7 @@ int main( int argc, char** argv ) {
         // Run application
         hprint( "Running application\n" );
 
-        compile_resources( ".", true );
+        compile_resources( ".", false );
 
         hg04 app;
         hydra::ApplicationConfiguration conf;
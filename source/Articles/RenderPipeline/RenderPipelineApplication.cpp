@@ -801,6 +801,7 @@ void RenderPipelineApplication::app_resize( uint16_t width, uint16_t height ) {
 void RenderPipelineCreation::init() {
     
     render_stages = nullptr;
+    owns_textures = true;
     string_hash_init_arena( name_to_textures );
 
     string_buffer.init( 1000 );
@@ -808,6 +809,20 @@ void RenderPipelineCreation::init() {
 
 void RenderPipelineCreation::terminate() {
 
+    for ( uint32_t s = 0; s < array_length( render_stages ); ++s ) {
+        render_stages[s].overriding_lookups.terminate();
+    }
+    array_free( render_stages );
+
+    // Textures loaded from a compiled blob live in the blob memory.
+    if ( owns_textures ) {
+        for ( uint32_t t = 0; t < string_hash_length( name_to_textures ); ++t ) {
+            delete name_to_textures[t].value;
+        }
+    }
+    string_hash_free( name_to_textures );
+
+    string_buffer.terminate();
 }
 
 bool RenderPipelineCreation::is_valid() {
@@ -916,244 +931,562 @@ void CameraMovementUpdate::update( hydra::graphics::Camera& camera, CameraInput&
 
 // RenderPipelineManager ////////////////////////////////////////////////////////
 
-void RenderPipelineManager::init( hydra::graphics::Device& device, hydra::StringBuffer& temp_string_buffer ) {
-    
-    render_pipeline_creations = nullptr;
+// Compiled render pipelines.
+// JSON is only the authoring format: it is compiled once into a single binary blob that is
+// loaded with one read and used in place. All offsets are relative to the start of the blob,
+// textures are stored as RenderPipelineTextureCreation so they can be referenced directly.
+static const uint32_t               k_render_pipelines_blob_magic   = 0x42505248;  // 'HRPB'
+static const uint32_t               k_render_pipelines_blob_version = 1;
+static const uint16_t               k_render_pipelines_invalid_index = 0xffff;
 
-     // Load pipelines
-    const char* resource_full_filename = temp_string_buffer.append_use( "..\\data\\source\\RenderPipelines.json" );
-    char* file_memory = hydra::read_file_into_memory( resource_full_filename, nullptr );
+struct RenderPipelinesBlobHeader {
 
-    if ( file_memory ) {
+    uint32_t                        magic;
+    uint32_t                        version;
+    hydra::FileTime                 source_write_time;      // Last write time of the JSON, used to detect stale binaries.
 
-        using namespace rapidjson;
-        Document document;
+    uint32_t                        num_pipelines;
+    uint32_t                        pipelines_offset;
+    uint32_t                        total_size;
 
-        if ( !document.Parse<0>( file_memory ).HasParseError() ) {
-            const Value& pipelines = document["RenderPipelines"];
+}; // struct RenderPipelinesBlobHeader
 
-            if ( pipelines.IsArray() ) {
-                const Value::ConstArray& pipeline_array = pipelines.GetArray();
+struct RenderPipelineBlob {
 
-                for ( uint32_t p = 0; p < pipeline_array.Size(); ++p ) {
+    char                            name[32];
 
-                    // 1. Parse all the render pipeline data
-                    const auto& render_pipeline_definition = pipeline_array[p];
+    uint32_t                        num_textures;
+    uint32_t                        textures_offset;        // RenderPipelineTextureCreation[num_textures]
+    uint32_t                        num_stages;
+    uint32_t                        stages_offset;          // RenderStageBlob[num_stages]
 
-                    RenderPipelineCreation render_pipeline_creation;
-                    render_pipeline_creation.init();
+}; // struct RenderPipelineBlob
 
-                    // Retrieve pipeline name and if not present just create one.
-                    char* pipeline_name = nullptr;
+struct RenderStageBindingBlob {
 
-                    if ( render_pipeline_definition.HasMember( "name" ) ) {
-                        const Value& name = render_pipeline_definition["name"];
+    char                            binding[32];
+    char                            resource[32];
 
-                        pipeline_name = temp_string_buffer.append_use( name.GetString() );
-                    }
-                    else {
-                        pipeline_name = temp_string_buffer.append_use( "unnamed_%u", p );
-                    }
-                    
-                    strcpy_s( render_pipeline_creation.name, 32, pipeline_name );
+}; // struct RenderStageBindingBlob
 
-                    // Parse textures from files
-                    if ( render_pipeline_definition.HasMember( "Textures" ) ) {
-                        const Value::ConstArray& textures = render_pipeline_definition["Textures"].GetArray();
+struct RenderStageBlob {
 
-                        for ( uint32_t t = 0; t < textures.Size(); ++t ) {
-                            const auto& texture_definition = textures[t];
+    char                            name[32];
+    char                            material_name[32];
+    char                            render_view_name[32];
 
-                            RenderPipelineTextureCreation* texture_creation = new RenderPipelineTextureCreation();
-                            texture_creation->path[0] = 0;
+    uint16_t                        inputs[32];             // Indices into the pipeline textures.
+    uint16_t                        outputs[8];
+    uint16_t                        output_depth;
 
-                            const Value& name = texture_definition["name"];
-                            const Value& path = texture_definition["path"];
+    uint16_t                        input_count;
+    uint16_t                        output_count;
+    uint16_t                        num_bindings;
+    uint32_t                        bindings_offset;        // RenderStageBindingBlob[num_bindings]
 
-                            strcpy_s( texture_creation->name, 32, name.GetString() );
-                            strcpy_s( texture_creation->path, 512, path.GetString() );
-                            texture_creation->texture_creation.render_target = 0;
+    float                           clear_color[4];
+    float                           clear_depth_value;
+    uint8_t                         clear_stencil_value;
+    uint8_t                         clear_rt;
+    uint8_t                         clear_depth;
+    uint8_t                         clear_stencil;
 
-                            string_hash_put( render_pipeline_creation.name_to_textures, texture_creation->name, texture_creation );
-                        }
-                    }
-                    
-                    // Parse render targets
-                    if ( render_pipeline_definition.HasMember( "RenderTargets" ) ) {
-                        const Value::ConstArray& textures = render_pipeline_definition["RenderTargets"].GetArray();
+    uint8_t                         stage_type;
+    uint8_t                         material_pass_index;
 
-                        for ( uint32_t t = 0; t < textures.Size(); ++t ) {
-                            const auto& texture_definition = textures[t];
+}; // struct RenderStageBlob
 
-                            RenderPipelineTextureCreation* texture_creation = new RenderPipelineTextureCreation();
-                            texture_creation->path[0] = 0;
+static uint32_t align_blob_offset( uint32_t offset ) {
+    return ( offset + 15 ) & ~15u;
+}
 
-                            const Value& name = texture_definition["name"];
-                            strcpy_s( texture_creation->name, 32, name.GetString() );
+//
+// Parse the authoring JSON into creation structs. Texture creations are heap allocated.
+static void parse_render_pipelines_json( char* file_memory, hydra::StringBuffer& temp_string_buffer, RenderPipelineCreation*& out_creations ) {
+    using namespace rapidjson;
+    Document document;
 
-                            texture_creation->texture_creation.render_target = 1;
+    if ( !document.Parse<0>( file_memory ).HasParseError() ) {
+        const Value& pipelines = document["RenderPipelines"];
 
-                            const char* texture_format_name = texture_definition["format"].GetString();
-                            for ( size_t f = 0; f < hydra::graphics::TextureFormat::Count; ++f ) {
-                                if ( strcmp(hydra::graphics::TextureFormat::s_value_names[f], texture_format_name ) == 0 ) {
+        if ( pipelines.IsArray() ) {
+            const Value::ConstArray& pipeline_array = pipelines.GetArray();
 
-                                    texture_creation->texture_creation.format = (hydra::graphics::TextureFormat::Enum)f;
-                                    break;
-                                }
-                            }
+            for ( uint32_t p = 0; p < pipeline_array.Size(); ++p ) {
 
-                            string_hash_put( render_pipeline_creation.name_to_textures, texture_creation->name, texture_creation );
-                        }
+                // 1. Parse all the render pipeline data
+                const auto& render_pipeline_definition = pipeline_array[p];
+
+                RenderPipelineCreation render_pipeline_creation;
+                render_pipeline_creation.init();
+
+                // Retrieve pipeline name and if not present just create one.
+                char* pipeline_name = nullptr;
+
+                if ( render_pipeline_definition.HasMember( "name" ) ) {
+                    const Value& name = render_pipeline_definition["name"];
+
+                    pipeline_name = temp_string_buffer.append_use( name.GetString() );
+                }
+                else {
+                    pipeline_name = temp_string_buffer.append_use( "unnamed_%u", p );
+                }
+                
+                strcpy_s( render_pipeline_creation.name, 32, pipeline_name );
+
+                // Parse textures from files
+                if ( render_pipeline_definition.HasMember( "Textures" ) ) {
+                    const Value::ConstArray& textures = render_pipeline_definition["Textures"].GetArray();
+
+                    for ( uint32_t t = 0; t < textures.Size(); ++t ) {
+                        const auto& texture_definition = textures[t];
+
+                        RenderPipelineTextureCreation* texture_creation = new RenderPipelineTextureCreation();
+                        texture_creation->path[0] = 0;
+
+                        const Value& name = texture_definition["name"];
+                        const Value& path = texture_definition["path"];
+
+                        strcpy_s( texture_creation->name, 32, name.GetString() );
+                        strcpy_s( texture_creation->path, 512, path.GetString() );
+                        texture_creation->texture_creation.render_target = 0;
+
+                        string_hash_put( render_pipeline_creation.name_to_textures, texture_creation->name, texture_creation );
                     }
+                }
+                
+                // Parse render targets
+                if ( render_pipeline_definition.HasMember( "RenderTargets" ) ) {
+                    const Value::ConstArray& textures = render_pipeline_definition["RenderTargets"].GetArray();
 
-                    // TODO: Parse render states
+                    for ( uint32_t t = 0; t < textures.Size(); ++t ) {
+                        const auto& texture_definition = textures[t];
 
-                    // Parse stages
-                    if ( render_pipeline_definition.HasMember( "RenderStages" ) ) {
-                        const Value::ConstArray& render_stages = render_pipeline_definition["RenderStages"].GetArray();
+                        RenderPipelineTextureCreation* texture_creation = new RenderPipelineTextureCreation();
+                        texture_creation->path[0] = 0;
 
-                        for ( uint32_t t = 0; t < render_stages.Size(); ++t ) {
-                            const auto& render_stage = render_stages[t];
+                        const Value& name = texture_definition["name"];
+                        strcpy_s( texture_creation->name, 32, name.GetString() );
 
-                            RenderStageCreation render_stage_creation;
-                            const Value& name = render_stage["name"];
-                            strcpy_s( render_stage_creation.name, 32, name.GetString() );
+                        texture_creation->texture_creation.render_target = 1;
 
-                            // Material name and index - used for 'post process' effects.
-                            if ( render_stage.HasMember( "material_name" ) ) {
-                                strcpy_s( render_stage_creation.material_name, 32, render_stage["material_name"].GetString() );
-                            }
-                            else {
-                                render_stage_creation.material_name[0] = 0;
-                            }
+                        const char* texture_format_name = texture_definition["format"].GetString();
+                        for ( size_t f = 0; f < hydra::graphics::TextureFormat::Count; ++f ) {
+                            if ( strcmp(hydra::graphics::TextureFormat::s_value_names[f], texture_format_name ) == 0 ) {
 
-                            if ( render_stage.HasMember( "material_pass_index" ) ) {
-                                render_stage_creation.material_pass_index = (uint8_t)render_stage["material_pass_index"].GetInt();
-                            }
-                            else {
-                                render_stage_creation.material_pass_index = 0;
+                                texture_creation->texture_creation.format = (hydra::graphics::TextureFormat::Enum)f;
+                                break;
                             }
+                        }
 
-                            const Value& type = render_stage["type"];
-                            const char* type_string = type.GetString();
-                            if ( strcmp(type_string, "Geometry" ) == 0 ) {
-                                render_stage_creation.stage_type = (uint8_t)hydra::graphics::RenderStage::Geometry;
-                            }
-                            else if ( strcmp( type_string, "Post" ) == 0 ) {
-                                render_stage_creation.stage_type = (uint8_t)hydra::graphics::RenderStage::Post;
-                            }
-                            else if ( strcmp( type_string, "PostCompute" ) == 0 ) {
-                                render_stage_creation.stage_type = (uint8_t)hydra::graphics::RenderStage::PostCompute;
-                            }
-                            else {
-                                render_stage_creation.stage_type = (uint8_t)hydra::graphics::RenderStage::Swapchain;
-                            }
+                        string_hash_put( render_pipeline_creation.name_to_textures, texture_creation->name, texture_creation );
+                    }
+                }
 
-                            if ( render_stage.HasMember( "render_view" ) ) {
-                                strcpy_s( render_stage_creation.render_view_name, 32, render_stage["render_view"].GetString() );
-                            }
-                            else {
-                                render_stage_creation.render_view_name[0] = 0;
-                            }
+                // TODO: Parse render states
 
-                            render_stage_creation.overriding_lookups.init();
+                // Parse stages
+                if ( render_pipeline_definition.HasMember( "RenderStages" ) ) {
+                    const Value::ConstArray& render_stages = render_pipeline_definition["RenderStages"].GetArray();
 
-                            // Get inputs
-                            const Value::ConstArray& input_textures = render_stage["inputs"].GetArray();
-                            for ( uint32_t i = 0; i < input_textures.Size(); ++i ) {
-                                const auto& input_texture = input_textures[i];
-                                
-                                const Value& input_texture_name = input_texture["name"];
-                                const char* texture_cstring = render_pipeline_creation.string_buffer.append_use( input_texture_name.GetString());
-                                render_stage_creation.inputs[i] = string_hash_get( render_pipeline_creation.name_to_textures, texture_cstring);
+                    for ( uint32_t t = 0; t < render_stages.Size(); ++t ) {
+                        const auto& render_stage = render_stages[t];
 
-                                // Add to the lookups
-                                const char* binding_cstring = render_pipeline_creation.string_buffer.append_use( input_texture["binding"].GetString() );
-                                render_stage_creation.overriding_lookups.add_binding_to_resource((char*)binding_cstring, (char*)texture_cstring);
+                        RenderStageCreation render_stage_creation = {};
+                        const Value& name = render_stage["name"];
+                        strcpy_s( render_stage_creation.name, 32, name.GetString() );
 
-                                // TODO: Add sampling
-                            }
+                        // Material name and index - used for 'post process' effects.
+                        if ( render_stage.HasMember( "material_name" ) ) {
+                            strcpy_s( render_stage_creation.material_name, 32, render_stage["material_name"].GetString() );
+                        }
+                        else {
+                            render_stage_creation.material_name[0] = 0;
+                        }
 
-                            render_stage_creation.input_count = (uint32_t)input_textures.Size();
-
-                            // Get outputs
-                            const Value& output = render_stage["outputs"];
-                            // Standard output used for all non-compute stages
-                            if ( output.HasMember("rts") ) {
-                                const Value::ConstArray& output_rts = output["rts"].GetArray();
-                                for ( uint32_t i = 0; i < output_rts.Size(); ++i ) {
-                                    const char* texture_cstring = output_rts[i].GetString();
-                                    render_stage_creation.outputs[i] = string_hash_get( render_pipeline_creation.name_to_textures, texture_cstring );
-                                }
-                                render_stage_creation.output_count = (uint32_t)output_rts.Size();
-                            }
-                            else if ( output.HasMember( "images" ) ) {
-                                const Value::ConstArray& output_rts = output["images"].GetArray();
-                                for ( uint32_t i = 0; i < output_rts.Size(); ++i ) {
+                        if ( render_stage.HasMember( "material_pass_index" ) ) {
+                            render_stage_creation.material_pass_index = (uint8_t)render_stage["material_pass_index"].GetInt();
+                        }
+                        else {
+                            render_stage_creation.material_pass_index = 0;
+                        }
 
-                                    const auto& output_image = output_rts[i];
+                        const Value& type = render_stage["type"];
+                        const char* type_string = type.GetString();
+                        if ( strcmp(type_string, "Geometry" ) == 0 ) {
+                            render_stage_creation.stage_type = (uint8_t)hydra::graphics::RenderStage::Geometry;
+                        }
+                        else if ( strcmp( type_string, "Post" ) == 0 ) {
+                            render_stage_creation.stage_type = (uint8_t)hydra::graphics::RenderStage::Post;
+                        }
+                        else if ( strcmp( type_string, "PostCompute" ) == 0 ) {
+                            render_stage_creation.stage_type = (uint8_t)hydra::graphics::RenderStage::PostCompute;
+                        }
+                        else {
+                            render_stage_creation.stage_type = (uint8_t)hydra::graphics::RenderStage::Swapchain;
+                        }
 
-                                    const Value& output_texture_name = output_image["name"];
-                                    const char* texture_cstring = render_pipeline_creation.string_buffer.append_use( output_texture_name.GetString() );
-                                    render_stage_creation.outputs[i] = string_hash_get( render_pipeline_creation.name_to_textures, texture_cstring );
+                        if ( render_stage.HasMember( "render_view" ) ) {
+                            strcpy_s( render_stage_creation.render_view_name, 32, render_stage["render_view"].GetString() );
+                        }
+                        else {
+                            render_stage_creation.render_view_name[0] = 0;
+                        }
 
-                                    // Add to the lookups
-                                    const char* binding_cstring = render_pipeline_creation.string_buffer.append_use( output_image["binding"].GetString() );
-                                    render_stage_creation.overriding_lookups.add_binding_to_resource( (char*)binding_cstring, (char*)texture_cstring );
-                                }
+                        render_stage_creation.overriding_lookups.init();
 
-                                render_stage_creation.output_count = (uint32_t)output_rts.Size();
-                            }
+                        // Get inputs
+                        const Value::ConstArray& input_textures = render_stage["inputs"].GetArray();
+                        for ( uint32_t i = 0; i < input_textures.Size(); ++i ) {
+                            const auto& input_texture = input_textures[i];
                             
+                            const Value& input_texture_name = input_texture["name"];
+                            const char* texture_cstring = render_pipeline_creation.string_buffer.append_use( input_texture_name.GetString());
+                            render_stage_creation.inputs[i] = string_hash_get( render_pipeline_creation.name_to_textures, texture_cstring);
 
-                            if ( output.HasMember( "depth" ) ) {
-                                const char* texture_cstring = output["depth"].GetString();
-                                render_stage_creation.output_depth = string_hash_get( render_pipeline_creation.name_to_textures, texture_cstring );
-                            }
-                            else {
-                                render_stage_creation.output_depth = nullptr;
-                            }
+                            // Add to the lookups
+                            const char* binding_cstring = render_pipeline_creation.string_buffer.append_use( input_texture["binding"].GetString() );
+                            render_stage_creation.overriding_lookups.add_binding_to_resource((char*)binding_cstring, (char*)texture_cstring);
 
-                            if ( output.HasMember( "clear_color" ) ) {
-                                render_stage_creation.clear_rt = true;
-                                render_stage_creation.clear_color[0] = 0.0f;
-                                render_stage_creation.clear_color[1] = 0.0f;
-                                render_stage_creation.clear_color[2] = 0.0f;
-                                render_stage_creation.clear_color[3] = 0.0f;
-                            }
-                            else {
-                                render_stage_creation.clear_rt = false;
-                            }
+                            // TODO: Add sampling
+                        }
 
-                            if ( output.HasMember( "clear_depth" ) ) {
-                                render_stage_creation.clear_depth = true;
-                                render_stage_creation.clear_depth_value = output["clear_depth"].GetFloat();
-                            }
-                            else {
-                                render_stage_creation.clear_depth = false;
-                            }
+                        render_stage_creation.input_count = (uint32_t)input_textures.Size();
 
-                            if ( output.HasMember( "clear_stencil" ) ) {
-                                render_stage_creation.clear_stencil = true;
-                                render_stage_creation.clear_stencil_value = (uint8_t)output["clear_stencil"].GetUint();
+                        // Get outputs
+                        const Value& output = render_stage["outputs"];
+                        // Standard output used for all non-compute stages
+                        if ( output.HasMember("rts") ) {
+                            const Value::ConstArray& output_rts = output["rts"].GetArray();
+                            for ( uint32_t i = 0; i < output_rts.Size(); ++i ) {
+                                const char* texture_cstring = output_rts[i].GetString();
+                                render_stage_creation.outputs[i] = string_hash_get( render_pipeline_creation.name_to_textures, texture_cstring );
                             }
-                            else {
-                                render_stage_creation.clear_stencil = false;
+                            render_stage_creation.output_count = (uint32_t)output_rts.Size();
+                        }
+                        else if ( output.HasMember( "images" ) ) {
+                            const Value::ConstArray& output_rts = output["images"].GetArray();
+                            for ( uint32_t i = 0; i < output_rts.Size(); ++i ) {
+
+                                const auto& output_image = output_rts[i];
+
+                                const Value& output_texture_name = output_image["name"];
+                                const char* texture_cstring = render_pipeline_creation.string_buffer.append_use( output_texture_name.GetString() );
+                                render_stage_creation.outputs[i] = string_hash_get( render_pipeline_creation.name_to_textures, texture_cstring );
+
+                                // Add to the lookups
+                                const char* binding_cstring = render_pipeline_creation.string_buffer.append_use( output_image["binding"].GetString() );
+                                render_stage_creation.overriding_lookups.add_binding_to_resource( (char*)binding_cstring, (char*)texture_cstring );
                             }
 
-                            array_push( render_pipeline_creation.render_stages, render_stage_creation );
+                            render_stage_creation.output_count = (uint32_t)output_rts.Size();
+                        }
+                        
+
+                        if ( output.HasMember( "depth" ) ) {
+                            const char* texture_cstring = output["depth"].GetString();
+                            render_stage_creation.output_depth = string_hash_get( render_pipeline_creation.name_to_textures, texture_cstring );
+                        }
+                        else {
+                            render_stage_creation.output_depth = nullptr;
+                        }
+
+                        if ( output.HasMember( "clear_color" ) ) {
+                            render_stage_creation.clear_rt = true;
+                            render_stage_creation.clear_color[0] = 0.0f;
+                            render_stage_creation.clear_color[1] = 0.0f;
+                            render_stage_creation.clear_color[2] = 0.0f;
+                            render_stage_creation.clear_color[3] = 0.0f;
+                        }
+                        else {
+                            render_stage_creation.clear_rt = false;
                         }
-                    }
 
-                    // Check if render pipeline is valid and add it. It will be created only when used for the first time.
-                    if ( render_pipeline_creation.is_valid() ) {
-                        array_push( render_pipeline_creations, render_pipeline_creation );
+                        if ( output.HasMember( "clear_depth" ) ) {
+                            render_stage_creation.clear_depth = true;
+                            render_stage_creation.clear_depth_value = output["clear_depth"].GetFloat();
+                        }
+                        else {
+                            render_stage_creation.clear_depth = false;
+                        }
+
+                        if ( output.HasMember( "clear_stencil" ) ) {
+                            render_stage_creation.clear_stencil = true;
+                            render_stage_creation.clear_stencil_value = (uint8_t)output["clear_stencil"].GetUint();
+                        }
+                        else {
+                            render_stage_creation.clear_stencil = false;
+                        }
+
+                        array_push( render_pipeline_creation.render_stages, render_stage_creation );
                     }
                 }
+
+                // Check if render pipeline is valid and add it. It will be created only when used for the first time.
+                if ( render_pipeline_creation.is_valid() ) {
+                    array_push( out_creations, render_pipeline_creation );
+                }
             }
         }
+    }
+}
 
-        //free( file_memory );
+static uint16_t find_texture_index( const RenderPipelineCreation& creation, const RenderPipelineTextureCreation* texture ) {
+    if ( texture ) {
+        for ( uint32_t t = 0; t < string_hash_length( creation.name_to_textures ); ++t ) {
+            if ( creation.name_to_textures[t].value == texture ) {
+                return (uint16_t)t;
+            }
+        }
+    }
+    return k_render_pipelines_invalid_index;
+}
+
+//
+// Compile the JSON pipelines into a binary blob. Returns false if the source is missing or the output cannot be written.
+static bool compile_render_pipelines( const char* source_filename, const char* binary_filename, hydra::StringBuffer& temp_string_buffer ) {
+
+    char* file_memory = hydra::read_file_into_memory( source_filename, nullptr );
+    if ( !file_memory ) {
+        hydra::print_format( "Missing render pipelines source %s\n", source_filename );
+        return false;
+    }
+
+    RenderPipelineCreation* creations = nullptr;
+    parse_render_pipelines_json( file_memory, temp_string_buffer, creations );
+    hydra::hy_free( file_memory );
+
+    // Calculate blob layout
+    const uint32_t num_pipelines = (uint32_t)array_length( creations );
+    uint32_t total_size = align_blob_offset( sizeof( RenderPipelinesBlobHeader ) );
+    const uint32_t pipelines_offset = total_size;
+    total_size = align_blob_offset( total_size + sizeof( RenderPipelineBlob ) * num_pipelines );
+
+    for ( uint32_t p = 0; p < num_pipelines; ++p ) {
+        const RenderPipelineCreation& creation = creations[p];
+        total_size = align_blob_offset( total_size + sizeof( RenderPipelineTextureCreation ) * (uint32_t)string_hash_length( creation.name_to_textures ) );
+        total_size = align_blob_offset( total_size + sizeof( RenderStageBlob ) * (uint32_t)array_length( creation.render_stages ) );
+
+        for ( uint32_t s = 0; s < array_length( creation.render_stages ); ++s ) {
+            const uint32_t num_bindings = (uint32_t)string_hash_length( creation.render_stages[s].overriding_lookups.binding_to_resource );
+            total_size = align_blob_offset( total_size + sizeof( RenderStageBindingBlob ) * num_bindings );
+        }
+    }
+
+    char* blob_memory = (char*)hydra::hy_malloc( total_size );
+    memset( blob_memory, 0, total_size );
+
+    RenderPipelinesBlobHeader* header = (RenderPipelinesBlobHeader*)blob_memory;
+    header->magic = k_render_pipelines_blob_magic;
+    header->version = k_render_pipelines_blob_version;
+    header->source_write_time = hydra::get_last_write_time( source_filename );
+    header->num_pipelines = num_pipelines;
+    header->pipelines_offset = pipelines_offset;
+    header->total_size = total_size;
+
+    // Write pipelines
+    uint32_t current_offset = align_blob_offset( pipelines_offset + sizeof( RenderPipelineBlob ) * num_pipelines );
+    RenderPipelineBlob* pipeline_blobs = (RenderPipelineBlob*)( blob_memory + pipelines_offset );
+
+    for ( uint32_t p = 0; p < num_pipelines; ++p ) {
+        const RenderPipelineCreation& creation = creations[p];
+        RenderPipelineBlob& pipeline_blob = pipeline_blobs[p];
+
+        memcpy( pipeline_blob.name, creation.name, 32 );
+
+        // Textures are stored as they are, minus the pointers.
+        pipeline_blob.num_textures = (uint32_t)string_hash_length( creation.name_to_textures );
+        pipeline_blob.textures_offset = current_offset;
+
+        RenderPipelineTextureCreation* texture_blobs = (RenderPipelineTextureCreation*)( blob_memory + current_offset );
+        for ( uint32_t t = 0; t < pipeline_blob.num_textures; ++t ) {
+            texture_blobs[t] = *creation.name_to_textures[t].value;
+            texture_blobs[t].texture_creation.initial_data = nullptr;
+            texture_blobs[t].texture_creation.name = nullptr;
+        }
+        current_offset = align_blob_offset( current_offset + sizeof( RenderPipelineTextureCreation ) * pipeline_blob.num_textures );
+
+        // Stages reference textures by index.
+        pipeline_blob.num_stages = (uint32_t)array_length( creation.render_stages );
+        pipeline_blob.stages_offset = current_offset;
+
+        RenderStageBlob* stage_blobs = (RenderStageBlob*)( blob_memory + current_offset );
+        current_offset = align_blob_offset( current_offset + sizeof( RenderStageBlob ) * pipeline_blob.num_stages );
+
+        for ( uint32_t s = 0; s < pipeline_blob.num_stages; ++s ) {
+            const RenderStageCreation& stage = creation.render_stages[s];
+            RenderStageBlob& stage_blob = stage_blobs[s];
+
+            memcpy( stage_blob.name, stage.name, 32 );
+            memcpy( stage_blob.material_name, stage.material_name, 32 );
+            memcpy( stage_blob.render_view_name, stage.render_view_name, 32 );
+
+            stage_blob.input_count = (uint16_t)stage.input_count;
+            for ( uint32_t i = 0; i < stage.input_count; ++i ) {
+                stage_blob.inputs[i] = find_texture_index( creation, stage.inputs[i] );
+            }
+
+            stage_blob.output_count = (uint16_t)stage.output_count;
+            for ( uint32_t i = 0; i < stage.output_count; ++i ) {
+                stage_blob.outputs[i] = find_texture_index( creation, stage.outputs[i] );
+            }
+
+            stage_blob.output_depth = find_texture_index( creation, stage.output_depth );
+
+            memcpy( stage_blob.clear_color, stage.clear_color, sizeof( float ) * 4 );
+            stage_blob.clear_depth_value = stage.clear_depth_value;
+            stage_blob.clear_stencil_value = stage.clear_stencil_value;
+            stage_blob.clear_rt = stage.clear_rt;
+            stage_blob.clear_depth = stage.clear_depth;
+            stage_blob.clear_stencil = stage.clear_stencil;
+            stage_blob.stage_type = stage.stage_type;
+            stage_blob.material_pass_index = stage.material_pass_index;
+
+            // Overriding lookups
+            stage_blob.num_bindings = (uint16_t)string_hash_length( stage.overriding_lookups.binding_to_resource );
+            stage_blob.bindings_offset = current_offset;
+
+            RenderStageBindingBlob* binding_blobs = (RenderStageBindingBlob*)( blob_memory + current_offset );
+            for ( uint32_t b = 0; b < stage_blob.num_bindings; ++b ) {
+                const hydra::graphics::ShaderResourcesLookup::NameMap& binding_entry = stage.overriding_lookups.binding_to_resource[b];
+                strcpy_s( binding_blobs[b].binding, 32, binding_entry.key );
+                strcpy_s( binding_blobs[b].resource, 32, binding_entry.value );
+            }
+            current_offset = align_blob_offset( current_offset + sizeof( RenderStageBindingBlob ) * stage_blob.num_bindings );
+        }
+    }
+
+    FILE* output_file = nullptr;
+    fopen_s( &output_file, binary_filename, "wb" );
+    if ( output_file ) {
+        fwrite( blob_memory, total_size, 1, output_file );
+        fclose( output_file );
+    }
+    else {
+        hydra::print_format( "Cannot write compiled render pipelines %s\n", binary_filename );
+    }
+
+    // Free the parsed creations, only the blob is used at runtime.
+    for ( uint32_t p = 0; p < num_pipelines; ++p ) {
+        creations[p].terminate();
+    }
+    array_free( creations );
+    hydra::hy_free( blob_memory );
+
+    return output_file != nullptr;
+}
+
+//
+// Check magic, version and the source write time. A missing source keeps the binary valid.
+static bool render_pipelines_blob_is_current( const char* blob_memory, size_t blob_size, const char* source_filename ) {
+    if ( !blob_memory || blob_size < sizeof( RenderPipelinesBlobHeader ) ) {
+        return false;
+    }
+
+    const RenderPipelinesBlobHeader* header = (const RenderPipelinesBlobHeader*)blob_memory;
+    if ( header->magic != k_render_pipelines_blob_magic || header->version != k_render_pipelines_blob_version || header->total_size != blob_size ) {
+        return false;
+    }
+
+    hydra::FileTime source_write_time = hydra::get_last_write_time( source_filename );
+    hydra::FileTime missing_source_time = {};
+    if ( memcmp( &source_write_time, &missing_source_time, sizeof( hydra::FileTime ) ) == 0 ) {
+        return true;
+    }
+
+    return memcmp( &source_write_time, &header->source_write_time, sizeof( hydra::FileTime ) ) == 0;
+}
+
+//
+// Build the creations pointing directly into the blob memory: no parsing and no string copies.
+static void load_render_pipelines_blob( char* blob_memory, RenderPipelineCreation*& out_creations ) {
+
+    const RenderPipelinesBlobHeader* header = (const RenderPipelinesBlobHeader*)blob_memory;
+    const RenderPipelineBlob* pipeline_blobs = (const RenderPipelineBlob*)( blob_memory + header->pipelines_offset );
+
+    for ( uint32_t p = 0; p < header->num_pipelines; ++p ) {
+        const RenderPipelineBlob& pipeline_blob = pipeline_blobs[p];
+
+        RenderPipelineCreation render_pipeline_creation;
+        render_pipeline_creation.init();
+        render_pipeline_creation.owns_textures = false;
+        memcpy( render_pipeline_creation.name, pipeline_blob.name, 32 );
+
+        RenderPipelineTextureCreation* textures = (RenderPipelineTextureCreation*)( blob_memory + pipeline_blob.textures_offset );
+        for ( uint32_t t = 0; t < pipeline_blob.num_textures; ++t ) {
+            string_hash_put( render_pipeline_creation.name_to_textures, textures[t].name, &textures[t] );
+        }
+
+        const RenderStageBlob* stage_blobs = (const RenderStageBlob*)( blob_memory + pipeline_blob.stages_offset );
+        for ( uint32_t s = 0; s < pipeline_blob.num_stages; ++s ) {
+            const RenderStageBlob& stage_blob = stage_blobs[s];
+
+            RenderStageCreation render_stage_creation = {};
+            memcpy( render_stage_creation.name, stage_blob.name, 32 );
+            memcpy( render_stage_creation.material_name, stage_blob.material_name, 32 );
+            memcpy( render_stage_creation.render_view_name, stage_blob.render_view_name, 32 );
+
+            render_stage_creation.input_count = stage_blob.input_count;
+            for ( uint32_t i = 0; i < stage_blob.input_count; ++i ) {
+                render_stage_creation.inputs[i] = stage_blob.inputs[i] != k_render_pipelines_invalid_index ? &textures[stage_blob.inputs[i]] : nullptr;
+            }
+
+            render_stage_creation.output_count = stage_blob.output_count;
+            for ( uint32_t i = 0; i < stage_blob.output_count; ++i ) {
+                render_stage_creation.outputs[i] = stage_blob.outputs[i] != k_render_pipelines_invalid_index ? &textures[stage_blob.outputs[i]] : nullptr;
+            }
+
+            render_stage_creation.output_depth = stage_blob.output_depth != k_render_pipelines_invalid_index ? &textures[stage_blob.output_depth] : nullptr;
+
+            memcpy( render_stage_creation.clear_color, stage_blob.clear_color, sizeof( float ) * 4 );
+            render_stage_creation.clear_depth_value = stage_blob.clear_depth_value;
+            render_stage_creation.clear_stencil_value = stage_blob.clear_stencil_value;
+            render_stage_creation.clear_rt = stage_blob.clear_rt;
+            render_stage_creation.clear_depth = stage_blob.clear_depth;
+            render_stage_creation.clear_stencil = stage_blob.clear_stencil;
+            render_stage_creation.stage_type = stage_blob.stage_type;
+            render_stage_creation.material_pass_index = stage_blob.material_pass_index;
+
+            // Binding and resource names are referenced from the blob.
+            render_stage_creation.overriding_lookups.init();
+            RenderStageBindingBlob* binding_blobs = (RenderStageBindingBlob*)( blob_memory + stage_blob.bindings_offset );
+            for ( uint32_t b = 0; b < stage_blob.num_bindings; ++b ) {
+                render_stage_creation.overriding_lookups.add_binding_to_resource( binding_blobs[b].binding, binding_blobs[b].resource );
+            }
+
+            array_push( render_pipeline_creation.render_stages, render_stage_creation );
+        }
+
+        if ( render_pipeline_creation.is_valid() ) {
+            array_push( out_creations, render_pipeline_creation );
+        }
+    }
+}
+
+void RenderPipelineManager::init( hydra::graphics::Device& device, hydra::StringBuffer& temp_string_buffer ) {
+    
+    render_pipeline_creations = nullptr;
+
+    // Load compiled pipelines, recompiling them if the source JSON changed.
+    const char* source_full_filename = temp_string_buffer.append_use( "..\\data\\source\\RenderPipelines.json" );
+    const char* binary_full_filename = temp_string_buffer.append_use( "..\\data\\bin\\RenderPipelines.brp" );
+
+    size_t blob_size = 0;
+    render_pipelines_blob = hydra::read_file_into_memory( binary_full_filename, &blob_size );
+
+    if ( !render_pipelines_blob_is_current( render_pipelines_blob, blob_size, source_full_filename ) ) {
+        if ( render_pipelines_blob ) {
+            hydra::hy_free( render_pipelines_blob );
+            render_pipelines_blob = nullptr;
+        }
+
+        if ( compile_render_pipelines( source_full_filename, binary_full_filename, temp_string_buffer ) ) {
+            render_pipelines_blob = hydra::read_file_into_memory( binary_full_filename, &blob_size );
+        }
+    }
+
+    if ( render_pipelines_blob && render_pipelines_blob_is_current( render_pipelines_blob, blob_size, source_full_filename ) ) {
+        load_render_pipelines_blob( render_pipelines_blob, render_pipeline_creations );
     }
 
     current_render_pipeline = nullptr;
@@ -1161,6 +1494,15 @@ void RenderPipelineManager::init( hydra::graphics::Device& device, hydra::String
 
 void RenderPipelineManager::terminate() {
 
+    for ( uint32_t p = 0; p < array_length( render_pipeline_creations ); ++p ) {
+        render_pipeline_creations[p].terminate();
+    }
+    array_free( render_pipeline_creations );
+
+    if ( render_pipelines_blob ) {
+        hydra::hy_free( render_pipelines_blob );
+        render_pipelines_blob = nullptr;
+    }
 }
 
 void RenderPipelineManager::set_pipeline( hydra::graphics::Device& device, const char* name, hydra::StringBuffer& temp_string_buffer,
@@ -60,6 +60,7 @@ struct RenderPipelineCreation {
     TextureMap*                     name_to_textures;
 
     char                            name[32];
+    bool                            owns_textures;          // False when textures point into a compiled pipelines blob.
 
 }; // struct RenderPipelineCreation
 
@@ -73,6 +74,7 @@ struct RenderPipelineManager {
 
     hydra::graphics::PipelineMap*   name_to_render_pipeline     = nullptr;
     RenderPipelineCreation*         render_pipeline_creations   = nullptr;
+    char*                           render_pipelines_blob       = nullptr;  // Compiled RenderPipelines, creations reference it directly.
     hydra::graphics::RenderViewMap* name_to_render_view         = nullptr;
 
     hydra::graphics::RenderPipeline* current_render_pipeline    = nullptr;
@@ -4,6 +4,8 @@
 #include "kernel/memory.hpp"
 #include "kernel/log.hpp"
 #include "kernel/time.hpp"
+#include "kernel/string_id.hpp"
+#include "kernel/profiler.hpp"
 
 #include "application/window.hpp"
 #include "application/hydra_input.hpp"
@@ -38,6 +40,19 @@ void GameApplication::create( const hydra::ApplicationConfiguration& configurati
 
     time_service_init();
 
+    // Asynchronous log: services and worker threads can print from any thread.
+    LogConfiguration log_configuration;
+    log_configuration.allocator = &MemoryService::instance()->system_allocator;
+    LogService::instance()->init( &log_configuration );
+
+    StringIdService::instance()->init( &MemoryService::instance()->system_allocator );
+    frame_marker = string_id_intern( "Frame" );
+
+    CPUProfilerConfiguration profiler_configuration;
+    profiler_configuration.allocator = &MemoryService::instance()->system_allocator;
+    CPUProfiler::instance()->init( &profiler_configuration );
+    CPUProfiler::instance()->set_thread_name( "Main" );
+
     service_manager = ServiceManager::instance;
     service_manager->init( &MemoryService::instance()->system_allocator );
 
@@ -54,7 +69,7 @@ void GameApplication::create( const hydra::ApplicationConfiguration& configurati
 
     // graphics
     hydra::gfx::DeviceCreation dc;
-    dc.set_window( window->width, window->height, window->platform_handle ).set_allocator( &MemoryService::instance()->system_allocator );
+    dc.set_window( window->width, window->height, window->platform_handle ).set_allocator( &MemoryService::instance()->system_allocator ).set_pipeline_cache_path( "pipeline_cache.bin" );
 
     hydra::gfx::Device* gpu = service_manager->get<hydra::gfx::Device>();
     gpu->init( dc );
@@ -90,6 +105,12 @@ void GameApplication::destroy() {
 
     time_service_shutdown();
 
+    CPUProfiler::instance()->shutdown();
+    StringIdService::instance()->shutdown();
+
+    // Flush and stop the asynchronous log, if enabled.
+    LogService::instance()->shutdown();
+
     service_manager->shutdown();
 
     hydra::MemoryService::instance()->shutdown();
@@ -125,8 +146,8 @@ bool GameApplication::main_loop() {
             // Draw debug UIs
             hydra::MemoryService::instance()->imgui_draw();
 
-            hydra::gfx::CommandBuffer* gpu_commands = renderer->get_command_buffer( hydra::gfx::QueueType::Graphics, true );
-            gpu_commands->push_marker( "Frame" );
+            hydra::gfx::CommandBuffer* gpu_commands = renderer->get_command_buffer( 0, hydra::gfx::QueueType::Graphics, true );
+            gpu_commands->push_marker( frame_marker );
 
             const f32 interpolation_factor = glm_clamp( (f32)(accumulator / step), 0.0f, 1.0f );
             render( interpolation_factor );
@@ -164,6 +185,9 @@ void GameApplication::render( f32 interpolation ) {
 }
 
 void GameApplication::handle_begin_frame() {
+    // Collect the scopes of the previous frame.
+    CPUProfiler::instance()->new_frame();
+
     // New frame
     if ( !window->minimized ) {
         renderer->begin_frame();
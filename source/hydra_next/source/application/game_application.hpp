@@ -53,6 +53,8 @@ namespace hydra {
         f32                         delta_time      = 0.0f;
         i64                         begin_frame_tick = 0;
 
+        StringId                    frame_marker;
+
         hydra::Window*              window          = nullptr;
 
         hydra::InputService*        input           = nullptr;
@@ -4,6 +4,7 @@
 
 #include "kernel/hash_map.hpp"
 #include "kernel/memory.hpp"
+#include "kernel/thread.hpp"
 
 #include "graphics/gpu_device.hpp"
 #include "graphics/command_buffer.hpp"
@@ -23,6 +24,7 @@ static hydra::gfx::BufferHandle g_vb, g_ib;
 static hydra::gfx::BufferHandle g_ui_cb;
 static hydra::gfx::ResourceLayoutHandle g_resource_layout;
 static hydra::gfx::ResourceListHandle g_ui_resource_list;  // Font resource list
+static hydra::StringId g_imgui_marker;
 
 static uint32_t g_vb_size = 665536, g_ib_size = 665536;
 
@@ -207,6 +209,8 @@ void ImGuiService::init( void* configuration ) {
     gfx = (hydra::gfx::Renderer*)configuration;
     hydra::gfx::Device* gpu = gfx->gpu;
 
+    g_imgui_marker = hydra::string_id_intern( "ImGUI" );
+
     ImGuiIO& io = ImGui::GetIO();
     io.BackendRendererName = "Hydra_ImGui";
     io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
@@ -429,7 +433,7 @@ void ImGuiService::render( hydra::gfx::Renderer* renderer, hydra::gfx::CommandBu
     }
 
     // TODO_KS: Add the sorting.
-    commands.push_marker( "ImGUI" );
+    commands.push_marker( g_imgui_marker );
 
     // todo: key
     uint64_t sort_key = 0;// hydra::gfx::SortKey::get_key( 254 );
@@ -517,17 +521,13 @@ void ImGuiService::render( hydra::gfx::Renderer* renderer, hydra::gfx::CommandBu
                             last_texture = new_texture;
                             FlatHashMapIterator it = g_texture_to_resource_list.find( last_texture.index );
 
-                            // TODO: invalidate handles and update resource list when needed ?
-                            // Found this problem when reusing the handle from a previous 
-                            // If not present
+                            // Textures other than the cached ones use a transient resource list, recreated each frame,
+                            // so it never references a destroyed texture whose handle was reused.
                             if ( it.is_invalid() ) {
-                                // Create new resource list
                                 ResourceListCreation rl_creation{};
 
                                 rl_creation.set_layout( g_resource_layout ).buffer( g_ui_cb, 0 ).texture( last_texture, 1 ).set_name( "RL_Dynamic_ImGUI" );
-                                last_resource_list = gpu.create_resource_list( rl_creation );
-
-                                g_texture_to_resource_list.insert( new_texture.index, last_resource_list.index );
+                                last_resource_list = gpu.create_resource_list_transient( rl_creation );
                             }
                             else {
                                 last_resource_list.index = g_texture_to_resource_list.get( it );
@@ -1134,22 +1134,27 @@ struct ExampleAppLog {
 
 static ExampleAppLog        s_imgui_log;
 static bool                 s_imgui_log_open = true;
+static Mutex                s_imgui_log_mutex;      // Asynchronous log calls the callback from its own thread.
 
 static void imgui_print( const char* text ) {
+    ScopedLock lock( s_imgui_log_mutex );
     s_imgui_log.AddLog( "%s", text );
 }
 
 void imgui_log_init() {
 
+    s_imgui_log_mutex.init();
     LogService::instance()->set_callback( &imgui_print );
 }
 
 void imgui_log_shutdown() {
 
+    LogService::instance()->flush();
     LogService::instance()->set_callback( nullptr );
 }
 
 void imgui_log_draw() {
+    ScopedLock lock( s_imgui_log_mutex );
     s_imgui_log.Draw( "Log", &s_imgui_log_open );
 }
 
@@ -3,18 +3,176 @@
 
 #if defined(HYDRA_VULKAN)
 #include "graphics/gpu_device_vulkan.hpp"
+#elif defined(HYDRA_NULL)
+#include "graphics/gpu_device_null.hpp"
+#include "kernel/log.hpp"
 #endif // HYDRA_VULKAN
 
+#include <string.h>
+
 namespace hydra {
 namespace gfx {
 
+// Deferred commands ////////////////////////////////////////////////////////////
+
+//
+// Header of each command in DeferredCommandStream::data, followed by the arguments.
+struct DeferredCommandHeader {
+
+    u8                              type;       // DeferredCommandType
+    u8                              padding[ 3 ];
+    u32                             size;
+
+}; // struct DeferredCommandHeader
+
+// Arguments of the deferred commands. Buffers inside a global dynamic buffer store the parent buffer
+// and offset they had when recorded, as both change every time they are mapped (ring or overflow page).
+static const u32                    k_no_global_offset = u32_max;
+
+struct DeferredBindVertexBuffer {
+    BufferHandle                    handle;
+    u32                             binding;
+    u32                             offset;
+    u32                             global_offset;
+    BufferHandle                    parent_buffer;
+}; // struct DeferredBindVertexBuffer
+
+struct DeferredBindIndexBuffer {
+    BufferHandle                    handle;
+    u32                             global_offset;
+    BufferHandle                    parent_buffer;
+}; // struct DeferredBindIndexBuffer
+
+struct DeferredBindResourceList {
+    ResourceListHandle              handles[ k_max_resource_layouts ];
+    u32                             offsets[ k_max_resource_layouts ];
+    u32                             num_lists;
+    u32                             num_offsets;
+}; // struct DeferredBindResourceList
+
+struct DeferredSetViewport {
+    Viewport                        viewport;
+    u32                             use_default;
+}; // struct DeferredSetViewport
+
+struct DeferredSetScissor {
+    Rect2DInt                       rect;
+    u32                             use_default;
+}; // struct DeferredSetScissor
+
+struct DeferredDraw {
+    TopologyType::Enum              topology;
+    u32                             first_vertex;
+    u32                             vertex_count;
+    u32                             first_instance;
+    u32                             instance_count;
+}; // struct DeferredDraw
+
+struct DeferredDrawIndexed {
+    TopologyType::Enum              topology;
+    u32                             index_count;
+    u32                             instance_count;
+    u32                             first_index;
+    i32                             vertex_offset;
+    u32                             first_instance;
+}; // struct DeferredDrawIndexed
+
+struct DeferredIndirect {
+    BufferHandle                    handle;
+    u32                             offset;
+    u32                             stride;
+}; // struct DeferredIndirect
+
+struct DeferredFillBuffer {
+    BufferHandle                    handle;
+    u32                             offset;
+    u32                             size;
+    u32                             data;
+}; // struct DeferredFillBuffer
+
+template <typename T>
+static void deferred_write( DeferredCommandStream* stream, u64 sort_key, DeferredCommandType::Enum type, const T& arguments ) {
+    memcpy( stream->write( sort_key, type, sizeof( T ) ), &arguments, sizeof( T ) );
+}
+
+// Commands without a sort key keep the one of the previous command.
+template <typename T>
+static void deferred_write_unkeyed( DeferredCommandStream* stream, DeferredCommandType::Enum type, const T& arguments ) {
+    deferred_write( stream, stream->last_sort_key, type, arguments );
+}
+
+static u32 deferred_global_offset( Device* device, BufferHandle handle ) {
+    const BufferAPIGnostic* buffer = device->access_buffer( handle );
+    return buffer->parent_buffer.index != k_invalid_index ? buffer->global_offset : k_no_global_offset;
+}
+
+//
+// Buffer that is actually bound: the handle itself, or the ring or overflow page a dynamic buffer was last mapped in.
+static BufferHandle bound_buffer_handle( Device* device, BufferHandle handle ) {
+    const BufferAPIGnostic* buffer = device->access_buffer( handle );
+    return buffer->parent_buffer.index != k_invalid_index ? buffer->parent_buffer : handle;
+}
+
+//
+// Deferred recording of the commands, shared by the backends.
+static void deferred_bind_vertex_buffer( CommandBuffer* command_buffer, u64 sort_key, BufferHandle handle, u32 binding, u32 offset ) {
+    Device* device = command_buffer->device;
+    const DeferredBindVertexBuffer arguments{ handle, binding, offset, deferred_global_offset( device, handle ), device->access_buffer( handle )->parent_buffer };
+    deferred_write( command_buffer->deferred_commands, sort_key, DeferredCommandType::BindVertexBuffer, arguments );
+}
+
+static void deferred_bind_index_buffer( CommandBuffer* command_buffer, u64 sort_key, BufferHandle handle ) {
+    Device* device = command_buffer->device;
+    const DeferredBindIndexBuffer arguments{ handle, deferred_global_offset( device, handle ), device->access_buffer( handle )->parent_buffer };
+    deferred_write( command_buffer->deferred_commands, sort_key, DeferredCommandType::BindIndexBuffer, arguments );
+}
+
+static void deferred_bind_resource_list( CommandBuffer* command_buffer, u64 sort_key, ResourceListHandle* handles, u32 num_lists, u32* offsets, u32 num_offsets ) {
+    hy_assert( num_lists <= k_max_resource_layouts && num_offsets <= k_max_resource_layouts );
+
+    DeferredBindResourceList arguments;
+    memset( &arguments, 0, sizeof( DeferredBindResourceList ) );
+    memcpy( arguments.handles, handles, sizeof( ResourceListHandle ) * num_lists );
+    if ( num_offsets ) {
+        memcpy( arguments.offsets, offsets, sizeof( u32 ) * num_offsets );
+    }
+    arguments.num_lists = num_lists;
+    arguments.num_offsets = num_offsets;
+
+    deferred_write( command_buffer->deferred_commands, sort_key, DeferredCommandType::BindResourceList, arguments );
+}
+
+static void deferred_set_viewport( CommandBuffer* command_buffer, u64 sort_key, const Viewport* viewport ) {
+    DeferredSetViewport arguments;
+    arguments.use_default = viewport == nullptr;
+    if ( viewport ) {
+        arguments.viewport = *viewport;
+    }
+    deferred_write( command_buffer->deferred_commands, sort_key, DeferredCommandType::SetViewport, arguments );
+}
+
+static void deferred_set_scissor( CommandBuffer* command_buffer, u64 sort_key, const Rect2DInt* rect ) {
+    DeferredSetScissor arguments;
+    arguments.use_default = rect == nullptr;
+    if ( rect ) {
+        arguments.rect = *rect;
+    }
+    deferred_write( command_buffer->deferred_commands, sort_key, DeferredCommandType::SetScissor, arguments );
+}
+
+#if defined(HYDRA_VULKAN)
 
 void CommandBuffer::reset() {
     
     is_recording = false;
+    pipeline_pending = false;
     current_render_pass = nullptr;
     current_pipeline = nullptr;
     current_command = 0;
+    deferred_commands = nullptr;
+
+    reset_bound_state();
+    bind_stats.reset();
 }
 
 
@@ -32,7 +190,12 @@ void CommandBuffer::terminate() {
 }
 
 void CommandBuffer::bind_pass( u64 sort_key, RenderPassHandle handle_ ) {
-    
+
+    if ( deferred_commands ) {
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::BindPass, handle_ );
+        return;
+    }
+
     //if ( !is_recording ) 
     {
         is_recording = true;
@@ -65,8 +228,29 @@ void CommandBuffer::bind_pass( u64 sort_key, RenderPassHandle handle_ ) {
 }
 
 void CommandBuffer::bind_pipeline( u64 sort_key, PipelineHandle handle_ ) {
-    
+
+    if ( deferred_commands ) {
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::BindPipeline, handle_ );
+        return;
+    }
+
     PipelineVulkan* pipeline = device->access_pipeline( handle_ );
+    if ( !device->is_pipeline_ready( handle_ ) ) {
+        // Keep the pipeline for its layout, resource lists can still be bound.
+        bound_pipeline = k_invalid_pipeline;
+        num_bound_resource_lists = 0;
+        current_pipeline = pipeline;
+        pipeline_pending = true;
+
+        ++bind_stats.pending_pipelines;
+        return;
+    }
+
+    pipeline_pending = false;
+    if ( is_pipeline_bound( handle_ ) ) {
+        return;
+    }
+
     vkCmdBindPipeline( vk_command_buffer, pipeline->vk_bind_point, pipeline->vk_pipeline );
     
     // Cache pipeline
@@ -74,7 +258,12 @@ void CommandBuffer::bind_pipeline( u64 sort_key, PipelineHandle handle_ ) {
 }
 
 void CommandBuffer::bind_vertex_buffer( u64 sort_key, BufferHandle handle_, u32 binding, u32 offset ) {
-    
+
+    if ( deferred_commands ) {
+        deferred_bind_vertex_buffer( this, sort_key, handle_, binding, offset );
+        return;
+    }
+
     BufferVulkan* buffer = device->access_buffer( handle_ );
     VkDeviceSize offsets[] = { offset };
 
@@ -85,12 +274,21 @@ void CommandBuffer::bind_vertex_buffer( u64 sort_key, BufferHandle handle_, u32
         vk_buffer = parent_buffer->vk_buffer;
         offsets[ 0 ] = buffer->global_offset;
     }
+
+    if ( is_vertex_buffer_bound( bound_buffer_handle( device, handle_ ), binding, ( u32 )offsets[ 0 ] ) ) {
+        return;
+    }
     
     vkCmdBindVertexBuffers( vk_command_buffer, binding, 1, &vk_buffer, offsets );
 }
 
 void CommandBuffer::bind_index_buffer( u64 sort_key, BufferHandle handle_ ) {
-    
+
+    if ( deferred_commands ) {
+        deferred_bind_index_buffer( this, sort_key, handle_ );
+        return;
+    }
+
     BufferVulkan* buffer = device->access_buffer( handle_ );
 
     VkBuffer vk_buffer = buffer->vk_buffer;
@@ -100,19 +298,31 @@ void CommandBuffer::bind_index_buffer( u64 sort_key, BufferHandle handle_ ) {
         vk_buffer = parent_buffer->vk_buffer;
         offset = buffer->global_offset;
     }
+
+    if ( is_index_buffer_bound( bound_buffer_handle( device, handle_ ), ( u32 )offset ) ) {
+        return;
+    }
+
     vkCmdBindIndexBuffer( vk_command_buffer, vk_buffer, offset, VkIndexType::VK_INDEX_TYPE_UINT16 );
 }
 
 void CommandBuffer::bind_resource_list( u64 sort_key, ResourceListHandle* handles, u32 num_lists, u32* offsets, u32 num_offsets ) {
 
-    // TODO:
+    // Dynamic offsets are searched in the lists unless given. Deferred commands give the ones read when recorded.
     u32 offsets_cache[ 8 ];
-    num_offsets = 0;
+    const bool search_offsets = num_offsets == 0;
+    if ( !search_offsets ) {
+        memcpy( offsets_cache, offsets, sizeof( u32 ) * num_offsets );
+    }
 
     for ( u32 l = 0; l < num_lists; ++l ) {
         ResourceListVulkan* resource_list = device->access_resource_list( handles[l] );
         vk_descriptor_sets[l] = resource_list->vk_descriptor_set;
 
+        if ( !search_offsets ) {
+            continue;
+        }
+
         // Search for dynamic buffers
         const ResourceLayoutVulkan* resource_layout = resource_list->layout;
         for ( u32 i = 0; i < resource_layout->num_bindings; ++i ) {
@@ -129,6 +339,15 @@ void CommandBuffer::bind_resource_list( u64 sort_key, ResourceListHandle* handle
         }
     }
     
+    if ( deferred_commands ) {
+        deferred_bind_resource_list( this, sort_key, handles, num_lists, offsets_cache, num_offsets );
+        return;
+    }
+
+    if ( is_resource_list_bound( handles, num_lists, offsets_cache, num_offsets ) ) {
+        return;
+    }
+
     const u32 k_first_set = 0;
     vkCmdBindDescriptorSets( vk_command_buffer, current_pipeline->vk_bind_point, current_pipeline->vk_pipeline_layout, k_first_set,
                              num_lists, vk_descriptor_sets, num_offsets, offsets_cache );
@@ -142,6 +361,11 @@ void CommandBuffer::bind_resource_list( u64 sort_key, ResourceListHandle* handle
 
 void CommandBuffer::set_viewport( u64 sort_key, const Viewport* viewport ) {
 
+    if ( deferred_commands ) {
+        deferred_set_viewport( this, sort_key, viewport );
+        return;
+    }
+
     VkViewport vk_viewport;
 
     if ( viewport ) {
@@ -177,6 +401,11 @@ void CommandBuffer::set_viewport( u64 sort_key, const Viewport* viewport ) {
 
 void CommandBuffer::set_scissor( u64 sort_key, const Rect2DInt* rect ) {
 
+    if ( deferred_commands ) {
+        deferred_set_scissor( this, sort_key, rect );
+        return;
+    }
+
     VkRect2D vk_scissor;
 
     if ( rect ) {
@@ -196,28 +425,86 @@ void CommandBuffer::set_scissor( u64 sort_key, const Rect2DInt* rect ) {
 }
 
 void CommandBuffer::clear( u64 sort_key, f32 red, f32 green, f32 blue, f32 alpha ) {
+
+    if ( deferred_commands ) {
+        const f32 arguments[] = { red, green, blue, alpha };
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::Clear, arguments );
+        return;
+    }
+
     clears[0].color = { red, green, blue, alpha };
 }
 
 void CommandBuffer::clear_depth_stencil( u64 sort_key, f32 depth, u8 value ) {
+
+    if ( deferred_commands ) {
+        const f32 arguments[] = { depth, ( f32 )value };
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::ClearDepthStencil, arguments );
+        return;
+    }
+
     clears[1].depthStencil.depth = depth;
     clears[1].depthStencil.stencil = value;
 }
 
 void CommandBuffer::draw( u64 sort_key, TopologyType::Enum topology, u32 first_vertex, u32 vertex_count, u32 first_instance, u32 instance_count ) {
+
+    if ( deferred_commands ) {
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::Draw, DeferredDraw{ topology, first_vertex, vertex_count, first_instance, instance_count } );
+        return;
+    }
+
+    if ( pipeline_pending ) {
+        ++bind_stats.skipped_draws;
+        return;
+    }
+
     vkCmdDraw( vk_command_buffer, vertex_count, instance_count, first_vertex, first_instance );
 }
 
 void CommandBuffer::draw_indexed( u64 sort_key, TopologyType::Enum topology, u32 index_count, u32 instance_count, u32 first_index, i32 vertex_offset, u32 first_instance ) {
+
+    if ( deferred_commands ) {
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::DrawIndexed, DeferredDrawIndexed{ topology, index_count, instance_count, first_index, vertex_offset, first_instance } );
+        return;
+    }
+
+    if ( pipeline_pending ) {
+        ++bind_stats.skipped_draws;
+        return;
+    }
+
     vkCmdDrawIndexed( vk_command_buffer, index_count, instance_count, first_index, vertex_offset, first_instance );
 }
 
 void CommandBuffer::dispatch( u64 sort_key, u32 group_x, u32 group_y, u32 group_z ) {
+
+    if ( deferred_commands ) {
+        const u32 arguments[] = { group_x, group_y, group_z };
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::Dispatch, arguments );
+        return;
+    }
+
+    if ( pipeline_pending ) {
+        ++bind_stats.skipped_draws;
+        return;
+    }
+
     vkCmdDispatch( vk_command_buffer, group_x, group_y, group_z );
 }
 
 void CommandBuffer::draw_indirect( u64 sort_key, BufferHandle buffer_handle, u32 offset, u32 stride ) {
 
+    if ( deferred_commands ) {
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::DrawIndirect, DeferredIndirect{ buffer_handle, offset, stride } );
+        return;
+    }
+
+    if ( pipeline_pending ) {
+        ++bind_stats.skipped_draws;
+        return;
+    }
+
     BufferVulkan* buffer = device->access_buffer( buffer_handle );
 
     VkBuffer vk_buffer = buffer->vk_buffer;
@@ -227,6 +514,17 @@ void CommandBuffer::draw_indirect( u64 sort_key, BufferHandle buffer_handle, u32
 }
 
 void CommandBuffer::draw_indexed_indirect( u64 sort_key, BufferHandle buffer_handle, u32 offset, u32 stride ) {
+
+    if ( deferred_commands ) {
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::DrawIndexedIndirect, DeferredIndirect{ buffer_handle, offset, stride } );
+        return;
+    }
+
+    if ( pipeline_pending ) {
+        ++bind_stats.skipped_draws;
+        return;
+    }
+
     BufferVulkan* buffer = device->access_buffer( buffer_handle );
 
     VkBuffer vk_buffer = buffer->vk_buffer;
@@ -236,6 +534,17 @@ void CommandBuffer::draw_indexed_indirect( u64 sort_key, BufferHandle buffer_han
 }
 
 void CommandBuffer::dispatch_indirect( u64 sort_key, BufferHandle buffer_handle, u32 offset ) {
+
+    if ( deferred_commands ) {
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::DispatchIndirect, DeferredIndirect{ buffer_handle, offset, 0 } );
+        return;
+    }
+
+    if ( pipeline_pending ) {
+        ++bind_stats.skipped_draws;
+        return;
+    }
+
     BufferVulkan* buffer = device->access_buffer( buffer_handle );
 
     VkBuffer vk_buffer = buffer->vk_buffer;
@@ -252,6 +561,11 @@ static ResourceState to_resource_state( PipelineStage::Enum stage ) {
 
 void CommandBuffer::barrier( const ExecutionBarrier& barrier ) {
 
+    if ( deferred_commands ) {
+        deferred_write_unkeyed( deferred_commands, DeferredCommandType::Barrier, barrier );
+        return;
+    }
+
     if ( current_render_pass && ( current_render_pass->type != RenderPassType::Compute ) ) {
         vkCmdEndRenderPass( vk_command_buffer );
 
@@ -475,23 +789,39 @@ void CommandBuffer::barrier( const ExecutionBarrier& barrier ) {
 }
 
 void CommandBuffer::fill_buffer( BufferHandle buffer, u32 offset, u32 size, u32 data ) {
+
+    if ( deferred_commands ) {
+        deferred_write_unkeyed( deferred_commands, DeferredCommandType::FillBuffer, DeferredFillBuffer{ buffer, offset, size, data } );
+        return;
+    }
+
     BufferVulkan* vk_buffer = device->access_buffer( buffer );
 
     vkCmdFillBuffer( vk_command_buffer, vk_buffer->vk_buffer, VkDeviceSize( offset ), size ? VkDeviceSize( size ) : VkDeviceSize( vk_buffer->size ), data);
 }
 
-void CommandBuffer::push_marker( const char* name ) {
+void CommandBuffer::push_marker( StringId name ) {
+
+    if ( deferred_commands ) {
+        deferred_write_unkeyed( deferred_commands, DeferredCommandType::PushMarker, name );
+        return;
+    }
 
     device->push_gpu_timestamp( this, name );
 
     if ( !device->debug_utils_extension_present )
         return;
 
-    device->push_marker( vk_command_buffer, name );
+    device->push_marker( vk_command_buffer, name.c_str() );
 }
 
 void CommandBuffer::pop_marker() {
 
+    if ( deferred_commands ) {
+        deferred_write_unkeyed( deferred_commands, DeferredCommandType::PopMarker, 0u );
+        return;
+    }
+
     device->pop_gpu_timestamp( this );
 
     if ( !device->debug_utils_extension_present )
@@ -500,6 +830,814 @@ void CommandBuffer::pop_marker() {
     device->pop_marker( vk_command_buffer );
 }
 
+#elif defined(HYDRA_NULL)
+
+// Null backend: commands are validated and appended to an in-memory stream.
+
+//
+//
+static void null_record( CommandBuffer* command_buffer, NullCommandType::Enum type, const void* arguments, u32 size ) {
+
+    const u32 aligned_size = ( size + 3 ) & ~3u;
+    const u32 total_size = sizeof( NullCommandHeader ) + aligned_size;
+
+    Array<u8>& stream = command_buffer->stream;
+    const u32 offset = stream.size;
+    stream.set_size( offset + total_size );
+
+    NullCommandHeader* header = ( NullCommandHeader* )( stream.data + offset );
+    header->type = type;
+    header->padding = 0;
+    header->size = ( u16 )aligned_size;
+
+    if ( size ) {
+        memcpy( header + 1, arguments, size );
+    }
+
+    ++command_buffer->num_commands;
+}
+
+//
+// Count and report commands using resources already released by the deletion queue.
+static void null_validate( CommandBuffer* command_buffer, ResourceDeletionType::Enum type, ResourceHandle handle, cstring command_name ) {
+    if ( !command_buffer->device->is_alive( type, handle ) ) {
+        ++command_buffer->invalid_handle_uses;
+        hprint( "Null device: %s using invalid handle %u\n", command_name, handle );
+    }
+}
+
+void CommandBuffer::reset() {
+
+    is_recording = false;
+    current_render_pass = k_invalid_pass;
+    current_pipeline = k_invalid_pipeline;
+    current_command = 0;
+    num_commands = 0;
+    invalid_handle_uses = 0;
+    deferred_commands = nullptr;
+    stream.clear();
+
+    reset_bound_state();
+    bind_stats.reset();
+}
+
+void CommandBuffer::init( QueueType::Enum type_, u32 buffer_size_, u32 submit_size, bool baked_ ) {
+    this->type = type_;
+    this->buffer_size = buffer_size_;
+    this->baked = baked_;
+
+    stream.init( device->allocator, buffer_size_ );
+
+    reset();
+}
+
+void CommandBuffer::terminate() {
+
+    is_recording = false;
+    stream.shutdown();
+}
+
+void CommandBuffer::bind_pass( u64 sort_key, RenderPassHandle handle_ ) {
+
+    if ( deferred_commands ) {
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::BindPass, handle_ );
+        return;
+    }
+
+    is_recording = true;
+
+    if ( handle_.index != current_render_pass.index ) {
+        null_validate( this, ResourceDeletionType::RenderPass, handle_.index, "bind_pass" );
+        null_record( this, NullCommandType::BindPass, &handle_, sizeof( RenderPassHandle ) );
+    }
+
+    current_render_pass = handle_;
+}
+
+void CommandBuffer::bind_pipeline( u64 sort_key, PipelineHandle handle_ ) {
+
+    if ( deferred_commands ) {
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::BindPipeline, handle_ );
+        return;
+    }
+
+    current_pipeline = handle_;
+    if ( is_pipeline_bound( handle_ ) ) {
+        return;
+    }
+
+    null_validate( this, ResourceDeletionType::Pipeline, handle_.index, "bind_pipeline" );
+    null_record( this, NullCommandType::BindPipeline, &handle_, sizeof( PipelineHandle ) );
+}
+
+void CommandBuffer::bind_vertex_buffer( u64 sort_key, BufferHandle handle_, u32 binding, u32 offset ) {
+
+    if ( deferred_commands ) {
+        deferred_bind_vertex_buffer( this, sort_key, handle_, binding, offset );
+        return;
+    }
+
+    const u32 global_offset = deferred_global_offset( device, handle_ );
+    if ( is_vertex_buffer_bound( bound_buffer_handle( device, handle_ ), binding, global_offset != k_no_global_offset ? global_offset : offset ) ) {
+        return;
+    }
+
+    null_validate( this, ResourceDeletionType::Buffer, handle_.index, "bind_vertex_buffer" );
+
+    const u32 arguments[] = { handle_.index, binding, offset };
+    null_record( this, NullCommandType::BindVertexBuffer, arguments, sizeof( arguments ) );
+}
+
+void CommandBuffer::bind_index_buffer( u64 sort_key, BufferHandle handle_ ) {
+
+    if ( deferred_commands ) {
+        deferred_bind_index_buffer( this, sort_key, handle_ );
+        return;
+    }
+
+    const u32 global_offset = deferred_global_offset( device, handle_ );
+    if ( is_index_buffer_bound( bound_buffer_handle( device, handle_ ), global_offset != k_no_global_offset ? global_offset : 0 ) ) {
+        return;
+    }
+
+    null_validate( this, ResourceDeletionType::Buffer, handle_.index, "bind_index_buffer" );
+    null_record( this, NullCommandType::BindIndexBuffer, &handle_, sizeof( BufferHandle ) );
+}
+
+void CommandBuffer::bind_resource_list( u64 sort_key, ResourceListHandle* handles, u32 num_lists, u32* offsets, u32 num_offsets ) {
+
+    if ( deferred_commands ) {
+        deferred_bind_resource_list( this, sort_key, handles, num_lists, offsets, num_offsets );
+        return;
+    }
+
+    if ( is_resource_list_bound( handles, num_lists, offsets, num_offsets ) ) {
+        return;
+    }
+
+    u32 arguments[ k_max_resource_layouts + 1 ];
+    arguments[ 0 ] = num_lists;
+
+    for ( u32 l = 0; l < num_lists; ++l ) {
+        null_validate( this, ResourceDeletionType::ResourceList, handles[ l ].index, "bind_resource_list" );
+        arguments[ l + 1 ] = handles[ l ].index;
+    }
+
+    null_record( this, NullCommandType::BindResourceList, arguments, sizeof( u32 ) * ( num_lists + 1 ) );
+}
+
+void CommandBuffer::set_viewport( u64 sort_key, const Viewport* viewport ) {
+
+    if ( deferred_commands ) {
+        deferred_set_viewport( this, sort_key, viewport );
+        return;
+    }
+
+    Viewport null_viewport;
+    if ( viewport ) {
+        null_viewport = *viewport;
+    }
+    else {
+        null_viewport.rect.width = device->swapchain_width;
+        null_viewport.rect.height = device->swapchain_height;
+        null_viewport.max_depth = 1.0f;
+    }
+
+    null_record( this, NullCommandType::SetViewport, &null_viewport, sizeof( Viewport ) );
+}
+
+void CommandBuffer::set_scissor( u64 sort_key, const Rect2DInt* rect ) {
+
+    if ( deferred_commands ) {
+        deferred_set_scissor( this, sort_key, rect );
+        return;
+    }
+
+    Rect2DInt null_rect;
+    if ( rect ) {
+        null_rect = *rect;
+    }
+    else {
+        null_rect.width = device->swapchain_width;
+        null_rect.height = device->swapchain_height;
+    }
+
+    null_record( this, NullCommandType::SetScissor, &null_rect, sizeof( Rect2DInt ) );
+}
+
+void CommandBuffer::clear( u64 sort_key, f32 red, f32 green, f32 blue, f32 alpha ) {
+
+    if ( deferred_commands ) {
+        const f32 arguments[] = { red, green, blue, alpha };
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::Clear, arguments );
+        return;
+    }
+
+    const f32 arguments[] = { red, green, blue, alpha };
+    null_record( this, NullCommandType::Clear, arguments, sizeof( arguments ) );
+}
+
+void CommandBuffer::clear_depth_stencil( u64 sort_key, f32 depth, u8 value ) {
+
+    if ( deferred_commands ) {
+        const f32 arguments[] = { depth, ( f32 )value };
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::ClearDepthStencil, arguments );
+        return;
+    }
+
+    const f32 arguments[] = { depth, ( f32 )value };
+    null_record( this, NullCommandType::ClearDepthStencil, arguments, sizeof( arguments ) );
+}
+
+void CommandBuffer::draw( u64 sort_key, TopologyType::Enum topology, u32 first_vertex, u32 vertex_count, u32 first_instance, u32 instance_count ) {
+
+    if ( deferred_commands ) {
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::Draw, DeferredDraw{ topology, first_vertex, vertex_count, first_instance, instance_count } );
+        return;
+    }
+
+    const u32 arguments[] = { first_vertex, vertex_count, first_instance, instance_count };
+    null_record( this, NullCommandType::Draw, arguments, sizeof( arguments ) );
+}
+
+void CommandBuffer::draw_indexed( u64 sort_key, TopologyType::Enum topology, u32 index_count, u32 instance_count, u32 first_index, i32 vertex_offset, u32 first_instance ) {
+
+    if ( deferred_commands ) {
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::DrawIndexed, DeferredDrawIndexed{ topology, index_count, instance_count, first_index, vertex_offset, first_instance } );
+        return;
+    }
+
+    const u32 arguments[] = { index_count, instance_count, first_index, ( u32 )vertex_offset, first_instance };
+    null_record( this, NullCommandType::DrawIndexed, arguments, sizeof( arguments ) );
+}
+
+void CommandBuffer::dispatch( u64 sort_key, u32 group_x, u32 group_y, u32 group_z ) {
+
+    if ( deferred_commands ) {
+        const u32 arguments[] = { group_x, group_y, group_z };
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::Dispatch, arguments );
+        return;
+    }
+
+    const u32 arguments[] = { group_x, group_y, group_z };
+    null_record( this, NullCommandType::Dispatch, arguments, sizeof( arguments ) );
+}
+
+void CommandBuffer::draw_indirect( u64 sort_key, BufferHandle buffer_handle, u32 offset, u32 stride ) {
+
+    if ( deferred_commands ) {
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::DrawIndirect, DeferredIndirect{ buffer_handle, offset, stride } );
+        return;
+    }
+
+    null_validate( this, ResourceDeletionType::Buffer, buffer_handle.index, "draw_indirect" );
+
+    const u32 arguments[] = { buffer_handle.index, offset, stride };
+    null_record( this, NullCommandType::DrawIndirect, arguments, sizeof( arguments ) );
+}
+
+void CommandBuffer::draw_indexed_indirect( u64 sort_key, BufferHandle buffer_handle, u32 offset, u32 stride ) {
+
+    if ( deferred_commands ) {
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::DrawIndexedIndirect, DeferredIndirect{ buffer_handle, offset, stride } );
+        return;
+    }
+
+    null_validate( this, ResourceDeletionType::Buffer, buffer_handle.index, "draw_indexed_indirect" );
+
+    const u32 arguments[] = { buffer_handle.index, offset, stride };
+    null_record( this, NullCommandType::DrawIndexedIndirect, arguments, sizeof( arguments ) );
+}
+
+void CommandBuffer::dispatch_indirect( u64 sort_key, BufferHandle buffer_handle, u32 offset ) {
+
+    if ( deferred_commands ) {
+        deferred_write( deferred_commands, sort_key, DeferredCommandType::DispatchIndirect, DeferredIndirect{ buffer_handle, offset, 0 } );
+        return;
+    }
+
+    null_validate( this, ResourceDeletionType::Buffer, buffer_handle.index, "dispatch_indirect" );
+
+    const u32 arguments[] = { buffer_handle.index, offset };
+    null_record( this, NullCommandType::DispatchIndirect, arguments, sizeof( arguments ) );
+}
+
+void CommandBuffer::barrier( const ExecutionBarrier& barrier ) {
+
+    if ( deferred_commands ) {
+        deferred_write_unkeyed( deferred_commands, DeferredCommandType::Barrier, barrier );
+        return;
+    }
+
+    // Barriers end the current render pass, like on the real backend.
+    current_render_pass = k_invalid_pass;
+
+    u32 arguments[ 4 + 16 ];
+    arguments[ 0 ] = barrier.source_pipeline_stage;
+    arguments[ 1 ] = barrier.destination_pipeline_stage;
+    arguments[ 2 ] = barrier.num_image_barriers;
+    arguments[ 3 ] = barrier.num_memory_barriers;
+
+    u32 num_arguments = 4;
+    for ( u32 i = 0; i < barrier.num_image_barriers; ++i ) {
+        null_validate( this, ResourceDeletionType::Texture, barrier.image_barriers[ i ].texture.index, "barrier" );
+        arguments[ num_arguments++ ] = barrier.image_barriers[ i ].texture.index;
+    }
+
+    for ( u32 i = 0; i < barrier.num_memory_barriers; ++i ) {
+        null_validate( this, ResourceDeletionType::Buffer, barrier.memory_barriers[ i ].buffer.index, "barrier" );
+        arguments[ num_arguments++ ] = barrier.memory_barriers[ i ].buffer.index;
+    }
+
+    null_record( this, NullCommandType::Barrier, arguments, sizeof( u32 ) * num_arguments );
+}
+
+void CommandBuffer::fill_buffer( BufferHandle buffer, u32 offset, u32 size, u32 data ) {
+
+    if ( deferred_commands ) {
+        deferred_write_unkeyed( deferred_commands, DeferredCommandType::FillBuffer, DeferredFillBuffer{ buffer, offset, size, data } );
+        return;
+    }
+
+    null_validate( this, ResourceDeletionType::Buffer, buffer.index, "fill_buffer" );
+
+    const u32 arguments[] = { buffer.index, offset, size, data };
+    null_record( this, NullCommandType::FillBuffer, arguments, sizeof( arguments ) );
+}
+
+void CommandBuffer::push_marker( StringId name ) {
+
+    if ( deferred_commands ) {
+        deferred_write_unkeyed( deferred_commands, DeferredCommandType::PushMarker, name );
+        return;
+    }
+
+    device->push_gpu_timestamp( this, name );
+
+    cstring name_string = name.c_str();
+    null_record( this, NullCommandType::PushMarker, &name_string, sizeof( cstring ) );
+}
+
+void CommandBuffer::pop_marker() {
+
+    if ( deferred_commands ) {
+        deferred_write_unkeyed( deferred_commands, DeferredCommandType::PopMarker, 0u );
+        return;
+    }
+
+    device->pop_gpu_timestamp( this );
+
+    null_record( this, NullCommandType::PopMarker, nullptr, 0 );
+}
+
+#endif // HYDRA_VULKAN
+
+void CommandBuffer::set_deferred( DeferredCommandStream* stream ) {
+    deferred_commands = stream;
+
+    if ( stream ) {
+        stream->reset();
+    }
+}
+
+void CommandBuffer::set_sort_key( u64 sort_key ) {
+    if ( deferred_commands ) {
+        deferred_commands->last_sort_key = sort_key;
+    }
+}
+
+// State shadowing //////////////////////////////////////////////////////////////
+
+void CommandBuffer::reset_bound_state() {
+    bound_pipeline = k_invalid_pipeline;
+    bound_index_buffer = k_invalid_buffer;
+    bound_index_offset = 0;
+
+    for ( u32 i = 0; i < k_max_vertex_streams; ++i ) {
+        bound_vertex_buffers[ i ] = k_invalid_buffer;
+        bound_vertex_offsets[ i ] = 0;
+    }
+
+    num_bound_resource_lists = 0;
+    num_bound_resource_list_offsets = 0;
+}
+
+bool CommandBuffer::is_pipeline_bound( PipelineHandle handle ) {
+    if ( handle.index == bound_pipeline.index ) {
+        ++bind_stats.filtered_pipelines;
+        return true;
+    }
+
+    // Resource lists are bound with the pipeline layout, so they are bound again after a pipeline change.
+    bound_pipeline = handle;
+    num_bound_resource_lists = 0;
+
+    ++bind_stats.issued_pipelines;
+    return false;
+}
+
+bool CommandBuffer::is_vertex_buffer_bound( BufferHandle handle, u32 binding, u32 offset ) {
+    hy_assert( binding < k_max_vertex_streams );
+
+    if ( bound_vertex_buffers[ binding ].index == handle.index && bound_vertex_offsets[ binding ] == offset ) {
+        ++bind_stats.filtered_vertex_buffers;
+        return true;
+    }
+
+    bound_vertex_buffers[ binding ] = handle;
+    bound_vertex_offsets[ binding ] = offset;
+
+    ++bind_stats.issued_vertex_buffers;
+    return false;
+}
+
+bool CommandBuffer::is_index_buffer_bound( BufferHandle handle, u32 offset ) {
+    if ( bound_index_buffer.index == handle.index && bound_index_offset == offset ) {
+        ++bind_stats.filtered_index_buffers;
+        return true;
+    }
+
+    bound_index_buffer = handle;
+    bound_index_offset = offset;
+
+    ++bind_stats.issued_index_buffers;
+    return false;
+}
+
+bool CommandBuffer::is_resource_list_bound( ResourceListHandle* handles, u32 num_lists, u32* offsets, u32 num_offsets ) {
+    hy_assert( num_lists <= k_max_resource_layouts && num_offsets <= k_max_resource_layouts );
+
+    if ( num_lists == num_bound_resource_lists && num_offsets == num_bound_resource_list_offsets &&
+         memcmp( handles, bound_resource_lists, sizeof( ResourceListHandle ) * num_lists ) == 0 &&
+         ( num_offsets == 0 || memcmp( offsets, bound_resource_list_offsets, sizeof( u32 ) * num_offsets ) == 0 ) ) {
+        ++bind_stats.filtered_resource_lists;
+        return true;
+    }
+
+    memcpy( bound_resource_lists, handles, sizeof( ResourceListHandle ) * num_lists );
+    if ( num_offsets ) {
+        memcpy( bound_resource_list_offsets, offsets, sizeof( u32 ) * num_offsets );
+    }
+    num_bound_resource_lists = num_lists;
+    num_bound_resource_list_offsets = num_offsets;
+
+    ++bind_stats.issued_resource_lists;
+    return false;
+}
+
+void BindCommandStats::reset() {
+    memset( this, 0, sizeof( BindCommandStats ) );
+}
+
+void BindCommandStats::accumulate( const BindCommandStats& other ) {
+    issued_pipelines += other.issued_pipelines;
+    filtered_pipelines += other.filtered_pipelines;
+    issued_resource_lists += other.issued_resource_lists;
+    filtered_resource_lists += other.filtered_resource_lists;
+    issued_vertex_buffers += other.issued_vertex_buffers;
+    filtered_vertex_buffers += other.filtered_vertex_buffers;
+    issued_index_buffers += other.issued_index_buffers;
+    filtered_index_buffers += other.filtered_index_buffers;
+    pending_pipelines += other.pending_pipelines;
+    skipped_draws += other.skipped_draws;
+}
+
+// DeferredCommandStream ////////////////////////////////////////////////////////
+
+void DeferredReplayStats::reset() {
+    memset( this, 0, sizeof( DeferredReplayStats ) );
+}
+
+void DeferredReplayStats::accumulate( const DeferredReplayStats& other ) {
+    num_streams += other.num_streams;
+    recorded_commands += other.recorded_commands;
+    replayed_commands += other.replayed_commands;
+    removed_pipeline_binds += other.removed_pipeline_binds;
+    removed_resource_list_binds += other.removed_resource_list_binds;
+    removed_vertex_buffer_binds += other.removed_vertex_buffer_binds;
+    removed_index_buffer_binds += other.removed_index_buffer_binds;
+}
+
+void DeferredCommandStream::init( Allocator* allocator, u32 initial_size ) {
+    data.init( allocator, initial_size );
+    keys.init( allocator, initial_size / 32 );
+
+    reset();
+}
+
+void DeferredCommandStream::shutdown() {
+    keys.shutdown();
+    data.shutdown();
+}
+
+void DeferredCommandStream::reset() {
+    data.clear();
+    keys.clear();
+    last_sort_key = 0;
+}
+
+u8* DeferredCommandStream::write( u64 sort_key, DeferredCommandType::Enum type, u32 size ) {
+
+    // Keep arguments aligned to 8 bytes, as they can contain pointers.
+    const u32 aligned_size = ( size + 7 ) & ~7u;
+    const u32 offset = data.size;
+    data.set_size( offset + sizeof( DeferredCommandHeader ) + aligned_size );
+
+    DeferredCommandHeader* header = ( DeferredCommandHeader* )( data.data + offset );
+    header->type = type;
+    header->size = aligned_size;
+
+    DeferredCommandKey& key = keys.push_use();
+    key.sort_key = sort_key;
+    key.offset = offset;
+    key.stream_index = 0;
+    key.padding = 0;
+
+    last_sort_key = sort_key;
+
+    return ( u8* )( header + 1 );
+}
+
+//
+// LSD radix sort, 8 bits per pass. It is stable, so commands with the same key keep the recording order.
+// Passes where all the keys have the same byte are skipped, common as keys use only few of the bits.
+static void deferred_radix_sort( Array<DeferredCommandKey>& keys, Array<DeferredCommandKey>& scratch ) {
+
+    const u32 count = keys.size;
+    scratch.set_size( count );
+
+    DeferredCommandKey* source = keys.data;
+    DeferredCommandKey* destination = scratch.data;
+
+    for ( u32 shift = 0; shift < 64; shift += 8 ) {
+        u32 histogram[ 256 ];
+        memset( histogram, 0, sizeof( histogram ) );
+
+        for ( u32 i = 0; i < count; ++i ) {
+            ++histogram[ ( source[ i ].sort_key >> shift ) & 0xff ];
+        }
+
+        if ( histogram[ ( source[ 0 ].sort_key >> shift ) & 0xff ] == count ) {
+            continue;
+        }
+
+        u32 total = 0;
+        for ( u32 b = 0; b < 256; ++b ) {
+            const u32 bucket_count = histogram[ b ];
+            histogram[ b ] = total;
+            total += bucket_count;
+        }
+
+        for ( u32 i = 0; i < count; ++i ) {
+            const u32 bucket = ( source[ i ].sort_key >> shift ) & 0xff;
+            destination[ histogram[ bucket ]++ ] = source[ i ];
+        }
+
+        DeferredCommandKey* temp = source;
+        source = destination;
+        destination = temp;
+    }
+
+    if ( source != keys.data ) {
+        memcpy( keys.data, source, sizeof( DeferredCommandKey ) * count );
+    }
+}
+
+void deferred_commands_replay( CommandBuffer* command_buffer, DeferredCommandStream** streams, u32 num_streams,
+                               Array<DeferredCommandKey>& sort_keys, Array<DeferredCommandKey>& sort_scratch,
+                               DeferredReplayStats& out_stats ) {
+
+    out_stats.reset();
+    out_stats.num_streams = num_streams;
+
+    // Merge keys of all streams, in order.
+    sort_keys.clear();
+    for ( u32 s = 0; s < num_streams; ++s ) {
+        const Array<DeferredCommandKey>& stream_keys = streams[ s ]->keys;
+
+        const u32 first = sort_keys.size;
+        sort_keys.set_size( first + stream_keys.size );
+        for ( u32 k = 0; k < stream_keys.size; ++k ) {
+            sort_keys[ first + k ] = stream_keys[ k ];
+            sort_keys[ first + k ].stream_index = ( u16 )s;
+        }
+    }
+
+    out_stats.recorded_commands = sort_keys.size;
+    if ( sort_keys.size == 0 ) {
+        return;
+    }
+
+    deferred_radix_sort( sort_keys, sort_scratch );
+
+    Device* device = command_buffer->device;
+
+    // Currently bound state, used to remove redundant binds.
+    PipelineHandle bound_pipeline = k_invalid_pipeline;
+    const DeferredBindResourceList* bound_resource_list = nullptr;
+    const DeferredBindIndexBuffer* bound_index_buffer = nullptr;
+    const DeferredBindVertexBuffer* bound_vertex_buffers[ k_max_vertex_streams ];
+    memset( bound_vertex_buffers, 0, sizeof( bound_vertex_buffers ) );
+
+    for ( u32 k = 0; k < sort_keys.size; ++k ) {
+        const DeferredCommandKey& key = sort_keys[ k ];
+        const DeferredCommandHeader* header = ( const DeferredCommandHeader* )( streams[ key.stream_index ]->data.data + key.offset );
+        const u8* arguments = ( const u8* )( header + 1 );
+        const u64 sort_key = key.sort_key;
+
+        switch ( header->type ) {
+            case DeferredCommandType::BindPass:
+            {
+                // Bound state does not survive a render pass change.
+                bound_pipeline = k_invalid_pipeline;
+                bound_resource_list = nullptr;
+                bound_index_buffer = nullptr;
+                memset( bound_vertex_buffers, 0, sizeof( bound_vertex_buffers ) );
+
+                command_buffer->bind_pass( sort_key, *( const RenderPassHandle* )arguments );
+                break;
+            }
+
+            case DeferredCommandType::BindPipeline:
+            {
+                const PipelineHandle pipeline = *( const PipelineHandle* )arguments;
+                if ( pipeline.index == bound_pipeline.index ) {
+                    ++out_stats.removed_pipeline_binds;
+                    continue;
+                }
+
+                // Resource lists are bound with the pipeline layout, rebind them after a pipeline change.
+                bound_pipeline = pipeline;
+                bound_resource_list = nullptr;
+
+                command_buffer->bind_pipeline( sort_key, pipeline );
+                break;
+            }
+
+            case DeferredCommandType::BindVertexBuffer:
+            {
+                const DeferredBindVertexBuffer* bind = ( const DeferredBindVertexBuffer* )arguments;
+                const DeferredBindVertexBuffer* bound = bind->binding < k_max_vertex_streams ? bound_vertex_buffers[ bind->binding ] : nullptr;
+                if ( bound && memcmp( bound, bind, sizeof( DeferredBindVertexBuffer ) ) == 0 ) {
+                    ++out_stats.removed_vertex_buffer_binds;
+                    continue;
+                }
+
+                if ( bind->binding < k_max_vertex_streams ) {
+                    bound_vertex_buffers[ bind->binding ] = bind;
+                }
+
+                if ( bind->global_offset != k_no_global_offset ) {
+                    BufferAPIGnostic* buffer = device->access_buffer( bind->handle );
+                    buffer->global_offset = bind->global_offset;
+                    buffer->parent_buffer = bind->parent_buffer;
+                }
+                command_buffer->bind_vertex_buffer( sort_key, bind->handle, bind->binding, bind->offset );
+                break;
+            }
+
+            case DeferredCommandType::BindIndexBuffer:
+            {
+                const DeferredBindIndexBuffer* bind = ( const DeferredBindIndexBuffer* )arguments;
+                if ( bound_index_buffer && memcmp( bound_index_buffer, bind, sizeof( DeferredBindIndexBuffer ) ) == 0 ) {
+                    ++out_stats.removed_index_buffer_binds;
+                    continue;
+                }
+
+                bound_index_buffer = bind;
+
+                if ( bind->global_offset != k_no_global_offset ) {
+                    BufferAPIGnostic* buffer = device->access_buffer( bind->handle );
+                    buffer->global_offset = bind->global_offset;
+                    buffer->parent_buffer = bind->parent_buffer;
+                }
+                command_buffer->bind_index_buffer( sort_key, bind->handle );
+                break;
+            }
+
+            case DeferredCommandType::BindResourceList:
+            {
+                const DeferredBindResourceList* bind = ( const DeferredBindResourceList* )arguments;
+                if ( bound_resource_list && memcmp( bound_resource_list, bind, sizeof( DeferredBindResourceList ) ) == 0 ) {
+                    ++out_stats.removed_resource_list_binds;
+                    continue;
+                }
+
+                bound_resource_list = bind;
+
+                command_buffer->bind_resource_list( sort_key, ( ResourceListHandle* )bind->handles, bind->num_lists, ( u32* )bind->offsets, bind->num_offsets );
+                break;
+            }
+
+            case DeferredCommandType::SetViewport:
+            {
+                const DeferredSetViewport* set = ( const DeferredSetViewport* )arguments;
+                command_buffer->set_viewport( sort_key, set->use_default ? nullptr : &set->viewport );
+                break;
+            }
+
+            case DeferredCommandType::SetScissor:
+            {
+                const DeferredSetScissor* set = ( const DeferredSetScissor* )arguments;
+                command_buffer->set_scissor( sort_key, set->use_default ? nullptr : &set->rect );
+                break;
+            }
+
+            case DeferredCommandType::Clear:
+            {
+                const f32* color = ( const f32* )arguments;
+                command_buffer->clear( sort_key, color[ 0 ], color[ 1 ], color[ 2 ], color[ 3 ] );
+                break;
+            }
+
+            case DeferredCommandType::ClearDepthStencil:
+            {
+                const f32* values = ( const f32* )arguments;
+                command_buffer->clear_depth_stencil( sort_key, values[ 0 ], ( u8 )values[ 1 ] );
+                break;
+            }
+
+            case DeferredCommandType::Draw:
+            {
+                const DeferredDraw* draw = ( const DeferredDraw* )arguments;
+                command_buffer->draw( sort_key, draw->topology, draw->first_vertex, draw->vertex_count, draw->first_instance, draw->instance_count );
+                break;
+            }
+
+            case DeferredCommandType::DrawIndexed:
+            {
+                const DeferredDrawIndexed* draw = ( const DeferredDrawIndexed* )arguments;
+                command_buffer->draw_indexed( sort_key, draw->topology, draw->index_count, draw->instance_count, draw->first_index, draw->vertex_offset, draw->first_instance );
+                break;
+            }
+
+            case DeferredCommandType::DrawIndirect:
+            {
+                const DeferredIndirect* indirect = ( const DeferredIndirect* )arguments;
+                command_buffer->draw_indirect( sort_key, indirect->handle, indirect->offset, indirect->stride );
+                break;
+            }
+
+            case DeferredCommandType::DrawIndexedIndirect:
+            {
+                const DeferredIndirect* indirect = ( const DeferredIndirect* )arguments;
+                command_buffer->draw_indexed_indirect( sort_key, indirect->handle, indirect->offset, indirect->stride );
+                break;
+            }
+
+            case DeferredCommandType::Dispatch:
+            {
+                const u32* groups = ( const u32* )arguments;
+                command_buffer->dispatch( sort_key, groups[ 0 ], groups[ 1 ], groups[ 2 ] );
+                break;
+            }
+
+            case DeferredCommandType::DispatchIndirect:
+            {
+                const DeferredIndirect* indirect = ( const DeferredIndirect* )arguments;
+                command_buffer->dispatch_indirect( sort_key, indirect->handle, indirect->offset );
+                break;
+            }
+
+            case DeferredCommandType::Barrier:
+            {
+                // Barriers end the render pass.
+                bound_pipeline = k_invalid_pipeline;
+                bound_resource_list = nullptr;
+
+                command_buffer->barrier( *( const ExecutionBarrier* )arguments );
+                break;
+            }
+
+            case DeferredCommandType::FillBuffer:
+            {
+                const DeferredFillBuffer* fill = ( const DeferredFillBuffer* )arguments;
+                command_buffer->fill_buffer( fill->handle, fill->offset, fill->size, fill->data );
+                break;
+            }
+
+            case DeferredCommandType::PushMarker:
+            {
+                command_buffer->push_marker( *( const StringId* )arguments );
+                break;
+            }
+
+            case DeferredCommandType::PopMarker:
+            {
+                command_buffer->pop_marker();
+                break;
+            }
+
+            default:
+            {
+                hy_assertm( false, "Unknown deferred command %u", header->type );
+                break;
+            }
+        }
+
+        ++out_stats.replayed_commands;
+    }
+}
 
 } // namespace gfx
 } // namespace hydra
@@ -6,12 +6,64 @@
 #include <vulkan/vulkan.h>
 #endif // HYDRA_VULKAN
 
+#include "kernel/array.hpp"
+
 namespace hydra {
 namespace gfx {
 
 struct Device;
 struct GpuDeviceVulkan;
-    
+struct GpuDeviceNull;
+struct CommandBuffer;
+
+// Deferred commands ////////////////////////////////////////////////////////////
+
+//
+// Commands that can be recorded in a DeferredCommandStream.
+namespace DeferredCommandType {
+    enum Enum : u8 {
+        BindPass, BindPipeline, BindVertexBuffer, BindIndexBuffer, BindResourceList, SetViewport, SetScissor, Clear, ClearDepthStencil,
+        Draw, DrawIndexed, DrawIndirect, DrawIndexedIndirect, Dispatch, DispatchIndirect, Barrier, FillBuffer, PushMarker, PopMarker, Count
+    };
+} // namespace DeferredCommandType
+
+//
+// Sort key layout of deferred commands:
+//      63..48  stage index, orders stages and their render passes.
+//      47..0   sequence inside the stage, incremented for each command.
+// Stages recorded in different command buffers are merged in stage order, and commands of a stage keep their sequence.
+static const u32                    k_sort_key_stage_shift = 48;
+
+inline u64                          sort_key_stage( u32 stage_index ) { return ( u64 )stage_index << k_sort_key_stage_shift; }
+
+//
+// Linear stream of commands with their sort keys, filled by a command buffer in deferred mode.
+// Commands without a sort key (barriers, fills, markers) take the key of the previous command,
+// or the one given to CommandBuffer::set_sort_key, so that they stay in place after sorting.
+// Dynamic offsets of buffers are read when recording, as buffers can be mapped more than once per frame.
+struct DeferredCommandStream {
+
+    void                            init( Allocator* allocator, u32 initial_size );
+    void                            shutdown();
+
+    void                            reset();
+
+    u8*                             write( u64 sort_key, DeferredCommandType::Enum type, u32 size );    // Returns memory for the arguments.
+
+    Array<u8>                       data;
+    Array<DeferredCommandKey>       keys;
+
+    u64                             last_sort_key   = 0;
+
+}; // struct DeferredCommandStream
+
+//
+// Merges the streams (the order of the array breaks ties between equal keys), radix sorts them by key
+// and records the commands in command_buffer, skipping binds of state that is already bound.
+void                                deferred_commands_replay( CommandBuffer* command_buffer, DeferredCommandStream** streams, u32 num_streams,
+                                                              Array<DeferredCommandKey>& sort_keys, Array<DeferredCommandKey>& sort_scratch,
+                                                              DeferredReplayStats& out_stats );
+
 //
 //
 struct CommandBuffer {
@@ -47,11 +99,23 @@ struct CommandBuffer {
 
     void                            fill_buffer( BufferHandle buffer, u32 offset, u32 size, u32 data );
 
-    void                            push_marker( const char* name );
+    void                            push_marker( StringId name );   // Intern the name once, markers are pushed every frame.
     void                            pop_marker();
 
     void                            reset();
 
+    // Commands recorded after this are written in stream, and replayed sorted by key at present.
+    void                            set_deferred( DeferredCommandStream* stream );
+    // Key of the next deferred commands without one, set it at the start of a stage so that its first barrier precedes the pass.
+    void                            set_sort_key( u64 sort_key );
+
+    // State shadowing: return true if the state is already bound, otherwise store it as bound. Update bind_stats.
+    bool                            is_pipeline_bound( PipelineHandle handle );
+    bool                            is_vertex_buffer_bound( BufferHandle handle, u32 binding, u32 offset );
+    bool                            is_index_buffer_bound( BufferHandle handle, u32 offset );
+    bool                            is_resource_list_bound( ResourceListHandle* handles, u32 num_lists, u32* offsets, u32 num_offsets );
+    void                            reset_bound_state();
+
 #if defined (HYDRA_VULKAN)
     VkCommandBuffer                 vk_command_buffer;
 
@@ -63,6 +127,19 @@ struct CommandBuffer {
     PipelineVulkan*                 current_pipeline;
     VkClearValue                    clears[2];          // 0 = color, 1 = depth stencil
     bool                            is_recording;
+    bool                            pipeline_pending;   // Current pipeline is still compiling, draws are skipped until a ready one is bound.
+
+    u32                             handle;
+#elif defined (HYDRA_NULL)
+    GpuDeviceNull*                  device;
+
+    Array<u8>                       stream;             // Recorded commands, NullCommandHeader followed by the arguments.
+    u32                             num_commands;
+    u32                             invalid_handle_uses;    // Counted here, merged into the device counters at present.
+
+    RenderPassHandle                current_render_pass;
+    PipelineHandle                  current_pipeline;
+    bool                            is_recording;
 
     u32                             handle;
 #elif defined (HYDRA_OPENGL)
@@ -81,6 +158,24 @@ struct CommandBuffer {
     QueueType::Enum                 type                = QueueType::Graphics;
     u32                             buffer_size         = 0;
 
+    u32                             thread_index        = 0;            // Thread owning the pool this buffer comes from.
+    u32                             submit_order        = 0;            // Queued buffers are submitted sorted by this.
+
+    DeferredCommandStream*          deferred_commands   = nullptr;      // When set, commands are recorded here instead of being executed.
+
+    // Bound state. Dynamic buffers are stored as the ring or overflow page they are bound from, with their global offset.
+    PipelineHandle                  bound_pipeline;
+    BufferHandle                    bound_vertex_buffers[ k_max_vertex_streams ];
+    u32                             bound_vertex_offsets[ k_max_vertex_streams ];
+    BufferHandle                    bound_index_buffer;
+    u32                             bound_index_offset;
+    ResourceListHandle              bound_resource_lists[ k_max_resource_layouts ];
+    u32                             bound_resource_list_offsets[ k_max_resource_layouts ];
+    u32                             num_bound_resource_lists;
+    u32                             num_bound_resource_list_offsets;
+
+    BindCommandStats                bind_stats;                         // Reset with the command buffer, gathered by the device at present.
+
     bool                            baked               = false;        // If baked reset will affect only the read of the commands.
 
 }; // struct CommandBuffer
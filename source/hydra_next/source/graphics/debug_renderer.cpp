@@ -44,10 +44,6 @@ void DebugRenderer::init( hydra::gfx::Renderer* renderer ) {
     // Constants
     lines_cb = renderer->create_buffer( BufferType::Constant_mask, ResourceUsageType::Dynamic, sizeof(LinesGPULocalConstants), nullptr, "line_renderer_cb" );
 
-    // Line segments buffers
-    lines_vb = renderer->create_buffer( BufferType::Vertex_mask, ResourceUsageType::Dynamic, sizeof( LineVertex ) * k_max_lines, nullptr, "lines_vb" );
-    lines_vb_2d = renderer->create_buffer( BufferType::Vertex_mask, ResourceUsageType::Dynamic, sizeof( LineVertex2D ) * k_max_lines, nullptr, "lines_vb_2d" );
-
     current_line = current_line_2d = 0;
 
     this->material = nullptr;
@@ -56,8 +52,6 @@ void DebugRenderer::init( hydra::gfx::Renderer* renderer ) {
 void DebugRenderer::shutdown( hydra::gfx::Renderer* renderer ) {
 
     //renderer.destroy_material( material );
-    renderer->destroy_buffer( lines_vb );
-    renderer->destroy_buffer( lines_vb_2d );
     renderer->destroy_buffer( lines_cb );
 }
 
@@ -69,7 +63,7 @@ void DebugRenderer::reload( hydra::gfx::Renderer* renderer, hydra::ResourceManag
 }
 
 
-void DebugRenderer::render( hydra::gfx::Renderer& renderer, hydra::gfx::CommandBuffer* gpu_commands, hydra::gfx::Camera& camera ) {
+void DebugRenderer::render( hydra::gfx::Renderer& renderer, u64& sort_key, hydra::gfx::CommandBuffer* gpu_commands, hydra::gfx::Camera& camera ) {
     using namespace hydra::gfx;
 
     if ( current_line || current_line_2d ) {
@@ -88,21 +82,15 @@ void DebugRenderer::render( hydra::gfx::Renderer& renderer, hydra::gfx::CommandB
         }
     }
 
-    u64 sort_key = 0;
-
+    // Line segments are copied in the dynamic allocator each frame.
     if ( current_line ) {
         const u32 mapping_size = sizeof( LineVertex ) * current_line;
-        LineVertex* vtx_dst = ( LineVertex* )renderer.map_buffer( lines_vb, 0, mapping_size );
-
-        if ( vtx_dst ) {
-            memcpy( vtx_dst, &s_line_buffer[ 0 ], mapping_size );
+        DynamicAllocation vertices = renderer.gpu->dynamic_allocate( mapping_size, BufferType::Vertex_mask );
+        memcpy( vertices.data, &s_line_buffer[ 0 ], mapping_size );
 
-            renderer.unmap_buffer( lines_vb );
-        }
-        
         MaterialPass& pass = material->passes[ 0 ];
         gpu_commands->bind_pipeline( sort_key++, pass.pipeline );
-        gpu_commands->bind_vertex_buffer( sort_key++, lines_vb->handle, 0, 0 );
+        gpu_commands->bind_vertex_buffer( sort_key++, vertices.buffer, 0, vertices.offset );
         gpu_commands->bind_resource_list( sort_key++, &pass.resource_list, 1, nullptr, 0 );
         // Draw using instancing and 6 vertices.
         const uint32_t num_vertices = 6;
@@ -111,16 +99,13 @@ void DebugRenderer::render( hydra::gfx::Renderer& renderer, hydra::gfx::CommandB
     }
 
     if ( current_line_2d ) {
-        const u32 mapping_size = sizeof( LineVertex2D ) * current_line;
-        LineVertex2D* vtx_dst = ( LineVertex2D* )renderer.map_buffer( lines_vb, 0, mapping_size );
-
-        if ( vtx_dst ) {
-            memcpy( vtx_dst, &s_line_buffer_2d[ 0 ], mapping_size );
-        }
+        const u32 mapping_size = sizeof( LineVertex2D ) * current_line_2d;
+        DynamicAllocation vertices = renderer.gpu->dynamic_allocate( mapping_size, BufferType::Vertex_mask );
+        memcpy( vertices.data, &s_line_buffer_2d[ 0 ], mapping_size );
 
         MaterialPass& pass = material->passes[ 1 ];
         gpu_commands->bind_pipeline( sort_key++, pass.pipeline );
-        gpu_commands->bind_vertex_buffer( sort_key++, lines_vb->handle, 0, 0 );
+        gpu_commands->bind_vertex_buffer( sort_key++, vertices.buffer, 0, vertices.offset );
         gpu_commands->bind_resource_list( sort_key++, &pass.resource_list, 1, nullptr, 0 );
         // Draw using instancing and 6 vertices.
         const uint32_t num_vertices = 6;
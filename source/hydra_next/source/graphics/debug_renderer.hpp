@@ -16,7 +16,7 @@ struct DebugRenderer {
 
     void                            reload( hydra::gfx::Renderer* renderer, hydra::ResourceManager* resource_manager );
 
-    void                            render( hydra::gfx::Renderer& renderer, hydra::gfx::CommandBuffer* commands, hydra::gfx::Camera& camera );
+    void                            render( hydra::gfx::Renderer& renderer, u64& sort_key, hydra::gfx::CommandBuffer* commands, hydra::gfx::Camera& camera );
 
     void                            line( const vec3s& from, const vec3s& to, hydra::Color color );
     void                            line( const vec3s& from, const vec3s& to, hydra::Color color0, hydra::Color color1 );
@@ -26,8 +26,6 @@ struct DebugRenderer {
     hydra::gfx::Material*           material;
 
     hydra::gfx::Buffer*             lines_cb;
-    hydra::gfx::Buffer*             lines_vb;
-    hydra::gfx::Buffer*             lines_vb_2d;
 
     u32                             current_line;
     u32                             current_line_2d;
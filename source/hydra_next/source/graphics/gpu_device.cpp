@@ -1,6 +1,12 @@
 #include "graphics/gpu_device.hpp"
+#include "graphics/command_buffer.hpp"
 
 #include "kernel/memory.hpp"
+#include "kernel/memory_utils.hpp"
+#include "kernel/numerics.hpp"
+#include "kernel/time.hpp"
+
+#include <string.h>
 
 namespace hydra {
 namespace gfx {
@@ -12,6 +18,20 @@ void Device::init( const DeviceCreation& creation ) {
     // 1. Perform common code
     allocator = creation.allocator;
     string_buffer.init( 1024 * 1024, creation.allocator );
+
+    deferred_sort_keys.init( allocator, 1024 );
+    deferred_sort_scratch.init( allocator, 1024 );
+    deferred_stats.reset();
+    bind_stats.reset();
+
+    frames_in_flight = clamp( ( u32 )creation.frames_in_flight, 1u, k_max_swapchain_images );
+    frame_pacing.reset();
+    frame_pacing.frames_in_flight = frames_in_flight;
+    memset( &frame_timings, 0, sizeof( FrameTimings ) );
+    record_start_time = 0;
+    last_present_time = 0;
+
+    resource_list_cache.init( allocator );
     
     // 2. Perform backend specific code
     backend_init( creation );
@@ -21,6 +41,9 @@ void Device::shutdown() {
     
     backend_shutdown();
 
+    resource_list_cache.shutdown();
+    deferred_sort_scratch.shutdown();
+    deferred_sort_keys.shutdown();
     string_buffer.shutdown();
 
     hprint( "Gpu Device shutdown\n" );
@@ -45,6 +68,177 @@ BufferHandle Device::get_dummy_constant_buffer() const {
     return dummy_constant_buffer;
 }
 
+//
+// Buffers can be queued by different threads in any order: sort them by request order so that
+// submission is always the same. Insertion sort, as there are few buffers per frame.
+void Device::sort_queued_command_buffers() {
+
+    for ( u32 i = 1; i < num_queued_command_buffers; ++i ) {
+        CommandBuffer* command_buffer = queued_command_buffers[ i ];
+
+        u32 j = i;
+        while ( j > 0 && queued_command_buffers[ j - 1 ]->submit_order > command_buffer->submit_order ) {
+            queued_command_buffers[ j ] = queued_command_buffers[ j - 1 ];
+            --j;
+        }
+        queued_command_buffers[ j ] = command_buffer;
+    }
+}
+
+//
+// Each run of consecutive deferred command buffers is merged and replayed into the first buffer of the run,
+// so that sorting happens across all of them. The others of the run are submitted empty.
+// Buffers queued between runs keep their place in the submission.
+void Device::replay_deferred_command_buffers() {
+
+    DeferredCommandStream* streams[ k_max_queued_command_buffers ];
+    DeferredReplayStats run_stats;
+    deferred_stats.reset();
+
+    u32 i = 0;
+    while ( i < num_queued_command_buffers ) {
+        CommandBuffer* target = queued_command_buffers[ i ];
+        if ( target->deferred_commands == nullptr ) {
+            ++i;
+            continue;
+        }
+
+        u32 num_streams = 0;
+        for ( ; i < num_queued_command_buffers && queued_command_buffers[ i ]->deferred_commands; ++i ) {
+            streams[ num_streams++ ] = queued_command_buffers[ i ]->deferred_commands;
+            queued_command_buffers[ i ]->deferred_commands = nullptr;
+        }
+
+        deferred_commands_replay( target, streams, num_streams, deferred_sort_keys, deferred_sort_scratch, run_stats );
+        deferred_stats.accumulate( run_stats );
+    }
+}
+
+//
+// Sum the bind counters of the command buffers submitted this frame. Called at present, after deferred commands are replayed.
+void Device::gather_bind_stats() {
+
+    bind_stats.reset();
+    for ( u32 i = 0; i < num_queued_command_buffers; ++i ) {
+        bind_stats.accumulate( queued_command_buffers[ i ]->bind_stats );
+    }
+}
+
+//
+// Frame time is measured between presents, so it includes the fence wait of the following new_frame.
+void Device::end_frame_timings() {
+
+    const i64 now = time_now();
+    frame_timings.frame = last_present_time ? ( f32 )time_delta_milliseconds( last_present_time, now ) : 0.f;
+    last_present_time = now;
+
+    frame_pacing.add_frame( frame_timings );
+    memset( &frame_timings, 0, sizeof( FrameTimings ) );
+}
+
+//
+// Same contents as ResourceListCreation::compute_hash, the name is not compared.
+static bool resource_list_creation_equal( const ResourceListCreation& a, const ResourceListCreation& b ) {
+    return a.layout.index == b.layout.index && a.num_resources == b.num_resources &&
+           memcmp( a.resources, b.resources, sizeof( ResourceHandle ) * a.num_resources ) == 0 &&
+           memcmp( a.samplers, b.samplers, sizeof( SamplerHandle ) * a.num_resources ) == 0 &&
+           memcmp( a.bindings, b.bindings, sizeof( u16 ) * a.num_resources ) == 0;
+}
+
+//
+//
+ResourceListHandle Device::create_resource_list_cached( const ResourceListCreation& creation ) {
+
+    // Walk the keys starting at the hash until the same contents or a free key are found.
+    u64 hash = creation.compute_hash();
+    for ( FlatHashMapIterator it = resource_list_cache.lists.find( hash ); it.is_valid(); it = resource_list_cache.lists.find( ++hash ) ) {
+        ResourceListHandle handle = { resource_list_cache.lists.get( it ) };
+        ResourceListCacheEntry& entry = resource_list_cache.entries[ handle.index ];
+        if ( resource_list_creation_equal( entry.creation, creation ) ) {
+            ++entry.references;
+            ++resource_list_cache.hits;
+            return handle;
+        }
+
+        ++resource_list_cache.collisions;
+    }
+
+    ResourceListHandle handle = create_resource_list( creation );
+    if ( handle.index == k_invalid_index ) {
+        return handle;
+    }
+
+    Array<ResourceListCacheEntry>& entries = resource_list_cache.entries;
+    if ( handle.index >= entries.size ) {
+        const u32 old_size = entries.size;
+        entries.set_size( handle.index + 1 );
+        for ( u32 i = old_size; i < entries.size; ++i ) {
+            entries[ i ].hash = 0;
+            entries[ i ].references = 0;
+        }
+    }
+
+    ResourceListCacheEntry& entry = entries[ handle.index ];
+    entry.creation = creation;
+    entry.creation.name = nullptr;
+    entry.hash = hash;
+    entry.references = 1;
+    resource_list_cache.lists.insert( hash, handle.index );
+    ++resource_list_cache.misses;
+    ++resource_list_cache.num_lists;
+
+    return handle;
+}
+
+void Device::destroy_resource_list_cached( ResourceListHandle resource_list ) {
+
+    Array<ResourceListCacheEntry>& entries = resource_list_cache.entries;
+    if ( resource_list.index >= entries.size || entries[ resource_list.index ].references == 0 ) {
+        hprint( "Graphics error: trying to release not cached ResourceList %u\n", resource_list.index );
+        return;
+    }
+
+    ResourceListCacheEntry& entry = entries[ resource_list.index ];
+    if ( --entry.references ) {
+        return;
+    }
+
+    // Backward shift deletion: entries after the freed key that probed past it are moved back,
+    // so that lookups stopping at the first free key still find them.
+    FlatHashMap<u64, u32>& lists = resource_list_cache.lists;
+    u64 hole = entry.hash;
+    lists.remove( hole );
+
+    for ( u64 key = hole + 1; ; ++key ) {
+        FlatHashMapIterator it = lists.find( key );
+        if ( !it.is_valid() ) {
+            break;
+        }
+
+        const u32 index = lists.get( it );
+        const u64 home = entries[ index ].creation.compute_hash();
+        // Unsigned differences handle keys wrapping around.
+        if ( hole - home < key - home ) {
+            lists.remove( it );
+            lists.insert( hole, index );
+            entries[ index ].hash = hole;
+            hole = key;
+        }
+    }
+
+    --resource_list_cache.num_lists;
+
+    destroy_resource_list( resource_list );
+}
+
+void* Device::dynamic_allocate( u32 size ) {
+    return dynamic_allocator.allocate( size, BufferType::Constant_mask ).data;
+}
+
+DynamicAllocation Device::dynamic_allocate( u32 size, BufferType::Mask usage ) {
+    return dynamic_allocator.allocate( size, usage );
+}
+
 void Device::resize( uint16_t width, uint16_t height ) {
     swapchain_width = width;
     swapchain_height = height;
@@ -129,20 +323,25 @@ u64 SortKey::get_key( u64 stage_index ) {
 
 // GPU Timestamp Manager ////////////////////////////////////////////////////////
 
-void GPUTimestampManager::init( Allocator* allocator_, u16 queries_per_frame_, u16 max_frames ) {
+void GPUTimestampManager::init( Allocator* allocator_, u16 queries_per_frame_, u16 max_frames_ ) {
 
     allocator = allocator_;
     queries_per_frame = queries_per_frame_;
+    max_frames = max_frames_;
 
     // Data is start, end in 2 u64 numbers.
     const u32 k_data_per_query = 2;
-    const sizet allocated_size = sizeof( GPUTimestamp ) * queries_per_frame * max_frames + sizeof( u64 ) * queries_per_frame * max_frames * k_data_per_query;
+    const sizet allocated_size = sizeof( GPUTimestamp ) * queries_per_frame * ( max_frames + 1 ) + sizeof( u64 ) * queries_per_frame * max_frames * k_data_per_query;
     u8* memory = hallocam( allocated_size, allocator );
+    memset( memory, 0, allocated_size );
 
     timestamps = ( GPUTimestamp* )memory;
+    resolved_timestamps = timestamps + queries_per_frame * max_frames;
     // Data is start, end in 2 u64 numbers.
-    timestamps_data = ( u64* )( memory + sizeof( GPUTimestamp ) * queries_per_frame * max_frames );
+    timestamps_data = ( u64* )( memory + sizeof( GPUTimestamp ) * queries_per_frame * ( max_frames + 1 ) );
 
+    memset( frame_queries, 0, sizeof( frame_queries ) );
+    resolved_queries = 0;
     reset();
 }
 
@@ -156,19 +355,42 @@ void GPUTimestampManager::reset() {
     parent_index = 0;
     current_frame_resolved = false;
     depth = 0;
+    dropped_queries = 0;
+    dropped_depth = 0;
 }
 
 bool GPUTimestampManager::has_valid_queries() const {
     // Even number of queries means asymettrical queries, thus we don't sample.
-    return current_query > 0 && (depth == 0);
+    return current_query > 0 && (depth == 0) && ( dropped_depth == 0 );
 }
 
-u32 GPUTimestampManager::resolve( u32 current_frame, GPUTimestamp* timestamps_to_fill ) {
-    hydra::memory_copy( timestamps_to_fill, &timestamps[ current_frame * queries_per_frame ], sizeof( GPUTimestamp ) * current_query );
-    return current_query;
+void GPUTimestampManager::end_frame( u32 frame ) {
+    frame_queries[ frame ] = has_valid_queries() ? current_query : 0;
+
+    if ( current_query && !frame_queries[ frame ] ) {
+        hprint( "Asymmetrical GPU queries, missing pop of some markers!\n" );
+    }
+}
+
+void GPUTimestampManager::resolve_frame( u32 frame ) {
+    resolved_queries = frame_queries[ frame ];
+    frame_queries[ frame ] = 0;
+
+    hydra::memory_copy( resolved_timestamps, &timestamps[ frame * queries_per_frame ], sizeof( GPUTimestamp ) * resolved_queries );
 }
 
-u32 GPUTimestampManager::push( u32 current_frame, const char* name ) {
+u32 GPUTimestampManager::resolve( GPUTimestamp* timestamps_to_fill ) {
+    hydra::memory_copy( timestamps_to_fill, resolved_timestamps, sizeof( GPUTimestamp ) * resolved_queries );
+    return resolved_queries;
+}
+
+u32 GPUTimestampManager::push( u32 current_frame, StringId name ) {
+    if ( current_query == queries_per_frame ) {
+        ++dropped_queries;
+        ++dropped_depth;
+        return k_invalid_index;
+    }
+
     u32 query_index = ( current_frame * queries_per_frame ) + current_query;
 
     GPUTimestamp& timestamp = timestamps[ query_index ];
@@ -185,6 +407,11 @@ u32 GPUTimestampManager::push( u32 current_frame, const char* name ) {
 }
 
 u32 GPUTimestampManager::pop( u32 current_frame ) {
+    // Scopes are nested: once the frame is full every following push is dropped, so dropped scopes are the innermost.
+    if ( dropped_depth ) {
+        --dropped_depth;
+        return k_invalid_index;
+    }
 
     u32 query_index = ( current_frame * queries_per_frame ) + parent_index;
     GPUTimestamp& timestamp = timestamps[ query_index ];
@@ -195,6 +422,25 @@ u32 GPUTimestampManager::pop( u32 current_frame ) {
     return ( query_index * 2 ) + 1;
 }
 
+void GPUTimestampManager::grow() {
+    const u32 needed_queries = current_query + dropped_queries;
+    u32 new_queries_per_frame = queries_per_frame ? queries_per_frame : 1;
+    while ( new_queries_per_frame < needed_queries ) {
+        new_queries_per_frame *= 2;
+    }
+    // Parent indices are stored in 16 bits.
+    new_queries_per_frame = new_queries_per_frame > u16_max ? u16_max : new_queries_per_frame;
+
+    hprint( "GPU timestamps: %u queries dropped, growing from %u to %u queries per frame.\n", dropped_queries, queries_per_frame, new_queries_per_frame );
+    if ( new_queries_per_frame == u16_max ) {
+        hprint( "GPU timestamps: reached the maximum of %u queries per frame, further queries will be dropped.\n", u16_max );
+    }
+
+    // Resets dropped queries too.
+    shutdown();
+    init( allocator, ( u16 )new_queries_per_frame, ( u16 )max_frames );
+}
+
 DeviceCreation& DeviceCreation::set_window( u32 width_, u32 height_, void* handle ) {
     width = ( u16 )width_;
     height = ( u16 )height_;
@@ -207,5 +453,415 @@ DeviceCreation& DeviceCreation::set_allocator( Allocator* allocator_ ) {
     return *this;
 }
 
+DeviceCreation& DeviceCreation::set_pipeline_cache_path( cstring path ) {
+    pipeline_cache_path = path;
+    return *this;
+}
+
+DeviceCreation& DeviceCreation::set_frames_in_flight( u32 frames ) {
+    frames_in_flight = ( u16 )frames;
+    return *this;
+}
+
+// FramePacingStats /////////////////////////////////////////////////////////////
+
+void FramePacingStats::reset() {
+    num_frames = 0;
+    next_frame = 0;
+}
+
+void FramePacingStats::add_frame( const FrameTimings& timings ) {
+    history[ next_frame ] = timings;
+    next_frame = ( next_frame + 1 ) % k_history_frames;
+    num_frames = min( num_frames + 1, k_history_frames );
+}
+
+void FramePacingStats::compute_average( FrameTimings& out_average ) const {
+    memset( &out_average, 0, sizeof( FrameTimings ) );
+    if ( num_frames == 0 ) {
+        return;
+    }
+
+    for ( u32 i = 0; i < num_frames; ++i ) {
+        const FrameTimings& timings = history[ i ];
+        out_average.frame += timings.frame;
+        out_average.fence_wait += timings.fence_wait;
+        out_average.record += timings.record;
+        out_average.acquire += timings.acquire;
+        out_average.submit += timings.submit;
+        out_average.present += timings.present;
+    }
+
+    const f32 inv_frames = 1.f / num_frames;
+    out_average.frame *= inv_frames;
+    out_average.fence_wait *= inv_frames;
+    out_average.record *= inv_frames;
+    out_average.acquire *= inv_frames;
+    out_average.submit *= inv_frames;
+    out_average.present *= inv_frames;
+}
+
+//
+// The CPU waiting on the fence means the GPU is behind, waiting on acquire or present means vertical sync
+// is limiting. A wait below a tenth of the frame is considered noise and the CPU the bottleneck.
+FrameBound::Enum FramePacingStats::compute_bound( const FrameTimings& average ) const {
+    const f32 threshold = average.frame * 0.1f;
+    const f32 present_wait = average.acquire + average.present;
+
+    if ( average.fence_wait > threshold && average.fence_wait >= present_wait ) {
+        return FrameBound::GPU;
+    }
+    if ( present_wait > threshold ) {
+        return FrameBound::Present;
+    }
+    return FrameBound::CPU;
+}
+
+void FramePacingStats::print() const {
+    FrameTimings average;
+    compute_average( average );
+
+    hprint( "Frame pacing over %u frames, %u frames in flight: %s bound\n", num_frames, frames_in_flight, FrameBound::ToString( compute_bound( average ) ) );
+    hprint( "    frame %2.3fms, record %2.3fms, fence wait %2.3fms, acquire %2.3fms, submit %2.3fms, present %2.3fms\n",
+            average.frame, average.record, average.fence_wait, average.acquire, average.submit, average.present );
+}
+
+// DynamicAllocator /////////////////////////////////////////////////////////////
+
+void DynamicAllocatorStats::reset() {
+    memset( this, 0, sizeof( DynamicAllocatorStats ) );
+}
+
+void DynamicAllocator::init( Device* gpu_, u32 size, u32 constants_alignment_, u32 storage_alignment_ ) {
+    gpu = gpu_;
+    constants_alignment = constants_alignment_;
+    storage_alignment = storage_alignment_;
+
+    capacity = 1;
+    while ( capacity < size ) {
+        capacity <<= 1;
+    }
+
+    BufferCreation bc;
+    bc.set( ( BufferType::Mask )( BufferType::Vertex_mask | BufferType::Index_mask | BufferType::Constant_mask ), ResourceUsageType::Immutable, capacity ).set_name( "Dynamic_Persistent_Buffer" );
+    buffer = gpu->create_buffer( bc );
+
+    MapBufferParameters cb_map = { buffer, 0, 0 };
+    mapped_memory = ( u8* )gpu->map_buffer( cb_map );
+
+    head = 0;
+    tail = 0;
+    frame_start = 0;
+    current_frame = 0;
+    for ( u32 i = 0; i < k_max_swapchain_images; ++i ) {
+        frame_end[ i ] = 0;
+    }
+
+    pages.init( gpu->allocator, 4 );
+    page_mutex.init();
+    page_size = k_default_page_size;
+
+    frame_stats.reset();
+    last_frame_stats.reset();
+    peak_frame_bytes = 0;
+}
+
+void DynamicAllocator::shutdown() {
+
+    for ( u32 i = 0; i < pages.size; ++i ) {
+        MapBufferParameters page_map = { pages[ i ].buffer, 0, 0 };
+        gpu->unmap_buffer( page_map );
+        gpu->destroy_buffer( pages[ i ].buffer );
+    }
+    pages.shutdown();
+    page_mutex.shutdown();
+
+    MapBufferParameters cb_map = { buffer, 0, 0 };
+    gpu->unmap_buffer( cb_map );
+    gpu->destroy_buffer( buffer );
+}
+
+u32 DynamicAllocator::get_alignment( u32 buffer_type_mask ) const {
+    if ( buffer_type_mask & BufferType::Constant_mask ) {
+        return constants_alignment;
+    }
+    if ( buffer_type_mask & BufferType::Structured_mask ) {
+        return storage_alignment;
+    }
+    return vertex_alignment;
+}
+
+DynamicAllocation DynamicAllocator::allocate( u32 size, u32 buffer_type_mask ) {
+
+    const u32 alignment = get_alignment( buffer_type_mask );
+    DynamicAllocation allocation;
+
+    if ( size <= capacity ) {
+        // Lock-free bump of the head, retried if another thread allocated in the meantime.
+        for ( ;; ) {
+            const u32 current_head = ( u32 )head;
+            const u32 physical = current_head & ( capacity - 1 );
+
+            u32 start = ( u32 )memory_align( physical, alignment );
+            if ( start + size > capacity ) {
+                // Wrap: the end of the ring is skipped.
+                start = capacity;
+            }
+
+            const u32 skipped = start - physical;
+            const u32 new_head = current_head + skipped + size;
+            if ( new_head - tail > capacity ) {
+                break;
+            }
+
+            if ( atomic_compare_exchange( &head, ( i32 )current_head, ( i32 )new_head ) ) {
+                start &= capacity - 1;
+
+                atomic_increment( ( volatile i32* )&frame_stats.allocations );
+                atomic_add( ( volatile i32* )&frame_stats.allocated_bytes, ( i32 )size );
+                atomic_add( ( volatile i32* )&frame_stats.alignment_bytes, ( i32 )skipped );
+
+                allocation.data = mapped_memory + start;
+                allocation.buffer = buffer;
+                allocation.offset = start;
+                allocation.size = size;
+                return allocation;
+            }
+        }
+    }
+
+    if ( buffer_type_mask & BufferType::Constant_mask ) {
+        // Reported once in end_frame, this can fail for every draw of the frame.
+        atomic_increment( ( volatile i32* )&frame_stats.failed_allocations );
+        return allocation;
+    }
+
+    return allocate_overflow( size, alignment );
+}
+
+//
+// Overflow pages are rare, they are created with the device while holding the lock.
+DynamicAllocation DynamicAllocator::allocate_overflow( u32 size, u32 alignment ) {
+
+    ScopedLock lock( page_mutex );
+
+    DynamicPage* page = nullptr;
+    u32 start = 0;
+
+    // Search first in the pages of this frame, then in the free ones.
+    for ( u32 i = 0; i < pages.size && !page; ++i ) {
+        DynamicPage& candidate = pages[ i ];
+        if ( candidate.frame != current_frame ) {
+            continue;
+        }
+
+        start = ( u32 )memory_align( candidate.allocated, alignment );
+        if ( start + size <= candidate.size ) {
+            page = &candidate;
+        }
+    }
+
+    for ( u32 i = 0; i < pages.size && !page; ++i ) {
+        DynamicPage& candidate = pages[ i ];
+        if ( candidate.frame == u32_max && size <= candidate.size ) {
+            page = &candidate;
+            start = 0;
+        }
+    }
+
+    if ( !page ) {
+        BufferCreation bc;
+        bc.set( ( BufferType::Mask )( BufferType::Vertex_mask | BufferType::Index_mask ), ResourceUsageType::Immutable, max( page_size, size ) ).set_name( "Dynamic_Overflow_Page" );
+
+        DynamicPage& new_page = pages.push_use();
+        new_page.buffer = gpu->create_buffer( bc );
+        new_page.size = max( page_size, size );
+        new_page.allocated = 0;
+        new_page.frame = u32_max;
+
+        MapBufferParameters page_map = { new_page.buffer, 0, 0 };
+        new_page.data = ( u8* )gpu->map_buffer( page_map );
+
+        hprint( "Dynamic allocator: frame overflowed the ring, added page %u of %u bytes.\n", pages.size - 1, new_page.size );
+
+        page = &new_page;
+        start = 0;
+    }
+
+    page->frame = current_frame;
+    page->allocated = start + size;
+
+    atomic_increment( ( volatile i32* )&frame_stats.overflow_allocations );
+    atomic_add( ( volatile i32* )&frame_stats.overflow_bytes, ( i32 )size );
+    atomic_increment( ( volatile i32* )&frame_stats.allocations );
+    atomic_add( ( volatile i32* )&frame_stats.allocated_bytes, ( i32 )size );
+
+    DynamicAllocation allocation;
+    allocation.data = page->data + start;
+    allocation.buffer = page->buffer;
+    allocation.offset = start;
+    allocation.size = size;
+    return allocation;
+}
+
+//
+// Called after the device waited for the fence of frame: everything allocated by it is free again.
+void DynamicAllocator::begin_frame( u32 frame ) {
+
+    // Frames complete in order, never move the tail backwards.
+    if ( ( i32 )( frame_end[ frame ] - tail ) > 0 ) {
+        tail = frame_end[ frame ];
+    }
+
+    for ( u32 i = 0; i < pages.size; ++i ) {
+        if ( pages[ i ].frame == frame ) {
+            pages[ i ].frame = u32_max;
+            pages[ i ].allocated = 0;
+        }
+    }
+
+    current_frame = frame;
+    frame_start = ( u32 )head;
+    frame_stats.reset();
+}
+
+void DynamicAllocator::end_frame( u32 frame ) {
+
+    frame_end[ frame ] = ( u32 )head;
+
+    peak_frame_bytes = max( peak_frame_bytes, frame_end[ frame ] - frame_start );
+    last_frame_stats = frame_stats;
+
+    if ( frame_stats.failed_allocations ) {
+        hprint( "Dynamic allocator: ring full, %u constants allocations failed this frame. Increase the ring size.\n", frame_stats.failed_allocations );
+    }
+}
+
+// ResourceListCache ////////////////////////////////////////////////////////////
+
+void ResourceListCache::init( Allocator* allocator ) {
+    lists.init( allocator, 64 );
+    lists.set_default_value( k_invalid_index );
+    entries.init( allocator, 64 );
+
+    hits = misses = collisions = num_lists = 0;
+}
+
+void ResourceListCache::shutdown() {
+
+    if ( num_lists ) {
+        hprint( "Resource list cache: %u resource lists still referenced at shutdown.\n", num_lists );
+    }
+
+    lists.shutdown();
+    entries.shutdown();
+}
+
+// TransientListAllocator ///////////////////////////////////////////////////////
+
+void TransientListAllocator::init( Allocator* fallback_allocator, sizet size ) {
+    linear.init( size );
+    fallback = fallback_allocator;
+    fallback_allocations.init( fallback_allocator, 8 );
+    requested_size = 0;
+}
+
+void TransientListAllocator::shutdown() {
+    reset();
+    fallback_allocations.shutdown();
+    linear.shutdown();
+}
+
+void* TransientListAllocator::allocate( sizet size, sizet alignment ) {
+    requested_size += size + alignment;
+
+    if ( memory_align( linear.allocated_size, alignment ) + size <= linear.total_size ) {
+        return linear.allocate( size, alignment );
+    }
+
+    void* pointer = fallback->allocate( size, alignment );
+    fallback_allocations.push( pointer );
+    return pointer;
+}
+
+void* TransientListAllocator::allocate( sizet size, sizet alignment, cstring file, i32 line ) {
+    return allocate( size, alignment );
+}
+
+void TransientListAllocator::deallocate( void* ) {
+    // Memory is released all at once in reset.
+}
+
+void TransientListAllocator::reset() {
+
+    if ( fallback_allocations.size ) {
+        for ( u32 i = 0; i < fallback_allocations.size; ++i ) {
+            fallback->deallocate( fallback_allocations[ i ] );
+        }
+        fallback_allocations.clear();
+
+        // Grow so that the next frames fit in the linear memory.
+        const sizet new_size = max( linear.total_size * 2, requested_size );
+        hprint( "Transient resource lists: frame needed %llu bytes, growing memory from %llu to %llu bytes.\n", ( u64 )requested_size, ( u64 )linear.total_size, ( u64 )new_size );
+        linear.shutdown();
+        linear.init( new_size );
+    }
+
+    linear.clear();
+    requested_size = 0;
+}
+
+// ResourceUpdateQueues /////////////////////////////////////////////////////////
+
+void ResourceUpdateQueues::init( Allocator* allocator, u32 initial_capacity ) {
+
+    for ( u32 f = 0; f < k_max_swapchain_images; ++f ) {
+        for ( u32 t = 0; t < ResourceDeletionType::Count; ++t ) {
+            deletions[ f ][ t ].init( allocator, initial_capacity );
+        }
+    }
+
+    resource_list_updates.init( allocator, initial_capacity );
+    bindless_updates.init( allocator, initial_capacity );
+}
+
+void ResourceUpdateQueues::shutdown() {
+
+    for ( u32 f = 0; f < k_max_swapchain_images; ++f ) {
+        for ( u32 t = 0; t < ResourceDeletionType::Count; ++t ) {
+            deletions[ f ][ t ].shutdown();
+        }
+    }
+
+    resource_list_updates.shutdown();
+    bindless_updates.shutdown();
+}
+
+void ResourceUpdateQueues::push_deletion( ResourceDeletionType::Enum type, ResourceHandle handle, u32 frame ) {
+    deletions[ frame ][ type ].push( handle );
+}
+
+void ResourceUpdateQueues::push_resource_list_update( ResourceListHandle resource_list ) {
+    resource_list_updates.push( resource_list );
+}
+
+void ResourceUpdateQueues::push_bindless_update( TextureHandle texture ) {
+    bindless_updates.push( texture );
+}
+
+void ResourceUpdateQueues::clear_deletions( u32 frame ) {
+    for ( u32 t = 0; t < ResourceDeletionType::Count; ++t ) {
+        deletions[ frame ][ t ].clear();
+    }
+}
+
+u32 ResourceUpdateQueues::count_deletions( u32 frame ) const {
+    u32 count = 0;
+    for ( u32 t = 0; t < ResourceDeletionType::Count; ++t ) {
+        count += deletions[ frame ][ t ].size;
+    }
+    return count;
+}
+
 } // namespace gfx
 } // namespace hydra
@@ -2,9 +2,13 @@
 
 #include "graphics/gpu_resources.hpp"
 
+#include "kernel/array.hpp"
 #include "kernel/data_structures.hpp"
+#include "kernel/hash_map.hpp"
 #include "kernel/string.hpp"
+#include "kernel/string_id.hpp"
 #include "kernel/service.hpp"
+#include "kernel/thread.hpp"
 
 namespace hydra {
 
@@ -35,10 +39,14 @@ struct GPUTimestamp {
     u32                             color;
     u32                             frame_index;
 
-    const char*                     name;
+    StringId                        name;
 }; // struct GPUTimestamp
 
 
+//
+// Queries exceeding queries_per_frame are dropped for the frame, then the backend calls grow
+// at the end of it: the capacity is doubled until the whole frame fits or the u16 limit is reached.
+// Queries of a frame are read back when the backend waited for its fence, so reading never stalls.
 struct GPUTimestampManager {
 
     void                            init( Allocator* allocator, u16 queries_per_frame, u16 max_frames );
@@ -46,24 +54,305 @@ struct GPUTimestampManager {
 
     bool                            has_valid_queries() const;
     void                            reset();
-    u32                             resolve( u32 current_frame, GPUTimestamp* timestamps_to_fill );    // Returns the total queries for this frame.
+    void                            end_frame( u32 frame );                         // Called at present, before reset.
+    void                            resolve_frame( u32 frame );                     // Called once the frame fence was waited and elapsed_ms filled.
+    u32                             resolve( GPUTimestamp* timestamps_to_fill );    // Returns the total queries of the last resolved frame.
 
-    u32                             push( u32 current_frame, const char* name );    // Returns the timestamp query index.
+    u32                             push( u32 current_frame, StringId name );       // Returns the timestamp query index, or k_invalid_index if dropped.
     u32                             pop( u32 current_frame );
 
+    bool                            needs_grow() const          { return dropped_queries != 0 && queries_per_frame < u16_max; }
+    void                            grow();                     // Discards all the frames data, the backend must recreate its queries.
+
     Allocator*                      allocator                   = nullptr;
     GPUTimestamp*                   timestamps                  = nullptr;
+    GPUTimestamp*                   resolved_timestamps         = nullptr;  // Copy of the last resolved frame, as its slot is reused while recording.
     u64*                            timestamps_data             = nullptr;
 
     u32                             queries_per_frame           = 0;
+    u32                             max_frames                  = 0;
     u32                             current_query               = 0;
     u32                             parent_index                = 0;
     u32                             depth                       = 0;
 
+    u32                             frame_queries[ k_max_swapchain_images ];    // Queries of each frame in flight, 0 once resolved or if not valid.
+    u32                             resolved_queries            = 0;        // Queries of the last resolved frame.
+    u32                             dropped_queries             = 0;        // Pushes exceeding queries_per_frame in the current frame.
+    u32                             dropped_depth               = 0;        // Open dropped scopes, their pops are dropped too.
+
     bool                            current_frame_resolved      = false;    // Used to query the GPU only once per frame if get_gpu_timestamps is called more than once per frame.
 
 }; // struct GPUTimestampManager
 
+//
+// Entry sorted by the replay: the offset points to the command header in its stream data.
+struct DeferredCommandKey {
+
+    u64                             sort_key;
+    u32                             offset;
+    u16                             stream_index;
+    u16                             padding;
+
+}; // struct DeferredCommandKey
+
+//
+//
+struct DeferredReplayStats {
+
+    u32                             num_streams;
+    u32                             recorded_commands;
+    u32                             replayed_commands;
+
+    u32                             removed_pipeline_binds;
+    u32                             removed_resource_list_binds;
+    u32                             removed_vertex_buffer_binds;
+    u32                             removed_index_buffer_binds;
+
+    void                            reset();
+    void                            accumulate( const DeferredReplayStats& other );
+
+}; // struct DeferredReplayStats
+
+//
+// Bind commands sent to the API and skipped because the same state was already bound.
+struct BindCommandStats {
+
+    u32                             issued_pipelines;
+    u32                             filtered_pipelines;
+    u32                             issued_resource_lists;
+    u32                             filtered_resource_lists;
+    u32                             issued_vertex_buffers;
+    u32                             filtered_vertex_buffers;
+    u32                             issued_index_buffers;
+    u32                             filtered_index_buffers;
+    u32                             pending_pipelines;          // Binds of pipelines still compiling.
+    u32                             skipped_draws;              // Draws and dispatches skipped because of a pending pipeline.
+
+    void                            reset();
+    void                            accumulate( const BindCommandStats& other );
+
+}; // struct BindCommandStats
+
+// Frame pacing /////////////////////////////////////////////////////////////////
+
+//
+// What limits the frame rate, estimated from the CPU waits measured by the device.
+namespace FrameBound {
+    enum Enum {
+        CPU, GPU, Present, Count
+    };
+
+    static const char* s_value_names[] = {
+        "CPU", "GPU", "Present", "Count"
+    };
+
+    static const char* ToString( Enum e ) {
+        return ((u32)e < Enum::Count ? s_value_names[(int)e] : "unsupported" );
+    }
+} // namespace FrameBound
+
+//
+// CPU timings of a frame in milliseconds, measured by the device in new_frame and present.
+struct FrameTimings {
+
+    f32                             frame;                      // From the end of the previous present to the end of this one.
+    f32                             fence_wait;                 // Waiting for the GPU to release a frame: grows when GPU bound.
+    f32                             record;                     // From the end of new_frame to the start of present.
+    f32                             acquire;                    // Swapchain image acquire, waits for vertical sync when present bound.
+    f32                             submit;                     // Sort and replay of command buffers plus the queue submit.
+    f32                             present;
+
+}; // struct FrameTimings
+
+//
+// Rolling history of FrameTimings, used by both the ImGui and the headless report.
+struct FramePacingStats {
+
+    void                            reset();
+    void                            add_frame( const FrameTimings& timings );
+
+    void                            compute_average( FrameTimings& out_average ) const;
+    FrameBound::Enum                compute_bound( const FrameTimings& average ) const;
+
+    void                            print() const;
+
+    static constexpr u32            k_history_frames = 128;
+
+    FrameTimings                    history[ k_history_frames ];
+    u32                             num_frames;
+    u32                             next_frame;
+    u32                             frames_in_flight;
+
+}; // struct FramePacingStats
+
+// Dynamic allocator ////////////////////////////////////////////////////////////
+
+//
+//
+struct DynamicAllocation {
+
+    u8*                             data            = nullptr;
+    BufferHandle                    buffer          = k_invalid_buffer; // Buffer containing the allocation: the ring or an overflow page.
+    u32                             offset          = 0;
+    u32                             size            = 0;
+
+}; // struct DynamicAllocation
+
+//
+//
+struct DynamicAllocatorStats {
+
+    u32                             allocations;
+    u32                             allocated_bytes;
+    u32                             alignment_bytes;            // Lost to alignment and to wrapping at the end of the ring.
+    u32                             overflow_allocations;
+    u32                             overflow_bytes;
+    u32                             failed_allocations;         // Constants not fitting in the ring: they can't go in overflow pages.
+
+    void                            reset();
+
+}; // struct DynamicAllocatorStats
+
+//
+// Overflow page, owned by a frame until the device waited for that frame.
+struct DynamicPage {
+
+    BufferHandle                    buffer;
+    u8*                             data;
+    u32                             size;
+    u32                             allocated;
+    u32                             frame;                      // u32_max when free.
+
+}; // struct DynamicPage
+
+//
+// Upload ring for per frame data, in a persistently mapped buffer.
+// Frames allocate one after the other, and the memory of a frame is reclaimed in begin_frame, called
+// after the device waited for the fence of that frame. When the ring is full allocations go in
+// overflow pages, created on demand and reused once their frame is done. Constants can't overflow,
+// as dynamic constants descriptors point to the ring buffer.
+struct DynamicAllocator {
+
+    void                            init( Device* gpu, u32 size, u32 constants_alignment, u32 storage_alignment );
+    void                            shutdown();
+
+    DynamicAllocation               allocate( u32 size, u32 buffer_type_mask );     // Thread safe.
+
+    void                            begin_frame( u32 frame );
+    void                            end_frame( u32 frame );
+
+    u32                             get_alignment( u32 buffer_type_mask ) const;
+
+    DynamicAllocation               allocate_overflow( u32 size, u32 alignment );
+
+    Device*                         gpu                 = nullptr;
+
+    BufferHandle                    buffer;
+    u8*                             mapped_memory       = nullptr;
+    u32                             capacity            = 0;        // Power of two, so that virtual offsets can wrap around u32.
+
+    // Virtual offsets, the physical one is offset & (capacity - 1).
+    volatile i32                    head                = 0;
+    u32                             tail                = 0;
+    u32                             frame_start         = 0;
+    u32                             frame_end[ k_max_swapchain_images ];
+    u32                             current_frame       = 0;
+
+    u32                             constants_alignment = 256;
+    u32                             storage_alignment   = 256;
+    u32                             vertex_alignment    = 16;
+
+    Array<DynamicPage>              pages;
+    Mutex                           page_mutex;
+    u32                             page_size           = 0;
+
+    DynamicAllocatorStats           frame_stats;
+    DynamicAllocatorStats           last_frame_stats;
+    u32                             peak_frame_bytes    = 0;        // Ring bytes used by the biggest frame.
+
+    static constexpr u32            k_default_page_size = 4 * 1024 * 1024;
+
+}; // struct DynamicAllocator
+
+// Resource update queues ///////////////////////////////////////////////////////
+
+//
+// Deferred deletions and descriptor updates. Deletions are bucketed by the frame that issued them
+// and stored per resource type, so that a frame is released with one loop per type when its index
+// comes back, without walking the other frames' entries. Resource list and bindless updates are all
+// flushed at the next frame, so they have a single bucket and no per frame cap.
+struct ResourceUpdateQueues {
+
+    void                            init( Allocator* allocator, u32 initial_capacity );
+    void                            shutdown();
+
+    void                            push_deletion( ResourceDeletionType::Enum type, ResourceHandle handle, u32 frame );
+    void                            push_resource_list_update( ResourceListHandle resource_list );
+    void                            push_bindless_update( TextureHandle texture );
+
+    void                            clear_deletions( u32 frame );
+    u32                             count_deletions( u32 frame ) const;
+
+    Array<ResourceHandle>           deletions[ k_max_swapchain_images ][ ResourceDeletionType::Count ];
+    Array<ResourceListHandle>       resource_list_updates;
+    Array<TextureHandle>            bindless_updates;
+
+}; // struct ResourceUpdateQueues
+
+// Resource list cache //////////////////////////////////////////////////////////
+
+//
+//
+struct ResourceListCacheEntry {
+
+    ResourceListCreation            creation;                   // Contents compared on lookup, without the name.
+    u64                             hash;                       // Key in the map, moved forward on collisions.
+    u32                             references;                 // 0 when the resource list is not cached.
+
+}; // struct ResourceListCacheEntry
+
+//
+// Resource lists shared by all the users creating them with the same layout, resources and samplers.
+// Lists are found by the hash of the creation contents and are ref-counted: the last release destroys them.
+// Colliding hashes with different contents are stored at the next free key.
+// Cached lists must not be updated, as all the users would see the change.
+struct ResourceListCache {
+
+    void                            init( Allocator* allocator );
+    void                            shutdown();
+
+    FlatHashMap<u64, u32>           lists;                      // Creation hash to resource list index.
+    Array<ResourceListCacheEntry>   entries;                    // Indexed by resource list index.
+
+    u32                             hits                = 0;
+    u32                             misses              = 0;
+    u32                             collisions          = 0;
+    u32                             num_lists           = 0;
+
+}; // struct ResourceListCache
+
+//
+// Per frame memory of transient resource lists. Allocations not fitting in the linear memory fall back
+// to the device allocator and are freed on reset, where the linear memory grows to fit the whole frame.
+struct TransientListAllocator : public Allocator {
+
+    void                            init( Allocator* fallback_allocator, sizet size );
+    void                            shutdown();
+
+    void*                           allocate( sizet size, sizet alignment ) override;
+    void*                           allocate( sizet size, sizet alignment, cstring file, i32 line ) override;
+
+    void                            deallocate( void* pointer ) override;
+
+    void                            reset();
+
+    LinearAllocator                 linear;
+    Allocator*                      fallback            = nullptr;
+    Array<void*>                    fallback_allocations;
+    sizet                           requested_size      = 0;    // Bytes requested since the last reset, alignment included.
+
+}; // struct TransientListAllocator
+
 
 //
 //
@@ -78,8 +367,13 @@ struct DeviceCreation {
     bool                            enable_gpu_time_queries = false;
     bool                            debug           = false;
 
+    cstring                         pipeline_cache_path = nullptr;  // File storing compiled pipelines between runs, not used if null.
+    u16                             frames_in_flight = k_max_swapchain_images;    // Frames recorded while the GPU executes previous ones, 1 to k_max_swapchain_images.
+
     DeviceCreation&                 set_window( u32 width, u32 height, void* handle );
     DeviceCreation&                 set_allocator( Allocator* allocator );
+    DeviceCreation&                 set_pipeline_cache_path( cstring path );
+    DeviceCreation&                 set_frames_in_flight( u32 frames );
 
 }; // struct DeviceCreation
 
@@ -103,6 +397,9 @@ struct Device : public Service {
     RenderPassHandle                create_render_pass( const RenderPassCreation& creation );
     ShaderStateHandle               create_shader_state( const ShaderStateCreation& creation );
 
+    PipelineHandle                  create_pipeline_async( const PipelineCreation& creation );  // Shaders and layout are created now, the pipeline on the compile thread.
+    bool                            is_pipeline_ready( PipelineHandle pipeline );                // Draws with a pipeline not ready are skipped.
+
     void                            destroy_buffer( BufferHandle buffer );
     void                            destroy_texture( TextureHandle texture );
     void                            destroy_pipeline( PipelineHandle pipeline );
@@ -112,6 +409,14 @@ struct Device : public Service {
     void                            destroy_render_pass( RenderPassHandle render_pass );
     void                            destroy_shader_state( ShaderStateHandle shader );
 
+    // Resource lists sharing and pooling ///////////////////////////////////////
+    ResourceListHandle              create_resource_list_cached( const ResourceListCreation& creation );   // Returns an existing list with the same contents if any, with one more reference.
+    void                            destroy_resource_list_cached( ResourceListHandle resource_list );      // Removes a reference, the last one destroys the list.
+
+    ResourceListHandle              create_resource_list_transient( const ResourceListCreation& creation ); // Valid for the current frame only, do not destroy it.
+
+    const ResourceListCache&        get_resource_list_cache() const                 { return resource_list_cache; }
+
     // Query Description ////////////////////////////////////////////////////////
     void                            query_buffer( BufferHandle buffer, BufferDescription& out_description );
     void                            query_texture( TextureHandle texture, TextureDescription& out_description );
@@ -136,15 +441,21 @@ struct Device : public Service {
     void*                           map_buffer( const MapBufferParameters& parameters );
     void                            unmap_buffer( const MapBufferParameters& parameters );
 
-    void*                           dynamic_allocate( u32 size );
+    void*                           dynamic_allocate( u32 size );                                   // Aligned for constants, from the ring only.
+    DynamicAllocation               dynamic_allocate( u32 size, BufferType::Mask usage );           // Aligned for usage, vertex and index data can overflow in extra pages.
+
+    const DynamicAllocatorStats&    get_dynamic_stats() const                       { return dynamic_allocator.last_frame_stats; }
 
     void                            set_buffer_global_offset( BufferHandle buffer, u32 offset );
 
     // Command Buffers //////////////////////////////////////////////////////////
-    CommandBuffer*                  get_command_buffer( QueueType::Enum type, bool begin );
+    // Each recording thread uses its own index, and gets buffers from its own per frame pools.
+    // Buffers are submitted in the order they were requested, so request them from one thread
+    // (in the wanted order) and hand them to the recording threads.
+    CommandBuffer*                  get_command_buffer( u32 thread_index, QueueType::Enum type, bool begin );
     CommandBuffer*                  get_instant_command_buffer();
 
-    void                            queue_command_buffer( CommandBuffer* command_buffer );          // Queue command buffer that will not be executed until present is called.
+    void                            queue_command_buffer( CommandBuffer* command_buffer );          // Queue command buffer that will not be executed until present is called. Thread safe.
 
     // Rendering ////////////////////////////////////////////////////////////////
     void                            new_frame();
@@ -164,13 +475,24 @@ struct Device : public Service {
     // GPU Timings //////////////////////////////////////////////////////////////
     void                            set_gpu_timestamps_enable( bool value )         { timestamps_enabled = value; }
 
-    u32                             get_gpu_timestamps( GPUTimestamp* out_timestamps );
-    void                            push_gpu_timestamp( CommandBuffer* command_buffer, const char* name );
+    u32                             get_gpu_timestamps( GPUTimestamp* out_timestamps );         // out_timestamps must hold get_gpu_timestamps_per_frame entries.
+    u32                             get_gpu_timestamps_per_frame() const            { return gpu_timestamp_manager->queries_per_frame; }
+    void                            push_gpu_timestamp( CommandBuffer* command_buffer, StringId name );
     void                            pop_gpu_timestamp( CommandBuffer* command_buffer );
     
     // Internals ////////////////////////////////////////////////////////////////
     void                            backend_init( const DeviceCreation& creation );
     void                            backend_shutdown();
+
+    void                            sort_queued_command_buffers();
+    void                            replay_deferred_command_buffers();
+    void                            gather_bind_stats();
+
+    const BindCommandStats&         get_bind_stats() const                          { return bind_stats; }     // Of the last presented frame.
+    const FramePacingStats&         get_frame_pacing() const                        { return frame_pacing; }
+    u32                             get_frames_in_flight() const                    { return frames_in_flight; }
+
+    void                            end_frame_timings();                            // Called at the end of present.
     
     ResourcePool                    buffers;
     ResourcePool                    textures;
@@ -196,15 +518,26 @@ struct Device : public Service {
 
     Allocator*                      allocator;
 
-    u32                             dynamic_max_per_frame_size;
-    BufferHandle                    dynamic_buffer;
-    u8*                             dynamic_mapped_memory;
-    u32                             dynamic_allocated_size;
+    DynamicAllocator                dynamic_allocator;
     u32                             dynamic_per_frame_size;
 
+    ResourceUpdateQueues            update_queues;
+    ResourceListCache               resource_list_cache;
+
     CommandBuffer**                 queued_command_buffers              = nullptr;
     u32                             num_allocated_command_buffers       = 0;
     u32                             num_queued_command_buffers          = 0;
+    volatile i32                    command_buffer_sequence             = 0;        // Source of CommandBuffer::submit_order, reset every frame.
+
+    Array<DeferredCommandKey>       deferred_sort_keys;
+    Array<DeferredCommandKey>       deferred_sort_scratch;
+    DeferredReplayStats             deferred_stats;                                 // Sum of the replays of deferred command buffers at the last present.
+    BindCommandStats                bind_stats;
+
+    FramePacingStats                frame_pacing;
+    FrameTimings                    frame_timings;                                  // Current frame, added to frame_pacing at present.
+    i64                             record_start_time                   = 0;        // End of new_frame.
+    i64                             last_present_time                   = 0;
 
     //DeviceRenderFrame*              render_frames;
 
@@ -213,6 +546,7 @@ struct Device : public Service {
     u32                             previous_frame;
 
     u32                             absolute_frame;
+    u32                             frames_in_flight                    = k_max_swapchain_images;
 
     u16                             swapchain_width                     = 1;
     u16                             swapchain_height                    = 1;
@@ -225,6 +559,7 @@ struct Device : public Service {
     bool                            vertical_sync                       = false;
 
     static constexpr cstring        k_name = "hydra_gpu_service";
+    static constexpr u32            k_max_queued_command_buffers = 128;
 
 
     ShaderStateAPIGnostic*          access_shader_state( ShaderStateHandle shader );
@@ -0,0 +1,1278 @@
+#include "graphics/gpu_device_null.hpp"
+#include "graphics/command_buffer.hpp"
+
+#include "kernel/log.hpp"
+#include "kernel/memory.hpp"
+#include "kernel/memory_utils.hpp"
+#include "kernel/numerics.hpp"
+#include "kernel/thread.hpp"
+#include "kernel/time.hpp"
+
+#if defined(HYDRA_NULL)
+
+#include <string.h>
+
+namespace hydra {
+namespace gfx {
+
+//
+// Mirrors the Vulkan ring: one pool per frame in flight and recording thread, buffers are never submitted anywhere.
+struct CommandBufferRing {
+
+    void                    init( GpuDeviceNull* gpu );
+    void                    shutdown();
+
+    void                    reset_pools( u32 frame_index );
+
+    CommandBuffer*          get_command_buffer( u32 frame, u32 thread_index, bool begin );
+    CommandBuffer*          get_command_buffer_instant( u32 frame, bool begin );
+
+    static u16              pool_from_indices( u32 frame_index, u32 thread_index ) { return (u16)(frame_index * k_max_threads) + thread_index; }
+
+    static const u16        k_max_threads = k_max_recording_threads;
+    static const u16        k_max_pools = GpuDeviceNull::k_max_frames * k_max_threads;
+    static const u16        k_buffer_per_pool = 8;      // Last buffer of each pool is reserved for instant commands.
+    static const u16        k_max_buffers = k_buffer_per_pool * k_max_pools;
+    static const u32        k_initial_stream_size = 64 * 1024;
+
+    GpuDeviceNull*          gpu;
+    CommandBuffer           command_buffers[ k_max_buffers ];
+    u8                      next_free_per_thread_frame[ k_max_pools ];
+
+}; // struct CommandBufferRing
+
+void CommandBufferRing::init( GpuDeviceNull* gpu_ ) {
+
+    gpu = gpu_;
+
+    for ( u32 i = 0; i < k_max_buffers; i++ ) {
+        const u32 pool_index = i / k_buffer_per_pool;
+
+        command_buffers[ i ].device = gpu;
+        command_buffers[ i ].handle = i;
+        command_buffers[ i ].thread_index = pool_index % k_max_threads;
+        command_buffers[ i ].init( QueueType::Graphics, k_initial_stream_size, 0, false );
+    }
+
+    for ( u32 i = 0; i < k_max_pools; i++ ) {
+        next_free_per_thread_frame[ i ] = 0;
+    }
+}
+
+void CommandBufferRing::shutdown() {
+    for ( u32 i = 0; i < k_max_buffers; i++ ) {
+        command_buffers[ i ].terminate();
+    }
+}
+
+void CommandBufferRing::reset_pools( u32 frame_index ) {
+
+    for ( u32 t = 0; t < k_max_threads; t++ ) {
+        const u32 pool_index = pool_from_indices( frame_index, t );
+
+        for ( u32 i = 0; i < k_buffer_per_pool; i++ ) {
+            command_buffers[ pool_index * k_buffer_per_pool + i ].reset();
+        }
+
+        next_free_per_thread_frame[ pool_index ] = 0;
+    }
+}
+
+CommandBuffer* CommandBufferRing::get_command_buffer( u32 frame, u32 thread_index, bool begin ) {
+    hy_assertm( thread_index < k_max_threads, "Thread index %u out of range, max recording threads %u", thread_index, k_max_threads );
+
+    const u32 pool_index = pool_from_indices( frame, thread_index );
+    u8& next_free = next_free_per_thread_frame[ pool_index ];
+    hy_assertm( next_free < k_buffer_per_pool - 1, "Command buffers of thread %u exhausted for this frame.", thread_index );
+
+    CommandBuffer* cb = &command_buffers[ pool_index * k_buffer_per_pool + next_free ];
+    ++next_free;
+
+    if ( begin ) {
+        cb->reset();
+    }
+
+    return cb;
+}
+
+CommandBuffer* CommandBufferRing::get_command_buffer_instant( u32 frame, bool begin ) {
+    CommandBuffer* cb = &command_buffers[ pool_from_indices( frame, 0 ) * k_buffer_per_pool + k_buffer_per_pool - 1 ];
+    return cb;
+}
+
+// Device implementation //////////////////////////////////////////////////
+
+static GpuDeviceNull s_null_device;
+
+Device* Device::instance() {
+    return &s_null_device;
+}
+
+void Device::backend_init( const DeviceCreation& creation ) {
+    s_null_device.internal_init( creation );
+}
+
+void Device::backend_shutdown() {
+    s_null_device.internal_shutdown();
+}
+
+// Resource Creation ////////////////////////////////////////////////////////////
+
+BufferHandle Device::create_buffer( const BufferCreation& creation ) {
+    return s_null_device.create_buffer( creation );
+}
+
+TextureHandle Device::create_texture( const TextureCreation& creation ) {
+    return s_null_device.create_texture( creation );
+}
+
+PipelineHandle Device::create_pipeline( const PipelineCreation& creation ) {
+    return s_null_device.create_pipeline( creation );
+}
+
+// Nothing to compile in the null backend, pipelines are ready when created.
+PipelineHandle Device::create_pipeline_async( const PipelineCreation& creation ) {
+    return s_null_device.create_pipeline( creation );
+}
+
+bool Device::is_pipeline_ready( PipelineHandle pipeline ) {
+    return true;
+}
+
+SamplerHandle Device::create_sampler( const SamplerCreation& creation ) {
+    return s_null_device.create_sampler( creation );
+}
+
+ResourceLayoutHandle Device::create_resource_layout( const ResourceLayoutCreation& creation ) {
+    return s_null_device.create_resource_layout( creation );
+}
+
+ResourceListHandle Device::create_resource_list( const ResourceListCreation& creation ) {
+    return s_null_device.create_resource_list( creation );
+}
+
+ResourceListHandle Device::create_resource_list_transient( const ResourceListCreation& creation ) {
+    return s_null_device.create_resource_list_transient( creation );
+}
+
+RenderPassHandle Device::create_render_pass( const RenderPassCreation& creation ) {
+    return s_null_device.create_render_pass( creation );
+}
+
+ShaderStateHandle Device::create_shader_state( const ShaderStateCreation& creation ) {
+    return s_null_device.create_shader_state( creation );
+}
+
+// Resource Destruction /////////////////////////////////////////////////////////
+
+void Device::destroy_buffer( BufferHandle buffer ) {
+    s_null_device.destroy_buffer( buffer );
+}
+
+void Device::destroy_texture( TextureHandle texture ) {
+    s_null_device.destroy_texture( texture );
+}
+
+void Device::destroy_pipeline( PipelineHandle pipeline ) {
+    s_null_device.destroy_pipeline( pipeline );
+}
+
+void Device::destroy_sampler( SamplerHandle sampler ) {
+    s_null_device.destroy_sampler( sampler );
+}
+
+void Device::destroy_resource_layout( ResourceLayoutHandle resource_layout ) {
+    s_null_device.destroy_resource_layout( resource_layout );
+}
+
+void Device::destroy_resource_list( ResourceListHandle resource_list ) {
+    s_null_device.destroy_resource_list( resource_list );
+}
+
+void Device::destroy_render_pass( RenderPassHandle render_pass ) {
+    s_null_device.destroy_render_pass( render_pass );
+}
+
+void Device::destroy_shader_state( ShaderStateHandle shader ) {
+    s_null_device.destroy_shader_state( shader );
+}
+
+// Misc ///////////////////////////////////////////////////////////////////
+void Device::resize_output_textures( RenderPassHandle render_pass, u32 width, u32 height ) {
+    s_null_device.resize_output_textures( render_pass, width, height );
+}
+
+void Device::link_texture_sampler( TextureHandle texture, SamplerHandle sampler ) {
+    s_null_device.link_texture_sampler( texture, sampler );
+}
+
+void Device::fill_barrier( RenderPassHandle render_pass, ExecutionBarrier& out_barrier ) {
+    s_null_device.fill_barrier( render_pass, out_barrier );
+}
+
+void Device::new_frame() {
+    s_null_device.new_frame();
+}
+
+void Device::present() {
+    s_null_device.present();
+}
+
+void Device::set_presentation_mode( PresentMode::Enum mode ) {
+    // Nothing is presented, just cache the mode.
+    present_mode = mode;
+}
+
+void* Device::map_buffer( const MapBufferParameters& parameters ) {
+    return s_null_device.map_buffer( parameters );
+}
+
+void Device::unmap_buffer( const MapBufferParameters& parameters ) {
+    s_null_device.unmap_buffer( parameters );
+}
+
+static sizet s_ubo_alignment = 256;
+
+void Device::set_buffer_global_offset( BufferHandle buffer, u32 offset ) {
+    s_null_device.set_buffer_global_offset( buffer, offset );
+}
+
+void Device::queue_command_buffer( CommandBuffer* command_buffer ) {
+
+    s_null_device.queue_command_buffer( command_buffer );
+}
+
+CommandBuffer* Device::get_command_buffer( u32 thread_index, QueueType::Enum type, bool begin ) {
+    return s_null_device.get_command_buffer( thread_index, type, begin );
+}
+
+CommandBuffer* Device::get_instant_command_buffer() {
+    return s_null_device.get_instant_command_buffer();
+}
+
+void Device::update_resource_list( ResourceListHandle resource_list ) {
+    s_null_device.update_resource_list( resource_list );
+}
+
+u32 Device::get_gpu_timestamps( GPUTimestamp* out_timestamps ) {
+    return s_null_device.get_gpu_timestamps( out_timestamps );
+}
+
+void Device::push_gpu_timestamp( CommandBuffer* command_buffer, StringId name ) {
+    s_null_device.push_gpu_timestamp( command_buffer, name );
+}
+
+void Device::pop_gpu_timestamp( CommandBuffer* command_buffer ) {
+    s_null_device.pop_gpu_timestamp( command_buffer );
+}
+
+// GpuDeviceNull //////////////////////////////////////////////////////////
+
+static CommandBufferRing command_buffer_ring;
+
+//
+// Pools are cleared so that 'alive' is false for never used slots.
+static void null_init_pool( ResourcePool& pool, Allocator* allocator, u32 pool_size, u32 resource_size ) {
+    pool.init( allocator, pool_size, resource_size );
+    memset( pool.memory, 0, pool_size * resource_size );
+}
+
+void GpuDeviceNull::internal_init( const DeviceCreation& creation ) {
+
+    hprint( "Null Device init: no window or GPU will be used.\n" );
+
+    swapchain_width = creation.width;
+    swapchain_height = creation.height;
+
+    //// Init pools
+    null_init_pool( buffers, allocator, 128, sizeof( BufferNull ) );
+    null_init_pool( textures, allocator, 128, sizeof( TextureNull ) );
+    null_init_pool( render_passes, allocator, 256, sizeof( RenderPassNull ) );
+    null_init_pool( resource_layouts, allocator, 128, sizeof( ResourceLayoutNull ) );
+    null_init_pool( pipelines, allocator, 128, sizeof( PipelineNull ) );
+    null_init_pool( shaders, allocator, 128, sizeof( ShaderStateNull ) );
+    null_init_pool( resource_lists, allocator, 128, sizeof( ResourceListNull ) );
+    null_init_pool( samplers, allocator, 32, sizeof( SamplerNull ) );
+
+    frame_counters.reset();
+    last_frame_counters.reset();
+    total_counters.reset();
+    memset( frame_counters.alive, 0, sizeof( frame_counters.alive ) );
+
+    // Same memory layout as the other backends: timestamp manager followed by queued command buffers.
+    u8* memory = hallocam( sizeof( GPUTimestampManager ) + sizeof( CommandBuffer* ) * k_max_queued_command_buffers, allocator );
+
+    gpu_timestamp_manager = ( GPUTimestampManager* )( memory );
+    gpu_timestamp_manager->init( allocator, creation.gpu_time_queries_per_frame, k_max_frames );
+
+    queued_command_buffers = ( CommandBuffer** )( gpu_timestamp_manager + 1 );
+
+    command_buffer_ring.init( this );
+
+    current_frame = 1;
+    previous_frame = 0;
+    absolute_frame = 0;
+    timestamps_enabled = false;
+
+    update_queues.init( allocator, 16 );
+
+    for ( u32 i = 0; i < k_max_swapchain_images; ++i ) {
+        transient_resource_lists[ i ].init( allocator, 16 );
+        transient_resource_list_memory[ i ].init( allocator, 64 * 1024 );
+    }
+
+    //
+    // Init primitive resources
+    //
+    SamplerCreation sc{};
+    sc.set_address_mode_uvw( TextureAddressMode::Clamp_Edge, TextureAddressMode::Clamp_Edge, TextureAddressMode::Clamp_Edge )
+        .set_min_mag_mip( TextureFilter::Linear, TextureFilter::Linear, TextureMipFilter::Linear ).set_name( "Sampler Default" );
+    default_sampler = create_sampler( sc );
+
+    BufferCreation fullscreen_vb_creation = { BufferType::Vertex_mask, ResourceUsageType::Immutable, 0, nullptr, "Fullscreen_vb" };
+    fullscreen_vertex_buffer = create_buffer( fullscreen_vb_creation );
+
+    // Swapchain format is fixed, there is no surface to query.
+    swapchain_output.reset();
+    swapchain_output.color( TextureFormat::B8G8R8A8_UNORM );
+    swapchain_output.depth( TextureFormat::D32_FLOAT );
+
+    RenderPassCreation swapchain_pass_creation = {};
+    swapchain_pass_creation.set_type( RenderPassType::Swapchain ).set_name( "Swapchain" );
+    swapchain_pass_creation.set_operations( RenderPassOperation::Clear, RenderPassOperation::Clear, RenderPassOperation::Clear );
+    swapchain_pass = create_render_pass( swapchain_pass_creation );
+
+    // Init Dummy resources
+    TextureCreation dummy_texture_creation = { nullptr, 1, 1, 1, 1, 0, TextureFormat::R8_UINT, TextureType::Texture2D };
+    dummy_texture = create_texture( dummy_texture_creation );
+
+    BufferCreation dummy_constant_buffer_creation = { BufferType::Constant_mask, ResourceUsageType::Immutable, 16, nullptr, "Dummy_cb" };
+    dummy_constant_buffer = create_buffer( dummy_constant_buffer_creation );
+
+    // Dynamic buffer handling: plain CPU memory, the ring and its overflow pages behave like on the real backends.
+    dynamic_per_frame_size = 1024 * 1024 * 10;
+    dynamic_allocator.init( this, dynamic_per_frame_size * k_max_frames, ( u32 )s_ubo_alignment, ( u32 )s_ubo_alignment );
+}
+
+void GpuDeviceNull::internal_shutdown() {
+
+    total_counters.print( "Null Device totals" );
+
+    command_buffer_ring.shutdown();
+
+    gpu_timestamp_manager->shutdown();
+
+    // Memory: this contains allocations for gpu timestamp memory and queued command buffers.
+    hfree( gpu_timestamp_manager, allocator );
+
+    destroy_buffer( fullscreen_vertex_buffer );
+    dynamic_allocator.shutdown();
+    destroy_render_pass( swapchain_pass );
+    destroy_texture( dummy_texture );
+    destroy_buffer( dummy_constant_buffer );
+    destroy_sampler( default_sampler );
+
+    // Destroy all pending resources.
+    for ( u32 i = 0; i < k_max_swapchain_images; ++i ) {
+        flush_deletions( i );
+        reset_transient_resource_lists( i );
+    }
+
+    for ( u32 i = 0; i < ResourceDeletionType::Count; ++i ) {
+        if ( frame_counters.alive[ i ] ) {
+            hprint( "Null Device: %u resources of type %u leaked.\n", frame_counters.alive[ i ], i );
+        }
+    }
+
+    update_queues.shutdown();
+
+    for ( u32 i = 0; i < k_max_swapchain_images; ++i ) {
+        transient_resource_lists[ i ].shutdown();
+        transient_resource_list_memory[ i ].shutdown();
+    }
+
+    pipelines.shutdown();
+    buffers.shutdown();
+    shaders.shutdown();
+    textures.shutdown();
+    samplers.shutdown();
+    resource_layouts.shutdown();
+    resource_lists.shutdown();
+    render_passes.shutdown();
+}
+
+// Resource Creation ////////////////////////////////////////////////////////////
+
+BufferHandle GpuDeviceNull::create_buffer( const BufferCreation& creation ) {
+    BufferHandle handle = { buffers.obtain_resource() };
+    if ( handle.index == k_invalid_index ) {
+        return handle;
+    }
+
+    BufferNull* buffer = access_buffer( handle );
+
+    buffer->name = creation.name;
+    buffer->size = creation.size;
+    buffer->type = creation.type;
+    buffer->usage = creation.usage;
+    buffer->handle = handle;
+    buffer->global_offset = 0;
+    buffer->parent_buffer = k_invalid_buffer;
+    buffer->data = nullptr;
+    buffer->alive = true;
+
+    count_creation( ResourceDeletionType::Buffer );
+
+    // Cache and calculate if dynamic buffer can be used.
+    static const u32 k_dynamic_buffer_mask = BufferType::Vertex_mask | BufferType::Index_mask | BufferType::Constant_mask;
+    const bool use_global_buffer = ( creation.type & k_dynamic_buffer_mask ) != 0;
+    if ( creation.usage == ResourceUsageType::Dynamic && use_global_buffer ) {
+        buffer->parent_buffer = dynamic_allocator.buffer;
+        return handle;
+    }
+
+    // CPU memory backing map_buffer, so that written data can be inspected.
+    if ( creation.size ) {
+        buffer->data = hallocam( creation.size, allocator );
+
+        if ( creation.initial_data ) {
+            memcpy( buffer->data, creation.initial_data, ( size_t )creation.size );
+        }
+    }
+
+    return handle;
+}
+
+TextureHandle GpuDeviceNull::create_texture( const TextureCreation& creation ) {
+    TextureHandle handle = { textures.obtain_resource() };
+    if ( handle.index == k_invalid_index ) {
+        return handle;
+    }
+
+    TextureNull* texture = access_texture( handle );
+
+    texture->width = creation.width;
+    texture->height = creation.height;
+    texture->depth = creation.depth;
+    texture->mipmaps = creation.mipmaps;
+    texture->flags = creation.flags;
+    texture->format = creation.format;
+    texture->type = creation.type;
+    texture->name = creation.name;
+    texture->handle = handle;
+    texture->sampler = nullptr;
+    texture->alive = true;
+
+    count_creation( ResourceDeletionType::Texture );
+
+    return handle;
+}
+
+ShaderStateHandle GpuDeviceNull::create_shader_state( const ShaderStateCreation& creation ) {
+
+    ShaderStateHandle handle = { k_invalid_index };
+
+    if ( creation.stages_count == 0 ) {
+        hprint( "Shader %s does not contain shader stages.\n", creation.name );
+        return handle;
+    }
+
+    handle.index = shaders.obtain_resource();
+    if ( handle.index == k_invalid_index ) {
+        return handle;
+    }
+
+    ShaderStateNull* shader_state = access_shader_state( handle );
+    shader_state->graphics_pipeline = true;
+    shader_state->active_shaders = creation.stages_count;
+    shader_state->name = creation.name;
+    shader_state->alive = true;
+
+    for ( u32 s = 0; s < creation.stages_count; ++s ) {
+        if ( creation.stages[ s ].type == ShaderStage::Compute ) {
+            shader_state->graphics_pipeline = false;
+        }
+    }
+
+    count_creation( ResourceDeletionType::ShaderState );
+
+    return handle;
+}
+
+PipelineHandle GpuDeviceNull::create_pipeline( const PipelineCreation& creation ) {
+    PipelineHandle handle = { pipelines.obtain_resource() };
+    if ( handle.index == k_invalid_index ) {
+        return handle;
+    }
+
+    ShaderStateHandle shader_state = create_shader_state( creation.shaders );
+    if ( shader_state.index == k_invalid_index ) {
+        pipelines.release_resource( handle.index );
+        handle.index = k_invalid_index;
+
+        return handle;
+    }
+
+    PipelineNull* pipeline = access_pipeline( handle );
+    const ShaderStateNull* shader_state_data = access_shader_state( shader_state );
+
+    pipeline->shader_state = shader_state;
+    pipeline->num_active_layouts = creation.num_active_layouts;
+    pipeline->graphics_pipeline = shader_state_data->graphics_pipeline;
+    pipeline->handle = handle;
+    pipeline->alive = true;
+
+    for ( u32 l = 0; l < creation.num_active_layouts; ++l ) {
+        pipeline->resource_layout_handle[ l ] = creation.resource_layout[ l ];
+    }
+
+    count_creation( ResourceDeletionType::Pipeline );
+
+    return handle;
+}
+
+SamplerHandle GpuDeviceNull::create_sampler( const SamplerCreation& creation ) {
+    SamplerHandle handle = { samplers.obtain_resource() };
+    if ( handle.index == k_invalid_index ) {
+        return handle;
+    }
+
+    SamplerNull* sampler = access_sampler( handle );
+
+    sampler->address_mode_u = creation.address_mode_u;
+    sampler->address_mode_v = creation.address_mode_v;
+    sampler->address_mode_w = creation.address_mode_w;
+    sampler->min_filter = creation.min_filter;
+    sampler->mag_filter = creation.mag_filter;
+    sampler->mip_filter = creation.mip_filter;
+    sampler->name = creation.name;
+    sampler->alive = true;
+
+    count_creation( ResourceDeletionType::Sampler );
+
+    return handle;
+}
+
+ResourceLayoutHandle GpuDeviceNull::create_resource_layout( const ResourceLayoutCreation& creation ) {
+    ResourceLayoutHandle handle = { resource_layouts.obtain_resource() };
+    if ( handle.index == k_invalid_index ) {
+        return handle;
+    }
+
+    ResourceLayoutNull* resource_layout = access_resource_layout( handle );
+
+    resource_layout->num_bindings = ( u16 )creation.num_bindings;
+    resource_layout->bindings = ( ResourceBinding* )hallocam( sizeof( ResourceBinding ) * creation.num_bindings, allocator );
+    resource_layout->handle = handle;
+    resource_layout->set_index = u16( creation.set_index );
+    resource_layout->alive = true;
+
+    for ( u32 r = 0; r < creation.num_bindings; ++r ) {
+        ResourceBinding& binding = resource_layout->bindings[ r ];
+        const ResourceLayoutCreation::Binding& input_binding = creation.bindings[ r ];
+        binding.start = input_binding.start == u16_max ? ( u16 )r : input_binding.start;
+        binding.count = 1;
+        binding.type = ( u16 )input_binding.type;
+        binding.set = resource_layout->set_index;
+        binding.name = input_binding.name;
+    }
+
+    count_creation( ResourceDeletionType::ResourceLayout );
+
+    return handle;
+}
+
+//
+// Cached resources arrays come from memory_allocator.
+static void null_create_resource_list( const ResourceListCreation& creation, ResourceListNull* resource_list, Allocator* memory_allocator ) {
+
+    // Cache data, same single allocation as the Vulkan backend.
+    u8* memory = hallocam( ( sizeof( ResourceHandle ) + sizeof( SamplerHandle ) + sizeof( u16 ) ) * creation.num_resources, memory_allocator );
+    resource_list->resources = ( ResourceHandle* )memory;
+    resource_list->samplers = ( SamplerHandle* )( memory + sizeof( ResourceHandle ) * creation.num_resources );
+    resource_list->bindings = ( u16* )( memory + ( sizeof( ResourceHandle ) + sizeof( SamplerHandle ) ) * creation.num_resources );
+    resource_list->num_resources = creation.num_resources;
+    resource_list->layout = creation.layout;
+    resource_list->alive = true;
+
+    for ( u32 r = 0; r < creation.num_resources; r++ ) {
+        resource_list->resources[ r ] = creation.resources[ r ];
+        resource_list->samplers[ r ] = creation.samplers[ r ];
+        resource_list->bindings[ r ] = creation.bindings[ r ];
+    }
+}
+
+ResourceListHandle GpuDeviceNull::create_resource_list( const ResourceListCreation& creation ) {
+    ResourceListHandle handle = { resource_lists.obtain_resource() };
+    if ( handle.index == k_invalid_index ) {
+        return handle;
+    }
+
+    null_create_resource_list( creation, access_resource_list( handle ), allocator );
+
+    count_creation( ResourceDeletionType::ResourceList );
+
+    return handle;
+}
+
+//
+// Not counted as created, as they never go through the deletion queue.
+ResourceListHandle GpuDeviceNull::create_resource_list_transient( const ResourceListCreation& creation ) {
+    ResourceListHandle handle = { resource_lists.obtain_resource() };
+    if ( handle.index == k_invalid_index ) {
+        return handle;
+    }
+
+    null_create_resource_list( creation, access_resource_list( handle ), &transient_resource_list_memory[ current_frame ] );
+
+    transient_resource_lists[ current_frame ].push( handle );
+    ++frame_counters.transient_resource_lists;
+
+    return handle;
+}
+
+RenderPassHandle GpuDeviceNull::create_render_pass( const RenderPassCreation& creation ) {
+    RenderPassHandle handle = { render_passes.obtain_resource() };
+    if ( handle.index == k_invalid_index ) {
+        return handle;
+    }
+
+    RenderPassNull* render_pass = access_render_pass( handle );
+    render_pass->type = creation.type;
+    render_pass->num_render_targets = ( u8 )creation.num_render_targets;
+    render_pass->name = creation.name;
+    render_pass->scale_x = creation.scale_x;
+    render_pass->scale_y = creation.scale_y;
+    render_pass->resize = creation.resize;
+    render_pass->width = swapchain_width;
+    render_pass->height = swapchain_height;
+    render_pass->alive = true;
+
+    render_pass->output.reset();
+
+    for ( u32 c = 0; c < creation.num_render_targets; ++c ) {
+        const TextureNull* texture = access_texture( creation.output_textures[ c ] );
+
+        render_pass->width = texture->width;
+        render_pass->height = texture->height;
+
+        render_pass->output_textures[ c ] = creation.output_textures[ c ];
+        render_pass->output.color( texture->format );
+    }
+
+    render_pass->output_depth = creation.depth_stencil_texture;
+
+    if ( creation.depth_stencil_texture.index != k_invalid_index ) {
+        const TextureNull* texture = access_texture( creation.depth_stencil_texture );
+        render_pass->output.depth( texture->format );
+    }
+
+    render_pass->output.color_operation = creation.color_operation;
+    render_pass->output.depth_operation = creation.depth_operation;
+    render_pass->output.stencil_operation = creation.stencil_operation;
+
+    if ( creation.type == RenderPassType::Swapchain ) {
+        render_pass->output = swapchain_output;
+    }
+
+    count_creation( ResourceDeletionType::RenderPass );
+
+    return handle;
+}
+
+// Resource Destruction /////////////////////////////////////////////////////////
+
+void GpuDeviceNull::destroy_buffer( BufferHandle buffer ) {
+    if ( buffer.index < buffers.pool_size ) {
+        update_queues.push_deletion( ResourceDeletionType::Buffer, buffer.index, current_frame );
+    } else {
+        hprint( "Graphics error: trying to free invalid Buffer %u\n", buffer.index );
+    }
+}
+
+void GpuDeviceNull::destroy_texture( TextureHandle texture ) {
+    if ( texture.index < textures.pool_size ) {
+        update_queues.push_deletion( ResourceDeletionType::Texture, texture.index, current_frame );
+    } else {
+        hprint( "Graphics error: trying to free invalid Texture %u\n", texture.index );
+    }
+}
+
+void GpuDeviceNull::destroy_pipeline( PipelineHandle pipeline ) {
+    if ( pipeline.index < pipelines.pool_size ) {
+        update_queues.push_deletion( ResourceDeletionType::Pipeline, pipeline.index, current_frame );
+        // Shader state creation is handled internally when creating a pipeline, thus add this to track correctly.
+        PipelineNull* null_pipeline = access_pipeline( pipeline );
+        destroy_shader_state( null_pipeline->shader_state );
+    } else {
+        hprint( "Graphics error: trying to free invalid Pipeline %u\n", pipeline.index );
+    }
+}
+
+void GpuDeviceNull::destroy_sampler( SamplerHandle sampler ) {
+    if ( sampler.index < samplers.pool_size ) {
+        update_queues.push_deletion( ResourceDeletionType::Sampler, sampler.index, current_frame );
+    } else {
+        hprint( "Graphics error: trying to free invalid Sampler %u\n", sampler.index );
+    }
+}
+
+void GpuDeviceNull::destroy_resource_layout( ResourceLayoutHandle resource_layout ) {
+    if ( resource_layout.index < resource_layouts.pool_size ) {
+        update_queues.push_deletion( ResourceDeletionType::ResourceLayout, resource_layout.index, current_frame );
+    } else {
+        hprint( "Graphics error: trying to free invalid ResourceLayout %u\n", resource_layout.index );
+    }
+}
+
+void GpuDeviceNull::destroy_resource_list( ResourceListHandle resource_list ) {
+    if ( resource_list.index < resource_lists.pool_size ) {
+        update_queues.push_deletion( ResourceDeletionType::ResourceList, resource_list.index, current_frame );
+    } else {
+        hprint( "Graphics error: trying to free invalid ResourceList %u\n", resource_list.index );
+    }
+}
+
+void GpuDeviceNull::destroy_render_pass( RenderPassHandle render_pass ) {
+    if ( render_pass.index < render_passes.pool_size ) {
+        update_queues.push_deletion( ResourceDeletionType::RenderPass, render_pass.index, current_frame );
+    } else {
+        hprint( "Graphics error: trying to free invalid RenderPass %u\n", render_pass.index );
+    }
+}
+
+void GpuDeviceNull::destroy_shader_state( ShaderStateHandle shader ) {
+    if ( shader.index < shaders.pool_size ) {
+        update_queues.push_deletion( ResourceDeletionType::ShaderState, shader.index, current_frame );
+    } else {
+        hprint( "Graphics error: trying to free invalid Shader %u\n", shader.index );
+    }
+}
+
+//
+// Real destruction, called by the deletion queue frames_in_flight frames after the destroy call.
+void GpuDeviceNull::destroy_resource_instant( ResourceDeletionType::Enum type, ResourceHandle handle ) {
+
+    if ( !is_alive( type, handle ) ) {
+        hprint( "Null Device: double free of resource %u of type %u\n", handle, type );
+        return;
+    }
+
+    switch ( type ) {
+
+        case ResourceDeletionType::Buffer:
+        {
+            BufferNull* buffer = ( BufferNull* )buffers.access_resource( handle );
+            if ( buffer->data ) {
+                hfree( buffer->data, allocator );
+                buffer->data = nullptr;
+            }
+            buffer->alive = false;
+            buffers.release_resource( handle );
+            break;
+        }
+
+        case ResourceDeletionType::Texture:
+        {
+            ( ( TextureNull* )textures.access_resource( handle ) )->alive = false;
+            textures.release_resource( handle );
+            break;
+        }
+
+        case ResourceDeletionType::Pipeline:
+        {
+            ( ( PipelineNull* )pipelines.access_resource( handle ) )->alive = false;
+            pipelines.release_resource( handle );
+            break;
+        }
+
+        case ResourceDeletionType::Sampler:
+        {
+            ( ( SamplerNull* )samplers.access_resource( handle ) )->alive = false;
+            samplers.release_resource( handle );
+            break;
+        }
+
+        case ResourceDeletionType::ResourceLayout:
+        {
+            ResourceLayoutNull* resource_layout = ( ResourceLayoutNull* )resource_layouts.access_resource( handle );
+            hfree( resource_layout->bindings, allocator );
+            resource_layout->alive = false;
+            resource_layouts.release_resource( handle );
+            break;
+        }
+
+        case ResourceDeletionType::ResourceList:
+        {
+            ResourceListNull* resource_list = ( ResourceListNull* )resource_lists.access_resource( handle );
+            // Contains the allocation for all the resources, binding and samplers arrays.
+            hfree( resource_list->resources, allocator );
+            resource_list->alive = false;
+            resource_lists.release_resource( handle );
+            break;
+        }
+
+        case ResourceDeletionType::RenderPass:
+        {
+            ( ( RenderPassNull* )render_passes.access_resource( handle ) )->alive = false;
+            render_passes.release_resource( handle );
+            break;
+        }
+
+        case ResourceDeletionType::ShaderState:
+        {
+            ( ( ShaderStateNull* )shaders.access_resource( handle ) )->alive = false;
+            shaders.release_resource( handle );
+            break;
+        }
+    }
+
+    ++frame_counters.destroyed[ type ];
+    --frame_counters.alive[ type ];
+}
+
+//
+// Releases the resources destroyed during frame, one bucket per resource type.
+void GpuDeviceNull::flush_deletions( u32 frame ) {
+
+    for ( u32 t = 0; t < ResourceDeletionType::Count; ++t ) {
+        const Array<ResourceHandle>& deletions = update_queues.deletions[ frame ][ t ];
+        for ( u32 i = 0; i < deletions.size; ++i ) {
+            destroy_resource_instant( ( ResourceDeletionType::Enum )t, deletions[ i ] );
+        }
+    }
+
+    update_queues.clear_deletions( frame );
+}
+
+//
+// Transient resource lists of frame are released all at once.
+void GpuDeviceNull::reset_transient_resource_lists( u32 frame ) {
+
+    Array<ResourceListHandle>& lists = transient_resource_lists[ frame ];
+    for ( u32 i = 0; i < lists.size; ++i ) {
+        access_resource_list( lists[ i ] )->alive = false;
+        resource_lists.release_resource( lists[ i ].index );
+    }
+    lists.clear();
+
+    transient_resource_list_memory[ frame ].reset();
+}
+
+// Counters ///////////////////////////////////////////////////////////////
+
+bool GpuDeviceNull::is_alive( ResourceDeletionType::Enum type, ResourceHandle handle ) const {
+
+    switch ( type ) {
+        case ResourceDeletionType::Buffer:
+            return handle < buffers.pool_size && ( ( const BufferNull* )buffers.access_resource( handle ) )->alive;
+        case ResourceDeletionType::Texture:
+            return handle < textures.pool_size && ( ( const TextureNull* )textures.access_resource( handle ) )->alive;
+        case ResourceDeletionType::Pipeline:
+            return handle < pipelines.pool_size && ( ( const PipelineNull* )pipelines.access_resource( handle ) )->alive;
+        case ResourceDeletionType::Sampler:
+            return handle < samplers.pool_size && ( ( const SamplerNull* )samplers.access_resource( handle ) )->alive;
+        case ResourceDeletionType::ResourceLayout:
+            return handle < resource_layouts.pool_size && ( ( const ResourceLayoutNull* )resource_layouts.access_resource( handle ) )->alive;
+        case ResourceDeletionType::ResourceList:
+            return handle < resource_lists.pool_size && ( ( const ResourceListNull* )resource_lists.access_resource( handle ) )->alive;
+        case ResourceDeletionType::RenderPass:
+            return handle < render_passes.pool_size && ( ( const RenderPassNull* )render_passes.access_resource( handle ) )->alive;
+        case ResourceDeletionType::ShaderState:
+            return handle < shaders.pool_size && ( ( const ShaderStateNull* )shaders.access_resource( handle ) )->alive;
+    }
+
+    return false;
+}
+
+void GpuDeviceNull::count_creation( ResourceDeletionType::Enum type ) {
+    ++frame_counters.created[ type ];
+    ++frame_counters.alive[ type ];
+}
+
+void NullDeviceCounters::reset() {
+    memset( created, 0, sizeof( created ) );
+    memset( destroyed, 0, sizeof( destroyed ) );
+    memset( commands, 0, sizeof( commands ) );
+
+    command_bytes = 0;
+    command_buffers_submitted = 0;
+    invalid_handle_uses = 0;
+    resource_list_updates = 0;
+    transient_resource_lists = 0;
+    map_calls = 0;
+    dynamic_allocated_bytes = 0;
+    frames = 0;
+}
+
+void NullDeviceCounters::accumulate( const NullDeviceCounters& other ) {
+    for ( u32 i = 0; i < ResourceDeletionType::Count; ++i ) {
+        created[ i ] += other.created[ i ];
+        destroyed[ i ] += other.destroyed[ i ];
+        // Alive is a snapshot, not a sum.
+        alive[ i ] = other.alive[ i ];
+    }
+
+    for ( u32 i = 0; i < NullCommandType::Count; ++i ) {
+        commands[ i ] += other.commands[ i ];
+    }
+
+    command_bytes += other.command_bytes;
+    command_buffers_submitted += other.command_buffers_submitted;
+    invalid_handle_uses += other.invalid_handle_uses;
+    resource_list_updates += other.resource_list_updates;
+    transient_resource_lists += other.transient_resource_lists;
+    map_calls += other.map_calls;
+    dynamic_allocated_bytes += other.dynamic_allocated_bytes;
+    frames += other.frames;
+}
+
+static cstring s_resource_type_names[] = { "Buffer", "Texture", "Pipeline", "Sampler", "ResourceLayout", "ResourceList", "RenderPass", "ShaderState" };
+
+void NullDeviceCounters::print( cstring title ) const {
+
+    hprint( "%s: %u frames, %u command buffers, %u command bytes, %u dynamic bytes, %u maps, %u resource list updates, %u transient resource lists, %u invalid handle uses\n",
+            title, frames, command_buffers_submitted, command_bytes, dynamic_allocated_bytes, map_calls, resource_list_updates, transient_resource_lists, invalid_handle_uses );
+
+    for ( u32 i = 0; i < ResourceDeletionType::Count; ++i ) {
+        if ( created[ i ] || destroyed[ i ] || alive[ i ] ) {
+            hprint( "    %-16s created %6u destroyed %6u alive %6u\n", s_resource_type_names[ i ], created[ i ], destroyed[ i ], alive[ i ] );
+        }
+    }
+
+    for ( u32 i = 0; i < NullCommandType::Count; ++i ) {
+        if ( commands[ i ] ) {
+            hprint( "    %-20s %8u\n", NullCommandType::ToString( ( NullCommandType::Enum )i ), commands[ i ] );
+        }
+    }
+}
+
+// Resource list //////////////////////////////////////////////////////////
+
+void GpuDeviceNull::update_resource_list( ResourceListHandle resource_list ) {
+    if ( resource_list.index < resource_lists.pool_size ) {
+        update_queues.push_resource_list_update( resource_list );
+    } else {
+        hprint( "Graphics error: trying to update invalid ResourceList %u\n", resource_list.index );
+    }
+}
+
+//
+//
+void GpuDeviceNull::resize_output_textures( RenderPassHandle render_pass, u32 width, u32 height ) {
+
+    RenderPassNull* null_render_pass = access_render_pass( render_pass );
+    if ( null_render_pass ) {
+
+        if ( !null_render_pass->resize ) {
+            return;
+        }
+
+        // Textures are resized in place, no memory is backing them so no deferred deletion is needed.
+        const u16 new_width = ( u16 )( width * null_render_pass->scale_x );
+        const u16 new_height = ( u16 )( height * null_render_pass->scale_y );
+
+        const u32 rts = null_render_pass->num_render_targets;
+        for ( u32 i = 0; i < rts; ++i ) {
+            TextureNull* texture = access_texture( null_render_pass->output_textures[ i ] );
+            texture->width = new_width;
+            texture->height = new_height;
+        }
+
+        if ( null_render_pass->output_depth.index != k_invalid_index ) {
+            TextureNull* texture = access_texture( null_render_pass->output_depth );
+            texture->width = new_width;
+            texture->height = new_height;
+        }
+
+        null_render_pass->width = new_width;
+        null_render_pass->height = new_height;
+    }
+}
+
+//
+//
+void GpuDeviceNull::fill_barrier( RenderPassHandle render_pass, ExecutionBarrier& out_barrier ) {
+
+    RenderPassNull* null_render_pass = access_render_pass( render_pass );
+
+    out_barrier.num_image_barriers = 0;
+
+    if ( null_render_pass ) {
+        const u32 rts = null_render_pass->num_render_targets;
+        for ( u32 i = 0; i < rts; ++i ) {
+            out_barrier.image_barriers[ out_barrier.num_image_barriers++ ].texture = null_render_pass->output_textures[ i ];
+        }
+
+        if ( null_render_pass->output_depth.index != k_invalid_index ) {
+            out_barrier.image_barriers[ out_barrier.num_image_barriers++ ].texture = null_render_pass->output_depth;
+        }
+    }
+}
+
+void GpuDeviceNull::new_frame() {
+
+    // There are no fences to wait: the frame in flight frames_in_flight ago is considered done.
+    // Its timestamps are resolved like the Vulkan backend does, there is no GPU time to measure.
+    const u32 frame_queries = gpu_timestamp_manager->frame_queries[ current_frame ];
+    if ( frame_queries ) {
+        for ( u32 i = 0; i < frame_queries; i++ ) {
+            u32 index = ( current_frame * gpu_timestamp_manager->queries_per_frame ) + i;
+            GPUTimestamp& timestamp = gpu_timestamp_manager->timestamps[ index ];
+            timestamp.elapsed_ms = 0.0;
+            timestamp.frame_index = absolute_frame - frames_in_flight;
+        }
+        gpu_timestamp_manager->resolve_frame( current_frame );
+    }
+
+    command_buffer_ring.reset_pools( current_frame );
+    command_buffer_sequence = 0;
+
+    // Dynamic memory and transient resource lists of this frame are reclaimed.
+    dynamic_allocator.begin_frame( current_frame );
+    reset_transient_resource_lists( current_frame );
+
+    // Resource List Updates: descriptors are not real, just count them.
+    frame_counters.resource_list_updates += update_queues.resource_list_updates.size;
+    update_queues.resource_list_updates.clear();
+
+    record_start_time = time_now();
+}
+
+void GpuDeviceNull::present() {
+
+    // Only CPU work is timed: fence wait, acquire and present are always zero.
+    const i64 submit_start = time_now();
+    frame_timings.record = ( f32 )time_delta_milliseconds( record_start_time, submit_start );
+
+    sort_queued_command_buffers();
+    replay_deferred_command_buffers();
+    gather_bind_stats();
+
+    // Count the recorded commands here, so that recording threads never share counters.
+    for ( u32 c = 0; c < num_queued_command_buffers; c++ ) {
+        CommandBuffer* command_buffer = queued_command_buffers[ c ];
+        command_buffer->is_recording = false;
+
+        const u8* stream = command_buffer->stream.data;
+        const u8* stream_end = stream + command_buffer->stream.size;
+        while ( stream < stream_end ) {
+            const NullCommandHeader* header = ( const NullCommandHeader* )stream;
+            ++frame_counters.commands[ header->type ];
+
+            stream += sizeof( NullCommandHeader ) + header->size;
+        }
+
+        frame_counters.command_bytes += command_buffer->stream.size;
+        frame_counters.invalid_handle_uses += command_buffer->invalid_handle_uses;
+    }
+
+    frame_counters.command_buffers_submitted += num_queued_command_buffers;
+    num_queued_command_buffers = 0;
+    frame_timings.submit = ( f32 )time_from_milliseconds( submit_start );
+
+    //
+    // GPU Timestamps are resolved in new_frame, when the frame would be done on the GPU.
+    if ( timestamps_enabled ) {
+        gpu_timestamp_manager->end_frame( current_frame );
+
+        if ( gpu_timestamp_manager->needs_grow() ) {
+            gpu_timestamp_manager->grow();
+        }
+
+        gpu_timestamp_manager->reset();
+    }
+
+    // Swapchain size was already cached by Device::resize, nothing to recreate.
+    resized = false;
+
+    frame_counters_advance();
+
+    // Resource deletion of the frame that is reusing this index.
+    flush_deletions( current_frame );
+
+    // Frame counters
+    frame_counters.frames = 1;
+    last_frame_counters = frame_counters;
+    total_counters.accumulate( frame_counters );
+    frame_counters.reset();
+
+    end_frame_timings();
+}
+
+void GpuDeviceNull::link_texture_sampler( TextureHandle texture, SamplerHandle sampler ) {
+
+    TextureNull* texture_null = access_texture( texture );
+    SamplerNull* sampler_null = access_sampler( sampler );
+
+    texture_null->sampler = sampler_null;
+}
+
+void GpuDeviceNull::frame_counters_advance() {
+    frame_counters.dynamic_allocated_bytes = dynamic_allocator.frame_stats.allocated_bytes;
+    dynamic_allocator.end_frame( current_frame );
+
+    previous_frame = current_frame;
+    current_frame = ( current_frame + 1 ) % frames_in_flight;
+
+    ++absolute_frame;
+}
+
+//
+//
+void GpuDeviceNull::queue_command_buffer( CommandBuffer* command_buffer ) {
+
+    const u32 queue_index = (u32)atomic_increment( ( volatile i32* )&num_queued_command_buffers ) - 1;
+    hy_assertm( queue_index < k_max_queued_command_buffers, "Too many queued command buffers." );
+
+    queued_command_buffers[ queue_index ] = command_buffer;
+}
+
+//
+//
+CommandBuffer* GpuDeviceNull::get_command_buffer( u32 thread_index, QueueType::Enum type, bool begin ) {
+    CommandBuffer* cb = command_buffer_ring.get_command_buffer( current_frame, thread_index, begin );
+    cb->submit_order = (u32)atomic_increment( &command_buffer_sequence );
+    return cb;
+}
+
+//
+//
+CommandBuffer* GpuDeviceNull::get_instant_command_buffer() {
+    CommandBuffer* cb = command_buffer_ring.get_command_buffer_instant( current_frame, false );
+    return cb;
+}
+
+// Resource Description Query ///////////////////////////////////////////////////
+
+void Device::query_buffer( BufferHandle buffer, BufferDescription& out_description ) {
+    if ( buffer.index != k_invalid_index ) {
+        const BufferNull* buffer_data = access_buffer( buffer );
+
+        out_description.name = buffer_data->name;
+        out_description.size = buffer_data->size;
+        out_description.type = buffer_data->type;
+        out_description.usage = buffer_data->usage;
+        out_description.parent_handle = buffer_data->parent_buffer;
+        out_description.native_handle = (void*)buffer_data->data;
+    }
+}
+
+void Device::query_texture( TextureHandle texture, TextureDescription& out_description ) {
+    if ( texture.index != k_invalid_index ) {
+        const TextureNull* texture_data = access_texture( texture );
+
+        out_description.width = texture_data->width;
+        out_description.height = texture_data->height;
+        out_description.depth = texture_data->depth;
+        out_description.format = texture_data->format;
+        out_description.mipmaps = texture_data->mipmaps;
+        out_description.type = texture_data->type;
+        out_description.render_target = (texture_data->flags & TextureFlags::RenderTarget_mask) == TextureFlags::RenderTarget_mask;
+        out_description.compute_access = ( texture_data->flags & TextureFlags::Compute_mask) == TextureFlags::Compute_mask;
+        out_description.native_handle = nullptr;
+        out_description.name = texture_data->name;
+    }
+}
+
+void Device::query_pipeline( PipelineHandle pipeline, PipelineDescription& out_description ) {
+    if ( pipeline.index != k_invalid_index ) {
+        const PipelineNull* pipeline_data = access_pipeline( pipeline );
+
+        out_description.shader = pipeline_data->shader_state;
+    }
+}
+
+void Device::query_sampler( SamplerHandle sampler, SamplerDescription& out_description ) {
+    if ( sampler.index != k_invalid_index ) {
+        //const SamplerNull* sampler_data = access_sampler( sampler );
+    }
+}
+
+void Device::query_resource_layout( ResourceLayoutHandle resource_list_layout, ResourceLayoutDescription& out_description ) {
+    if ( resource_list_layout.index != k_invalid_index ) {
+        const ResourceLayoutNull* resource_list_layout_data = access_resource_layout( resource_list_layout );
+
+        const uint32_t num_bindings = resource_list_layout_data->num_bindings;
+        for ( size_t i = 0; i < num_bindings; i++ ) {
+            out_description.bindings[i].name = resource_list_layout_data->bindings[i].name;
+            out_description.bindings[i].type = resource_list_layout_data->bindings[i].type;
+        }
+
+        out_description.num_active_bindings = resource_list_layout_data->num_bindings;
+    }
+}
+
+void Device::query_resource_list( ResourceListHandle resource_list, ResourceListDescription& out_description ) {
+    if ( resource_list.index != k_invalid_index ) {
+        const ResourceListNull* resource_list_data = access_resource_list( resource_list );
+
+        out_description.num_active_resources = resource_list_data->num_resources;
+    }
+}
+
+const RenderPassOutput& Device::get_render_pass_output( RenderPassHandle render_pass ) const {
+    const RenderPassNull* null_render_pass = access_render_pass( render_pass );
+    return null_render_pass->output;
+}
+
+// Resource Map/Unmap ///////////////////////////////////////////////////////////
+
+void* GpuDeviceNull::map_buffer( const MapBufferParameters& parameters ) {
+    if ( parameters.buffer.index == k_invalid_index )
+        return nullptr;
+
+    atomic_increment( ( volatile i32* )&frame_counters.map_calls );
+
+    BufferNull* buffer = access_buffer( parameters.buffer );
+
+    // Dynamic buffers: each map gets new memory from the dynamic allocator, in the ring or in an overflow page.
+    if ( buffer->parent_buffer.index != k_invalid_index ) {
+
+        const DynamicAllocation allocation = dynamic_allocator.allocate( parameters.size == 0 ? buffer->size : parameters.size, buffer->type );
+        if ( allocation.data ) {
+            buffer->parent_buffer = allocation.buffer;
+            buffer->global_offset = allocation.offset;
+        }
+
+        return allocation.data;
+    }
+
+    return buffer->data + parameters.offset;
+}
+
+void GpuDeviceNull::unmap_buffer( const MapBufferParameters& parameters ) {
+    // Memory is always CPU visible.
+}
+
+void GpuDeviceNull::set_buffer_global_offset( BufferHandle buffer, u32 offset ) {
+    if ( buffer.index == k_invalid_index )
+        return;
+
+    BufferNull* null_buffer = access_buffer( buffer );
+    null_buffer->global_offset = offset;
+}
+
+u32 GpuDeviceNull::get_gpu_timestamps( GPUTimestamp* out_timestamps ) {
+    return gpu_timestamp_manager->resolve( out_timestamps );
+}
+
+// Timestamps hierarchy is kept only for the main thread (index 0), the manager is not thread safe.
+void GpuDeviceNull::push_gpu_timestamp( CommandBuffer* command_buffer, StringId name ) {
+    if ( !timestamps_enabled || command_buffer->thread_index != 0 )
+        return;
+
+    gpu_timestamp_manager->push( current_frame, name );
+}
+
+void GpuDeviceNull::pop_gpu_timestamp( CommandBuffer* command_buffer ) {
+    if ( !timestamps_enabled || command_buffer->thread_index != 0 )
+        return;
+
+    gpu_timestamp_manager->pop( current_frame );
+}
+
+} // namespace gfx
+} // namespace hydra
+
+#endif // HYDRA_NULL
@@ -0,0 +1,159 @@
+#pragma once
+
+#if defined(HYDRA_NULL)
+
+#if defined(HYDRA_VULKAN)
+    #error "HYDRA_NULL and HYDRA_VULKAN are exclusive, define only one backend."
+#endif // HYDRA_VULKAN
+
+#include "graphics/gpu_device.hpp"
+#include "graphics/gpu_resources_null.hpp"
+#include "graphics/command_buffer.hpp"
+
+#include "kernel/array.hpp"
+#include "kernel/memory.hpp"
+
+namespace hydra {
+namespace gfx {
+
+//
+// Commands recorded in the null command buffer stream.
+namespace NullCommandType {
+    enum Enum : u8 {
+        BindPass, BindPipeline, BindVertexBuffer, BindIndexBuffer, BindResourceList, SetViewport, SetScissor, Clear, ClearDepthStencil,
+        Draw, DrawIndexed, DrawIndirect, DrawIndexedIndirect, Dispatch, DispatchIndirect, Barrier, FillBuffer, PushMarker, PopMarker,
+        Timestamp, Count
+    };
+
+    static const char* s_value_names[] = {
+        "BindPass", "BindPipeline", "BindVertexBuffer", "BindIndexBuffer", "BindResourceList", "SetViewport", "SetScissor", "Clear", "ClearDepthStencil",
+        "Draw", "DrawIndexed", "DrawIndirect", "DrawIndexedIndirect", "Dispatch", "DispatchIndirect", "Barrier", "FillBuffer", "PushMarker", "PopMarker",
+        "Timestamp", "Count"
+    };
+
+    static const char* ToString( Enum e ) {
+        return ((u32)e < Enum::Count ? s_value_names[(int)e] : "unsupported" );
+    }
+} // namespace NullCommandType
+
+//
+// Each command in the stream is a header followed by its arguments, padded to 4 bytes.
+struct NullCommandHeader {
+
+    u8                              type;       // NullCommandType
+    u8                              padding;
+    u16                             size;       // Size of the arguments in bytes.
+
+}; // struct NullCommandHeader
+
+//
+// Calls counted by the null device. Resource arrays are indexed with ResourceDeletionType.
+struct NullDeviceCounters {
+
+    u32                             created[ ResourceDeletionType::Count ];
+    u32                             destroyed[ ResourceDeletionType::Count ];   // Released by the deletion queue.
+    u32                             alive[ ResourceDeletionType::Count ];       // Not cleared by reset, it spans frames.
+
+    u32                             commands[ NullCommandType::Count ];
+    u32                             command_bytes;
+    u32                             command_buffers_submitted;
+    u32                             invalid_handle_uses;                        // Commands referencing released resources.
+
+    u32                             resource_list_updates;
+    u32                             transient_resource_lists;
+    u32                             map_calls;
+    u32                             dynamic_allocated_bytes;
+    u32                             frames;
+
+    void                            reset();
+    void                            accumulate( const NullDeviceCounters& other );
+    void                            print( cstring title ) const;
+
+}; // struct NullDeviceCounters
+
+//
+// Headless device: resources are plain structs in the same pools used by the real backends,
+// command buffers record into a compact memory stream and the deletion queue is simulated with
+// frames_in_flight frames. Used to measure CPU costs of rendering code without a GPU.
+struct GpuDeviceNull : public Device {
+
+    void                            internal_init( const DeviceCreation& creation );
+    void                            internal_shutdown();
+
+    // Creation/Destruction of resources ////////////////////////////////////////
+    BufferHandle                    create_buffer( const BufferCreation& creation );
+    TextureHandle                   create_texture( const TextureCreation& creation );
+    PipelineHandle                  create_pipeline( const PipelineCreation& creation );
+    SamplerHandle                   create_sampler( const SamplerCreation& creation );
+    ResourceLayoutHandle            create_resource_layout( const ResourceLayoutCreation& creation );
+    ResourceListHandle              create_resource_list( const ResourceListCreation& creation );
+    ResourceListHandle              create_resource_list_transient( const ResourceListCreation& creation );
+    RenderPassHandle                create_render_pass( const RenderPassCreation& creation );
+    ShaderStateHandle               create_shader_state( const ShaderStateCreation& creation );
+
+    void                            destroy_buffer( BufferHandle buffer );
+    void                            destroy_texture( TextureHandle texture );
+    void                            destroy_pipeline( PipelineHandle pipeline );
+    void                            destroy_sampler( SamplerHandle sampler );
+    void                            destroy_resource_layout( ResourceLayoutHandle resource_layout );
+    void                            destroy_resource_list( ResourceListHandle resource_list );
+    void                            destroy_render_pass( RenderPassHandle render_pass );
+    void                            destroy_shader_state( ShaderStateHandle shader );
+
+    // Map/unmap //////////////////////////////////////////////////////////
+    void*                           map_buffer( const MapBufferParameters& parameters );
+    void                            unmap_buffer( const MapBufferParameters& parameters );
+    void                            set_buffer_global_offset( BufferHandle buffer, u32 offset );
+
+    // Resource list //////////////////////////////////////////////////////
+    void                            update_resource_list( ResourceListHandle resource_list );
+
+    // Command buffers ////////////////////////////////////////////////////
+    CommandBuffer*                  get_command_buffer( u32 thread_index, QueueType::Enum type, bool begin );
+    CommandBuffer*                  get_instant_command_buffer();
+
+    void                            queue_command_buffer( CommandBuffer* command_buffer );
+
+    // GPU Timestamps
+    u32                             get_gpu_timestamps( GPUTimestamp* out_timestamps );
+    void                            push_gpu_timestamp( CommandBuffer* command_buffer, StringId name );
+    void                            pop_gpu_timestamp( CommandBuffer* command_buffer );
+
+    // Instant methods
+    void                            destroy_resource_instant( ResourceDeletionType::Enum type, ResourceHandle handle );
+    void                            flush_deletions( u32 frame );
+    void                            reset_transient_resource_lists( u32 frame );
+
+    //
+    void                            new_frame();
+    void                            present();
+
+    void                            fill_barrier( RenderPassHandle render_pass, ExecutionBarrier& out_barrier );
+    void                            resize_output_textures( RenderPassHandle render_pass, u32 width, u32 height );
+    void                            link_texture_sampler( TextureHandle texture, SamplerHandle sampler );
+
+    void                            frame_counters_advance();
+
+    // Counters ///////////////////////////////////////////////////////////
+    bool                            is_alive( ResourceDeletionType::Enum type, ResourceHandle handle ) const;
+    void                            count_creation( ResourceDeletionType::Enum type );
+
+    const NullDeviceCounters&       get_last_frame_counters() const     { return last_frame_counters; }
+    const NullDeviceCounters&       get_total_counters() const          { return total_counters; }
+
+    static const uint32_t           k_max_frames                    = 3;
+
+    // Transient resource lists, released with their frame.
+    Array<ResourceListHandle>       transient_resource_lists[ k_max_swapchain_images ];
+    TransientListAllocator          transient_resource_list_memory[ k_max_swapchain_images ];
+
+    NullDeviceCounters              frame_counters;                 // Current frame, accumulated into total at present.
+    NullDeviceCounters              last_frame_counters;
+    NullDeviceCounters              total_counters;
+
+}; // struct GpuDeviceNull
+
+} // namespace gfx
+} // namespace hydra
+
+#endif // HYDRA_NULL
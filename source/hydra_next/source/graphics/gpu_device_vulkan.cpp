@@ -6,6 +6,8 @@
 #include "kernel/hash_map.hpp"
 #include "kernel/log.hpp"
 #include "kernel/memory_utils.hpp"
+#include "kernel/thread.hpp"
+#include "kernel/time.hpp"
 
 #if defined(HYDRA_VULKAN)
 
@@ -66,14 +68,15 @@ struct CommandBufferRing {
 
     void                    reset_pools( u32 frame_index );
 
-    CommandBuffer*          get_command_buffer( u32 frame, bool begin );
+    CommandBuffer*          get_command_buffer( u32 frame, u32 thread_index, bool begin );
     CommandBuffer*          get_command_buffer_instant( u32 frame, bool begin );
 
     static u16              pool_from_index( u32 index ) { return (u16)index / k_buffer_per_pool; }
+    static u16              pool_from_indices( u32 frame_index, u32 thread_index ) { return (u16)(frame_index * k_max_threads) + thread_index; }
 
-    static const u16        k_max_threads = 1;
+    static const u16        k_max_threads = k_max_recording_threads;
     static const u16        k_max_pools = k_max_swapchain_images * k_max_threads;
-    static const u16        k_buffer_per_pool = 4;
+    static const u16        k_buffer_per_pool = 8;      // Last buffer of each pool is reserved for instant commands.
     static const u16        k_max_buffers = k_buffer_per_pool * k_max_pools;
 
     GpuDeviceVulkan*        gpu;
@@ -105,8 +108,13 @@ void CommandBufferRing::init( GpuDeviceVulkan* gpu_ ) {
 
         command_buffers[ i ].device = gpu;
         command_buffers[ i ].handle = i;
+        command_buffers[ i ].thread_index = pool_index % k_max_threads;
         command_buffers[ i ].reset();
     }
+
+    for ( u32 i = 0; i < k_max_pools; i++ ) {
+        next_free_per_thread_frame[ i ] = 0;
+    }
 }
 
 void CommandBufferRing::shutdown() {
@@ -118,13 +126,24 @@ void CommandBufferRing::shutdown() {
 void CommandBufferRing::reset_pools( u32 frame_index ) {
 
     for ( u32 i = 0; i < k_max_threads; i++ ) {
-        vkResetCommandPool( gpu->vulkan_device, vulkan_command_pools[ frame_index * k_max_threads + i ], 0 );
+        const u32 pool_index = pool_from_indices( frame_index, i );
+        vkResetCommandPool( gpu->vulkan_device, vulkan_command_pools[ pool_index ], 0 );
+
+        next_free_per_thread_frame[ pool_index ] = 0;
     }
 }
 
-CommandBuffer* CommandBufferRing::get_command_buffer( u32 frame, bool begin ) {
-    // TODO: take in account threads
-    CommandBuffer* cb = &command_buffers[ frame * k_buffer_per_pool ];
+//
+// Each thread uses only its own pool, so no synchronization is needed here.
+CommandBuffer* CommandBufferRing::get_command_buffer( u32 frame, u32 thread_index, bool begin ) {
+    hy_assertm( thread_index < k_max_threads, "Thread index %u out of range, max recording threads %u", thread_index, k_max_threads );
+
+    const u32 pool_index = pool_from_indices( frame, thread_index );
+    u8& next_free = next_free_per_thread_frame[ pool_index ];
+    hy_assertm( next_free < k_buffer_per_pool - 1, "Command buffers of thread %u exhausted for this frame.", thread_index );
+
+    CommandBuffer* cb = &command_buffers[ pool_index * k_buffer_per_pool + next_free ];
+    ++next_free;
 
     if ( begin ) {
         cb->reset();
@@ -138,7 +157,7 @@ CommandBuffer* CommandBufferRing::get_command_buffer( u32 frame, bool begin ) {
 }
 
 CommandBuffer* CommandBufferRing::get_command_buffer_instant( u32 frame, bool begin ) {
-    CommandBuffer* cb = &command_buffers[ frame * k_buffer_per_pool + 1 ];
+    CommandBuffer* cb = &command_buffers[ pool_from_indices( frame, 0 ) * k_buffer_per_pool + k_buffer_per_pool - 1 ];
     return cb;
 }
     
@@ -240,6 +259,37 @@ VkDebugUtilsMessengerCreateInfoEXT create_debug_utils_messenger_info() {
 static GpuDeviceVulkan s_vulkan_device;
 static hydra::FlatHashMap<u64, VkRenderPass> render_pass_cache;
 
+//
+// Pipeline creation executed by the compile thread. Render pass and cache are found by the caller,
+// as their caches are not thread safe.
+struct PipelineCompileJob {
+
+    PipelineCreation                creation;
+    PipelineVulkan*                 pipeline;
+    VkRenderPass                    vk_render_pass;
+    VkPipelineCache                 vk_pipeline_cache;
+
+}; // struct PipelineCompileJob
+
+//
+// The compile thread sleeps on job_available, waiters for a pipeline sleep on job_done.
+struct PipelineCompiler {
+
+    hydra::Thread                   thread;
+    hydra::Mutex                    mutex;
+    hydra::ConditionVariable        job_available;
+    hydra::ConditionVariable        job_done;
+
+    Array<PipelineCompileJob>       queue;                      // Guarded by mutex, executed in order starting from queue_head.
+    u32                             queue_head      = 0;
+
+    bool                            running         = false;    // Guarded by mutex. Queued jobs are still compiled after it is cleared.
+
+}; // struct PipelineCompiler
+
+static PipelineCompiler pipeline_compiler;
+static void pipeline_compile_thread( void* user_data );
+
 Device* Device::instance() {
     return &s_vulkan_device;
 }
@@ -266,6 +316,14 @@ PipelineHandle Device::create_pipeline( const PipelineCreation& creation ) {
     return s_vulkan_device.create_pipeline( creation );
 }
 
+PipelineHandle Device::create_pipeline_async( const PipelineCreation& creation ) {
+    return s_vulkan_device.create_pipeline_async( creation );
+}
+
+bool Device::is_pipeline_ready( PipelineHandle pipeline ) {
+    return s_vulkan_device.is_pipeline_ready( pipeline );
+}
+
 SamplerHandle Device::create_sampler( const SamplerCreation& creation ) {
     return s_vulkan_device.create_sampler( creation );
 }
@@ -278,6 +336,10 @@ ResourceListHandle Device::create_resource_list( const ResourceListCreation& cre
     return s_vulkan_device.create_resource_list( creation );
 }
 
+ResourceListHandle Device::create_resource_list_transient( const ResourceListCreation& creation ) {
+    return s_vulkan_device.create_resource_list_transient( creation );
+}
+
 RenderPassHandle Device::create_render_pass( const RenderPassCreation& creation ) {
     return s_vulkan_device.create_render_pass( creation );
 }
@@ -357,12 +419,6 @@ void Device::unmap_buffer( const MapBufferParameters& parameters ) {
 static sizet s_ubo_alignment = 256;
 static sizet s_ssbo_alignemnt = 256;
 
-void* Device::dynamic_allocate( u32 size ) {
-    void* mapped_memory = dynamic_mapped_memory + dynamic_allocated_size;
-    dynamic_allocated_size += (u32)hydra::memory_align( size, s_ubo_alignment );
-    return mapped_memory;
-}
-
 void Device::set_buffer_global_offset( BufferHandle buffer, u32 offset ) {
     s_vulkan_device.set_buffer_global_offset( buffer, offset );
 }
@@ -372,8 +428,8 @@ void Device::queue_command_buffer( CommandBuffer* command_buffer ) {
     s_vulkan_device.queue_command_buffer( command_buffer );
 }
 
-CommandBuffer* Device::get_command_buffer( QueueType::Enum type, bool begin ) {
-    return s_vulkan_device.get_command_buffer( type, begin );
+CommandBuffer* Device::get_command_buffer( u32 thread_index, QueueType::Enum type, bool begin ) {
+    return s_vulkan_device.get_command_buffer( thread_index, type, begin );
 }
 
 CommandBuffer* Device::get_instant_command_buffer() {
@@ -388,7 +444,7 @@ u32 Device::get_gpu_timestamps( GPUTimestamp* out_timestamps ) {
     return s_vulkan_device.get_gpu_timestamps( out_timestamps );
 }
 
-void Device::push_gpu_timestamp( CommandBuffer* command_buffer, const char* name ) {
+void Device::push_gpu_timestamp( CommandBuffer* command_buffer, StringId name ) {
     s_vulkan_device.push_gpu_timestamp( command_buffer, name );
 }
 
@@ -686,6 +742,13 @@ void GpuDeviceVulkan::internal_init( const DeviceCreation& creation ) {
     result = vkCreateDescriptorPool( vulkan_device, &pool_info, vulkan_allocation_callbacks, &vulkan_descriptor_pool );
     check( result );
 
+    // Transient pools never free single descriptor sets, they are reset when their frame comes back.
+    pool_info.flags = 0;
+    for ( u32 i = 0; i < k_max_swapchain_images; ++i ) {
+        result = vkCreateDescriptorPool( vulkan_device, &pool_info, vulkan_allocation_callbacks, &vulkan_transient_descriptor_pools[ i ] );
+        check( result );
+    }
+
 #if defined (HYDRA_BINDLESS)
     // Create bindless descriptor pool
     VkDescriptorPoolSize pool_sizes_bindless[] =
@@ -784,7 +847,7 @@ void GpuDeviceVulkan::internal_init( const DeviceCreation& creation ) {
 
     // Init render frame informations. This includes fences, semaphores, command buffers, ...
     // TODO: memory - allocate memory of all Device render frame stuff
-    u8* memory = hallocam( sizeof(GPUTimestampManager) + sizeof(CommandBuffer*) * 128, allocator);
+    u8* memory = hallocam( sizeof(GPUTimestampManager) + sizeof(CommandBuffer*) * k_max_queued_command_buffers, allocator);
 
     VkSemaphoreCreateInfo semaphore_info{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
     vkCreateSemaphore( vulkan_device, &semaphore_info, vulkan_allocation_callbacks, &vulkan_image_acquired_semaphore );
@@ -814,9 +877,18 @@ void GpuDeviceVulkan::internal_init( const DeviceCreation& creation ) {
     absolute_frame = 0;
     timestamps_enabled = false;
     
-    resource_deletion_queue.init( allocator, 16 );
-    resource_list_update_queue.init( allocator, 16 );
-    texture_to_update_bindless.init( allocator, 16 );
+    update_queues.init( allocator, 16 );
+
+    descriptor_writes.init( allocator, 64 );
+    descriptor_buffer_infos.init( allocator, 64 );
+    descriptor_image_infos.init( allocator, 64 );
+    descriptor_set_layouts.init( allocator, 16 );
+    descriptor_sets.init( allocator, 16 );
+
+    for ( u32 i = 0; i < k_max_swapchain_images; ++i ) {
+        transient_resource_lists[ i ].init( allocator, 16 );
+        transient_resource_list_memory[ i ].init( allocator, 64 * 1024 );
+    }
 
     //
     // Init primitive resources
@@ -857,21 +929,49 @@ void GpuDeviceVulkan::internal_init( const DeviceCreation& creation ) {
     string_buffer.clear();
 
     // Dynamic buffer handling
-    // TODO:
     dynamic_per_frame_size = 1024 * 1024 * 10;
-    BufferCreation bc;
-    bc.set( (BufferType::Mask)(BufferType::Vertex_mask | BufferType::Index_mask | BufferType::Constant_mask), ResourceUsageType::Immutable, dynamic_per_frame_size * k_max_frames ).set_name( "Dynamic_Persistent_Buffer" );
-    dynamic_buffer = create_buffer( bc );
-
-    MapBufferParameters cb_map = { dynamic_buffer, 0, 0 };
-    dynamic_mapped_memory = ( u8* )map_buffer( cb_map );
+    dynamic_allocator.init( this, dynamic_per_frame_size * k_max_frames, ( u32 )s_ubo_alignment, ( u32 )s_ssbo_alignemnt );
 
     // Init render pass cache
     render_pass_cache.init( allocator, 16 );
+
+    // Pipeline caches and compile thread
+    pipeline_caches.init( allocator, 16 );
+    pipeline_cache_path[ 0 ] = 0;
+    if ( creation.pipeline_cache_path ) {
+        const sizet path_length = strlen( creation.pipeline_cache_path );
+        if ( path_length < ArraySize( pipeline_cache_path ) ) {
+            memcpy( pipeline_cache_path, creation.pipeline_cache_path, path_length + 1 );
+            load_pipeline_caches( pipeline_cache_path );
+        }
+        else {
+            hprint( "Pipeline cache path is %llu characters, maximum is %u. Pipeline caches are not saved.\n", ( u64 )path_length, ( u32 )ArraySize( pipeline_cache_path ) - 1 );
+        }
+    }
+
+    pipeline_compiler.mutex.init();
+    pipeline_compiler.job_available.init();
+    pipeline_compiler.job_done.init();
+    pipeline_compiler.queue.init( allocator, 16 );
+    pipeline_compiler.queue_head = 0;
+    pipeline_compiler.running = true;
+    hydra::thread_create( pipeline_compiler.thread, pipeline_compile_thread, &pipeline_compiler, "hydra_pipeline_compile" );
 }
 
 void GpuDeviceVulkan::internal_shutdown() {
 
+    // Finish queued pipelines before anything is destroyed: the thread exits once the queue is empty.
+    {
+        hydra::ScopedLock lock( pipeline_compiler.mutex );
+        pipeline_compiler.running = false;
+        pipeline_compiler.job_available.notify_one();
+    }
+    hydra::thread_join( pipeline_compiler.thread );
+    pipeline_compiler.queue.shutdown();
+    pipeline_compiler.job_done.shutdown();
+    pipeline_compiler.job_available.shutdown();
+    pipeline_compiler.mutex.shutdown();
+
     vkDeviceWaitIdle( vulkan_device );
 
     command_buffer_ring.shutdown();
@@ -885,78 +985,22 @@ void GpuDeviceVulkan::internal_shutdown() {
 
     gpu_timestamp_manager->shutdown();
 
-    MapBufferParameters cb_map = { dynamic_buffer, 0, 0 };
-    unmap_buffer( cb_map );
+    dynamic_allocator.shutdown();
 
     // Memory: this contains allocations for gpu timestamp memory, queued command buffers and render frames.
     hfree( gpu_timestamp_manager, allocator );
 
     destroy_texture( depth_texture );
     destroy_buffer( fullscreen_vertex_buffer );
-    destroy_buffer( dynamic_buffer );
     destroy_render_pass( swapchain_pass );
     destroy_texture( dummy_texture );
     destroy_buffer( dummy_constant_buffer );
     destroy_sampler( default_sampler );
 
     // Destroy all pending resources.
-    for ( u32 i = 0; i < resource_deletion_queue.size; i++ ) {
-        ResourceUpdate& resource_deletion = resource_deletion_queue[ i ];
-
-        // Skip just freed resources.
-        if ( resource_deletion.current_frame == -1 )
-            continue;
-
-        switch ( resource_deletion.type ) {
-
-            case ResourceDeletionType::Buffer:
-            {
-                destroy_buffer_instant( resource_deletion.handle );
-                break;
-            }
-
-            case ResourceDeletionType::Pipeline:
-            {
-                destroy_pipeline_instant( resource_deletion.handle );
-                break;
-            }
-
-            case ResourceDeletionType::RenderPass:
-            {
-                destroy_render_pass_instant( resource_deletion.handle );
-                break;
-            }
-
-            case ResourceDeletionType::ResourceList:
-            {
-                destroy_resource_list_instant( resource_deletion.handle );
-                break;
-            }
-
-            case ResourceDeletionType::ResourceLayout:
-            {
-                destroy_resource_layout_instant( resource_deletion.handle );
-                break;
-            }
-
-            case ResourceDeletionType::Sampler:
-            {
-                destroy_sampler_instant( resource_deletion.handle );
-                break;
-            }
-
-            case ResourceDeletionType::ShaderState:
-            {
-                destroy_shader_state_instant( resource_deletion.handle );
-                break;
-            }
-
-            case ResourceDeletionType::Texture:
-            {
-                destroy_texture_instant( resource_deletion.handle );
-                break;
-            }
-        }
+    for ( u32 i = 0; i < k_max_swapchain_images; ++i ) {
+        flush_deletions( i );
+        reset_transient_resource_lists( i );
     }
 
 
@@ -969,6 +1013,18 @@ void GpuDeviceVulkan::internal_shutdown() {
     }
     render_pass_cache.shutdown();
 
+    // Save and destroy pipeline caches.
+    if ( pipeline_cache_path[ 0 ] ) {
+        save_pipeline_caches( pipeline_cache_path );
+    }
+    it = pipeline_caches.iterator_begin();
+    while ( it.is_valid() ) {
+        VkPipelineCache vk_pipeline_cache = pipeline_caches.get( it );
+        vkDestroyPipelineCache( vulkan_device, vk_pipeline_cache, vulkan_allocation_callbacks );
+        pipeline_caches.iterator_advance( it );
+    }
+    pipeline_caches.shutdown();
+
     // Destroy swapchain render pass, not present in the cache.
     RenderPassVulkan* vk_swapchain_pass = access_render_pass( swapchain_pass );
     vkDestroyRenderPass( vulkan_device, vk_swapchain_pass->vk_render_pass, vulkan_allocation_callbacks );
@@ -979,9 +1035,18 @@ void GpuDeviceVulkan::internal_shutdown() {
 
     vmaDestroyAllocator( vma_allocator );
 
-    resource_deletion_queue.shutdown();
-    resource_list_update_queue.shutdown();
-    texture_to_update_bindless.shutdown();
+    update_queues.shutdown();
+
+    descriptor_writes.shutdown();
+    descriptor_buffer_infos.shutdown();
+    descriptor_image_infos.shutdown();
+    descriptor_set_layouts.shutdown();
+    descriptor_sets.shutdown();
+
+    for ( u32 i = 0; i < k_max_swapchain_images; ++i ) {
+        transient_resource_lists[ i ].shutdown();
+        transient_resource_list_memory[ i ].shutdown();
+    }
 
     //command_buffers.shutdown();
     pipelines.shutdown();
@@ -1007,6 +1072,9 @@ void GpuDeviceVulkan::internal_shutdown() {
 #endif // HYDRA_BINDLESS
 
     vkDestroyDescriptorPool( vulkan_device, vulkan_descriptor_pool, vulkan_allocation_callbacks );
+    for ( u32 i = 0; i < k_max_swapchain_images; ++i ) {
+        vkDestroyDescriptorPool( vulkan_device, vulkan_transient_descriptor_pools[ i ], vulkan_allocation_callbacks );
+    }
     vkDestroyQueryPool( vulkan_device, vulkan_timestamp_query_pool, vulkan_allocation_callbacks );
 
     vkDestroyDevice( vulkan_device, vulkan_allocation_callbacks );
@@ -1142,9 +1210,8 @@ static void vulkan_create_texture( GpuDeviceVulkan& gpu, const TextureCreation&
 #if defined (HYDRA_BINDLESS)
     // Add deferred bindless update.
     if ( gpu.bindless_supported ) {
-        ResourceUpdate resource_update{ ResourceDeletionType::Texture, texture->handle.index, gpu.current_frame };
-        gpu.texture_to_update_bindless.push( resource_update );
-    }    
+        gpu.update_queues.push_bindless_update( texture->handle );
+    }
 #endif // HYDRA_BINDLESS
 }
 
@@ -1337,32 +1404,35 @@ ShaderStateHandle GpuDeviceVulkan::create_shader_state( const ShaderStateCreatio
     return handle;
 }
 
-PipelineHandle GpuDeviceVulkan::create_pipeline( const PipelineCreation& creation ) {
-    PipelineHandle handle = { pipelines.obtain_resource() };
+//
+// Creates shader state and pipeline layout, the VkPipeline is created by vulkan_create_pipeline.
+static PipelineHandle vulkan_prepare_pipeline( GpuDeviceVulkan& gpu, const PipelineCreation& creation ) {
+    PipelineHandle handle = { gpu.pipelines.obtain_resource() };
     if ( handle.index == k_invalid_index ) {
         return handle;
     }
 
-    ShaderStateHandle shader_state = create_shader_state( creation.shaders );
+    ShaderStateHandle shader_state = gpu.create_shader_state( creation.shaders );
     if ( shader_state.index == k_invalid_index ) {
         // Shader did not compile.
-        pipelines.release_resource( handle.index );
+        gpu.pipelines.release_resource( handle.index );
         handle.index = k_invalid_index;
 
         return handle;
     }
 
     // Now that shaders have compiled we can create the pipeline.
-    PipelineVulkan* pipeline = access_pipeline( handle );
-    ShaderStateVulkan* shader_state_data = access_shader_state( shader_state );
+    PipelineVulkan* pipeline = gpu.access_pipeline( handle );
 
     pipeline->shader_state = shader_state;
+    pipeline->handle = handle;
+    pipeline->status = PipelineVulkan::Status_Pending;
 
     VkDescriptorSetLayout vk_layouts[ k_max_resource_layouts ];
 
     // Create VkPipelineLayout
     for ( uint32_t l = 0; l < creation.num_active_layouts; ++l ) {
-        pipeline->resource_layout[ l ] = access_resource_layout( creation.resource_layout[ l ] );
+        pipeline->resource_layout[ l ] = gpu.access_resource_layout( creation.resource_layout[ l ] );
         pipeline->resource_layout_handle[ l ] = creation.resource_layout[ l ];
 
         vk_layouts[ l ] = pipeline->resource_layout[ l ]->vk_descriptor_set_layout;
@@ -1370,7 +1440,7 @@ PipelineHandle GpuDeviceVulkan::create_pipeline( const PipelineCreation& creatio
 
     u32 bindless_active = 0;
 #if defined(HYDRA_BINDLESS)
-    vk_layouts[ creation.num_active_layouts ] = vulkan_bindless_descriptor_layout;
+    vk_layouts[ creation.num_active_layouts ] = gpu.vulkan_bindless_descriptor_layout;
     bindless_active = 1;
 #endif
 
@@ -1379,11 +1449,22 @@ PipelineHandle GpuDeviceVulkan::create_pipeline( const PipelineCreation& creatio
     pipeline_layout_info.setLayoutCount = creation.num_active_layouts + bindless_active;
 
     VkPipelineLayout pipeline_layout;
-    check( vkCreatePipelineLayout( vulkan_device, &pipeline_layout_info, vulkan_allocation_callbacks, &pipeline_layout ) );
+    check( vkCreatePipelineLayout( gpu.vulkan_device, &pipeline_layout_info, gpu.vulkan_allocation_callbacks, &pipeline_layout ) );
     // Cache pipeline layout
     pipeline->vk_pipeline_layout = pipeline_layout;
     pipeline->num_active_layouts = creation.num_active_layouts;
 
+    return handle;
+}
+
+//
+// Creates the VkPipeline, safe to call from the compile thread.
+static void vulkan_create_pipeline( GpuDeviceVulkan& gpu, const PipelineCreation& creation, PipelineVulkan* pipeline, VkRenderPass vk_render_pass, VkPipelineCache vk_pipeline_cache ) {
+
+    ShaderStateVulkan* shader_state_data = gpu.access_shader_state( pipeline->shader_state );
+    VkPipelineLayout pipeline_layout = pipeline->vk_pipeline_layout;
+    VkResult result;
+
     // Create full pipeline
     if ( shader_state_data->graphics_pipeline ) {
         VkGraphicsPipelineCreateInfo pipeline_info = { VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
@@ -1528,14 +1609,14 @@ PipelineHandle GpuDeviceVulkan::create_pipeline( const PipelineCreation& creatio
         VkViewport viewport = {};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
-        viewport.width = ( float )swapchain_width;
-        viewport.height = ( float )swapchain_height;
+        viewport.width = ( float )gpu.swapchain_width;
+        viewport.height = ( float )gpu.swapchain_height;
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
 
         VkRect2D scissor = {};
         scissor.offset = { 0, 0 };
-        scissor.extent = { swapchain_width, swapchain_height };
+        scissor.extent = { gpu.swapchain_width, gpu.swapchain_height };
 
         VkPipelineViewportStateCreateInfo viewport_state{ VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO };
         viewport_state.viewportCount = 1;
@@ -1546,7 +1627,7 @@ PipelineHandle GpuDeviceVulkan::create_pipeline( const PipelineCreation& creatio
         pipeline_info.pViewportState = &viewport_state;
 
         //// Render Pass
-        pipeline_info.renderPass = get_vulkan_render_pass( creation.render_pass, creation.name );
+        pipeline_info.renderPass = vk_render_pass;
 
         //// Dynamic states
         VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
@@ -1556,7 +1637,7 @@ PipelineHandle GpuDeviceVulkan::create_pipeline( const PipelineCreation& creatio
 
         pipeline_info.pDynamicState = &dynamic_state;
 
-        vkCreateGraphicsPipelines( vulkan_device, VK_NULL_HANDLE, 1, &pipeline_info, vulkan_allocation_callbacks, &pipeline->vk_pipeline );
+        result = vkCreateGraphicsPipelines( gpu.vulkan_device, vk_pipeline_cache, 1, &pipeline_info, gpu.vulkan_allocation_callbacks, &pipeline->vk_pipeline );
 
         pipeline->vk_bind_point = VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_GRAPHICS;
     } else {
@@ -1565,14 +1646,108 @@ PipelineHandle GpuDeviceVulkan::create_pipeline( const PipelineCreation& creatio
         pipeline_info.stage = shader_state_data->shader_stage_info[ 0 ];
         pipeline_info.layout = pipeline_layout;
 
-        vkCreateComputePipelines( vulkan_device, VK_NULL_HANDLE, 1, &pipeline_info, vulkan_allocation_callbacks, &pipeline->vk_pipeline );
+        result = vkCreateComputePipelines( gpu.vulkan_device, vk_pipeline_cache, 1, &pipeline_info, gpu.vulkan_allocation_callbacks, &pipeline->vk_pipeline );
 
         pipeline->vk_bind_point = VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_COMPUTE;
     }
 
+    if ( result != VK_SUCCESS ) {
+        hprint( "Error creating pipeline %s: vulkan code(%d)\n", creation.name ? creation.name : "", result );
+        pipeline->vk_pipeline = VK_NULL_HANDLE;
+        hydra::atomic_store_release( &pipeline->status, PipelineVulkan::Status_Failed );
+        return;
+    }
+
+    hydra::atomic_store_release( &pipeline->status, PipelineVulkan::Status_Ready );
+}
+
+static void pipeline_compile_thread( void* user_data ) {
+    PipelineCompiler* compiler = ( PipelineCompiler* )user_data;
+
+    for ( ;; ) {
+        PipelineCompileJob job;
+        {
+            hydra::ScopedLock lock( compiler->mutex );
+            while ( compiler->running && compiler->queue_head == compiler->queue.size ) {
+                compiler->job_available.wait( compiler->mutex );
+            }
+
+            // Stopped with nothing left to compile.
+            if ( compiler->queue_head == compiler->queue.size ) {
+                break;
+            }
+
+            job = compiler->queue[ compiler->queue_head++ ];
+
+            // Reuse the queue memory once everything has been consumed.
+            if ( compiler->queue_head == compiler->queue.size ) {
+                compiler->queue.clear();
+                compiler->queue_head = 0;
+            }
+        }
+
+        vulkan_create_pipeline( s_vulkan_device, job.creation, job.pipeline, job.vk_render_pass, job.vk_pipeline_cache );
+
+        hydra::ScopedLock lock( compiler->mutex );
+        compiler->job_done.notify_all();
+    }
+}
+
+PipelineHandle GpuDeviceVulkan::create_pipeline( const PipelineCreation& creation ) {
+    PipelineHandle handle = vulkan_prepare_pipeline( *this, creation );
+    if ( handle.index == k_invalid_index ) {
+        return handle;
+    }
+
+    VkRenderPass vk_render_pass = VK_NULL_HANDLE;
+    if ( access_shader_state( access_pipeline( handle )->shader_state )->graphics_pipeline ) {
+        vk_render_pass = get_vulkan_render_pass( creation.render_pass, creation.name );
+    }
+
+    vulkan_create_pipeline( *this, creation, access_pipeline( handle ), vk_render_pass, get_pipeline_cache( creation.shaders ) );
+
     return handle;
 }
 
+PipelineHandle GpuDeviceVulkan::create_pipeline_async( const PipelineCreation& creation ) {
+    PipelineHandle handle = vulkan_prepare_pipeline( *this, creation );
+    if ( handle.index == k_invalid_index ) {
+        return handle;
+    }
+
+    PipelineCompileJob job;
+    job.creation = creation;
+    job.pipeline = access_pipeline( handle );
+    job.vk_render_pass = VK_NULL_HANDLE;
+    if ( access_shader_state( job.pipeline->shader_state )->graphics_pipeline ) {
+        job.vk_render_pass = get_vulkan_render_pass( creation.render_pass, creation.name );
+    }
+    job.vk_pipeline_cache = get_pipeline_cache( creation.shaders );
+
+    hydra::ScopedLock lock( pipeline_compiler.mutex );
+    pipeline_compiler.queue.push( job );
+    pipeline_compiler.job_available.notify_one();
+
+    return handle;
+}
+
+bool GpuDeviceVulkan::is_pipeline_ready( PipelineHandle pipeline ) {
+    return hydra::atomic_load_acquire( &access_pipeline( pipeline )->status ) == PipelineVulkan::Status_Ready;
+}
+
+//
+// Waits until the compile thread is done with the pipeline, that is then ready or failed.
+// Status is set before job_done is notified under the mutex, so the check under the mutex can't miss it.
+void GpuDeviceVulkan::wait_pipeline_compiled( PipelineHandle pipeline ) {
+    PipelineVulkan* vulkan_pipeline = access_pipeline( pipeline );
+
+    hydra::ScopedLock lock( pipeline_compiler.mutex );
+    while ( hydra::atomic_load_acquire( &vulkan_pipeline->status ) == PipelineVulkan::Status_Pending ) {
+        pipeline_compiler.job_done.wait( pipeline_compiler.mutex );
+    }
+}
+
+
 BufferHandle GpuDeviceVulkan::create_buffer( const BufferCreation& creation ) {
     BufferHandle handle = { buffers.obtain_resource() };
     if ( handle.index == k_invalid_index ) {
@@ -1593,7 +1768,7 @@ BufferHandle GpuDeviceVulkan::create_buffer( const BufferCreation& creation ) {
     static const u32 k_dynamic_buffer_mask = BufferType::Vertex_mask | BufferType::Index_mask | BufferType::Constant_mask;
     const bool use_global_buffer = ( creation.type & k_dynamic_buffer_mask ) != 0;
     if ( creation.usage == ResourceUsageType::Dynamic && use_global_buffer ) {
-        buffer->parent_buffer = dynamic_buffer;
+        buffer->parent_buffer = dynamic_allocator.buffer;
         return handle;
     }
 
@@ -1934,18 +2109,16 @@ static void vulkan_fill_write_descriptor_sets( GpuDeviceVulkan& gpu, const Resou
     num_resources = used_resources;
 }
 
-ResourceListHandle GpuDeviceVulkan::create_resource_list( const ResourceListCreation& creation ) {
-    ResourceListHandle handle = { resource_lists.obtain_resource() };
-    if ( handle.index == k_invalid_index ) {
-        return handle;
-    }
+//
+// Descriptor set comes from descriptor_pool, cached resources arrays from memory_allocator.
+static void vulkan_create_resource_list( GpuDeviceVulkan& gpu, const ResourceListCreation& creation, ResourceListVulkan* resource_list,
+                                         VkDescriptorPool descriptor_pool, Allocator* memory_allocator ) {
 
-    ResourceListVulkan* resource_list = access_resource_list( handle );
-    const ResourceLayoutVulkan* resource_list_layout = access_resource_layout( creation.layout );
+    const ResourceLayoutVulkan* resource_list_layout = gpu.access_resource_layout( creation.layout );
 
     // Allocate descriptor set
     VkDescriptorSetAllocateInfo alloc_info{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
-    alloc_info.descriptorPool = vulkan_descriptor_pool;
+    alloc_info.descriptorPool = descriptor_pool;
     alloc_info.descriptorSetCount = 1;
     alloc_info.pSetLayouts = &resource_list_layout->vk_descriptor_set_layout;
 
@@ -1953,7 +2126,7 @@ ResourceListHandle GpuDeviceVulkan::create_resource_list( const ResourceListCrea
     //VkDescriptorSetVariableDescriptorCountAllocateInfoEXT count_info{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO_EXT };
     //u32 max_binding = resource_list_layout->max_binding + 1;
     //// Use variable descriptor only on layouts that have bindless resources.
-    //if ( bindless_supported && resource_list_layout->max_binding >= k_bindless_texture_binding ) {
+    //if ( gpu.bindless_supported && resource_list_layout->max_binding >= k_bindless_texture_binding ) {
     //    count_info.descriptorSetCount = 1;
     //    // This number is the max allocatable count
     //    count_info.pDescriptorCounts = &max_binding;
@@ -1961,9 +2134,9 @@ ResourceListHandle GpuDeviceVulkan::create_resource_list( const ResourceListCrea
     //}
 #endif // HYDRA_BINDLESS
 
-    check( vkAllocateDescriptorSets( vulkan_device, &alloc_info, &resource_list->vk_descriptor_set ) );
+    check( vkAllocateDescriptorSets( gpu.vulkan_device, &alloc_info, &resource_list->vk_descriptor_set ) );
     // Cache data
-    u8* memory = hallocam( ( sizeof( ResourceHandle ) + sizeof( SamplerHandle ) + sizeof( u16 ) ) * creation.num_resources, allocator );
+    u8* memory = hallocam( ( sizeof( ResourceHandle ) + sizeof( SamplerHandle ) + sizeof( u16 ) ) * creation.num_resources, memory_allocator );
     resource_list->resources = ( ResourceHandle* )memory;
     resource_list->samplers = ( SamplerHandle* )( memory + sizeof( ResourceHandle ) * creation.num_resources );
     resource_list->bindings = ( u16* )( memory + ( sizeof( ResourceHandle ) + sizeof( SamplerHandle ) ) * creation.num_resources );
@@ -1975,10 +2148,10 @@ ResourceListHandle GpuDeviceVulkan::create_resource_list( const ResourceListCrea
     VkDescriptorBufferInfo buffer_info[ 8 ];
     VkDescriptorImageInfo image_info[ 8 ];
 
-    SamplerVulkan* vk_default_sampler = access_sampler( default_sampler );
+    SamplerVulkan* vk_default_sampler = gpu.access_sampler( gpu.default_sampler );
 
     u32 num_resources = creation.num_resources;
-    vulkan_fill_write_descriptor_sets( *this, resource_list_layout, resource_list->vk_descriptor_set, descriptor_write, buffer_info, image_info, vk_default_sampler->vk_sampler,
+    vulkan_fill_write_descriptor_sets( gpu, resource_list_layout, resource_list->vk_descriptor_set, descriptor_write, buffer_info, image_info, vk_default_sampler->vk_sampler,
                                        num_resources, creation.resources, creation.samplers, creation.bindings );
 
     // Cache resources
@@ -1988,7 +2161,31 @@ ResourceListHandle GpuDeviceVulkan::create_resource_list( const ResourceListCrea
         resource_list->bindings[ r ] = creation.bindings[ r ];
     }
 
-    vkUpdateDescriptorSets( vulkan_device, num_resources, descriptor_write, 0, nullptr );
+    vkUpdateDescriptorSets( gpu.vulkan_device, num_resources, descriptor_write, 0, nullptr );
+}
+
+ResourceListHandle GpuDeviceVulkan::create_resource_list( const ResourceListCreation& creation ) {
+    ResourceListHandle handle = { resource_lists.obtain_resource() };
+    if ( handle.index == k_invalid_index ) {
+        return handle;
+    }
+
+    ResourceListVulkan* resource_list = access_resource_list( handle );
+    vulkan_create_resource_list( *this, creation, resource_list, vulkan_descriptor_pool, allocator );
+
+    return handle;
+}
+
+ResourceListHandle GpuDeviceVulkan::create_resource_list_transient( const ResourceListCreation& creation ) {
+    ResourceListHandle handle = { resource_lists.obtain_resource() };
+    if ( handle.index == k_invalid_index ) {
+        return handle;
+    }
+
+    ResourceListVulkan* resource_list = access_resource_list( handle );
+    vulkan_create_resource_list( *this, creation, resource_list, vulkan_transient_descriptor_pools[ current_frame ], &transient_resource_list_memory[ current_frame ] );
+
+    transient_resource_lists[ current_frame ].push( handle );
 
     return handle;
 }
@@ -2349,7 +2546,7 @@ RenderPassHandle GpuDeviceVulkan::create_render_pass( const RenderPassCreation&
 
 void GpuDeviceVulkan::destroy_buffer( BufferHandle buffer ) {
     if ( buffer.index < buffers.pool_size ) {
-        resource_deletion_queue.push( { ResourceDeletionType::Buffer, buffer.index, current_frame } );
+        update_queues.push_deletion( ResourceDeletionType::Buffer, buffer.index, current_frame );
     } else {
         hprint( "Graphics error: trying to free invalid Buffer %u\n", buffer.index );
     }
@@ -2357,8 +2554,12 @@ void GpuDeviceVulkan::destroy_buffer( BufferHandle buffer ) {
 
 void GpuDeviceVulkan::destroy_texture( TextureHandle texture ) {
     if ( texture.index < textures.pool_size ) {
-        resource_deletion_queue.push( { ResourceDeletionType::Texture, texture.index, current_frame } );
-        texture_to_update_bindless.push( { ResourceDeletionType::Texture, texture.index, current_frame } );
+        update_queues.push_deletion( ResourceDeletionType::Texture, texture.index, current_frame );
+#if defined (HYDRA_BINDLESS)
+        if ( bindless_supported ) {
+            update_queues.push_bindless_update( texture );
+        }
+#endif // HYDRA_BINDLESS
         // Signal texture to update the bindless slot to dummy texture.
         //TextureVulkan* vk_texture = access_texture( texture );
         //vk_texture->format = TextureFormat::UNKNOWN;
@@ -2370,7 +2571,10 @@ void GpuDeviceVulkan::destroy_texture( TextureHandle texture ) {
 
 void GpuDeviceVulkan::destroy_pipeline( PipelineHandle pipeline ) {
     if ( pipeline.index < pipelines.pool_size ) {
-        resource_deletion_queue.push( { ResourceDeletionType::Pipeline, pipeline.index, current_frame } );
+        // Shader modules are used by the compile thread until the pipeline is created or failed.
+        wait_pipeline_compiled( pipeline );
+
+        update_queues.push_deletion( ResourceDeletionType::Pipeline, pipeline.index, current_frame );
         // Shader state creation is handled internally when creating a pipeline, thus add this to track correctly.
         PipelineVulkan* v_pipeline = access_pipeline( pipeline );
         destroy_shader_state( v_pipeline->shader_state );
@@ -2381,7 +2585,7 @@ void GpuDeviceVulkan::destroy_pipeline( PipelineHandle pipeline ) {
 
 void GpuDeviceVulkan::destroy_sampler( SamplerHandle sampler ) {
     if ( sampler.index < samplers.pool_size ) {
-        resource_deletion_queue.push( { ResourceDeletionType::Sampler, sampler.index, current_frame } );
+        update_queues.push_deletion( ResourceDeletionType::Sampler, sampler.index, current_frame );
     } else {
         hprint( "Graphics error: trying to free invalid Sampler %u\n", sampler.index );
     }
@@ -2389,7 +2593,7 @@ void GpuDeviceVulkan::destroy_sampler( SamplerHandle sampler ) {
 
 void GpuDeviceVulkan::destroy_resource_layout( ResourceLayoutHandle resource_layout ) {
     if ( resource_layout.index < resource_layouts.pool_size ) {
-        resource_deletion_queue.push( { ResourceDeletionType::ResourceLayout, resource_layout.index, current_frame } );
+        update_queues.push_deletion( ResourceDeletionType::ResourceLayout, resource_layout.index, current_frame );
     } else {
         hprint( "Graphics error: trying to free invalid ResourceLayout %u\n", resource_layout.index );
     }
@@ -2397,7 +2601,7 @@ void GpuDeviceVulkan::destroy_resource_layout( ResourceLayoutHandle resource_lay
 
 void GpuDeviceVulkan::destroy_resource_list( ResourceListHandle resource_list ) {
     if ( resource_list.index < resource_lists.pool_size ) {
-        resource_deletion_queue.push( { ResourceDeletionType::ResourceList, resource_list.index, current_frame } );
+        update_queues.push_deletion( ResourceDeletionType::ResourceList, resource_list.index, current_frame );
     } else {
         hprint( "Graphics error: trying to free invalid ResourceList %u\n", resource_list.index );
     }
@@ -2405,7 +2609,7 @@ void GpuDeviceVulkan::destroy_resource_list( ResourceListHandle resource_list )
 
 void GpuDeviceVulkan::destroy_render_pass( RenderPassHandle render_pass ) {
     if ( render_pass.index < render_passes.pool_size ) {
-        resource_deletion_queue.push( { ResourceDeletionType::RenderPass, render_pass.index, current_frame } );
+        update_queues.push_deletion( ResourceDeletionType::RenderPass, render_pass.index, current_frame );
     } else {
         hprint( "Graphics error: trying to free invalid RenderPass %u\n", render_pass.index );
     }
@@ -2413,7 +2617,7 @@ void GpuDeviceVulkan::destroy_render_pass( RenderPassHandle render_pass ) {
 
 void GpuDeviceVulkan::destroy_shader_state( ShaderStateHandle shader ) {
     if ( shader.index < shaders.pool_size ) {
-        resource_deletion_queue.push( { ResourceDeletionType::ShaderState, shader.index, current_frame } );
+        update_queues.push_deletion( ResourceDeletionType::ShaderState, shader.index, current_frame );
     } else {
         hprint( "Graphics error: trying to free invalid Shader %u\n", shader.index );
     }
@@ -2635,6 +2839,141 @@ VkRenderPass GpuDeviceVulkan::get_vulkan_render_pass( const RenderPassOutput& ou
     return vulkan_render_pass;
 }
 
+// Pipeline cache /////////////////////////////////////////////////////////
+
+//
+// File layout: header, then for each cache its key, data size and data as returned by vkGetPipelineCacheData.
+// The whole file is discarded if it was written by a different device or driver.
+struct PipelineCacheFileHeader {
+
+    u32                             magic;
+    u32                             version;
+    u32                             vendor_id;
+    u32                             device_id;
+    u32                             driver_version;
+    u32                             num_entries;
+    u8                              uuid[ VK_UUID_SIZE ];
+
+}; // struct PipelineCacheFileHeader
+
+struct PipelineCacheFileEntry {
+
+    u64                             key;
+    u64                             size;
+
+}; // struct PipelineCacheFileEntry
+
+static const u32                    k_pipeline_cache_magic = 0x43504648;      // 'HFPC'
+static const u32                    k_pipeline_cache_version = 1;
+
+//
+// Pipelines using the same shaders share a cache, so recompiling a variant with a different state is faster too.
+VkPipelineCache GpuDeviceVulkan::get_pipeline_cache( const ShaderStateCreation& shaders ) {
+    const u64 key = shaders.compute_hash();
+    VkPipelineCache vk_pipeline_cache = pipeline_caches.get( key );
+    if ( vk_pipeline_cache ) {
+        return vk_pipeline_cache;
+    }
+
+    VkPipelineCacheCreateInfo cache_info{ VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+    check( vkCreatePipelineCache( vulkan_device, &cache_info, vulkan_allocation_callbacks, &vk_pipeline_cache ) );
+    pipeline_caches.insert( key, vk_pipeline_cache );
+
+    return vk_pipeline_cache;
+}
+
+void GpuDeviceVulkan::load_pipeline_caches( cstring path ) {
+    FileReadResult file = file_read_binary( path, allocator );
+    if ( file.data == nullptr ) {
+        return;
+    }
+
+    const PipelineCacheFileHeader* header = ( const PipelineCacheFileHeader* )file.data;
+    const bool valid = file.size >= sizeof( PipelineCacheFileHeader ) &&
+                       header->magic == k_pipeline_cache_magic && header->version == k_pipeline_cache_version &&
+                       header->vendor_id == vulkan_physical_properties.vendorID && header->device_id == vulkan_physical_properties.deviceID &&
+                       header->driver_version == vulkan_physical_properties.driverVersion &&
+                       memcmp( header->uuid, vulkan_physical_properties.pipelineCacheUUID, VK_UUID_SIZE ) == 0;
+    if ( !valid ) {
+        hprint( "Pipeline cache %s is not compatible with the current device, discarding it.\n", path );
+        hfree( file.data, allocator );
+        return;
+    }
+
+    sizet offset = sizeof( PipelineCacheFileHeader );
+    for ( u32 i = 0; i < header->num_entries; ++i ) {
+        if ( offset + sizeof( PipelineCacheFileEntry ) > file.size ) {
+            break;
+        }
+        const PipelineCacheFileEntry* entry = ( const PipelineCacheFileEntry* )( file.data + offset );
+        offset += sizeof( PipelineCacheFileEntry );
+        if ( offset + entry->size > file.size ) {
+            break;
+        }
+
+        VkPipelineCacheCreateInfo cache_info{ VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+        cache_info.initialDataSize = ( sizet )entry->size;
+        cache_info.pInitialData = file.data + offset;
+        offset += ( sizet )entry->size;
+
+        VkPipelineCache vk_pipeline_cache;
+        if ( vkCreatePipelineCache( vulkan_device, &cache_info, vulkan_allocation_callbacks, &vk_pipeline_cache ) == VK_SUCCESS ) {
+            pipeline_caches.insert( entry->key, vk_pipeline_cache );
+        }
+    }
+
+    hfree( file.data, allocator );
+}
+
+//
+// Written in a temporary file and then renamed, so a crash while saving does not leave a partial cache.
+void GpuDeviceVulkan::save_pipeline_caches( cstring path ) {
+    char temporary_path[ 512 ];
+    snprintf( temporary_path, 512, "%s.tmp", path );
+
+    FILE* file = fopen( temporary_path, "wb" );
+    if ( file == nullptr ) {
+        return;
+    }
+
+    PipelineCacheFileHeader header;
+    header.magic = k_pipeline_cache_magic;
+    header.version = k_pipeline_cache_version;
+    header.vendor_id = vulkan_physical_properties.vendorID;
+    header.device_id = vulkan_physical_properties.deviceID;
+    header.driver_version = vulkan_physical_properties.driverVersion;
+    header.num_entries = ( u32 )pipeline_caches.size;
+    memcpy( header.uuid, vulkan_physical_properties.pipelineCacheUUID, VK_UUID_SIZE );
+
+    bool written = fwrite( &header, sizeof( PipelineCacheFileHeader ), 1, file ) == 1;
+
+    FlatHashMapIterator it = pipeline_caches.iterator_begin();
+    while ( written && it.is_valid() ) {
+        const FlatHashMap<u64, VkPipelineCache>::KeyValue& cache = pipeline_caches.get_structure( it );
+
+        sizet data_size = 0;
+        vkGetPipelineCacheData( vulkan_device, cache.value, &data_size, nullptr );
+        void* data = data_size ? hallocam( data_size, allocator ) : nullptr;
+        if ( data ) {
+            vkGetPipelineCacheData( vulkan_device, cache.value, &data_size, data );
+        }
+
+        PipelineCacheFileEntry entry{ cache.key, data_size };
+        written = fwrite( &entry, sizeof( PipelineCacheFileEntry ), 1, file ) == 1;
+        written = written && ( data_size == 0 || fwrite( data, data_size, 1, file ) == 1 );
+
+        if ( data ) {
+            hfree( data, allocator );
+        }
+        pipeline_caches.iterator_advance( it );
+    }
+    fclose( file );
+
+    if ( !written || !file_rename( temporary_path, path ) ) {
+        file_delete( temporary_path );
+    }
+}
+
 //
 //
 static void vulkan_resize_texture( GpuDeviceVulkan& gpu, TextureVulkan* v_texture, TextureVulkan* v_texture_to_delete, u16 width, u16 height, u16 depth ) {
@@ -2703,50 +3042,173 @@ void GpuDeviceVulkan::update_resource_list( ResourceListHandle resource_list ) {
 
     if ( resource_list.index < resource_lists.pool_size ) {
 
-        ResourceListUpdate new_update = { resource_list, current_frame };
-        resource_list_update_queue.push( new_update );
-
-
+        update_queues.push_resource_list_update( resource_list );
     } else {
         hprint( "Graphics error: trying to update invalid ResourceList %u\n", resource_list.index );
     }
 }
 
-void GpuDeviceVulkan::update_resource_list_instant( const ResourceListUpdate& update ) {
+// Update queues //////////////////////////////////////////////////////////
 
-    // Use a dummy resource list to delete the vulkan descriptor set handle
-    ResourceListHandle dummy_delete_resource_list_handle = { resource_lists.obtain_resource() };
-    ResourceListVulkan* dummy_delete_resource_list = access_resource_list( dummy_delete_resource_list_handle );
+//
+// All queued resource lists get a new descriptor set, allocated and written in one call each.
+void GpuDeviceVulkan::flush_resource_list_updates() {
 
-    ResourceListVulkan* resource_list = access_resource_list( update.resource_list );
-    const ResourceLayoutVulkan* resource_layout = resource_list->layout;
+    const u32 num_updates = update_queues.resource_list_updates.size;
+    if ( num_updates == 0 ) {
+        return;
+    }
 
-    dummy_delete_resource_list->vk_descriptor_set = resource_list->vk_descriptor_set;
-    dummy_delete_resource_list->bindings = nullptr;
-    dummy_delete_resource_list->resources = nullptr;
-    dummy_delete_resource_list->samplers = nullptr;
-    dummy_delete_resource_list->num_resources = 0;
+    descriptor_set_layouts.set_size( num_updates );
+    descriptor_sets.set_size( num_updates );
 
-    destroy_resource_list( dummy_delete_resource_list_handle );
+    u32 max_writes = 0;
+    for ( u32 i = 0; i < num_updates; ++i ) {
+        ResourceListVulkan* resource_list = access_resource_list( update_queues.resource_list_updates[ i ] );
+        descriptor_set_layouts[ i ] = resource_list->layout->vk_descriptor_set_layout;
+        max_writes += resource_list->layout->num_bindings;
+    }
 
-    // Allocate the new descriptor set and update its content.
-    VkWriteDescriptorSet descriptor_write[ 8 ];
-    VkDescriptorBufferInfo buffer_info[ 8 ];
-    VkDescriptorImageInfo image_info[ 8 ];
+    VkDescriptorSetAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+    allocInfo.descriptorPool = vulkan_descriptor_pool;
+    allocInfo.descriptorSetCount = num_updates;
+    allocInfo.pSetLayouts = descriptor_set_layouts.data;
+    vkAllocateDescriptorSets( vulkan_device, &allocInfo, descriptor_sets.data );
+
+    // Writes point to the infos, so size the arrays before filling them.
+    descriptor_writes.set_size( max_writes );
+    descriptor_buffer_infos.set_size( max_writes );
+    descriptor_image_infos.set_size( max_writes );
 
     SamplerVulkan* vk_default_sampler = access_sampler( default_sampler );
 
-    VkDescriptorSetAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
-    allocInfo.descriptorPool = vulkan_descriptor_pool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &resource_list->layout->vk_descriptor_set_layout;
-    vkAllocateDescriptorSets( vulkan_device, &allocInfo, &resource_list->vk_descriptor_set );
+    u32 num_writes = 0;
+    for ( u32 i = 0; i < num_updates; ++i ) {
+        ResourceListVulkan* resource_list = access_resource_list( update_queues.resource_list_updates[ i ] );
+        const ResourceLayoutVulkan* resource_layout = resource_list->layout;
+
+        // Use a dummy resource list to delete the vulkan descriptor set handle
+        ResourceListHandle dummy_delete_resource_list_handle = { resource_lists.obtain_resource() };
+        ResourceListVulkan* dummy_delete_resource_list = access_resource_list( dummy_delete_resource_list_handle );
+
+        dummy_delete_resource_list->vk_descriptor_set = resource_list->vk_descriptor_set;
+        dummy_delete_resource_list->bindings = nullptr;
+        dummy_delete_resource_list->resources = nullptr;
+        dummy_delete_resource_list->samplers = nullptr;
+        dummy_delete_resource_list->num_resources = 0;
+
+        destroy_resource_list( dummy_delete_resource_list_handle );
+
+        resource_list->vk_descriptor_set = descriptor_sets[ i ];
+
+        u32 num_resources = resource_layout->num_bindings;
+        vulkan_fill_write_descriptor_sets( *this, resource_layout, resource_list->vk_descriptor_set, &descriptor_writes[ num_writes ], &descriptor_buffer_infos[ num_writes ],
+                                           &descriptor_image_infos[ num_writes ], vk_default_sampler->vk_sampler, num_resources, resource_list->resources, resource_list->samplers,
+                                           resource_list->bindings );
+        num_writes += num_resources;
+    }
+
+    vkUpdateDescriptorSets( vulkan_device, num_writes, descriptor_writes.data, 0, nullptr );
+
+    update_queues.resource_list_updates.clear();
+}
+
+//
+// Writes all queued textures in the bindless descriptor set. Destroyed textures are written as the dummy texture.
+void GpuDeviceVulkan::flush_bindless_updates() {
+
+    const u32 num_updates = update_queues.bindless_updates.size;
+    if ( num_updates == 0 ) {
+        return;
+    }
+
+    descriptor_writes.set_size( num_updates );
+    descriptor_image_infos.set_size( num_updates );
+
+    TextureVulkan* vk_dummy_texture = access_texture( dummy_texture );
+    SamplerVulkan* vk_default_sampler = access_sampler( default_sampler );
+
+    // Writes are applied in order, so the last update of a texture wins.
+    for ( u32 i = 0; i < num_updates; ++i ) {
+        TextureHandle texture_handle = update_queues.bindless_updates[ i ];
+        TextureVulkan* texture = access_texture( texture_handle );
+
+        // Handles should be the same.
+        hy_assert( texture->handle.index == texture_handle.index );
 
-    u32 num_resources = resource_layout->num_bindings;
-    vulkan_fill_write_descriptor_sets( *this, resource_layout, resource_list->vk_descriptor_set, descriptor_write, buffer_info, image_info, vk_default_sampler->vk_sampler,
-                                       num_resources, resource_list->resources, resource_list->samplers, resource_list->bindings );
+        VkWriteDescriptorSet& descriptor_write = descriptor_writes[ i ];
+        descriptor_write = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+        descriptor_write.descriptorCount = 1;
+        descriptor_write.dstArrayElement = texture_handle.index;
+        descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptor_write.dstSet = vulkan_bindless_descriptor_set;
+        descriptor_write.dstBinding = k_bindless_texture_binding;
 
-    vkUpdateDescriptorSets( vulkan_device, num_resources, descriptor_write, 0, nullptr );
+        VkDescriptorImageInfo& descriptor_image_info = descriptor_image_infos[ i ];
+        descriptor_image_info.sampler = vk_default_sampler->vk_sampler;
+        descriptor_image_info.imageView = texture->format != TextureFormat::UNKNOWN ? texture->vk_image_view : vk_dummy_texture->vk_image_view;
+        descriptor_image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        descriptor_write.pImageInfo = &descriptor_image_info;
+    }
+
+    vkUpdateDescriptorSets( vulkan_device, num_updates, descriptor_writes.data, 0, nullptr );
+
+    update_queues.bindless_updates.clear();
+}
+
+//
+// Releases the resources destroyed during frame, with one loop per resource type.
+void GpuDeviceVulkan::flush_deletions( u32 frame ) {
+
+    const Array<ResourceHandle>* deletions = update_queues.deletions[ frame ];
+
+    for ( u32 i = 0; i < deletions[ ResourceDeletionType::Buffer ].size; ++i ) {
+        destroy_buffer_instant( deletions[ ResourceDeletionType::Buffer ][ i ] );
+    }
+
+    for ( u32 i = 0; i < deletions[ ResourceDeletionType::Texture ].size; ++i ) {
+        destroy_texture_instant( deletions[ ResourceDeletionType::Texture ][ i ] );
+    }
+
+    for ( u32 i = 0; i < deletions[ ResourceDeletionType::Pipeline ].size; ++i ) {
+        destroy_pipeline_instant( deletions[ ResourceDeletionType::Pipeline ][ i ] );
+    }
+
+    for ( u32 i = 0; i < deletions[ ResourceDeletionType::Sampler ].size; ++i ) {
+        destroy_sampler_instant( deletions[ ResourceDeletionType::Sampler ][ i ] );
+    }
+
+    for ( u32 i = 0; i < deletions[ ResourceDeletionType::ResourceLayout ].size; ++i ) {
+        destroy_resource_layout_instant( deletions[ ResourceDeletionType::ResourceLayout ][ i ] );
+    }
+
+    for ( u32 i = 0; i < deletions[ ResourceDeletionType::ResourceList ].size; ++i ) {
+        destroy_resource_list_instant( deletions[ ResourceDeletionType::ResourceList ][ i ] );
+    }
+
+    for ( u32 i = 0; i < deletions[ ResourceDeletionType::RenderPass ].size; ++i ) {
+        destroy_render_pass_instant( deletions[ ResourceDeletionType::RenderPass ][ i ] );
+    }
+
+    for ( u32 i = 0; i < deletions[ ResourceDeletionType::ShaderState ].size; ++i ) {
+        destroy_shader_state_instant( deletions[ ResourceDeletionType::ShaderState ][ i ] );
+    }
+
+    update_queues.clear_deletions( frame );
+}
+
+//
+// Transient resource lists of frame are not used by the GPU anymore: release all of them at once.
+void GpuDeviceVulkan::reset_transient_resource_lists( u32 frame ) {
+
+    Array<ResourceListHandle>& lists = transient_resource_lists[ frame ];
+    for ( u32 i = 0; i < lists.size; ++i ) {
+        resource_lists.release_resource( lists[ i ].index );
+    }
+    lists.clear();
+
+    transient_resource_list_memory[ frame ].reset();
+    vkResetDescriptorPool( vulkan_device, vulkan_transient_descriptor_pools[ frame ], 0 );
 }
 
 //
@@ -2852,50 +3314,87 @@ void GpuDeviceVulkan::new_frame() {
     // Fence wait and reset
     VkFence* render_complete_fence = &vulkan_command_buffer_executed_fence[ current_frame ];
 
+    const i64 fence_wait_start = time_now();
     if ( vkGetFenceStatus( vulkan_device, *render_complete_fence ) != VK_SUCCESS ) {
         vkWaitForFences( vulkan_device, 1, render_complete_fence, VK_TRUE, UINT64_MAX );
     }
+    frame_timings.fence_wait += ( f32 )time_from_milliseconds( fence_wait_start );
 
     vkResetFences( vulkan_device, 1, render_complete_fence );
-    // Command pool reset
-    command_buffer_ring.reset_pools( current_frame );
-    // Dynamic memory update
-    const u32 used_size = dynamic_allocated_size - ( dynamic_per_frame_size * previous_frame );
-    dynamic_max_per_frame_size = max( used_size, dynamic_max_per_frame_size );
-    dynamic_allocated_size = dynamic_per_frame_size * current_frame;
 
-    // Resource List Updates
-    if ( resource_list_update_queue.size ) {
-        for ( i32 i = resource_list_update_queue.size - 1; i >= 0; i-- ) {
-            ResourceListUpdate& update = resource_list_update_queue[ i ];
+    //
+    // GPU Timestamp resolve: the queries of the frame that used this index are complete now that its fence was waited.
+    const u32 frame_queries = gpu_timestamp_manager->frame_queries[ current_frame ];
+    if ( frame_queries ) {
+        const u32 query_offset = ( current_frame * gpu_timestamp_manager->queries_per_frame ) * 2;
+        const u32 query_count = frame_queries * 2;
+        VkResult result = vkGetQueryPoolResults( vulkan_device, vulkan_timestamp_query_pool, query_offset, query_count,
+                                                 sizeof( uint64_t ) * query_count, &gpu_timestamp_manager->timestamps_data[ query_offset ],
+                                                 sizeof( gpu_timestamp_manager->timestamps_data[ 0 ] ), VK_QUERY_RESULT_64_BIT );
+
+        if ( result == VK_SUCCESS ) {
+            // Calculate and cache the elapsed time
+            for ( u32 i = 0; i < frame_queries; i++ ) {
+                uint32_t index = ( current_frame * gpu_timestamp_manager->queries_per_frame ) + i;
 
-            //if ( update.frame_issued == current_frame ) 
-            {
-                update_resource_list_instant( update );
+                GPUTimestamp& timestamp = gpu_timestamp_manager->timestamps[ index ];
 
-                update.frame_issued = u32_max;
-                resource_list_update_queue.delete_swap( i );
+                double start = ( double )gpu_timestamp_manager->timestamps_data[ ( index * 2 ) ];
+                double end = ( double )gpu_timestamp_manager->timestamps_data[ ( index * 2 ) + 1 ];
+                double range = end - start;
+                double elapsed_time = range * gpu_timestamp_frequency;
+
+                timestamp.elapsed_ms = elapsed_time;
+                timestamp.frame_index = absolute_frame - frames_in_flight;
             }
+            gpu_timestamp_manager->resolve_frame( current_frame );
+        }
+        else {
+            gpu_timestamp_manager->frame_queries[ current_frame ] = 0;
         }
     }
+
+    // Command pool reset
+    command_buffer_ring.reset_pools( current_frame );
+    command_buffer_sequence = 0;
+    // Dynamic memory and transient resource lists of this frame are not used by the GPU anymore.
+    dynamic_allocator.begin_frame( current_frame );
+    reset_transient_resource_lists( current_frame );
+
+    // Resource List Updates
+    flush_resource_list_updates();
+
+    record_start_time = time_now();
 }
 
 void GpuDeviceVulkan::present() {
 
+    const i64 acquire_start = time_now();
+    frame_timings.record = ( f32 )time_delta_milliseconds( record_start_time, acquire_start );
+
     VkResult result = vkAcquireNextImageKHR( vulkan_device, vulkan_swapchain, UINT64_MAX, vulkan_image_acquired_semaphore, VK_NULL_HANDLE, &vulkan_image_index );
+    const i64 submit_start = time_now();
+    frame_timings.acquire = ( f32 )time_delta_milliseconds( acquire_start, submit_start );
+
     if ( result == VK_ERROR_OUT_OF_DATE_KHR ) {
         resize_swapchain();
 
-        // Advance frame counters that are skipped during this frame.
+        // Advance frame counters that are skipped during this frame. Its timestamps were never submitted.
+        gpu_timestamp_manager->reset();
         frame_counters_advance();
+        end_frame_timings();
 
         return;
     }
     VkFence* render_complete_fence = &vulkan_command_buffer_executed_fence[ current_frame ];
     VkSemaphore* render_complete_semaphore = &vulkan_render_complete_semaphore[ current_frame ];
     
-    // Copy all commands
-    VkCommandBuffer enqueued_command_buffers[ 4 ];
+    // Copy all commands, in a deterministic order.
+    sort_queued_command_buffers();
+    replay_deferred_command_buffers();
+    gather_bind_stats();
+
+    VkCommandBuffer enqueued_command_buffers[ k_max_queued_command_buffers ];
     for ( uint32_t c = 0; c < num_queued_command_buffers; c++ ) {
 
         CommandBuffer* command_buffer = queued_command_buffers[ c ];
@@ -2922,6 +3421,8 @@ void GpuDeviceVulkan::present() {
     submit_info.pSignalSemaphores = render_complete_semaphore;
 
     vkQueueSubmit( vulkan_queue, 1, &submit_info, *render_complete_fence );
+    const i64 present_start = time_now();
+    frame_timings.submit = ( f32 )time_delta_milliseconds( submit_start, present_start );
 
     VkPresentInfoKHR present_info{ VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
     present_info.waitSemaphoreCount = 1;
@@ -2933,40 +3434,24 @@ void GpuDeviceVulkan::present() {
     present_info.pImageIndices = &vulkan_image_index;
     present_info.pResults = nullptr; // Optional
     result = vkQueuePresentKHR( vulkan_queue, &present_info );
+    frame_timings.present = ( f32 )time_from_milliseconds( present_start );
 
     num_queued_command_buffers = 0;
 
     //
-    // GPU Timestamp resolve
+    // GPU Timestamps are read in new_frame, after waiting for the fence of this frame: reading them here would stall on the GPU.
     if ( timestamps_enabled ) {
-        if ( gpu_timestamp_manager->has_valid_queries() ) {
-        // Query GPU for all timestamps.
-            const u32 query_offset = ( current_frame * gpu_timestamp_manager->queries_per_frame ) * 2;
-            const u32 query_count = gpu_timestamp_manager->current_query * 2;
-            vkGetQueryPoolResults( vulkan_device, vulkan_timestamp_query_pool, query_offset, query_count,
-                                   sizeof( uint64_t ) * query_count * 2, &gpu_timestamp_manager->timestamps_data[ query_offset ],
-                                   sizeof( gpu_timestamp_manager->timestamps_data[ 0 ] ), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT );
+        gpu_timestamp_manager->end_frame( current_frame );
 
-            // Calculate and cache the elapsed time
-            for ( u32 i = 0; i < gpu_timestamp_manager->current_query; i++ ) {
-                uint32_t index = ( current_frame * gpu_timestamp_manager->queries_per_frame ) + i;
+        // Recreate the query pool with enough queries for this frame, the other frames in flight use it too.
+        if ( gpu_timestamp_manager->needs_grow() ) {
+            vkDeviceWaitIdle( vulkan_device );
+            vkDestroyQueryPool( vulkan_device, vulkan_timestamp_query_pool, vulkan_allocation_callbacks );
 
-                GPUTimestamp& timestamp = gpu_timestamp_manager->timestamps[ index ];
-
-                double start = ( double )gpu_timestamp_manager->timestamps_data[ ( index * 2 ) ];
-                double end = ( double )gpu_timestamp_manager->timestamps_data[ ( index * 2 ) + 1 ];
-                double range = end - start;
-                double elapsed_time = range * gpu_timestamp_frequency;
+            gpu_timestamp_manager->grow();
 
-                timestamp.elapsed_ms = elapsed_time;
-                timestamp.frame_index = absolute_frame;
-
-                //print_format( "%s: %2.3f d(%u) - ", timestamp.name, elapsed_time, timestamp.depth );
-            }
-            //print_format( "\n" );
-        }
-        else if ( gpu_timestamp_manager->current_query ) {
-            hprint( "Asymmetrical GPU queries, missing pop of some markers!\n" );
+            VkQueryPoolCreateInfo vqpci{ VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO, nullptr, 0, VK_QUERY_TYPE_TIMESTAMP, gpu_timestamp_manager->queries_per_frame * 2 * k_max_frames, 0 };
+            vkCreateQueryPool( vulkan_device, &vqpci, vulkan_allocation_callbacks, &vulkan_timestamp_query_pool );
         }
 
         gpu_timestamp_manager->reset();
@@ -2982,6 +3467,7 @@ void GpuDeviceVulkan::present() {
 
         // Advance frame counters that are skipped during this frame.
         frame_counters_advance();
+        end_frame_timings();
 
         return;
     }
@@ -2993,124 +3479,23 @@ void GpuDeviceVulkan::present() {
 
 
 #if defined(HYDRA_BINDLESS)
-    if ( texture_to_update_bindless.size ) {
-        // Handle deferred writes to bindless textures.
-        static constexpr u32 k_num_writes_per_frame = 16;
-        VkWriteDescriptorSet bindless_descriptor_writes[ k_num_writes_per_frame ];
-        VkDescriptorImageInfo bindless_image_info[ k_num_writes_per_frame ];
-
-        TextureVulkan* vk_dummy_texture = access_texture( dummy_texture );
-
-        u32 current_write_index = 0;
-        for ( i32 it = texture_to_update_bindless.size - 1; it >= 0; it-- ) {
-            ResourceUpdate& texture_to_update = texture_to_update_bindless[ it ];
-
-            if ( current_write_index == k_num_writes_per_frame )
-                break;
-
-            //if ( texture_to_update.current_frame == current_frame ) 
-            {
-                TextureVulkan* texture = access_texture( { texture_to_update.handle } );
-                VkWriteDescriptorSet& descriptor_write = bindless_descriptor_writes[ current_write_index ];
-                descriptor_write = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
-                descriptor_write.descriptorCount = 1;
-                descriptor_write.dstArrayElement = texture_to_update.handle;
-                descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-                descriptor_write.dstSet = vulkan_bindless_descriptor_set;
-                descriptor_write.dstBinding = k_bindless_texture_binding;
-
-                // Handles should be the same.
-                hy_assert( texture->handle.index == texture_to_update.handle );
-
-                SamplerVulkan* vk_default_sampler = access_sampler( default_sampler );
-                VkDescriptorImageInfo& descriptor_image_info = bindless_image_info[ current_write_index ];
-                descriptor_image_info.sampler = vk_default_sampler->vk_sampler;
-                descriptor_image_info.imageView = texture->format != TextureFormat::UNKNOWN ? texture->vk_image_view : vk_dummy_texture->vk_image_view;
-                descriptor_image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                descriptor_write.pImageInfo = &descriptor_image_info;
-
-                //hprint( "Updating image view %x %u\n", texture->vk_image_view, texture->handle.index );
-
-                texture_to_update.current_frame = u32_max;
-
-                texture_to_update_bindless.delete_swap( it );
-
-                ++current_write_index;
-            }
-        }
-
-        if ( current_write_index ) {
-            vkUpdateDescriptorSets( vulkan_device, current_write_index, bindless_descriptor_writes, 0, nullptr );
-        }
-    }
+    // Handle deferred writes to bindless textures.
+    flush_bindless_updates();
 #endif // HYDRA_BINDLESS
 
-    // Resource deletion using reverse iteration and swap with last element.
-    if ( resource_deletion_queue.size > 0 ) {
-        for ( i32 i = resource_deletion_queue.size - 1; i >= 0; i-- ) {
-            ResourceUpdate& resource_deletion = resource_deletion_queue[ i ];
-
-            if ( resource_deletion.current_frame == current_frame ) {
-
-                switch ( resource_deletion.type ) {
-
-                case ResourceDeletionType::Buffer:
-                {
-                    destroy_buffer_instant( resource_deletion.handle );
-                    break;
-                }
-
-                case ResourceDeletionType::Pipeline:
-                {
-                    destroy_pipeline_instant( resource_deletion.handle );
-                    break;
-                }
-
-                case ResourceDeletionType::RenderPass:
-                {
-                    destroy_render_pass_instant( resource_deletion.handle );
-                    break;
-                }
-
-                case ResourceDeletionType::ResourceList:
-                {
-                    destroy_resource_list_instant( resource_deletion.handle );
-                    break;
-                }
-
-                case ResourceDeletionType::ResourceLayout:
-                {
-                    destroy_resource_layout_instant( resource_deletion.handle );
-                    break;
-                }
-
-                case ResourceDeletionType::Sampler:
-                {
-                    destroy_sampler_instant( resource_deletion.handle );
-                    break;
-                }
-
-                case ResourceDeletionType::ShaderState:
-                {
-                    destroy_shader_state_instant( resource_deletion.handle );
-                    break;
-                }
-
-                case ResourceDeletionType::Texture:
-                {
-                    destroy_texture_instant( resource_deletion.handle );
-                    break;
-                }
-                }
-
-                // Mark resource as free
-                resource_deletion.current_frame = u32_max;
-
-                // Swap element
-                resource_deletion_queue.delete_swap( i );
-            }
+    // Resource deletion of the frame that is reusing this index.
+    // Its fence is waited only in the next new_frame: with few frames in flight the GPU can still be using them.
+    if ( update_queues.count_deletions( current_frame ) ) {
+        VkFence* reused_frame_fence = &vulkan_command_buffer_executed_fence[ current_frame ];
+        const i64 fence_wait_start = time_now();
+        if ( vkGetFenceStatus( vulkan_device, *reused_frame_fence ) != VK_SUCCESS ) {
+            vkWaitForFences( vulkan_device, 1, reused_frame_fence, VK_TRUE, UINT64_MAX );
         }
+        frame_timings.fence_wait += ( f32 )time_from_milliseconds( fence_wait_start );
     }
+    flush_deletions( current_frame );
+
+    end_frame_timings();
 }
 
 static VkPresentModeKHR to_vk_present_mode( PresentMode::Enum mode ) {
@@ -3163,8 +3548,10 @@ void GpuDeviceVulkan::link_texture_sampler( TextureHandle texture, SamplerHandle
 }
 
 void GpuDeviceVulkan::frame_counters_advance() {
+    dynamic_allocator.end_frame( current_frame );
+
     previous_frame = current_frame;
-    current_frame = ( current_frame + 1 ) % vulkan_swapchain_image_count;
+    current_frame = ( current_frame + 1 ) % frames_in_flight;
 
     ++absolute_frame;
 }
@@ -3173,18 +3560,22 @@ void GpuDeviceVulkan::frame_counters_advance() {
 //
 void GpuDeviceVulkan::queue_command_buffer( CommandBuffer* command_buffer ) {
 
-    queued_command_buffers[ num_queued_command_buffers++ ] = command_buffer;
+    const u32 queue_index = (u32)atomic_increment( ( volatile i32* )&num_queued_command_buffers ) - 1;
+    hy_assertm( queue_index < k_max_queued_command_buffers, "Too many queued command buffers." );
+
+    queued_command_buffers[ queue_index ] = command_buffer;
 }
 
 //
 //
-CommandBuffer* GpuDeviceVulkan::get_command_buffer( QueueType::Enum type, bool begin ) {
-    CommandBuffer* cb = command_buffer_ring.get_command_buffer( current_frame, begin );
+CommandBuffer* GpuDeviceVulkan::get_command_buffer( u32 thread_index, QueueType::Enum type, bool begin ) {
+    CommandBuffer* cb = command_buffer_ring.get_command_buffer( current_frame, thread_index, begin );
+    cb->submit_order = (u32)atomic_increment( &command_buffer_sequence );
 
-    // The first commandbuffer issued in the frame is used to reset the timestamp queries used.
-    if ( gpu_timestamp_reset && begin ) {
+    // The first main thread commandbuffer issued in the frame is used to reset the timestamp queries used.
+    if ( gpu_timestamp_reset && begin && thread_index == 0 ) {
         // These are currently indices!
-        vkCmdResetQueryPool( cb->vk_command_buffer, vulkan_timestamp_query_pool, current_frame * gpu_timestamp_manager->queries_per_frame * 2, gpu_timestamp_manager->queries_per_frame );
+        vkCmdResetQueryPool( cb->vk_command_buffer, vulkan_timestamp_query_pool, current_frame * gpu_timestamp_manager->queries_per_frame * 2, gpu_timestamp_manager->queries_per_frame * 2 );
 
         gpu_timestamp_reset = false;
     }
@@ -3284,11 +3675,16 @@ void* GpuDeviceVulkan::map_buffer( const MapBufferParameters& parameters ) {
 
     BufferVulkan* buffer = access_buffer( parameters.buffer );
 
-    if ( buffer->parent_buffer.index == dynamic_buffer.index ) {
+    // Dynamic buffers: each map gets new memory from the dynamic allocator, in the ring or in an overflow page.
+    if ( buffer->parent_buffer.index != k_invalid_index ) {
 
-        buffer->global_offset = dynamic_allocated_size;
+        const DynamicAllocation allocation = dynamic_allocator.allocate( parameters.size == 0 ? buffer->size : parameters.size, buffer->type );
+        if ( allocation.data ) {
+            buffer->parent_buffer = allocation.buffer;
+            buffer->global_offset = allocation.offset;
+        }
 
-        return dynamic_allocate( parameters.size == 0 ? buffer->size : parameters.size );
+        return allocation.data;
     }
     
     void* data;
@@ -3302,7 +3698,7 @@ void GpuDeviceVulkan::unmap_buffer( const MapBufferParameters& parameters ) {
         return;
 
     BufferVulkan* buffer = access_buffer( parameters.buffer );
-    if ( buffer->parent_buffer.index == dynamic_buffer.index )
+    if ( buffer->parent_buffer.index != k_invalid_index )
         return;
 
     vmaUnmapMemory( vma_allocator, buffer->vma_allocation );
@@ -3318,23 +3714,30 @@ void GpuDeviceVulkan::set_buffer_global_offset( BufferHandle buffer, u32 offset
 }
 
 u32 GpuDeviceVulkan::get_gpu_timestamps( GPUTimestamp* out_timestamps ) {
-    return gpu_timestamp_manager->resolve( previous_frame, out_timestamps );
+    return gpu_timestamp_manager->resolve( out_timestamps );
 
 }
 
-void GpuDeviceVulkan::push_gpu_timestamp( CommandBuffer* command_buffer, const char* name ) {
-    if ( !timestamps_enabled )
+// Timestamps hierarchy is kept only for the main thread (index 0), the manager is not thread safe.
+void GpuDeviceVulkan::push_gpu_timestamp( CommandBuffer* command_buffer, StringId name ) {
+    if ( !timestamps_enabled || command_buffer->thread_index != 0 )
         return;
 
     u32 query_index = gpu_timestamp_manager->push( current_frame, name );
+    if ( query_index == k_invalid_index )
+        return;
+
     vkCmdWriteTimestamp( command_buffer->vk_command_buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, vulkan_timestamp_query_pool, query_index );
 }
 
 void GpuDeviceVulkan::pop_gpu_timestamp( CommandBuffer* command_buffer ) {
-    if ( !timestamps_enabled )
+    if ( !timestamps_enabled || command_buffer->thread_index != 0 )
         return;
 
     u32 query_index = gpu_timestamp_manager->pop( current_frame );
+    if ( query_index == k_invalid_index )
+        return;
+
     vkCmdWriteTimestamp( command_buffer->vk_command_buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, vulkan_timestamp_query_pool, query_index );
 }
 
@@ -12,6 +12,7 @@
 #include "graphics/command_buffer.hpp"
 
 #include "kernel/array.hpp"
+#include "kernel/memory.hpp"
 
 namespace hydra {
 namespace gfx {
@@ -28,9 +29,11 @@ struct GpuDeviceVulkan : public Device {
     BufferHandle                    create_buffer( const BufferCreation& creation );
     TextureHandle                   create_texture( const TextureCreation& creation );
     PipelineHandle                  create_pipeline( const PipelineCreation& creation );
+    PipelineHandle                  create_pipeline_async( const PipelineCreation& creation );
     SamplerHandle                   create_sampler( const SamplerCreation& creation );
     ResourceLayoutHandle            create_resource_layout( const ResourceLayoutCreation& creation );
     ResourceListHandle              create_resource_list( const ResourceListCreation& creation );
+    ResourceListHandle              create_resource_list_transient( const ResourceListCreation& creation );
     RenderPassHandle                create_render_pass( const RenderPassCreation& creation );
     ShaderStateHandle               create_shader_state( const ShaderStateCreation& creation );
 
@@ -59,7 +62,20 @@ struct GpuDeviceVulkan : public Device {
 
     // Resource list //////////////////////////////////////////////////////
     void                            update_resource_list( ResourceListHandle resource_list );
-    void                            update_resource_list_instant( const ResourceListUpdate& update );
+
+    // Update queues //////////////////////////////////////////////////////
+    void                            flush_resource_list_updates();
+    void                            flush_bindless_updates();
+    void                            flush_deletions( u32 frame );
+    void                            reset_transient_resource_lists( u32 frame );
+
+    // Pipeline cache ///////////////////////////////////////////////////
+    VkPipelineCache                 get_pipeline_cache( const ShaderStateCreation& shaders );
+    void                            load_pipeline_caches( cstring path );
+    void                            save_pipeline_caches( cstring path );
+
+    bool                            is_pipeline_ready( PipelineHandle pipeline );
+    void                            wait_pipeline_compiled( PipelineHandle pipeline );       // Until ready or failed.
 
     // Swapchain //////////////////////////////////////////////////////////
     void                            create_swapchain();
@@ -67,7 +83,7 @@ struct GpuDeviceVulkan : public Device {
     void                            resize_swapchain();
 
     // Command buffers ////////////////////////////////////////////////////
-    CommandBuffer*                  get_command_buffer( QueueType::Enum type, bool begin );
+    CommandBuffer*                  get_command_buffer( u32 thread_index, QueueType::Enum type, bool begin );
     CommandBuffer*                  get_instant_command_buffer();
 
     void                            queue_command_buffer( CommandBuffer* command_buffer );
@@ -75,7 +91,7 @@ struct GpuDeviceVulkan : public Device {
     // GPU Timestamps
 
     u32                             get_gpu_timestamps( GPUTimestamp* out_timestamps );
-    void                            push_gpu_timestamp( CommandBuffer* command_buffer, const char* name );
+    void                            push_gpu_timestamp( CommandBuffer* command_buffer, StringId name );
     void                            pop_gpu_timestamp( CommandBuffer* command_buffer );
 
     // Instant methods 
@@ -114,6 +130,7 @@ struct GpuDeviceVulkan : public Device {
     VkQueue                         vulkan_queue;
     uint32_t                        vulkan_queue_family;
     VkDescriptorPool                vulkan_descriptor_pool;
+    VkDescriptorPool                vulkan_transient_descriptor_pools[ k_max_swapchain_images ];   // Reset wholesale when the frame comes back.
     VkDescriptorPool                vulkan_descriptor_pool_bindless;
     VkDescriptorSetLayout           vulkan_bindless_descriptor_layout;      // Global bindless descriptor layout.
     VkDescriptorSet                 vulkan_bindless_descriptor_set;         // Global bindless descriptor set.
@@ -147,10 +164,20 @@ struct GpuDeviceVulkan : public Device {
     
     VmaAllocator                    vma_allocator;
 
-    // These are dynamic - so that workload can be handled correctly.
-    Array<ResourceUpdate>           resource_deletion_queue;
-    Array<ResourceListUpdate>       resource_list_update_queue;
-    Array<ResourceUpdate>           texture_to_update_bindless;
+    // Scratch memory to flush all queued descriptor updates with one vkUpdateDescriptorSets.
+    Array<VkWriteDescriptorSet>     descriptor_writes;
+    Array<VkDescriptorBufferInfo>   descriptor_buffer_infos;
+    Array<VkDescriptorImageInfo>    descriptor_image_infos;
+    Array<VkDescriptorSetLayout>    descriptor_set_layouts;
+    Array<VkDescriptorSet>          descriptor_sets;
+
+    // Transient resource lists, released with their frame.
+    Array<ResourceListHandle>       transient_resource_lists[ k_max_swapchain_images ];
+    TransientListAllocator          transient_resource_list_memory[ k_max_swapchain_images ];
+
+    // Pipeline caches keyed by the hash of the shader code, saved to pipeline_cache_path at shutdown.
+    FlatHashMap<u64, VkPipelineCache> pipeline_caches;
+    char                            pipeline_cache_path[ 512 ];
 
     f32                             gpu_timestamp_frequency;
     bool                            gpu_timestamp_reset             = true;
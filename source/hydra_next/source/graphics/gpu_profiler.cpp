@@ -1,12 +1,15 @@
 #include "gpu_profiler.hpp"
 
+#include "kernel/file.hpp"
 #include "kernel/hash_map.hpp"
+#include "kernel/log.hpp"
 #include "kernel/numerics.hpp"
 
 #include "graphics/renderer.hpp"
 
 #include "imgui/imgui.h"
 #include <cmath>
+#include <stdlib.h>
 
 namespace hydra {
 namespace gfx {
@@ -16,209 +19,467 @@ hydra::FlatHashMap<u64, u32>   name_to_color;
 
 static u32      initial_frames_paused = 3;
 
-void GPUProfiler::init( Allocator* allocator_, u32 max_frames_ ) {
+static const u32 k_statistics_window_frames = 512;
 
-    allocator = allocator_;
-    max_frames = max_frames_;
-    timestamps = ( GPUTimestamp* )halloca( sizeof( GPUTimestamp ) * max_frames * 32, allocator );
-    per_frame_active = ( u16* )halloca( sizeof( u16 ) * max_frames, allocator );
+// GPUTimestampStatistics ///////////////////////////////////////////
 
-    max_duration = 16.666f;
-    current_frame = 0;
-    min_time = max_time = average_time = 0.f;
-    paused = false;
+void GPUTimestampStatistics::init( Allocator* allocator_, u32 window_frames_ ) {
+    allocator = allocator_;
+    window_frames = window_frames_;
+    total_frames = 0;
 
-    memset( per_frame_active, 0, 2 * max_frames );
+    scopes.init( allocator, 16 );
+    path_to_scope.init( allocator, 16 );
+    path_to_scope.set_default_value( u32_max );
 
-    name_to_color.init( allocator, 16 );
-    name_to_color.set_default_value( u32_max );
+    frame_scopes.init( allocator, 32 );
+    touched_scopes.init( allocator, 32 );
+    sort_scratch.init( allocator, window_frames );
 }
 
-void GPUProfiler::shutdown() {
+void GPUTimestampStatistics::shutdown() {
+    reset();
 
-    name_to_color.shutdown();
+    scopes.shutdown();
+    path_to_scope.shutdown();
+    frame_scopes.shutdown();
+    touched_scopes.shutdown();
+    sort_scratch.shutdown();
+}
 
-    hfree( timestamps, allocator );
-    hfree( per_frame_active, allocator );
+void GPUTimestampStatistics::reset() {
+    for ( u32 i = 0; i < scopes.size; ++i ) {
+        hfree( scopes[ i ].samples, allocator );
+    }
+    scopes.clear();
+    path_to_scope.clear();
+    total_frames = 0;
 }
 
-void GPUProfiler::update( Device& gpu ) {
+//
+// Timestamps are in push order: parents always come before their children.
+void GPUTimestampStatistics::add_frame( const GPUTimestamp* timestamps, u32 num_timestamps ) {
+    if ( num_timestamps == 0 ) {
+        return;
+    }
 
-    gpu.set_gpu_timestamps_enable( !paused );
+    ++total_frames;
+    frame_scopes.set_size( num_timestamps );
+    touched_scopes.clear();
+
+    for ( u32 i = 0; i < num_timestamps; ++i ) {
+        const GPUTimestamp& timestamp = timestamps[ i ];
+
+        const bool root = timestamp.depth == 0 || timestamp.parent_index >= i;
+        const u32 parent = root ? u32_max : frame_scopes[ timestamp.parent_index ];
+        const u64 path_hash = hash_bytes( ( void* )&timestamp.name.hash, sizeof( u64 ), root ? 0 : scopes[ parent ].path_hash );
+
+        u32 scope_index = path_to_scope.get( path_hash );
+        if ( scope_index == u32_max ) {
+            scope_index = scopes.size;
+            path_to_scope.insert( path_hash, scope_index );
+
+            GPUScopeStatistics& new_scope = scopes.push_use();
+            memset( &new_scope, 0, sizeof( GPUScopeStatistics ) );
+            new_scope.name = timestamp.name;
+            new_scope.path_hash = path_hash;
+            new_scope.parent = parent;
+            new_scope.depth = root ? 0 : scopes[ parent ].depth + 1;
+            new_scope.samples = ( f32* )hallocam( sizeof( f32 ) * window_frames * 2, allocator );
+            new_scope.self_samples = new_scope.samples + window_frames;
+            new_scope.frame_index = u64_max;
+        }
+        frame_scopes[ i ] = scope_index;
+
+        GPUScopeStatistics& scope = scopes[ scope_index ];
+        if ( scope.frame_index != total_frames ) {
+            scope.frame_index = total_frames;
+            scope.frame_time = 0.f;
+            scope.frame_children_time = 0.f;
+            touched_scopes.push( scope_index );
+        }
 
-    if ( initial_frames_paused ) {
-        --initial_frames_paused;
-        return;
+        const f32 elapsed_ms = ( f32 )timestamp.elapsed_ms;
+        scope.frame_time += elapsed_ms;
+        if ( !root ) {
+            scopes[ parent ].frame_children_time += elapsed_ms;
+        }
     }
 
-    if ( paused && !gpu.resized )
-        return;
+    for ( u32 i = 0; i < touched_scopes.size; ++i ) {
+        GPUScopeStatistics& scope = scopes[ touched_scopes[ i ] ];
 
-    u32 active_timestamps = gpu.get_gpu_timestamps( &timestamps[ 32 * current_frame ] );
-    per_frame_active[ current_frame ] = ( u16 )active_timestamps;
+        const f32 self_time = scope.frame_time - scope.frame_children_time;
+        scope.samples[ scope.next_sample ] = scope.frame_time;
+        scope.self_samples[ scope.next_sample ] = self_time > 0.f ? self_time : 0.f;
+        scope.next_sample = ( scope.next_sample + 1 ) % window_frames;
+        scope.num_samples = hydra::min( scope.num_samples + 1, window_frames );
+        ++scope.total_frames;
+    }
+}
 
-    // Get colors
-    for ( u32 i = 0; i < active_timestamps; ++i ) {
-        GPUTimestamp& timestamp = timestamps[ 32 * current_frame + i ];
+static int compare_f32( const void* a, const void* b ) {
+    const f32 fa = *( const f32* )a;
+    const f32 fb = *( const f32* )b;
+    return ( fa > fb ) - ( fa < fb );
+}
 
-        u64 hashed_name = hydra::hash_calculate( timestamp.name );
-        u32 color_index = name_to_color.get( hashed_name );
-        // No entry found, add new color
-        if ( color_index == u32_max ) {
+//
+// Nearest rank percentile of sorted values.
+static f32 percentile( const f32* sorted_values, u32 count, f32 percent ) {
+    if ( count == 0 ) {
+        return 0.f;
+    }
+    u32 rank = ( u32 )ceilf( percent * count );
+    rank = rank ? rank - 1 : 0;
+    return sorted_values[ hydra::min( rank, count - 1 ) ];
+}
 
-            color_index = ( u32 )name_to_color.size;
-            name_to_color.insert( hashed_name, color_index );
+static void compute_scope_percentiles( const f32* samples, u32 num_samples, Array<f32>& sort_scratch, f32& p50, f32& p95, f32& p99 ) {
+    sort_scratch.set_size( num_samples );
+    memcpy( sort_scratch.data, samples, sizeof( f32 ) * num_samples );
+    qsort( sort_scratch.data, num_samples, sizeof( f32 ), compare_f32 );
+
+    p50 = percentile( sort_scratch.data, num_samples, 0.50f );
+    p95 = percentile( sort_scratch.data, num_samples, 0.95f );
+    p99 = percentile( sort_scratch.data, num_samples, 0.99f );
+}
+
+void GPUTimestampStatistics::compute_percentiles() {
+    for ( u32 i = 0; i < scopes.size; ++i ) {
+        GPUScopeStatistics& scope = scopes[ i ];
+        compute_scope_percentiles( scope.samples, scope.num_samples, sort_scratch, scope.p50, scope.p95, scope.p99 );
+        compute_scope_percentiles( scope.self_samples, scope.num_samples, sort_scratch, scope.self_p50, scope.self_p95, scope.self_p99 );
+    }
+}
+
+void GPUTimestampStatistics::get_scope_path( u32 scope_index, char* out_path, u32 path_size ) const {
+    // Walk up to the root, then write names from the root down.
+    u32 chain[ 64 ];
+    u32 chain_length = 0;
+    for ( u32 s = scope_index; s != u32_max && chain_length < 64; s = scopes[ s ].parent ) {
+        chain[ chain_length++ ] = s;
+    }
+
+    u32 written = 0;
+    out_path[ 0 ] = 0;
+    for ( i32 c = ( i32 )chain_length - 1; c >= 0 && written < path_size; --c ) {
+        const i32 result = snprintf( out_path + written, path_size - written, written ? "/%s" : "%s", scopes[ chain[ c ] ].name.c_str() );
+        if ( result < 0 ) {
+            break;
         }
+        written += ( u32 )result;
+    }
+}
 
-        timestamp.color = hydra::Color::get_distinct_color( color_index );
+void GPUTimestampStatistics::print() {
+    compute_percentiles();
+
+    hprint( "[gpu profiler] %llu frames, %u scopes, window of %u frames.\n", total_frames, scopes.size, window_frames );
+    hprint( "%-48s %10s %10s %10s %10s %10s %10s\n", "Scope", "p50 ms", "p95 ms", "p99 ms", "Self p50", "Self p95", "Self p99" );
+
+    char path[ 256 ];
+    for ( u32 i = 0; i < scopes.size; ++i ) {
+        const GPUScopeStatistics& scope = scopes[ i ];
+        get_scope_path( i, path, 256 );
+        hprint( "%-48s %10.4f %10.4f %10.4f %10.4f %10.4f %10.4f\n", path, scope.p50, scope.p95, scope.p99, scope.self_p50, scope.self_p95, scope.self_p99 );
     }
+}
 
-    current_frame = ( current_frame + 1 ) % max_frames;
+//
+// One row per scope, the path column identifies the scope across captures.
+bool GPUTimestampStatistics::export_csv( cstring filename ) {
+    FileHandle file = nullptr;
+    file_open( filename, "w", &file );
+    if ( !file ) {
+        hprint( "[gpu profiler] Cannot open file %s for writing.\n", filename );
+        return false;
+    }
 
-    // Reset Min/Max/Average after few frames
-    if ( current_frame == 0 ) {
-        max_time = -FLT_MAX;
-        min_time = FLT_MAX;
-        average_time = 0.f;
+    compute_percentiles();
+
+    fprintf( file, "path,name,depth,frames,samples,p50_ms,p95_ms,p99_ms,self_p50_ms,self_p95_ms,self_p99_ms\n" );
+
+    char path[ 256 ];
+    for ( u32 i = 0; i < scopes.size; ++i ) {
+        const GPUScopeStatistics& scope = scopes[ i ];
+        get_scope_path( i, path, 256 );
+        fprintf( file, "\"%s\",\"%s\",%u,%llu,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n", path, scope.name.c_str(), scope.depth, scope.total_frames, scope.num_samples,
+                 scope.p50, scope.p95, scope.p99, scope.self_p50, scope.self_p95, scope.self_p99 );
     }
+
+    file_close( file );
+    return true;
 }
 
-void GPUProfiler::imgui_draw() {
-    if ( initial_frames_paused ) {
-        return;
+static void write_json_string( FileHandle file, cstring string ) {
+    for ( cstring c = string; *c; ++c ) {
+        if ( *c == '"' || *c == '\\' ) {
+            fputc( '\\', file );
+        }
+        fputc( *c, file );
+    }
+}
+
+bool GPUTimestampStatistics::export_json( cstring filename ) {
+    FileHandle file = nullptr;
+    file_open( filename, "w", &file );
+    if ( !file ) {
+        hprint( "[gpu profiler] Cannot open file %s for writing.\n", filename );
+        return false;
+    }
+
+    compute_percentiles();
+
+    fprintf( file, "{\"frames\":%llu,\"window_frames\":%u,\"scopes\":[\n", total_frames, window_frames );
+
+    char path[ 256 ];
+    for ( u32 i = 0; i < scopes.size; ++i ) {
+        const GPUScopeStatistics& scope = scopes[ i ];
+        get_scope_path( i, path, 256 );
+
+        fprintf( file, "%s{\"path\":\"", i ? ",\n" : "" );
+        write_json_string( file, path );
+        fprintf( file, "\",\"name\":\"" );
+        write_json_string( file, scope.name.c_str() );
+        fprintf( file, "\",\"parent\":%d,\"depth\":%u,\"frames\":%llu,\"samples\":%u,", scope.parent == u32_max ? -1 : ( i32 )scope.parent, scope.depth, scope.total_frames, scope.num_samples );
+        fprintf( file, "\"p50_ms\":%.4f,\"p95_ms\":%.4f,\"p99_ms\":%.4f,\"self_p50_ms\":%.4f,\"self_p95_ms\":%.4f,\"self_p99_ms\":%.4f}",
+                 scope.p50, scope.p95, scope.p99, scope.self_p50, scope.self_p95, scope.self_p99 );
     }
 
-    {
-        ImDrawList* draw_list = ImGui::GetWindowDrawList();
-        ImVec2 cursor_pos = ImGui::GetCursorScreenPos();
-        ImVec2 canvas_size = ImGui::GetContentRegionAvail();
-        f32 widget_height = canvas_size.y - 100;
+    fprintf( file, "\n]}\n" );
+    file_close( file );
+    return true;
+}
 
-        f32 legend_width = 200;
-        f32 graph_width = canvas_size.x - legend_width;
-        u32 rect_width = ceilu32( graph_width / max_frames );
-        i32 rect_x = ceili32( graph_width - rect_width );
+// GPUProfiler //////////////////////////////////////////////////////
 
-        f64 new_average = 0;
+//
+//
+static f32 gpu_profiler_frame_time( void* user_data, u32 frame_index ) {
+    const GPUProfiler* profiler = ( const GPUProfiler* )user_data;
+    return ( f32 )profiler->timestamps[ frame_index * profiler->queries_per_frame ].elapsed_ms;
+}
+
+//
+//
+static void gpu_profiler_draw_frame( void* user_data, u32 frame_index, f32 x, f32 bottom, f32 width, f32 pixels_per_ms ) {
+    const GPUProfiler* profiler = ( const GPUProfiler* )user_data;
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
 
-        ImGuiIO& io = ImGui::GetIO();
+    const GPUTimestamp* frame_timestamps = &profiler->timestamps[ frame_index * profiler->queries_per_frame ];
+    for ( u32 j = 0; j < profiler->per_frame_active[ frame_index ]; ++j ) {
+        const GPUTimestamp& timestamp = frame_timestamps[ j ];
 
-        static char buf[ 128 ];
+        const f32 rect_height = ( f32 )timestamp.elapsed_ms * pixels_per_ms;
+        draw_list->AddRectFilled( { x, bottom - rect_height }, { x + width, bottom }, timestamp.color );
+    }
+}
 
-        const ImVec2 mouse_pos = io.MousePos;
+//
+//
+static void gpu_profiler_draw_legend( void* user_data, u32 frame_index, f32 x, f32 y ) {
+    const GPUProfiler* profiler = ( const GPUProfiler* )user_data;
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
 
-        i32 selected_frame = -1;
+    static char buf[ 128 ];
 
-        // Draw time reference lines
-        sprintf( buf, "%3.4fms", max_duration );
-        draw_list->AddText( { cursor_pos.x, cursor_pos.y }, 0xff0000ff, buf );
-        draw_list->AddLine( { cursor_pos.x + rect_width, cursor_pos.y }, { cursor_pos.x + graph_width, cursor_pos.y }, 0xff0000ff );
+    const GPUTimestamp* frame_timestamps = &profiler->timestamps[ frame_index * profiler->queries_per_frame ];
+    for ( u32 j = 0; j < profiler->per_frame_active[ frame_index ]; ++j ) {
+        const GPUTimestamp& timestamp = frame_timestamps[ j ];
 
-        sprintf( buf, "%3.4fms", max_duration / 2.f );
-        draw_list->AddText( { cursor_pos.x, cursor_pos.y + widget_height / 2.f }, 0xff00ffff, buf );
-        draw_list->AddLine( { cursor_pos.x + rect_width, cursor_pos.y + widget_height / 2.f }, { cursor_pos.x + graph_width, cursor_pos.y + widget_height / 2.f }, 0xff00ffff );
+        draw_list->AddRectFilled( { x, y }, { x + 8, y + 8 }, timestamp.color );
+
+        sprintf( buf, "(%d)-%s %2.4f", timestamp.depth, timestamp.name.c_str(), timestamp.elapsed_ms );
+        draw_list->AddText( { x + 12, y }, 0xffffffff, buf );
+
+        y += 16;
+    }
+}
+
+void GPUProfiler::init( Allocator* allocator_, u32 max_frames_ ) {
+
+    allocator = allocator_;
+    max_frames = max_frames_;
+    // Allocated by update, with the per frame capacity of the device.
+    timestamps = nullptr;
+    queries_per_frame = 0;
+    per_frame_active = ( u16* )halloca( sizeof( u16 ) * max_frames, allocator );
 
-        // Draw Graph
-        for ( u32 i = 0; i < max_frames; ++i ) {
-            u32 frame_index = ( current_frame - 1 - i ) % max_frames;
+    current_frame = 0;
+    paused = false;
 
-            f32 frame_x = cursor_pos.x + rect_x;
-            GPUTimestamp* frame_timestamps = &timestamps[ frame_index * 32 ];
-            f32 frame_time = ( f32 )frame_timestamps[ 0 ].elapsed_ms;
-            // Clamp values to not destroy the frame data
-            frame_time = clamp( frame_time, 0.00001f, 1000.f );
-            // Update timings
-            new_average += frame_time;
-            min_time = hydra::min( min_time, frame_time );
-            max_time = hydra::max( max_time, frame_time );
+    timeline.frame_time = gpu_profiler_frame_time;
+    timeline.draw_frame = gpu_profiler_draw_frame;
+    timeline.draw_legend = gpu_profiler_draw_legend;
+    timeline.user_data = this;
+    timeline.max_frames = max_frames;
+    timeline.legend_width = 200.f;
+    timeline.reset_timings();
 
-            f32 rect_height = frame_time / max_duration * widget_height;
-            //drawList->AddRectFilled( { frame_x, cursor_pos.y + rect_height }, { frame_x + rect_width, cursor_pos.y }, 0xffffffff );
+    memset( per_frame_active, 0, sizeof( u16 ) * max_frames );
 
-            for ( u32 j = 0; j < per_frame_active[ frame_index ]; ++j ) {
-                const GPUTimestamp& timestamp = frame_timestamps[ j ];
+    name_to_color.init( allocator, 16 );
+    name_to_color.set_default_value( u32_max );
 
-                /*if ( timestamp.depth != 1 ) {
-                    continue;
-                }*/
+    statistics.init( allocator, k_statistics_window_frames );
+    frame_pacing = nullptr;
+}
 
-                rect_height = ( f32 )timestamp.elapsed_ms / max_duration * widget_height;
-                draw_list->AddRectFilled( { frame_x, cursor_pos.y + widget_height - rect_height },
-                    { frame_x + rect_width, cursor_pos.y + widget_height }, timestamp.color );
-            }
+void GPUProfiler::shutdown() {
 
-            if ( mouse_pos.x >= frame_x && mouse_pos.x < frame_x + rect_width &&
-                mouse_pos.y >= cursor_pos.y && mouse_pos.y < cursor_pos.y + widget_height ) {
-                draw_list->AddRectFilled( { frame_x, cursor_pos.y + widget_height },
-                    { frame_x + rect_width, cursor_pos.y }, 0x0fffffff );
+    statistics.shutdown();
+    name_to_color.shutdown();
 
-                ImGui::SetTooltip( "(%u): %f", frame_index, frame_time );
+    if ( timestamps ) {
+        hfree( timestamps, allocator );
+    }
+    hfree( per_frame_active, allocator );
+}
 
-                selected_frame = frame_index;
-            }
+void GPUProfiler::update( Device& gpu ) {
 
-            draw_list->AddLine( { frame_x, cursor_pos.y + widget_height }, { frame_x, cursor_pos.y }, 0x0fffffff );
+    frame_pacing = &gpu.get_frame_pacing();
+    gpu.set_gpu_timestamps_enable( !paused );
 
-            // Debug only
-            /*static char buf[ 32 ];
-            sprintf( buf, "%u", frame_index );
-            draw_list->AddText( { frame_x, cursor_pos.y + widget_height - 64 }, 0xffffffff, buf );
+    if ( initial_frames_paused ) {
+        --initial_frames_paused;
+        return;
+    }
 
-            sprintf( buf, "%u", frame_timestamps[0].frame_index );
-            drawList->AddText( { frame_x, cursor_pos.y + widget_height - 32 }, 0xffffffff, buf );*/
+    if ( paused && !gpu.resized )
+        return;
 
-            rect_x -= rect_width;
+    // Device capacity grows when a frame has more queries, history is discarded.
+    if ( queries_per_frame != gpu.get_gpu_timestamps_per_frame() ) {
+        if ( timestamps ) {
+            hfree( timestamps, allocator );
         }
+        queries_per_frame = gpu.get_gpu_timestamps_per_frame();
+        timestamps = ( GPUTimestamp* )halloca( sizeof( GPUTimestamp ) * max_frames * queries_per_frame, allocator );
+        memset( per_frame_active, 0, sizeof( u16 ) * max_frames );
+    }
 
-        average_time = ( f32 )new_average / max_frames;
+    GPUTimestamp* frame_timestamps = &timestamps[ queries_per_frame * current_frame ];
+    u32 active_timestamps = gpu.get_gpu_timestamps( frame_timestamps );
+    per_frame_active[ current_frame ] = ( u16 )active_timestamps;
 
-        // Draw legend
-        ImGui::SetCursorPosX( cursor_pos.x + graph_width );
-        // Default to last frame if nothing is selected.
-        selected_frame = selected_frame == -1 ? ( current_frame - 1 ) % max_frames : selected_frame;
-        if ( selected_frame >= 0 ) {
-            GPUTimestamp* frame_timestamps = &timestamps[ selected_frame * 32 ];
+    statistics.add_frame( frame_timestamps, active_timestamps );
 
-            f32 x = cursor_pos.x + graph_width;
-            f32 y = cursor_pos.y;
+    // Get colors
+    for ( u32 i = 0; i < active_timestamps; ++i ) {
+        GPUTimestamp& timestamp = frame_timestamps[ i ];
 
-            for ( u32 j = 0; j < per_frame_active[ selected_frame ]; ++j ) {
-                const GPUTimestamp& timestamp = frame_timestamps[ j ];
+        u64 hashed_name = timestamp.name.hash;
+        u32 color_index = name_to_color.get( hashed_name );
+        // No entry found, add new color
+        if ( color_index == u32_max ) {
+
+            color_index = ( u32 )name_to_color.size;
+            name_to_color.insert( hashed_name, color_index );
+        }
+
+        timestamp.color = hydra::Color::get_distinct_color( color_index );
+    }
 
-                /*if ( timestamp.depth != 1 ) {
-                    continue;
-                }*/
+    current_frame = ( current_frame + 1 ) % max_frames;
 
-                draw_list->AddRectFilled( { x, y },
-                    { x + 8, y + 8 }, timestamp.color );
+    // Reset Min/Max/Average after few frames
+    if ( current_frame == 0 ) {
+        timeline.reset_timings();
+    }
+}
 
-                sprintf( buf, "(%d)-%s %2.4f", timestamp.depth, timestamp.name, timestamp.elapsed_ms );
-                draw_list->AddText( { x + 12, y }, 0xffffffff, buf );
+//
+// Average CPU timings of the device frames and what is limiting them.
+static void imgui_draw_frame_pacing( const FramePacingStats& frame_pacing ) {
+
+    FrameTimings average;
+    frame_pacing.compute_average( average );
+    const FrameBound::Enum bound = frame_pacing.compute_bound( average );
+
+    ImGui::Text( "%s bound, %2.3fms per frame, %u frames in flight", FrameBound::ToString( bound ), average.frame, frame_pacing.frames_in_flight );
+    if ( ImGui::CollapsingHeader( "Frame pacing" ) ) {
+
+        ImGui::Columns( 2 );
+        ImGui::Text( "Record" ); ImGui::NextColumn(); ImGui::Text( "%2.3fms", average.record ); ImGui::NextColumn();
+        ImGui::Text( "Fence wait" ); ImGui::NextColumn(); ImGui::Text( "%2.3fms", average.fence_wait ); ImGui::NextColumn();
+        ImGui::Text( "Acquire" ); ImGui::NextColumn(); ImGui::Text( "%2.3fms", average.acquire ); ImGui::NextColumn();
+        ImGui::Text( "Submit" ); ImGui::NextColumn(); ImGui::Text( "%2.3fms", average.submit ); ImGui::NextColumn();
+        ImGui::Text( "Present" ); ImGui::NextColumn(); ImGui::Text( "%2.3fms", average.present ); ImGui::NextColumn();
+        ImGui::Columns( 1 );
+
+        // Frames in history order, oldest first.
+        f32 fence_waits[ FramePacingStats::k_history_frames ];
+        f32 records[ FramePacingStats::k_history_frames ];
+        const u32 first_frame = frame_pacing.num_frames < FramePacingStats::k_history_frames ? 0 : frame_pacing.next_frame;
+        for ( u32 i = 0; i < frame_pacing.num_frames; ++i ) {
+            const FrameTimings& timings = frame_pacing.history[ ( first_frame + i ) % FramePacingStats::k_history_frames ];
+            fence_waits[ i ] = timings.fence_wait;
+            records[ i ] = timings.record;
+        }
+        ImGui::PlotLines( "Record", records, frame_pacing.num_frames, 0, nullptr, 0.f, FLT_MAX, ImVec2( 0, 40 ) );
+        ImGui::PlotLines( "Fence wait", fence_waits, frame_pacing.num_frames, 0, nullptr, 0.f, FLT_MAX, ImVec2( 0, 40 ) );
 
-                y += 16;
-            }
+        if ( ImGui::Button( "Print" ) ) {
+            frame_pacing.print();
         }
+    }
+}
 
-        ImGui::Dummy( { canvas_size.x, widget_height } );
+void GPUProfiler::imgui_draw() {
+    if ( frame_pacing ) {
+        imgui_draw_frame_pacing( *frame_pacing );
     }
 
-    ImGui::SetNextItemWidth( 100.f );
-    ImGui::LabelText( "", "Max %3.4fms", max_time );
-    ImGui::SameLine();
-    ImGui::SetNextItemWidth( 100.f );
-    ImGui::LabelText( "", "Min %3.4fms", min_time );
-    ImGui::SameLine();
-    ImGui::LabelText( "", "Ave %3.4fms", average_time );
+    if ( initial_frames_paused || timestamps == nullptr ) {
+        return;
+    }
+
+    // Min/Max/Average accumulate until update resets them.
+    timeline.draw( ( current_frame + max_frames - 1 ) % max_frames );
 
-    ImGui::Separator();
     ImGui::Checkbox( "Pause", &paused );
 
-    static const char* items[] = { "200ms", "100ms", "66ms", "33ms", "16ms", "8ms", "4ms" };
-    static const float max_durations[] = { 200.f, 100.f, 66.f, 33.f, 16.f, 8.f, 4.f };
+    // Percentiles per scope, indented by depth.
+    if ( ImGui::CollapsingHeader( "Statistics" ) ) {
+        statistics.compute_percentiles();
+
+        ImGui::Text( "%llu frames, last %u", statistics.total_frames, statistics.window_frames );
+        ImGui::SameLine();
+        if ( ImGui::Button( "Export CSV" ) ) {
+            statistics.export_csv( "gpu_statistics.csv" );
+        }
+        ImGui::SameLine();
+        if ( ImGui::Button( "Export JSON" ) ) {
+            statistics.export_json( "gpu_statistics.json" );
+        }
+        ImGui::SameLine();
+        if ( ImGui::Button( "Reset" ) ) {
+            statistics.reset();
+        }
 
-    static int max_duration_index = 4;
-    if ( ImGui::Combo( "Graph Max", &max_duration_index, items, IM_ARRAYSIZE( items ) ) ) {
-        max_duration = max_durations[ max_duration_index ];
+        ImGui::Columns( 7 );
+        ImGui::Text( "Scope" ); ImGui::NextColumn();
+        ImGui::Text( "p50" ); ImGui::NextColumn();
+        ImGui::Text( "p95" ); ImGui::NextColumn();
+        ImGui::Text( "p99" ); ImGui::NextColumn();
+        ImGui::Text( "Self p50" ); ImGui::NextColumn();
+        ImGui::Text( "Self p95" ); ImGui::NextColumn();
+        ImGui::Text( "Self p99" ); ImGui::NextColumn();
+        ImGui::Separator();
+
+        for ( u32 i = 0; i < statistics.scopes.size; ++i ) {
+            const GPUScopeStatistics& scope = statistics.scopes[ i ];
+            ImGui::Text( "%*s%s", scope.depth * 2, "", scope.name.c_str() ); ImGui::NextColumn();
+            ImGui::Text( "%2.4f", scope.p50 ); ImGui::NextColumn();
+            ImGui::Text( "%2.4f", scope.p95 ); ImGui::NextColumn();
+            ImGui::Text( "%2.4f", scope.p99 ); ImGui::NextColumn();
+            ImGui::Text( "%2.4f", scope.self_p50 ); ImGui::NextColumn();
+            ImGui::Text( "%2.4f", scope.self_p95 ); ImGui::NextColumn();
+            ImGui::Text( "%2.4f", scope.self_p99 ); ImGui::NextColumn();
+        }
+        ImGui::Columns( 1 );
     }
 }
 
@@ -1,11 +1,80 @@
 #pragma once
 
 #include "kernel/memory.hpp"
+#include "kernel/array.hpp"
+#include "kernel/profiler.hpp"
 #include "graphics/gpu_device.hpp"
 
 namespace hydra {
 namespace gfx {
 
+// GPUScopeStatistics ///////////////////////////////////////////////
+
+//
+// Rolling timings of a scope, identified by its name and the names of its parents.
+// Instances of the same scope in a frame are summed in a single sample.
+struct GPUScopeStatistics {
+
+    StringId                    name;
+    u64                         path_hash;
+    u32                         parent;             // Index in GPUTimestampStatistics::scopes, u32_max for roots.
+    u32                         depth;
+
+    f32*                        samples;            // Inclusive milliseconds, ring of window_frames.
+    f32*                        self_samples;       // Milliseconds not spent in child scopes.
+    u32                         num_samples;
+    u32                         next_sample;
+    u64                         total_frames;       // Frames the scope was present in.
+
+    // Filled by compute_percentiles
+    f32                         p50;
+    f32                         p95;
+    f32                         p99;
+    f32                         self_p50;
+    f32                         self_p95;
+    f32                         self_p99;
+
+    // Current frame accumulation
+    f32                         frame_time;
+    f32                         frame_children_time;
+    u64                         frame_index;
+
+}; // struct GPUScopeStatistics
+
+// GPUTimestampStatistics ///////////////////////////////////////////
+
+//
+// Percentiles over the last window_frames frames for each scope of the timestamp hierarchy.
+// Does not depend on ImGui: feed it with Device::get_gpu_timestamps and export the results.
+struct GPUTimestampStatistics {
+
+    void                        init( Allocator* allocator, u32 window_frames );
+    void                        shutdown();
+
+    void                        add_frame( const GPUTimestamp* timestamps, u32 num_timestamps );
+    void                        compute_percentiles();
+    void                        reset();
+
+    void                        get_scope_path( u32 scope_index, char* out_path, u32 path_size ) const;   // Names from the root, separated by '/'.
+
+    void                        print();
+    bool                        export_csv( cstring filename );
+    bool                        export_json( cstring filename );
+
+    Allocator*                  allocator           = nullptr;
+
+    Array<GPUScopeStatistics>   scopes;
+    FlatHashMap<u64, u32>       path_to_scope;
+
+    Array<u32>                  frame_scopes;       // Scope of each timestamp of the frame being added.
+    Array<u32>                  touched_scopes;     // Scopes present in the frame being added.
+    Array<f32>                  sort_scratch;
+
+    u32                         window_frames       = 0;
+    u64                         total_frames        = 0;
+
+}; // struct GPUTimestampStatistics
+
 // GPUProfiler //////////////////////////////////////////////////////
 
 struct GPUProfiler {
@@ -18,20 +87,20 @@ struct GPUProfiler {
     void                        imgui_draw();
 
     Allocator*                  allocator;
-    GPUTimestamp*               timestamps;
+    GPUTimestamp*               timestamps;         // max_frames * queries_per_frame, follows the device capacity.
     u16*                        per_frame_active;
 
+    GPUTimestampStatistics      statistics;
+    const FramePacingStats*     frame_pacing        = nullptr;  // Of the device, drawn even without timestamps.
+
     u32                         max_frames;
+    u32                         queries_per_frame;
     u32                         current_frame;
 
-    f32                         max_time;
-    f32                         min_time;
-    f32                         average_time;
-
-    f32                         max_duration;
+    ProfilerTimeline            timeline;
     bool                        paused;
 
 }; // struct GPUProfiler
 
 } // namespace hydra
-} // namespace gfx
\ No newline at end of file
+} // namespace gfx
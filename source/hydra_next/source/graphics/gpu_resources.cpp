@@ -1,5 +1,9 @@
 #include "gpu_resources.hpp"
 
+#include "kernel/hash_map.hpp"
+
+#include <string.h>
+
 
 namespace hydra {
 namespace gfx {
@@ -173,6 +177,16 @@ ShaderStateCreation& ShaderStateCreation::set_spv_input( bool value ) {
     return *this;
 }
 
+u64 ShaderStateCreation::compute_hash() const {
+    u64 hash = hash_bytes( ( void* )&spv_input, sizeof( u32 ), stages_count );
+    for ( u32 i = 0; i < stages_count; ++i ) {
+        const Stage& stage = stages[ i ];
+        hash = hash_bytes( ( void* )&stage.type, sizeof( ShaderStage::Enum ), hash );
+        hash = hash_bytes( ( void* )stage.code, stage.code_size, hash );
+    }
+    return hash;
+}
+
 // ResourceLayoutCreation //////////////////////////////////
 ResourceLayoutCreation& ResourceLayoutCreation::reset() {
     num_bindings = 0;
@@ -234,6 +248,15 @@ ResourceListCreation& ResourceListCreation::set_name( cstring name_ ) {
     return *this;
 }
 
+u64 ResourceListCreation::compute_hash() const {
+    // Hash only the used entries, the rest of the arrays is not initialized.
+    u64 hash = hash_bytes( ( void* )&layout, sizeof( ResourceLayoutHandle ), num_resources );
+    hash = hash_bytes( ( void* )resources, sizeof( ResourceHandle ) * num_resources, hash );
+    hash = hash_bytes( ( void* )samplers, sizeof( SamplerHandle ) * num_resources, hash );
+    hash = hash_bytes( ( void* )bindings, sizeof( u16 ) * num_resources, hash );
+    return hash;
+}
+
 // VertexInputCreation /////////////////////////////////////
 VertexInputCreation& VertexInputCreation::reset() {
     num_vertex_streams = num_vertex_attributes = 0;
@@ -341,6 +364,38 @@ RenderPassCreation& RenderPassCreation::set_operations( RenderPassOperation::Enu
     return *this;
 }
 
+// ShaderConstantField /////////////////////////////////////
+u32 shader_constants_copy_dirty( const void* data, void* shadow, void* gpu_data, const ShaderConstantField* fields, u32 num_fields ) {
+    const u8* source = ( const u8* )data;
+    u8* shadow_memory = ( u8* )shadow;
+    u8* destination = ( u8* )gpu_data;
+
+    u32 written_bytes = 0;
+    u32 range_start = u32_max;
+    u32 range_end = 0;
+
+    for ( u32 i = 0; i <= num_fields; ++i ) {
+        const bool last = i == num_fields;
+        const bool dirty = !last && memcmp( source + fields[ i ].offset, shadow_memory + fields[ i ].offset, fields[ i ].size ) != 0;
+
+        // Flush the current range when the contiguous dirty fields end.
+        if ( range_start != u32_max && ( last || !dirty || fields[ i ].offset != range_end ) ) {
+            const u32 range_size = range_end - range_start;
+            memcpy( destination + range_start, source + range_start, range_size );
+            memcpy( shadow_memory + range_start, source + range_start, range_size );
+            written_bytes += range_size;
+            range_start = u32_max;
+        }
+
+        if ( dirty ) {
+            range_start = range_start == u32_max ? fields[ i ].offset : range_start;
+            range_end = fields[ i ].offset + fields[ i ].size;
+        }
+    }
+
+    return written_bytes;
+}
+
 // ExecutionBarrier ////////////////////////////////////////
 ExecutionBarrier& ExecutionBarrier::reset() {
     num_image_barriers = num_memory_barriers = 0;
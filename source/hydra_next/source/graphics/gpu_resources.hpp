@@ -277,6 +277,8 @@ struct ShaderStateCreation {
     ShaderStateCreation&            add_stage( const char* code, u32 code_size, ShaderStage::Enum type );
     ShaderStateCreation&            set_spv_input( bool value );
 
+    u64                             compute_hash() const;       // Hash of the code of all stages, used to key pipeline caches.
+
 }; // struct ShaderStateCreation
 
 //
@@ -329,6 +331,8 @@ struct ResourceListCreation {
     ResourceListCreation&           texture_sampler( TextureHandle texture, SamplerHandle sampler, u16 binding );   // TODO: separate samplers from textures
     ResourceListCreation&           set_name( cstring name );
 
+    u64                             compute_hash() const;       // Hash of layout, resources, samplers and bindings. The name is not part of it.
+
 }; // struct ResourceListCreation
 
 //
@@ -493,6 +497,23 @@ struct ResourceBinding {
     const char*                     name = nullptr;
 }; // struct ResourceBinding
 
+//
+// Member of a shader constant/structured buffer, as reflected from SPIR-V.
+// Generated shader headers emit a constexpr table of these for each struct.
+struct ShaderConstantField {
+
+    cstring                         name    = nullptr;
+    u32                             offset  = 0;        // std140 for constant buffers, std430 for structured buffers.
+    u32                             size    = 0;
+
+}; // struct ShaderConstantField
+
+//
+// Copies the fields of 'data' that differ from 'shadow' into both 'gpu_data' and 'shadow'.
+// Adjacent dirty fields are merged in a single copy. Returns the number of bytes written to gpu_data.
+u32                                 shader_constants_copy_dirty( const void* data, void* shadow, void* gpu_data,
+                                                                 const ShaderConstantField* fields, u32 num_fields );
+
 
 // API-agnostic descriptions ////////////////////////////////////////////////////
 
@@ -670,6 +691,29 @@ struct DeviceStateGL;
 #elif defined (HYDRA_VULKAN)*/
 
 static const u32            k_max_swapchain_images = 3;
+static const u32            k_max_recording_threads = 4;    // Threads that can record command buffers at the same time, each with its own pools.
+
+#if defined (HYDRA_NULL)
+
+struct ShaderStateNull;
+struct TextureNull;
+struct BufferNull;
+struct PipelineNull;
+struct SamplerNull;
+struct ResourceLayoutNull;
+struct ResourceListNull;
+struct RenderPassNull;
+
+#define ShaderStateAPIGnostic       ShaderStateNull
+#define TextureAPIGnostic           TextureNull
+#define BufferAPIGnostic            BufferNull
+#define PipelineAPIGnostic          PipelineNull
+#define SamplerAPIGnostic           SamplerNull
+#define ResourceLayoutAPIGnostic    ResourceLayoutNull
+#define ResourceListAPIGnostic      ResourceListNull
+#define RenderPassAPIGnostic        RenderPassNull
+
+#else
 
 struct ShaderStateVulkan;
 struct TextureVulkan;
@@ -691,6 +735,8 @@ struct DeviceStateVulkan;
 #define ResourceListAPIGnostic      ResourceListVulkan
 #define RenderPassAPIGnostic        RenderPassVulkan
 
+#endif // HYDRA_NULL
+
 
 } // namespace gfx
 } // namespace hydra
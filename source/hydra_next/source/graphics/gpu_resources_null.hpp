@@ -0,0 +1,151 @@
+#pragma once
+
+
+namespace hydra {
+namespace gfx {
+
+// Main structs /////////////////////////////////////////////////////////////////
+//
+// Null backend resources: only the API-agnostic informations are kept, so that
+// queries and command recording behave like the real backends.
+// 'alive' is cleared when the resource is actually released by the deletion queue,
+// and it is used to catch commands using freed handles.
+
+//
+//
+struct BufferNull {
+
+    u8*                             data            = nullptr;      // CPU memory returned by map_buffer.
+
+    BufferType::Mask                type            = BufferType::Vertex_mask;
+    ResourceUsageType::Enum         usage           = ResourceUsageType::Immutable;
+    u32                             size            = 0;
+    u32                             global_offset   = 0;    // Offset into global constant, if dynamic
+
+    BufferHandle                    handle;
+    BufferHandle                    parent_buffer;
+
+    const char*                     name            = nullptr;
+    bool                            alive           = false;
+
+}; // struct BufferNull
+
+//
+//
+struct SamplerNull {
+
+    TextureFilter::Enum             min_filter = TextureFilter::Nearest;
+    TextureFilter::Enum             mag_filter = TextureFilter::Nearest;
+    TextureMipFilter::Enum          mip_filter = TextureMipFilter::Nearest;
+
+    TextureAddressMode::Enum        address_mode_u = TextureAddressMode::Repeat;
+    TextureAddressMode::Enum        address_mode_v = TextureAddressMode::Repeat;
+    TextureAddressMode::Enum        address_mode_w = TextureAddressMode::Repeat;
+
+    const char*                     name    = nullptr;
+    bool                            alive   = false;
+
+}; // struct SamplerNull
+
+//
+//
+struct TextureNull {
+
+    u16                             width = 1;
+    u16                             height = 1;
+    u16                             depth = 1;
+    u8                              mipmaps = 1;
+    u8                              flags = 0;
+
+    TextureHandle                   handle;
+
+    TextureFormat::Enum             format  = TextureFormat::UNKNOWN;
+    TextureType::Enum               type    = TextureType::Texture2D;
+
+    SamplerNull*                    sampler = nullptr;
+
+    const char*                     name    = nullptr;
+    bool                            alive   = false;
+
+}; // struct TextureNull
+
+//
+//
+struct ShaderStateNull {
+
+    const char*                     name = nullptr;
+
+    u32                             active_shaders = 0;
+    bool                            graphics_pipeline = false;
+    bool                            alive = false;
+
+}; // struct ShaderStateNull
+
+//
+//
+struct PipelineNull {
+
+    ShaderStateHandle               shader_state;
+
+    ResourceLayoutHandle            resource_layout_handle[ k_max_resource_layouts ];
+    u32                             num_active_layouts = 0;
+
+    PipelineHandle                  handle;
+    bool                            graphics_pipeline = true;
+    bool                            alive = false;
+
+}; // struct PipelineNull
+
+//
+//
+struct RenderPassNull {
+
+    RenderPassOutput                output;
+
+    TextureHandle                   output_textures[ k_max_image_outputs ];
+    TextureHandle                   output_depth;
+
+    RenderPassType::Enum            type;
+
+    f32                             scale_x     = 1.f;
+    f32                             scale_y     = 1.f;
+    u16                             width       = 0;
+    u16                             height      = 0;
+
+    u8                              resize      = 0;
+    u8                              num_render_targets = 0;
+
+    const char*                     name        = nullptr;
+    bool                            alive       = false;
+
+}; // struct RenderPassNull
+
+//
+//
+struct ResourceLayoutNull {
+
+    ResourceBinding*                bindings        = nullptr;
+    u16                             num_bindings    = 0;
+    u16                             set_index       = 0;
+
+    ResourceLayoutHandle            handle;
+    bool                            alive           = false;
+
+}; // struct ResourceLayoutNull
+
+//
+//
+struct ResourceListNull {
+
+    ResourceHandle*                 resources       = nullptr;
+    SamplerHandle*                  samplers        = nullptr;
+    u16*                            bindings        = nullptr;
+
+    ResourceLayoutHandle            layout;
+    u32                             num_resources   = 0;
+    bool                            alive           = false;
+
+}; // struct ResourceListNull
+
+} // namespace gfx
+} // namespace hydra
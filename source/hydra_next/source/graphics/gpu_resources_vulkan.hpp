@@ -106,6 +106,14 @@ struct PipelineVulkan {
     PipelineHandle                  handle;
     bool                            graphics_pipeline = true;
 
+    enum Status : u32 {
+        Status_Pending = 0,
+        Status_Ready,
+        Status_Failed                                               // vk_pipeline is null, draws using it are always skipped.
+    }; // enum Status
+
+    volatile u32                    status          = Status_Pending;   // Set when vk_pipeline is created, asynchronous pipelines are created on the compile thread.
+
 }; // struct PipelineVulkan
 
 
@@ -1,7 +1,7 @@
 #pragma once
 
 //
-//  Hydra Graphics - v0.54
+//  Hydra Graphics - v0.64
 //  3D API wrapper around Vulkan/Direct3D12/OpenGL.
 //  Mostly based on the amazing Sokol library (https://github.com/floooh/sokol), but with a different target (wrapping Vulkan/Direct3D12).
 //
@@ -11,11 +11,34 @@
 //
 // Files /////////////////////////////////
 //
-// command_buffer.hpp/.cpp, gpu_device.hpp/.cpp, gpu_device_vulkan.hpp/.cpp, gpu_enum.hpp, gpu_enum_vulkan.hpp,
-// gpu_resources.hpp/.cpp, gpu_resources_vulkan.hpp.
+// command_buffer.hpp/.cpp, gpu_device.hpp/.cpp, gpu_device_vulkan.hpp/.cpp, gpu_device_null.hpp/.cpp, gpu_enum.hpp, gpu_enum_vulkan.hpp,
+// gpu_resources.hpp/.cpp, gpu_resources_vulkan.hpp, gpu_resources_null.hpp.
 //
 // Revision history //////////////////////
 //
+//      0.64  (2022/01/11): + Added FramePacingStats: record, fence wait, acquire, submit and present times per frame, with a CPU/GPU/Present bound estimate.
+//                            + Added DeviceCreation::frames_in_flight, from 1 to k_max_swapchain_images.
+//                            + Vulkan present waits for the reused frame before flushing its deletions.
+//      0.63  (2022/01/10): + GPU timestamp queries are not bounded anymore: dropped queries grow the manager and the query pool at the end of the frame.
+//                            + Added GPUTimestampStatistics: p50/p95/p99 of inclusive and self time per scope hierarchy path, with CSV/JSON export.
+//                            + Fixed the reset of timestamp queries, only half of the frame queries were reset.
+//      0.62  (2022/01/09): + Added persistent pipeline caches, keyed by ShaderStateCreation::compute_hash and saved to DeviceCreation::pipeline_cache_path.
+//                            + Added Device::create_pipeline_async: pipelines are created on a compile thread, draws are skipped until they are ready.
+//      0.61  (2022/01/08): + Added ResourceListCreation::compute_hash and Device::create_resource_list_cached/destroy_resource_list_cached: resource lists
+//                            with the same contents are shared and ref-counted. Materials use them. + Added Device::create_resource_list_transient:
+//                            lists valid for the current frame, from per frame descriptor pools reset wholesale.
+//      0.60  (2022/01/07): + Added ResourceUpdateQueues: deletions are bucketed per frame and type and released in bulk, resource list and bindless
+//                            updates are written with one vkUpdateDescriptorSets each. Removed the limit of 16 bindless writes per frame.
+//      0.59  (2022/01/06): + Added DynamicAllocator: dynamic memory is a ring reclaimed per frame after its fence, with alignment per usage
+//                            and overflow pages for vertex/index data. Added Device::dynamic_allocate( size, usage ) and get_dynamic_stats().
+//      0.58  (2022/01/05): + CommandBuffer shadows bound pipeline, resource lists, vertex and index buffers and skips redundant binds.
+//                            Issued and filtered binds are counted per frame in Device::get_bind_stats().
+//      0.57  (2022/01/04): + Added deferred command buffers (CommandBuffer::set_deferred): commands are stored with their sort keys, merged across
+//                            command buffers at present, radix sorted and replayed without redundant pipeline, resource list and vertex/index buffer binds.
+//      0.56  (2022/01/02): + Command buffers can be recorded on multiple threads: pools are per frame and thread, get_command_buffer takes the thread index
+//                            and queued command buffers are submitted in request order. + RenderGraph::render records stages on multiple threads.
+//      0.55  (2021/12/30): + Added HYDRA_NULL headless backend: commands are recorded in a memory stream, resource lifetimes and deletion queue are simulated,
+//                            and calls are counted per frame (NullDeviceCounters).
 //      0.48  (2021/11/15): + Handled update after bind for bindless descriptor set layout. + Added deferred bindless textures descriptors update, and batched them.
 //      0.47  (2021/11/07): + Changed ResourceLayoutCreation::Binding to use a cstring instead of an array. Backend implementation are using a cstring,
 //                            so they were losing the data after the creation struct was going out of scope.
@@ -1,4 +1,4 @@
-// Hydra HFX v0.54
+// Hydra HFX v0.63
 
 #include "hydra_shaderfx.h"
 
@@ -7,6 +7,7 @@
 #include "kernel/assert.hpp"
 #include "kernel/process.hpp"
 #include "kernel/file.hpp"
+#include "kernel/time.hpp"
 #include "kernel/blob_serialization.hpp"
 
 #include "external/json.hpp"
@@ -35,6 +36,7 @@ void parser_init( Parser* parser, Lexer* lexer, hydra::Allocator* allocator, con
 
     parser->lexer = lexer;
     parser->allocator = allocator;
+    parser->dependencies = nullptr;
 
     parser->string_buffer.init(1024 * 16, allocator);
     strcpy( parser->source_path, source_path );
@@ -53,6 +55,66 @@ void parser_terminate( Parser* parser ) {
     parser->string_buffer.shutdown();
 }
 
+//
+// Hash of the file content, as stored in the dependency files. Returns false if the file cannot be read.
+static bool dependency_hash_file( cstring path, FileContentCache* file_cache, hydra::Allocator* allocator, u64& out_hash ) {
+    if ( file_cache ) {
+        const FileContent* content = file_cache->read( path );
+        out_hash = content ? content->hash : 0;
+        return content != nullptr;
+    }
+
+    hydra::FileReadResult file = hydra::file_read_binary( path, allocator );
+    if ( file.data == nullptr ) {
+        return false;
+    }
+
+    out_hash = hydra::hash_bytes( file.data, file.size );
+    hfree( file.data, allocator );
+    return true;
+}
+
+//
+//
+void parser_add_dependency( const Parser* parser, cstring path ) {
+    hydra::Array<Dependency>* dependencies = parser->dependencies;
+    if ( dependencies == nullptr ) {
+        return;
+    }
+
+    // Includes are usually shared by many stages, add them once.
+    for ( u32 i = 0; i < dependencies->size; ++i ) {
+        if ( strcmp( ( *dependencies )[ i ].path, path ) == 0 ) {
+            return;
+        }
+    }
+
+    Dependency dependency;
+    strncpy( dependency.path, path, ArraySize( dependency.path ) - 1 );
+    dependency.path[ ArraySize( dependency.path ) - 1 ] = 0;
+    if ( dependency_hash_file( path, parser->file_cache, parser->allocator, dependency.hash ) ) {
+        dependencies->push( dependency );
+    }
+}
+
+//
+// Files are read from the cache of the compile server when present, otherwise from disk.
+// Memory must be released with parser_release_file.
+static char* parser_read_file( const Parser* parser, cstring path, bool text_mode ) {
+    if ( parser->file_cache ) {
+        const FileContent* content = parser->file_cache->read( path );
+        return content ? content->text : nullptr;
+    }
+
+    return text_mode ? hydra::file_read_text( path, parser->allocator, nullptr ) : hydra::file_read_binary( path, parser->allocator, nullptr );
+}
+
+static void parser_release_file( const Parser* parser, char* memory ) {
+    if ( parser->file_cache == nullptr ) {
+        hfree( memory, parser->allocator );
+    }
+}
+
 void parser_generate_ast( Parser* parser ) {
 
     // Read source text until the end.
@@ -79,6 +141,37 @@ void parser_generate_ast( Parser* parser ) {
             }
         }
     }
+
+    parser_expand_pass_variants( parser );
+}
+
+//
+//
+void parser_expand_pass_variants( Parser* parser ) {
+    std::vector<Pass>& passes = parser->shader.passes;
+
+    // Variants are appended after all the declared passes, so that their indices do not change.
+    const u32 declared_pass_count = ( u32 )passes.size();
+    for ( u32 p = 0; p < declared_pass_count; ++p ) {
+        const u32 variant_count = 1 << ( u32 )passes[ p ].variant_keywords.size();
+        if ( variant_count == 1 ) {
+            continue;
+        }
+
+        passes[ p ].variant_first_pass = ( u32 )passes.size();
+
+        for ( u32 key = 1; key < variant_count; ++key ) {
+            Pass variant = passes[ p ];
+            variant.variant_key = key;
+
+            // Unique name, used also in the generated C++ header.
+            char* name = parser->string_buffer.append_use_f( "%.*s_v%u", ( i32 )variant.name.length, variant.name.text, key );
+            variant.name.text = name;
+            variant.name.length = strlen( name );
+
+            passes.emplace_back( variant );
+        }
+    }
 }
 
 void identifier( Parser* parser, const Token& token ) {
@@ -180,7 +273,11 @@ void pass_identifier( Parser* parser, const Token& token, Pass& pass ) {
 
             case 'v':
             {
-                if ( lexer_expect_keyword( token.text, 6, "vertex" ) ) {
+                if ( lexer_expect_keyword( token.text, 8, "variants" ) ) {
+                    declaration_pass_variants( parser, pass );
+                    return;
+                }
+                else if ( lexer_expect_keyword( token.text, 6, "vertex" ) ) {
                     Pass::ShaderStage stage = { nullptr, Stage::Vertex };
                     declaration_shader_stage( parser, stage );
 
@@ -691,24 +788,21 @@ void vertex_attribute_identifier( Parser* parser, Token& token, hydra::gfx::Vert
     // Skip name
     lexer_next_token( parser->lexer, token );
     // Parse binding
-    uint32_t data_index = parser->lexer->data_buffer->current_entries - 1;
-    float value;
-    data_buffer_get( *parser->lexer->data_buffer, data_index, value );
+    u32 value;
+    data_buffer_get_current( *parser->lexer->data_buffer, value );
 
     attribute.binding = (uint16_t)value;
 
     lexer_next_token( parser->lexer, token );
 
     // Parse location
-    data_index = parser->lexer->data_buffer->current_entries - 1;
-    data_buffer_get( *parser->lexer->data_buffer, data_index, value );
+    data_buffer_get_current( *parser->lexer->data_buffer, value );
 
     attribute.location = (uint16_t)value;
 
     lexer_next_token( parser->lexer, token );
     // Parse offset
-    data_index = parser->lexer->data_buffer->current_entries - 1;
-    data_buffer_get( *parser->lexer->data_buffer, data_index, value );
+    data_buffer_get_current( *parser->lexer->data_buffer, value );
 
     attribute.offset = (uint16_t)value;
 }
@@ -718,15 +812,13 @@ void vertex_attribute_identifier( Parser* parser, Token& token, hydra::gfx::Vert
 void vertex_binding_identifier( Parser* parser, Token& token, hydra::gfx::VertexStream& stream ) {
 
     // Parse binding
-    float value;
-    uint32_t data_index = parser->lexer->data_buffer->current_entries - 1;
-    data_buffer_get( *parser->lexer->data_buffer, data_index, value );
+    u32 value;
+    data_buffer_get_current( *parser->lexer->data_buffer, value );
     stream.binding = (uint16_t)value;
 
     // Parse stride
     lexer_next_token( parser->lexer, token );
-    data_index = parser->lexer->data_buffer->current_entries - 1;
-    data_buffer_get( *parser->lexer->data_buffer, data_index, value );
+    data_buffer_get_current( *parser->lexer->data_buffer, value );
     stream.stride = (uint16_t)value;
 
     // Parse frequency (vertex or instance)
@@ -1495,6 +1587,31 @@ void declaration_pass_options( Parser* parser, Pass& pass ) {
     pass.options_offsets.emplace_back( count );
 }
 
+//
+// Syntax: variants = ( KEYWORD_0, KEYWORD_1, ... ).
+// Each keyword is a define enabled by the corresponding bit of the variant key.
+void declaration_pass_variants( Parser* parser, Pass& pass ) {
+    Token token;
+
+    if ( !lexer_expect_token( parser->lexer, token, Token::Token_Equals ) ) {
+        return;
+    }
+
+    while ( !lexer_equals_token( parser->lexer, token, Token::Token_CloseParen ) ) {
+        lexer_next_token( parser->lexer, token );
+
+        if ( token.type == Token::Token_Identifier ) {
+            if ( pass.variant_keywords.size() == Pass::k_max_variant_keywords ) {
+                HYDRA_LOG( "Too many variant keywords in pass %.*s, max is %u. Ignoring %.*s.\n", ( i32 )pass.name.length, pass.name.text, Pass::k_max_variant_keywords,
+                           ( i32 )token.text.length, token.text.text );
+                continue;
+            }
+
+            pass.variant_keywords.emplace_back( token.text );
+        }
+    }
+}
+
 //
 //
 void declaration_pass_dispatch( Parser* parser, Pass& pass ) {
@@ -1550,8 +1667,11 @@ void declaration_includes( Parser* parser ) {
             path_buffer.append( parser->source_path );
             path_buffer.append( token.text );
 
-            char* text = hydra::file_read_binary( path_buffer.data, parser->allocator, nullptr );
+            // Code fragments reference the text, it is never released.
+            char* text = parser_read_file( parser, path_buffer.data, false );
             if ( text ) {
+                parser_add_dependency( parser, path_buffer.data );
+
                 Lexer lexer;
                 DataBuffer data_buffer;
 
@@ -1560,6 +1680,8 @@ void declaration_includes( Parser* parser ) {
 
                 Parser local_parser;
                 hfx::parser_init( &local_parser, &lexer, parser->allocator, parser->source_path, path_buffer.data, "." );
+                local_parser.dependencies = parser->dependencies;
+                local_parser.file_cache = parser->file_cache;
                 hfx::parser_generate_ast( &local_parser );
 
                 // TODO: cleanup code!
@@ -1788,6 +1910,33 @@ static void append_reflection_data( nlohmann::json& parsed_json, const char* nam
         // contains duplicates.
         hydra::FlatHashMap<u64, u8> written_types;
         written_types.init( allocator, 16 );
+        // Size in bytes of the structs already written, to track the offset of struct members.
+        hydra::FlatHashMap<u64, u32> type_sizes;
+        type_sizes.init( allocator, 16 );
+        type_sizes.set_default_value( 0 );
+        // Block types are laid out as std140 when used as constant buffers and std430 when used as structured buffers.
+        hydra::FlatHashMap<u64, cstring> type_layouts;
+        type_layouts.init( allocator, 16 );
+
+        json blocks = parsed_json[ "ubos" ];
+        for ( u32 i = 0; i < blocks.size(); ++i ) {
+            blocks[ i ][ "type" ].get_to( name_str );
+            type_layouts.insert( hydra::hash_calculate( name_str.c_str() ), "std140" );
+        }
+        blocks = parsed_json[ "ssbos" ];
+        for ( u32 i = 0; i < blocks.size(); ++i ) {
+            blocks[ i ][ "type" ].get_to( name_str );
+            type_layouts.insert( hydra::hash_calculate( name_str.c_str() ), "std430" );
+        }
+
+        // Per struct members with their reflected offset, used for the layout asserts and the field table.
+        struct ReflectedField {
+            cstring                 name;
+            u32                     offset;
+            u32                     size;
+        };
+        hydra::Array<ReflectedField> fields;
+        fields.init( allocator, 16 );
 
         for ( json::iterator it = types.begin(); it != types.end(); ++it ) {
             json definition = it.value();
@@ -1813,12 +1962,18 @@ static void append_reflection_data( nlohmann::json& parsed_json, const char* nam
             written_types.insert( type_hash, 1 );
             
 
-            reflection_buffer->append_f( "\t\t\tstruct %s {\n", name_str.c_str() );
+            cstring layout = type_layouts.get( name_hash );
+            if ( layout ) {
+                reflection_buffer->append_f( "\t\t\t// Layout %s\n", layout );
+            }
+            reflection_buffer->append_f( "\t\t\tstruct %s {\n", type_interned );
 
             json members = definition[ "members" ];
 
             u32 member_memory_offset = 0;
             u32 padding_added = 0;
+            bool offsets_known = true;
+            fields.clear();
 
             // Iterate all struct members
             for ( u32 i = 0; i < members.size(); ++i ) {
@@ -1864,42 +2019,98 @@ static void append_reflection_data( nlohmann::json& parsed_json, const char* nam
                     cstring type_name = name_to_type.get( member_typename_hash );
                     if ( type_name ) {
                         name_str = type_name;
+                        member_size = type_sizes.get( hydra::hash_calculate( type_name ) );
                     }
                     else {
                         hprint( "Error parsing type %s\n", name_str.c_str() );
                     }
                 }
 
+                // Fixed size arrays are written as arrays, runtime sized ones as a single element.
+                u32 array_count = 0;
+                json array = m[ "array" ];
+                if ( array.is_array() && array.size() == 1 && array[ 0 ].is_number() ) {
+                    array[ 0 ].get_to( array_count );
+                }
+                if ( array_count > 1 ) {
+                    const u32 array_stride = m.value( "array_stride", member_size );
+                    member_size = array_stride * array_count;
+                }
+
                 // Add padding
                 if ( offset.is_number() ) {
                     u32 current_member_offset;
                     offset.get_to( current_member_offset );
 
-                    // TODO:
-                    //hprint( "TODO: improve array padding\n" );
-
-                    if ( member_memory_offset < current_member_offset ) {
-                        while ( member_memory_offset < current_member_offset ) {
-
-                            reflection_buffer->append_f( "\t\t\t\tuint32_t\t\t\t\tpad%d;\n", padding_added++ );
-                            ++member_memory_offset;
-                        }
-                    }
-                    else {
-                        member_memory_offset += member_size;
+                    while ( member_memory_offset + 4 <= current_member_offset ) {
+                        reflection_buffer->append_f( "\t\t\t\tuint32_t\t\t\t\tpad%d;\n", padding_added++ );
+                        member_memory_offset += 4;
                     }
+
+                    member_memory_offset = current_member_offset + member_size;
+                    offsets_known = offsets_known && member_size != 0;
+                }
+                else {
+                    offsets_known = false;
                 }
 
                 // Write type
                 reflection_buffer->append_f( "\t\t\t\t%s", name_str.c_str() );
                 // Write name
                 name.get_to( name_str );
-                reflection_buffer->append_f( "\t\t\t\t\t%s;\n", name_str.c_str() );
+                if ( array_count > 1 ) {
+                    reflection_buffer->append_f( "\t\t\t\t\t%s[ %u ];\n", name_str.c_str(), array_count );
+                }
+                else {
+                    reflection_buffer->append_f( "\t\t\t\t\t%s;\n", name_str.c_str() );
+                }
+
+                if ( offset.is_number() && member_size ) {
+                    ReflectedField& field = fields.push_use();
+                    field.name = ( cstring )buffer.append_use( name_str.c_str() );
+                    offset.get_to( field.offset );
+                    field.size = member_size;
+                }
+            }
+
+            // Offsets and sizes are known only for explicitly laid out structs.
+            if ( !offsets_known || fields.size == 0 ) {
+                reflection_buffer->append_f( "\t\t\t};\n\n" );
+                continue;
             }
 
+            type_sizes.insert( type_hash, member_memory_offset );
+
+            // Update helper, declared here and defined after the field table.
+            reflection_buffer->append_f( "\n\t\t\t\tuint32_t\t\t\t\tupdate( void* gpu_data, %s& previous ) const;\n", type_interned );
+            reflection_buffer->append_f( "\t\t\t};\n\n" );
+
+            // Fail compilation of the generated header if the C++ layout does not match the shader one.
+            for ( u32 f = 0; f < fields.size; ++f ) {
+                const ReflectedField& field = fields[ f ];
+                reflection_buffer->append_f( "\t\t\tstatic_assert( offsetof( %s, %s ) == %u, \"%s::%s offset differs from the shader\" );\n",
+                                             type_interned, field.name, field.offset, type_interned, field.name );
+            }
+            reflection_buffer->append_f( "\t\t\tstatic_assert( sizeof( %s ) >= %u, \"%s is smaller than the shader struct\" );\n\n", type_interned, member_memory_offset, type_interned );
+
+            // Field table, to upload only the changed fields.
+            reflection_buffer->append_f( "\t\t\tstatic const uint32_t %s_num_fields = %u;\n", type_interned, fields.size );
+            reflection_buffer->append_f( "\t\t\tstatic constexpr hydra::gfx::ShaderConstantField %s_fields[ %u ] = {\n", type_interned, fields.size );
+            for ( u32 f = 0; f < fields.size; ++f ) {
+                const ReflectedField& field = fields[ f ];
+                reflection_buffer->append_f( "\t\t\t\t{ \"%s\", %u, %u },\n", field.name, field.offset, field.size );
+            }
             reflection_buffer->append_f( "\t\t\t};\n\n" );
+
+            reflection_buffer->append_f( "\t\t\tinline uint32_t %s::update( void* gpu_data, %s& previous ) const {\n", type_interned, type_interned );
+            reflection_buffer->append_f( "\t\t\t\treturn hydra::gfx::shader_constants_copy_dirty( this, &previous, gpu_data, %s_fields, %s_num_fields );\n", type_interned, type_interned );
+            reflection_buffer->append_f( "\t\t\t}\n\n" );
         }
 
+        fields.shutdown();
+        type_layouts.shutdown();
+        type_sizes.shutdown();
+
         // Write resource indices
         json ubos = parsed_json[ "ubos" ];
         for ( u32 i = 0; i < ubos.size(); ++i ) {
@@ -1977,11 +2188,13 @@ static void append_include_code( const CodeFragment::Include& include, cstring p
         }
 
         filename_buffer.append( include.filename );
-        char* include_code = hydra::file_read_text( filename_buffer.data, parser->allocator, nullptr );
+        char* include_code = parser_read_file( parser, filename_buffer.data, true );
         if ( include_code ) {
+            parser_add_dependency( parser, filename_buffer.data );
+
             code_buffer.append_f( "%s\n", include_code );
 
-            hfree( include_code, parser->allocator );
+            parser_release_file( parser, include_code );
         }
         else {
             HYDRA_LOG( "Cannot find include file %s\n", filename_buffer.data );
@@ -1994,7 +2207,7 @@ static void append_include_code( const CodeFragment::Include& include, cstring p
 
 //
 // Finalize shader code.
-static void finalize_shader_code( const char* path, const CodeGenerator* code_generator, const Pass::ShaderStage& shader_stage,
+static void finalize_shader_code( const char* path, const CodeGenerator* code_generator, const Pass& pass, const Pass::ShaderStage& shader_stage,
                                   const StringBuffer& constants_buffer, StringBuffer& filename_buffer, StringBuffer& code_buffer ) {
 
     const Parser* parser = code_generator->parser;
@@ -2009,6 +2222,15 @@ static void finalize_shader_code( const char* path, const CodeGenerator* code_ge
 
     // Add the per stage define.
     code_buffer.append( s_shader_stage_defines[ stage ] );
+
+    // Add the defines enabled by the pass variant.
+    for ( u32 k = 0; k < ( u32 )pass.variant_keywords.size(); ++k ) {
+        if ( pass.variant_key & ( 1 << k ) ) {
+            code_buffer.append( "#define " );
+            code_buffer.append( pass.variant_keywords[ k ] );
+            code_buffer.append( "\n" );
+        }
+    }
     code_buffer.append( "\n\t\t" );
 
     // Append local constants
@@ -2059,189 +2281,459 @@ static void finalize_shader_code( const char* path, const CodeGenerator* code_ge
 }
 
 
+// Shader stage cache /////////////////////////////////////////////////////
+
 //
-// Compile shader given the finalized code.
-// Returns the filename to the compiled shader if no errors occurred, null otherwise.
-static char* compile_shader( cstring path, const CodeGenerator* code_generator, const Pass::ShaderStage& shader_stage,
-                             StringBuffer& filename_buffer, StringBuffer& code_buffer, u32 cached_buffer_size ) {
+// Compiled stages are stored in a content addressed cache: entries are named after the hash of the
+// finalized code, that contains all the includes, and of the options changing the compiler output.
+struct ShaderCacheEntryHeader {
 
+    u32                         magic;
+    u32                         version;
+    u32                         binary_size;
+    u32                         reflection_size;
 
-    filename_buffer.clear();
+}; // struct ShaderCacheEntryHeader
 
-    Stage stage = shader_stage.stage;
+static const u32                k_shader_cache_magic = 0x43584648;      // 'HFXC'
+static const u32                k_shader_cache_version = 1;             // Increase to invalidate all the entries.
+static const u32                k_shader_cache_options_mask = CompileOptions_OpenGL | CompileOptions_Vulkan | CompileOptions_SpirV;
 
-    // Calculate output filename.
-    // Used as input for external compilation step.
-    char* intermediate_filename = filename_buffer.append_use( code_generator->parser->shader.name );
-    char* intermediate_shadername = filename_buffer.append_use( shader_stage.code->name );
-    char* temp_filename = filename_buffer.append_use_f( "%s\\%s_%s_hfx.%s", code_generator->parser->destination_path, intermediate_filename, intermediate_shadername, s_shader_compiler_stage[ stage ] );
-    // Write current shader to file.
-    FILE* temp_shader_file = fopen( temp_filename, "w" );
-    fwrite( &code_buffer.data[ cached_buffer_size ], code_buffer.current_size - cached_buffer_size, 1, temp_shader_file );
-    fclose( temp_shader_file );
+//
+// Compilers are identified by the modification time of their binaries: entries produced by
+// a different glslangValidator or spirv-cross are not found anymore.
+static u64 shader_cache_compiler_identity( cstring glsl_compiler_path, cstring spirv_cross_path ) {
+    const hydra::FileTime glsl_compiler_time = hydra::file_last_write_time( glsl_compiler_path );
+    const hydra::FileTime spirv_cross_time = hydra::file_last_write_time( spirv_cross_path );
+
+    const u64 identity = hydra::hash_bytes( ( void* )&glsl_compiler_time, sizeof( glsl_compiler_time ) );
+    return hydra::hash_bytes( ( void* )&spirv_cross_time, sizeof( spirv_cross_time ), identity );
+}
 
-    // Rewind code buffer by simply pointing to the memory before all the changes.
-    code_buffer.current_size = cached_buffer_size;
+//
+//
+static u64 shader_cache_key( const char* code, u32 code_size, Stage stage, u32 options, u64 compiler_identity ) {
+    const u32 seed_data[] = { k_shader_cache_version, options & k_shader_cache_options_mask, ( u32 )stage };
+    const u64 seed = hydra::hash_bytes( ( void* )seed_data, sizeof( seed_data ), compiler_identity );
 
-    uint32_t compile_options = code_generator->options;
+    return hydra::hash_bytes( ( void* )code, code_size, seed );
+}
 
-    //char* final_shader = nullptr;
-    bool compilation_succeeded = true;
-    char* final_shader_filename = nullptr;
+//
+// Returns true if the entry is valid and contains reflection data when needed.
+// Binary and reflection are allocated with the allocator, reflection is null terminated.
+static bool shader_cache_read( cstring entry_filename, bool needs_reflection, hydra::Allocator* allocator,
+                               hydra::FileReadResult& out_binary, hydra::FileReadResult& out_reflection ) {
 
-    hprint( ">>>>>>> Compiling shader\n" );
+    hydra::FileReadResult entry = hydra::file_read_binary( entry_filename, allocator );
+    if ( entry.data == nullptr ) {
+        return false;
+    }
 
-    // Execute compilation process.
-    if ( ( compile_options & CompileOptions_SpirV ) == CompileOptions_SpirV ) {
-        // Convert to SpirV binary blob.
-        char* glsl_compiler_path = filename_buffer.append_use_f( "%sglslangValidator.exe", code_generator->shader_binaries_path );
-        final_shader_filename = filename_buffer.append_use_f( "%s.spv", temp_filename );
-        const char* gl_vertex_id_define = "gl_VertexID=gl_VertexIndex";
-        char* arguments = filename_buffer.append_use_f( "glslangValidator.exe %s -V -o %s -S %s --D %s", temp_filename, final_shader_filename, s_shader_compiler_stage[ stage ], gl_vertex_id_define );
-        compilation_succeeded = hydra::process_execute( ".", glsl_compiler_path, arguments, "ERROR" );
+    const ShaderCacheEntryHeader* header = ( const ShaderCacheEntryHeader* )entry.data;
+    const bool valid = entry.size >= sizeof( ShaderCacheEntryHeader ) &&
+                       header->magic == k_shader_cache_magic && header->version == k_shader_cache_version &&
+                       entry.size == sizeof( ShaderCacheEntryHeader ) + ( sizet )header->binary_size + header->reflection_size &&
+                       header->binary_size > 0 && ( !needs_reflection || header->reflection_size > 0 );
 
-        // Load newly generated file - binary.
-        //final_shader = hydra::file_read_binary( final_shader_filename, code_generator->parser->allocator, &final_shader_size );
-    } else {
-        // Convert to SpirV binary blob.
-        char* glsl_compiler_path = filename_buffer.append_use_f( "%sglslangValidator.exe", code_generator->shader_binaries_path );
-        const char* gl_vertex_id_define = "gl_VertexIndex=gl_VertexID";
-        char* arguments = filename_buffer.append_use_f( "glslangValidator.exe %s --aml -G -o %s\\shader.spv -S %s --D %s", temp_filename, code_generator->parser->destination_path, s_shader_compiler_stage[ stage ], gl_vertex_id_define );
-        compilation_succeeded = hydra::process_execute( ".", glsl_compiler_path, arguments, "ERROR" );
+    if ( valid ) {
+        const char* binary = entry.data + sizeof( ShaderCacheEntryHeader );
+        out_binary.size = header->binary_size;
+        out_binary.data = ( char* )halloca( out_binary.size, allocator );
+        memcpy( out_binary.data, binary, out_binary.size );
 
-        // spirv - opt.exe - O ComputeTest.spv - o ComputeTest_opt.spv
-        // Convert back to glsl
-        char* spirv_cross_path = filename_buffer.append_use_f( "%sspirv-cross.exe", code_generator->shader_binaries_path );
-        arguments = filename_buffer.append_use_f( "spirv-cross.exe --version 450 --no-es %s\\shader.spv --output %s\\%s_%s.%s", code_generator->parser->destination_path,
-                                                  code_generator->parser->destination_path, intermediate_filename, intermediate_shadername, s_shader_compiler_stage[ stage ] );
-        hydra::process_execute( ".", spirv_cross_path, arguments );
+        if ( needs_reflection ) {
+            out_reflection.size = header->reflection_size;
+            out_reflection.data = ( char* )halloca( out_reflection.size + 1, allocator );
+            memcpy( out_reflection.data, binary + header->binary_size, out_reflection.size );
+            out_reflection.data[ out_reflection.size ] = 0;
+        }
+    }
 
-        final_shader_filename = filename_buffer.append_use_f( "%s\\%s_%s.%s", code_generator->parser->destination_path, intermediate_filename, intermediate_shadername, s_shader_compiler_stage[ stage ] );
-        // Use binary version because in the append it will be memcopied.
-        //final_shader = hydra::file_read_binary( final_shader_filename, code_generator->parser->allocator, &final_shader_size );
+    hfree( entry.data, allocator );
+    return valid;
+}
+
+//
+// Entry is written in a temporary file and then renamed, so concurrent compilations never read partial entries.
+static void shader_cache_write( cstring entry_filename, cstring temporary_filename, const hydra::FileReadResult& binary, const hydra::FileReadResult& reflection ) {
+
+    FILE* file = fopen( temporary_filename, "wb" );
+    if ( file == nullptr ) {
+        return;
     }
 
-    if ( !compilation_succeeded ) {
-        // Print the shader
-        char* shader_code = hydra::file_read_text( temp_filename, code_generator->parser->allocator, nullptr );
-        const char* process_output = hydra::process_get_output();
+    ShaderCacheEntryHeader header;
+    header.magic = k_shader_cache_magic;
+    header.version = k_shader_cache_version;
+    header.binary_size = ( u32 )binary.size;
+    header.reflection_size = ( u32 )reflection.size;
 
-        const char* error_string = strstr( process_output, "ERROR" );
-        // Error format is: ERROR: filename:(line)
-        error_string = strstr( error_string, ":" );
-        ++error_string;
-        error_string = strstr( error_string, ":" );
-        ++error_string;
-        i32
-            error_line = atoi( error_string );
+    bool written = fwrite( &header, sizeof( ShaderCacheEntryHeader ), 1, file ) == 1;
+    written = written && fwrite( binary.data, binary.size, 1, file ) == 1;
+    written = written && ( reflection.size == 0 || fwrite( reflection.data, reflection.size, 1, file ) == 1 );
+    fclose( file );
 
-        const i32 k_output_error_lines = 10;
-        i32 min_line = hydra::max( 0, error_line - k_output_error_lines );
-        // Search line
-        char* shader_error_line = shader_code;
+    if ( !written || !hydra::file_rename( temporary_filename, entry_filename ) ) {
+        hydra::file_delete( temporary_filename );
+    }
+}
 
-        Lexer lexer;
-        lexer_init( &lexer, shader_error_line, nullptr );
-        lexer_goto_line( &lexer, min_line );
+// Parallel shader compilation ////////////////////////////////////////////
 
-        shader_error_line = lexer.position;
+//
+// Compilation state of a single shader stage. All the stages of all passes are sent to the
+// process pool at once, then the results are consumed in order when writing the binary.
+struct ShaderStageCompilation {
 
-        lexer_next_line( &lexer );
-        char* shader_next_error_line = lexer.position;
+    Pass::ShaderStage           shader_stage;
+    u32                         pass_index;
 
-        int32_t shader_line_size = ( i32 )( shader_next_error_line - shader_error_line );
-        // Output lines before the error line.
-        // Need to limit the output to just one line at the time.
-        for ( size_t i = 0; i < k_output_error_lines; i++ ) {
-            char* shader_line_text = filename_buffer.append_use_substring( shader_error_line, 0, shader_line_size );
+    char*                       code;                   // Finalized code, sent through stdin.
+    u32                         code_size;
 
-            hprint( "%s%s", ( i == k_output_error_lines - 1 ) ? "\nERROR LINE:\n" : "", shader_line_text );
+    char*                       spirv_filename;         // Compiler output.
 
-            // Advance one line
-            shader_error_line = shader_next_error_line;
-            lexer_next_line( &lexer );
-            shader_next_error_line = lexer.position;
+    hydra::ProcessJob*          compile_job;
+    hydra::ProcessJob*          convert_job;            // OpenGL only: SpirV converted back to glsl by spirv-cross.
+    hydra::ProcessJob*          reflection_job;
 
-            shader_line_size = ( i32 )( shader_next_error_line - shader_error_line );
-        }
+    hydra::FileReadResult       binary;                 // Final code to embed, SpirV or glsl.
+    hydra::FileReadResult       reflection;             // Reflection json, null terminated.
 
-        hprint( "\n>>>>>>> Compilation ERROR!\n\n" );
-        //hprint( "FULL CODE %s\n", shader_code);
+    u64                         cache_key;
+    char*                       cache_filename;
 
-        // NOTE: return!
-        return nullptr;
-    } else {
-        hprint( ">>>>>>> Compilation successful!\n\n" );
-    }
+    bool                        succeeded;
+    bool                        cached;                 // Retrieved from the cache, no process was executed.
 
-    // Delete intermediate files if needed
-    const bool keep_intermediate = ( compile_options & CompileOptions_Output_Files ) == CompileOptions_Output_Files;
-    if ( !keep_intermediate ) {
-        hydra::file_delete( temp_filename );
+}; // struct ShaderStageCompilation
+
+//
+// Binary already written in the blob, shared by passes with identical code.
+struct ShaderBinaryEntry {
+
+    char*                       data;
+    u32                         size;
+    u8                          stage;
+
+}; // struct ShaderBinaryEntry
+
+//
+// Output the lines preceding the error, using the code sent to the compiler.
+static void output_shader_compilation_error( const ShaderStageCompilation& compilation, cstring process_output, StringBuffer& filename_buffer ) {
+
+    // Error format is: ERROR: filename:(line)
+    const char* error_string = process_output ? strstr( process_output, "ERROR" ) : nullptr;
+    error_string = error_string ? strstr( error_string, ":" ) : nullptr;
+    error_string = error_string ? strstr( error_string + 1, ":" ) : nullptr;
+    if ( error_string == nullptr ) {
+        return;
     }
 
-    return final_shader_filename;
+    const i32 error_line = atoi( error_string + 1 );
+
+    const i32 k_output_error_lines = 10;
+    i32 min_line = hydra::max( 0, error_line - k_output_error_lines );
+
+    Lexer lexer;
+    lexer_init( &lexer, compilation.code, nullptr );
+    lexer_goto_line( &lexer, min_line );
+
+    char* shader_error_line = lexer.position;
+
+    lexer_next_line( &lexer );
+    char* shader_next_error_line = lexer.position;
+
+    int32_t shader_line_size = ( i32 )( shader_next_error_line - shader_error_line );
+    // Output lines before the error line.
+    // Need to limit the output to just one line at the time.
+    for ( size_t i = 0; i < k_output_error_lines; i++ ) {
+        char* shader_line_text = filename_buffer.append_use_substring( shader_error_line, 0, shader_line_size );
+
+        hprint( "%s%s", ( i == k_output_error_lines - 1 ) ? "\nERROR LINE:\n" : "", shader_line_text );
+
+        // Advance one line
+        shader_error_line = shader_next_error_line;
+        lexer_next_line( &lexer );
+        shader_next_error_line = lexer.position;
+
+        shader_line_size = ( i32 )( shader_next_error_line - shader_error_line );
+    }
 }
 
 //
-// Finalize and append code to a code string buffer.
-// For embedded code (into binary HFX), prepend the stage and null terminate.
-static bool append_finalized_shader_code( const char* path, const CodeGenerator* code_generator, const Pass::ShaderStage& shader_stage,
-                                          StringBuffer& filename_buffer, StringBuffer& code_buffer, const StringBuffer& constants_buffer,
-                                          StringBuffer* reflection_buffer, const StringRef* pass_name ) {
+// Finalize the code of every stage and compile all of them concurrently using the code generator process pool.
+// Sources are sent through stdin and compiler messages, converted glsl and reflection data are read from pipes.
+// Stages found in the shader cache are not compiled.
+// Returns true if all stages compiled successfully.
+static bool compile_shader_stages( cstring path, const CodeGenerator* code_generator, hydra::Array<ShaderStageCompilation>& out_compilations,
+                                   StringBuffer& jobs_buffer, StringBuffer& filename_buffer, StringBuffer& code_buffer, const StringBuffer& constants_buffer ) {
 
     const Parser* parser = code_generator->parser;
-    // Cache current buffer size, use it to compose the shader.
-    uint32_t cached_buffer_size = code_buffer.current_size;
+    hydra::ProcessPool* process_pool = code_generator->process_pool;
 
-    Stage stage = shader_stage.stage;
-    const CodeFragment* code_fragment = shader_stage.code;
+    const u32 compile_options = code_generator->options;
+    const bool spirv = ( compile_options & CompileOptions_SpirV ) == CompileOptions_SpirV;
+    const bool keep_intermediate = ( compile_options & CompileOptions_Output_Files ) == CompileOptions_Output_Files;
+    const bool needs_reflection = code_generator->generate_reflection_data;
+    cstring shader_cache_path = code_generator->shader_cache_path;
 
-    // Append glsl version
-    code_buffer.append_f( "%s\n", "#version 450" );
+    // Paths and arguments must live until the jobs are done: they are all stored in the jobs buffer.
+    cstring glsl_compiler_path = jobs_buffer.append_use_f( "%sglslangValidator.exe", code_generator->shader_binaries_path );
+    cstring spirv_cross_path = jobs_buffer.append_use_f( "%sspirv-cross.exe", code_generator->shader_binaries_path );
+    cstring shader_name = jobs_buffer.append_use( parser->shader.name );
 
-    // Add the per stage define.
-    code_buffer.append( s_shader_stage_defines[ stage ] );
-    code_buffer.append( "\n\t\t" );
+    const u64 compiler_identity = shader_cache_path ? shader_cache_compiler_identity( glsl_compiler_path, spirv_cross_path ) : 0;
 
-    // Append local constants
-    code_buffer.append( constants_buffer );
+    // Finalize all stages and submit compilation.
+    const u32 pass_count = ( u32 )parser->shader.passes.size();
+    for ( u32 p = 0; p < pass_count; ++p ) {
+        const Pass& pass = parser->shader.passes[ p ];
 
-    // Add the code straight from the HFX file.
-    code_buffer.append( "\n\t\t" );
+        for ( u32 s = 0; s < ( u32 )pass.shader_stages.size(); ++s ) {
+            const Pass::ShaderStage& shader_stage = pass.shader_stages[ s ];
+            if ( shader_stage.code == nullptr ) {
+                continue;
+            }
 
-    Lexer lexer;
-    lexer_init( &lexer, code_fragment->code.text, nullptr );
-    char* current_line_start = lexer.position;
-    lexer_next_line( &lexer );
-    char* next_line_start = lexer.position;
+            ShaderStageCompilation& compilation = out_compilations.push_use();
+            memset( &compilation, 0, sizeof( ShaderStageCompilation ) );
+            compilation.shader_stage = shader_stage;
+            compilation.pass_index = p;
 
-    char buffer[ 10000 ];
+            code_buffer.clear();
+            finalize_shader_code( path, code_generator, pass, shader_stage, constants_buffer, filename_buffer, code_buffer );
 
-    // Get first include to search
-    const CodeFragment::Include* include = code_fragment->includes.size() ? &code_fragment->includes[ 0 ] : nullptr;
-    u32 include_index = include ? 0 : u32_max;
-    u32 include_relative_line = include ? include->declaration_line - code_fragment->starting_file_line : u32_max;
+            compilation.code_size = code_buffer.current_size;
+            compilation.code = ( char* )halloca( compilation.code_size + 1, parser->allocator );
+            memcpy( compilation.code, code_buffer.data, compilation.code_size );
+            compilation.code[ compilation.code_size ] = 0;
 
-    // Perform line by line code write
-    while ( lexer.position - code_fragment->code.text < (i32)code_fragment->code.length ) {
+            const Stage stage = shader_stage.stage;
+            // Pass index is part of the name: the same code fragment can be used by different passes compiling at the same time.
+            char* intermediate_shadername = filename_buffer.append_use( shader_stage.code->name );
+            char* intermediate_filename = jobs_buffer.append_use_f( "%s\\%s_%s_%u_hfx.%s", parser->destination_path, shader_name, intermediate_shadername, p, s_shader_compiler_stage[ stage ] );
+            filename_buffer.clear();
 
-        if ( lexer.line == include_relative_line ) {
-            // Inject include code
-            append_include_code( *include, path, parser, stage, filename_buffer, code_buffer );
-            // Advance to next include if present
-            ++include_index;
-            if ( include_index < code_fragment->includes.size() ) {
-                include = &code_fragment->includes[ include_index ];
-                include_relative_line = include->declaration_line - code_fragment->starting_file_line;
+            if ( keep_intermediate ) {
+                hydra::file_write_binary( intermediate_filename, compilation.code, compilation.code_size );
             }
-            else {
-                include_relative_line = u32_max;
-                include = nullptr;
+
+            compilation.spirv_filename = jobs_buffer.append_use_f( "%s.spv", intermediate_filename );
+
+            if ( shader_cache_path ) {
+                compilation.cache_key = shader_cache_key( compilation.code, compilation.code_size, stage, compile_options, compiler_identity );
+                compilation.cache_filename = jobs_buffer.append_use_f( "%s%016llx.hfxc", shader_cache_path, compilation.cache_key );
+
+                compilation.cached = shader_cache_read( compilation.cache_filename, needs_reflection, parser->allocator, compilation.binary, compilation.reflection );
+                if ( compilation.cached ) {
+                    compilation.succeeded = true;
+                    continue;
+                }
+            }
+
+            char* arguments = nullptr;
+            if ( spirv ) {
+                arguments = jobs_buffer.append_use_f( "glslangValidator.exe --stdin -V -o %s -S %s --D gl_VertexID=gl_VertexIndex", compilation.spirv_filename, s_shader_compiler_stage[ stage ] );
+            } else {
+                arguments = jobs_buffer.append_use_f( "glslangValidator.exe --stdin --aml -G -o %s -S %s --D gl_VertexIndex=gl_VertexID", compilation.spirv_filename, s_shader_compiler_stage[ stage ] );
             }
+
+            compilation.compile_job = process_pool->submit( ".", glsl_compiler_path, arguments, compilation.code, compilation.code_size );
         }
-    
-        // Copy current line
+    }
+
+    u32 cached_count = 0;
+    for ( u32 i = 0; i < out_compilations.size; ++i ) {
+        cached_count += out_compilations[ i ].cached ? 1 : 0;
+    }
+
+    hprint( ">>>>>>> Compiling %u shader stages, %u from cache\n", out_compilations.size - cached_count, cached_count );
+
+    // Check results in order and submit conversion and reflection for the successful ones.
+    bool compilation_succeeded = true;
+    for ( u32 i = 0; i < out_compilations.size; ++i ) {
+        ShaderStageCompilation& compilation = out_compilations[ i ];
+        if ( compilation.cached ) {
+            continue;
+        }
+
+        process_pool->wait( compilation.compile_job );
+
+        cstring process_output = compilation.compile_job->output;
+        compilation.succeeded = compilation.compile_job->succeeded() && !( process_output && strstr( process_output, "ERROR" ) );
+
+        if ( process_output ) {
+            hprint( "%s\n", process_output );
+        }
+
+        if ( !compilation.succeeded ) {
+            output_shader_compilation_error( compilation, process_output, filename_buffer );
+            filename_buffer.clear();
+
+            hprint( "\n>>>>>>> Compilation ERROR in shader %s, pass %u!\n\n", shader_name, compilation.pass_index );
+
+            compilation_succeeded = false;
+            continue;
+        }
+
+        // spirv-cross writes to stdout when no output file is specified.
+        if ( !spirv ) {
+            char* arguments = jobs_buffer.append_use_f( "spirv-cross.exe --version 450 --no-es %s", compilation.spirv_filename );
+            compilation.convert_job = process_pool->submit( ".", spirv_cross_path, arguments );
+        }
+
+        if ( needs_reflection ) {
+            char* arguments = jobs_buffer.append_use_f( "spirv-cross.exe %s --reflect", compilation.spirv_filename );
+            compilation.reflection_job = process_pool->submit( ".", spirv_cross_path, arguments );
+        }
+    }
+
+    // Collect final code.
+    for ( u32 i = 0; i < out_compilations.size; ++i ) {
+        ShaderStageCompilation& compilation = out_compilations[ i ];
+        if ( !compilation.succeeded || compilation.cached ) {
+            continue;
+        }
+
+        if ( compilation.reflection_job ) {
+            process_pool->wait( compilation.reflection_job );
+
+            const hydra::ProcessJob* reflection_job = compilation.reflection_job;
+            if ( reflection_job->output ) {
+                compilation.reflection.size = reflection_job->output_size;
+                compilation.reflection.data = ( char* )halloca( reflection_job->output_size + 1, parser->allocator );
+                memcpy( compilation.reflection.data, reflection_job->output, reflection_job->output_size );
+                compilation.reflection.data[ compilation.reflection.size ] = 0;
+            }
+        }
+
+        if ( spirv ) {
+            compilation.binary = hydra::file_read_binary( compilation.spirv_filename, parser->allocator );
+        } else {
+            process_pool->wait( compilation.convert_job );
+
+            const hydra::ProcessJob* convert_job = compilation.convert_job;
+            if ( convert_job->succeeded() && convert_job->output ) {
+                // Use binary version because in the append it will be memcopied.
+                compilation.binary.size = convert_job->output_size;
+                compilation.binary.data = ( char* )halloca( convert_job->output_size, parser->allocator );
+                memcpy( compilation.binary.data, convert_job->output, convert_job->output_size );
+            }
+        }
+
+        if ( compilation.binary.data == nullptr ) {
+            hprint( ">>>>>>> Cannot retrieve compiled code for shader %s, pass %u!\n", shader_name, compilation.pass_index );
+            compilation.succeeded = false;
+            compilation_succeeded = false;
+        } else if ( shader_cache_path ) {
+            char* temporary_filename = filename_buffer.append_use_f( "%s.hfxc", compilation.spirv_filename );
+            shader_cache_write( compilation.cache_filename, temporary_filename, compilation.binary, compilation.reflection );
+            filename_buffer.clear();
+        }
+
+        if ( !keep_intermediate ) {
+            hydra::file_delete( compilation.spirv_filename );
+        }
+    }
+
+    if ( compilation_succeeded ) {
+        hprint( ">>>>>>> Compilation successful!\n\n" );
+    }
+
+    return compilation_succeeded;
+}
+
+//
+// Release memory and jobs of the compiled stages.
+static void release_shader_stages( const CodeGenerator* code_generator, hydra::Array<ShaderStageCompilation>& compilations ) {
+    hydra::Allocator* allocator = code_generator->parser->allocator;
+    hydra::ProcessPool* process_pool = code_generator->process_pool;
+
+    for ( u32 i = 0; i < compilations.size; ++i ) {
+        ShaderStageCompilation& compilation = compilations[ i ];
+
+        // Jobs still running after an error must be completed before releasing them.
+        hydra::ProcessJob* jobs[] = { compilation.compile_job, compilation.convert_job, compilation.reflection_job };
+        for ( u32 j = 0; j < ArraySize( jobs ); ++j ) {
+            if ( jobs[ j ] ) {
+                process_pool->wait( jobs[ j ] );
+                process_pool->release( jobs[ j ] );
+            }
+        }
+
+        if ( compilation.binary.data ) {
+            hfree( compilation.binary.data, allocator );
+        }
+        if ( compilation.reflection.data ) {
+            hfree( compilation.reflection.data, allocator );
+        }
+        hfree( compilation.code, allocator );
+    }
+
+    compilations.clear();
+}
+
+//
+// Finalize and append code to a code string buffer.
+// For embedded code (into binary HFX), prepend the stage and null terminate.
+static bool append_finalized_shader_code( const char* path, const CodeGenerator* code_generator, const Pass::ShaderStage& shader_stage,
+                                          StringBuffer& filename_buffer, StringBuffer& code_buffer, const StringBuffer& constants_buffer,
+                                          StringBuffer* reflection_buffer, const StringRef* pass_name ) {
+
+    const Parser* parser = code_generator->parser;
+    // Cache current buffer size, use it to compose the shader.
+    uint32_t cached_buffer_size = code_buffer.current_size;
+
+    Stage stage = shader_stage.stage;
+    const CodeFragment* code_fragment = shader_stage.code;
+
+    // Append glsl version
+    code_buffer.append_f( "%s\n", "#version 450" );
+
+    // Add the per stage define.
+    code_buffer.append( s_shader_stage_defines[ stage ] );
+    code_buffer.append( "\n\t\t" );
+
+    // Append local constants
+    code_buffer.append( constants_buffer );
+
+    // Add the code straight from the HFX file.
+    code_buffer.append( "\n\t\t" );
+
+    Lexer lexer;
+    lexer_init( &lexer, code_fragment->code.text, nullptr );
+    char* current_line_start = lexer.position;
+    lexer_next_line( &lexer );
+    char* next_line_start = lexer.position;
+
+    char buffer[ 10000 ];
+
+    // Get first include to search
+    const CodeFragment::Include* include = code_fragment->includes.size() ? &code_fragment->includes[ 0 ] : nullptr;
+    u32 include_index = include ? 0 : u32_max;
+    u32 include_relative_line = include ? include->declaration_line - code_fragment->starting_file_line : u32_max;
+
+    // Perform line by line code write
+    while ( lexer.position - code_fragment->code.text < (i32)code_fragment->code.length ) {
+
+        if ( lexer.line == include_relative_line ) {
+            // Inject include code
+            append_include_code( *include, path, parser, stage, filename_buffer, code_buffer );
+            // Advance to next include if present
+            ++include_index;
+            if ( include_index < code_fragment->includes.size() ) {
+                include = &code_fragment->includes[ include_index ];
+                include_relative_line = include->declaration_line - code_fragment->starting_file_line;
+            }
+            else {
+                include_relative_line = u32_max;
+                include = nullptr;
+            }
+        }
+    
+        // Copy current line
         memcpy( buffer, current_line_start, next_line_start - current_line_start );
         // Append
         code_buffer.append_m( buffer, next_line_start - current_line_start );
@@ -2626,7 +3118,116 @@ static bool is_resources_layout_automatic( const Shader& shader, const Pass& pas
     return pass.resource_lists.size() == 0;
 }
 
-static void code_generator_generate_embedded_file_v2( CodeGenerator* code_generator, const char* output_filename ) {
+//
+// Fill the baked layout creation from the bindings. Names are pointers and are set when loading.
+static void resource_layout_blueprint_bake( ResourceLayoutBlueprint& layout, u32 set_index ) {
+    hydra::gfx::ResourceLayoutCreation& creation = layout.creation;
+    creation = hydra::gfx::ResourceLayoutCreation();
+    creation.set_index = set_index;
+    creation.num_bindings = layout.bindings.size;
+
+    // Hash only what defines the layout on the gpu, in the canonical form used by the device:
+    // names are debug only, missing binding points default to the binding index and count is always 1.
+    // Order is kept because resource lists address bindings by index.
+    u64 binding_keys[ hydra::gfx::k_max_resources_per_list ];
+    for ( u32 b = 0; b < creation.num_bindings; ++b ) {
+        const ResourceBinding& binding = layout.bindings[ b ];
+        hydra::gfx::ResourceLayoutCreation::Binding& out_binding = creation.bindings[ b ];
+        out_binding.type = binding.type;
+        out_binding.start = binding.start;
+        out_binding.count = binding.count;
+        out_binding.name = nullptr;
+
+        const u16 binding_point = binding.start == u16_max ? ( u16 )b : binding.start;
+        binding_keys[ b ] = ( ( u64 )binding.type << 32 ) | binding_point;
+    }
+
+    layout.hash = hydra::hash_bytes( binding_keys, creation.num_bindings * sizeof( u64 ), set_index );
+}
+
+//
+// Fill the baked pipeline creation from the pass data already written in the blob.
+static void pass_blueprint_bake_pipeline( ShaderPassBlueprint& pass ) {
+    hydra::gfx::PipelineCreation& pipeline = pass.pipeline;
+    pipeline = hydra::gfx::PipelineCreation();
+
+    hydra::gfx::ShaderStateCreation& shader_creation = pipeline.shaders;
+    shader_creation.reset().set_spv_input( pass.is_spirv );
+    for ( u32 s = 0; s < pass.shaders.size; ++s ) {
+        const ShaderCodeBlueprint& shader_code = pass.shaders[ s ];
+        // Code is set when loading.
+        shader_creation.add_stage( nullptr, shader_code.code.size, ( hydra::gfx::ShaderStage::Enum )shader_code.stage );
+    }
+
+    if ( pass.vertex_streams.size ) {
+        hydra::gfx::VertexInputCreation& vertex_input = pipeline.vertex_input;
+        vertex_input.num_vertex_attributes = pass.vertex_attributes.size;
+        vertex_input.num_vertex_streams = pass.vertex_streams.size;
+
+        memcpy( ( void* )vertex_input.vertex_attributes, pass.vertex_attributes.get(), sizeof( hydra::gfx::VertexAttribute ) * pass.vertex_attributes.size );
+        memcpy( ( void* )vertex_input.vertex_streams, pass.vertex_streams.get(), sizeof( hydra::gfx::VertexStream ) * pass.vertex_streams.size );
+    }
+
+    if ( pass.render_state.is_not_null() ) {
+        memcpy( &pipeline.rasterization, pass.render_state.get(), sizeof( hydra::gfx::RasterizationCreation ) + sizeof( hydra::gfx::DepthStencilCreation ) + sizeof( hydra::gfx::BlendStateCreation ) );
+    }
+
+    pipeline.num_active_layouts = pass.resource_layouts.size;
+}
+
+//
+// Exact blob size needed by code_generator_generate_embedded_file_v2: the blob memory cannot grow,
+// as the generation keeps pointers into it, and allocations past its end would return null.
+// Binaries shared between passes are counted for each use, automatic layouts for all the bindings.
+static sizet code_generator_embedded_file_v2_size( CodeGenerator* code_generator, const hydra::Array<ShaderStageCompilation>& stage_compilations ) {
+
+    const Shader& shader = code_generator->parser->shader;
+    const u32 pass_count = ( u32 )shader.passes.size();
+
+    sizet size = sizeof( ShaderEffectBlueprint ) + shader.name.length + 1 + pass_count * sizeof( ShaderPassBlueprint );
+
+    for ( u32 i = 0; i < pass_count; ++i ) {
+        const Pass& pass = shader.passes[ i ];
+
+        size += pass.shader_stages.size() * sizeof( ShaderCodeBlueprint );
+
+        if ( pass.variant_key == 0 && pass.variant_keywords.size() ) {
+            size += ( ( sizet )1 << pass.variant_keywords.size() ) * sizeof( u16 );
+        }
+
+        if ( pass.render_state ) {
+            size += sizeof( RenderStateBlueprint );
+        }
+
+        if ( pass.vertex_layout ) {
+            size += pass.vertex_layout->attributes.size() * sizeof( hydra::gfx::VertexAttribute );
+            size += pass.vertex_layout->streams.size() * sizeof( hydra::gfx::VertexStream );
+        }
+
+        const bool automatic_layout = is_resources_layout_automatic( shader, pass );
+        const sizet num_layouts = pass.resource_lists.size();
+        size += ( num_layouts + ( automatic_layout ? 1 : 0 ) ) * sizeof( ResourceLayoutBlueprint );
+
+        for ( sizet l = 0; l < num_layouts; ++l ) {
+            const ResourceList* resource_list = ( const ResourceList* )pass.resource_lists[ l ];
+            size += resource_list->resources.size() * sizeof( ResourceBinding );
+        }
+
+        if ( automatic_layout ) {
+            size += 32 * sizeof( ResourceBinding );
+        }
+    }
+
+    for ( u32 c = 0; c < stage_compilations.size; ++c ) {
+        size += stage_compilations[ c ].binary.size;
+    }
+
+    return size;
+}
+
+//
+// Returns true if the binary and the generated files were written.
+static bool code_generator_generate_embedded_file_v2( CodeGenerator* code_generator, const char* output_filename ) {
 
     // Alias for string buffers used in the process.
     StringBuffer& filename_buffer = code_generator->string_buffers[ 0 ];
@@ -2652,28 +3253,49 @@ static void code_generator_generate_embedded_file_v2( CodeGenerator* code_genera
     // Calculate input path
     const char* input_path = code_generator->parser->source_path;
 
+    // Output files only if compilation has succeded.
+    bool compilation_succeeded = true;
+
+    const uint32_t pass_count = ( uint32_t )code_generator->parser->shader.passes.size();
+
+    const bool generate_reflection_data = ( ( compile_options & CompileOptions_Reflection_CPP ) == CompileOptions_Reflection_CPP ) ||
+                                          ( ( compile_options & CompileOptions_Reflection_Reload ) == CompileOptions_Reflection_Reload );
+    code_generator->generate_reflection_data = generate_reflection_data;
+
+    // Compile all the stages upfront, concurrently.
+    hydra::Array<ShaderStageCompilation> stage_compilations;
+    stage_compilations.init( code_generator->parser->allocator, 16 );
+
+    StringBuffer jobs_buffer;
+    jobs_buffer.init( 2048 + pass_count * Stage::Count * 6 * 512, code_generator->parser->allocator );
+
+    compilation_succeeded = compile_shader_stages( input_path, code_generator, stage_compilations, jobs_buffer, filename_buffer, shader_code_buffer, constants_buffer );
+    u32 stage_compilation_index = 0;
+
     hydra::BlobSerializer blob;
     blob.is_reading = false;
-    ShaderEffectBlueprint* hfx_blueprint = blob.write_and_prepare<ShaderEffectBlueprint>( code_generator->parser->allocator, 0, 1024 * 1024 );
+    const sizet blob_size = code_generator_embedded_file_v2_size( code_generator, stage_compilations );
+    ShaderEffectBlueprint* hfx_blueprint = blob.write_and_prepare<ShaderEffectBlueprint>( code_generator->parser->allocator, ShaderEffectBlueprint::k_version, blob_size );
     
     // Copy binary header magic
     memcpy( hfx_blueprint->binary_header_magic, code_generator->binary_header_magic, 32 );
     blob.allocate_and_set( hfx_blueprint->name, code_generator->parser->shader.name.text, ( u32 )code_generator->parser->shader.name.length );
 
-    // Output files only if compilation has succeded.
-    bool compilation_succeeded = true;
-
-    const uint32_t pass_count = ( uint32_t )code_generator->parser->shader.passes.size();
     blob.allocate_and_set( hfx_blueprint->passes, pass_count );
 
-    const bool generate_reflection_data = ( ( compile_options & CompileOptions_Reflection_CPP ) == CompileOptions_Reflection_CPP ) ||
-                                          ( ( compile_options & CompileOptions_Reflection_Reload ) == CompileOptions_Reflection_Reload );
-    code_generator->generate_reflection_data = generate_reflection_data;
+    // Identical binaries, common between variants, are written once and shared by all the passes using them.
+    hydra::Array<ShaderBinaryEntry> shader_binaries;
+    shader_binaries.init( code_generator->parser->allocator, 16 );
+    hydra::FlatHashMap<u64, u32> binary_hash_to_index;
+    binary_hash_to_index.init( code_generator->parser->allocator, 16 );
+    binary_hash_to_index.set_default_value( u32_max );
+    u32 shared_binaries_count = 0;
 
     char* reflection_filename = nullptr;
 
     if ( generate_reflection_data ) {
         const char* shader_name = filename_buffer.append_use( code_generator->parser->shader.name );
+        reflection_buffer.append( "// This file is autogenerated!\n#pragma once\n\n#include <stddef.h>\n\n" );
         reflection_buffer.append_f( "namespace %s {\n", shader_name );
         reflection_buffer.append_f( "\n\tstatic hydra::gfx::ResourceListCreation tables[ %u ];\n\n", pass_count );
 
@@ -2692,7 +3314,7 @@ static void code_generator_generate_embedded_file_v2( CodeGenerator* code_genera
     hfx::ResourceBinding pass_bindings[ 32 ];
 
     // For each pass
-    for ( uint32_t i = 0; i < pass_count; i++ ) {
+    for ( uint32_t i = 0; i < pass_count && compilation_succeeded; i++ ) {
 
         const Pass& pass = code_generator->parser->shader.passes[ i ];
         const uint32_t pass_shader_stages = ( uint32_t )pass.shader_stages.size();
@@ -2708,6 +3330,28 @@ static void code_generator_generate_embedded_file_v2( CodeGenerator* code_genera
         char* pass_name_C = filename_buffer.append_use( pass.name );
         reflection_buffer.append_f( "\tnamespace %s {\n", pass_name_C );
 
+        // Variant table is stored in the declaring pass: the variant key directly indexes the pass to use.
+        pass_blueprint.variant_key = ( u16 )pass.variant_key;
+        const u32 variant_keyword_count = ( u32 )pass.variant_keywords.size();
+        if ( pass.variant_key == 0 && variant_keyword_count ) {
+            const u32 variant_count = 1 << variant_keyword_count;
+            blob.allocate_and_set( pass_blueprint.variant_passes, variant_count );
+
+            pass_blueprint.variant_passes[ 0 ] = ( u16 )i;
+            for ( u32 key = 1; key < variant_count; ++key ) {
+                pass_blueprint.variant_passes[ key ] = ( u16 )( pass.variant_first_pass + key - 1 );
+            }
+
+            for ( u32 k = 0; k < variant_keyword_count; ++k ) {
+                reflection_buffer.append( "\t\tstatic const uint32_t variant_" );
+                reflection_buffer.append( pass.variant_keywords[ k ] );
+                reflection_buffer.append_f( " = %u;\n", 1 << k );
+            }
+        }
+        else {
+            pass_blueprint.variant_passes.set_empty();
+        }
+
         pass_blueprint.compute_dispatch = pass.compute_dispatch;
         pass_blueprint.is_spirv = ( ( code_generator->options & CompileOptions_SpirV ) == CompileOptions_SpirV ) ? 1 : 0;
 
@@ -2727,47 +3371,48 @@ static void code_generator_generate_embedded_file_v2( CodeGenerator* code_genera
                 continue;
             }
 
-            shader_code_buffer.clear();
-            finalize_shader_code( input_path, code_generator, shader_stage, constants_buffer, filename_buffer, shader_code_buffer );
+            // Compilations are stored in the same order as passes and stages.
+            const ShaderStageCompilation& compilation = stage_compilations[ stage_compilation_index++ ];
 
-            char* compiled_filename = compile_shader( input_path, code_generator, shader_stage, filename_buffer, shader_code_buffer, 0 );
-            compilation_succeeded = compilation_succeeded && ( compiled_filename != nullptr );
-
-            if ( !compilation_succeeded ) {
-                break;
-            }
-            // From here code compilation is successful.
-            
             if ( generate_reflection_data ) {
-                char* spirv_cross_path = filename_buffer.append_use_f( "%sspirv-cross.exe", code_generator->shader_binaries_path );
-                reflection_filename = filename_buffer.append_use_f( "%s.json", compiled_filename );
-                char* arguments = filename_buffer.append_use_f( "spirv-cross.exe %s --reflect --output %s", compiled_filename, reflection_filename );
-                hydra::process_execute( ".", spirv_cross_path, arguments );
-
-                // Open generated reflection json file.
+                // Reflection json comes from spirv-cross stdout or from the shader cache.
                 using json = nlohmann::json;
-                char* reflection_json_memory = hydra::file_read_text( reflection_filename, code_generator->parser->allocator, nullptr );
-                json reflection_json = json::parse( reflection_json_memory );
+                json reflection_json = json::parse( compilation.reflection.data ? compilation.reflection.data : "{}" );
 
                 // Search binding points from reflection data
                 append_reflection_data( reflection_json, s_shader_compiler_stage[ shader_stage.stage ], &reflection_buffer, code_generator->name_to_type,
                                         filename_buffer, pass_bindings, code_generator->parser->allocator );
 
-                if ( ( compile_options & CompileOptions_Output_Files ) != CompileOptions_Output_Files )
-                    hydra::file_delete( reflection_filename );
+                if ( keep_intermediate && compilation.reflection.data ) {
+                    reflection_filename = filename_buffer.append_use_f( "%s.json", compilation.spirv_filename );
+                    hydra::file_write_binary( reflection_filename, compilation.reflection.data, compilation.reflection.size );
+                }
             }
 
-            // Read output file and write it into the blob.
-            hydra::FileReadResult file = hydra::file_read_binary( compiled_filename, code_generator->parser->allocator );
-
             ShaderCodeBlueprint& shader_blueprint = pass_blueprint.shaders[ s ];
             shader_blueprint.stage = (u8)shader_stage.stage;
-            blob.allocate_and_set( shader_blueprint.code, (u32)file.size, file.data );
 
-            hfree( file.data, code_generator->parser->allocator );
+            // Variants often produce the same code for stages not using their defines.
+            const u64 binary_hash = hydra::hash_bytes( compilation.binary.data, compilation.binary.size );
+            const u32 binary_index = binary_hash_to_index.get( binary_hash );
+            const ShaderBinaryEntry* shared_binary = binary_index != u32_max ? &shader_binaries[ binary_index ] : nullptr;
+
+            if ( shared_binary && shared_binary->stage == shader_blueprint.stage && shared_binary->size == compilation.binary.size &&
+                 memcmp( shared_binary->data, compilation.binary.data, shared_binary->size ) == 0 ) {
+                shader_blueprint.code.set( shared_binary->data, shared_binary->size );
+                ++shared_binaries_count;
+            }
+            else {
+                blob.allocate_and_set( shader_blueprint.code, (u32)compilation.binary.size, compilation.binary.data );
+
+                if ( binary_index == u32_max ) {
+                    binary_hash_to_index.insert( binary_hash, shader_binaries.size );
 
-            if ( !keep_intermediate ) {
-                hydra::file_delete( compiled_filename );
+                    ShaderBinaryEntry& binary_entry = shader_binaries.push_use();
+                    binary_entry.data = ( char* )shader_blueprint.code.get();
+                    binary_entry.size = ( u32 )compilation.binary.size;
+                    binary_entry.stage = shader_blueprint.stage;
+                }
             }
         }
 
@@ -2814,7 +3459,7 @@ static void code_generator_generate_embedded_file_v2( CodeGenerator* code_genera
         if ( num_layouts == 0 ) {
             hprint( "Error in shader %s, pass %s: there are no layouts defined!\n", output_filename, pass_name_c );
         }
-        blob.allocate_and_set<ResourceLayoutBlueprint>( pass_blueprint.resource_layouts, num_layouts + automatic_layout ? 1 : 0 );
+        blob.allocate_and_set<ResourceLayoutBlueprint>( pass_blueprint.resource_layouts, num_layouts + ( automatic_layout ? 1 : 0 ) );
         for ( u32 l = 0; l < num_layouts; ++l ) {
             ResourceList* resource_list = (ResourceList*)pass.resource_lists[ l ];
 
@@ -2834,6 +3479,7 @@ static void code_generator_generate_embedded_file_v2( CodeGenerator* code_genera
 
             ResourceLayoutBlueprint& resource_layout_blueprint = pass_blueprint.resource_layouts[ l ];
             blob.allocate_and_set<ResourceBinding>( resource_layout_blueprint.bindings, num_resources, (void*)resource_list->resources.data() );
+            resource_layout_blueprint_bake( resource_layout_blueprint, l );
         }
 
         // Output Table to quickly setup resources
@@ -2893,11 +3539,25 @@ static void code_generator_generate_embedded_file_v2( CodeGenerator* code_genera
 
             ResourceLayoutBlueprint& resource_layout_blueprint = pass_blueprint.resource_layouts[ num_layouts ];
             blob.allocate_and_set<ResourceBinding>( resource_layout_blueprint.bindings, (u32)automatic_resource_list.resources.size(), ( void* )automatic_resource_list.resources.data() );
+            resource_layout_blueprint_bake( resource_layout_blueprint, num_layouts );
         }
 
+        pass_blueprint_bake_pipeline( pass_blueprint );
+
         reflection_buffer.append_f( "\t} // pass %s\n\n", pass_name_c );
     }
 
+    if ( shared_binaries_count ) {
+        hprint( "Shared %u identical shader binaries between passes.\n", shared_binaries_count );
+    }
+
+    binary_hash_to_index.shutdown();
+    shader_binaries.shutdown();
+
+    release_shader_stages( code_generator, stage_compilations );
+    stage_compilations.shutdown();
+    jobs_buffer.shutdown();
+
 
     // Output to HFX and generated c++ file if compilation is good
     if ( compilation_succeeded ) {
@@ -2909,9 +3569,10 @@ static void code_generator_generate_embedded_file_v2( CodeGenerator* code_genera
             if ( !hydra::directory_exists( code_generator->cpp_generated_folder ) ) {
                 hprint( "Directory %s does not exists! Creating it.\n", code_generator->cpp_generated_folder );
 
-                if ( !hydra::directory_create( code_generator->cpp_generated_folder ) ) {
+                if ( !hydra::directory_create( code_generator->cpp_generated_folder ) && !hydra::directory_exists( code_generator->cpp_generated_folder ) ) {
                     hprint( "Error creating directory %s! Cannot output generated shader generated file. Quitting.\n", code_generator->cpp_generated_folder );
-                    return;
+                    blob.shutdown();
+                    return false;
                 }
             }
 
@@ -2952,6 +3613,8 @@ static void code_generator_generate_embedded_file_v2( CodeGenerator* code_genera
         hprint( "DAK\n" );
     }
 #endif
+
+    return compilation_succeeded;
 }
 //
 //
@@ -3372,74 +4035,180 @@ void code_generator_generate_shader_cpp_header( CodeGenerator* code_generator, c
 
 static const size_t                 k_hfx_random_seed = 0xfeba666ddea21a46;
 
+// Dependency files /////////////////////////////////////////////////////////////
+
+static const char*                  k_dependency_file_header = "hfx_dependencies 1";
+
 //
+// Written next to each output as 'output_filename.hfxdeps'. Contains the parameters needed to compile it again
+// and all the files consumed with the hash of their content. Text format, one 'key value' per line:
+// input, output, options, cpp and then one 'dependency hash path' line per file.
+struct DependencyFile {
+
+    char                            input_filename[ 512 ];
+    char                            output_filename[ 512 ];
+    char                            cpp_generated_folder[ 512 ];
+    u32                             options;
+
+}; // struct DependencyFile
+
 //
-bool hfx_compile( const char* input_filename, const char* output_filename, u32 options, cstring cpp_generated_folder, bool force_rebuild ) {
+//
+static void dependency_file_write( cstring output_filename, cstring input_filename, u32 options, cstring cpp_generated_folder,
+                                   const hydra::Array<Dependency>& dependencies ) {
+    char dependency_filename[ 512 ];
+    snprintf( dependency_filename, 512, "%s.hfxdeps", output_filename );
+
+    FILE* file = fopen( dependency_filename, "w" );
+    if ( file == nullptr ) {
+        hprint( "Cannot write dependency file %s.\n", dependency_filename );
+        return;
+    }
+
+    fprintf( file, "%s\n", k_dependency_file_header );
+    fprintf( file, "input %s\n", input_filename );
+    fprintf( file, "output %s\n", output_filename );
+    fprintf( file, "options %x\n", options );
+    fprintf( file, "cpp %s\n", cpp_generated_folder ? cpp_generated_folder : "" );
+
+    for ( u32 i = 0; i < dependencies.size; ++i ) {
+        fprintf( file, "dependency %016llx %s\n", dependencies[ i ].hash, dependencies[ i ].path );
+    }
+
+    fclose( file );
+}
+
+//
+// Returns true if all the files listed in the dependency file still have the same content.
+// Optionally fills out_file with the compilation parameters and out_dependencies with the listed files.
+static bool dependency_file_check( cstring dependency_filename, DependencyFile* out_file, FileContentCache* file_cache, hydra::Allocator* allocator,
+                                   hydra::Array<Dependency>* out_dependencies = nullptr ) {
+
+    char* text = hydra::file_read_text( dependency_filename, allocator, nullptr );
+    if ( text == nullptr ) {
+        return false;
+    }
+
+    bool up_to_date = strncmp( text, k_dependency_file_header, strlen( k_dependency_file_header ) ) == 0;
+    bool has_dependencies = false;
+
+    char* line = text;
+    while ( line && *line ) {
+        char* line_end = strchr( line, '\n' );
+        if ( line_end ) {
+            *line_end = 0;
+        }
+
+        // Key and value are separated by the first space. Paths can contain spaces, so they are always the last element.
+        char* value = strchr( line, ' ' );
+        if ( value ) {
+            *value++ = 0;
+
+            if ( strcmp( line, "dependency" ) == 0 ) {
+                has_dependencies = true;
+
+                // Stop hashing files at the first change.
+                if ( up_to_date ) {
+                    char* path = nullptr;
+                    const u64 saved_hash = strtoull( value, &path, 16 );
+                    path = ( path && *path == ' ' ) ? path + 1 : path;
+
+                    u64 hash = 0;
+                    up_to_date = path && dependency_hash_file( path, file_cache, allocator, hash ) && hash == saved_hash;
+
+                    if ( up_to_date && out_dependencies ) {
+                        Dependency& dependency = out_dependencies->push_use();
+                        strncpy( dependency.path, path, ArraySize( dependency.path ) - 1 );
+                        dependency.path[ ArraySize( dependency.path ) - 1 ] = 0;
+                        dependency.hash = hash;
+                    }
+                }
+            } else if ( out_file ) {
+                if ( strcmp( line, "input" ) == 0 ) {
+                    strncpy( out_file->input_filename, value, 511 );
+                } else if ( strcmp( line, "output" ) == 0 ) {
+                    strncpy( out_file->output_filename, value, 511 );
+                } else if ( strcmp( line, "cpp" ) == 0 ) {
+                    strncpy( out_file->cpp_generated_folder, value, 511 );
+                } else if ( strcmp( line, "options" ) == 0 ) {
+                    out_file->options = ( u32 )strtoul( value, nullptr, 16 );
+                }
+            }
+        }
+
+        line = line_end ? line_end + 1 : nullptr;
+    }
+
+    hfree( text, allocator );
+
+    return up_to_date && has_dependencies;
+}
+
+//
+// Process pool is optional, if null a dedicated one is created when compilation is needed.
+static bool hfx_compile_internal( const char* input_filename, const char* output_filename, u32 options, cstring cpp_generated_folder, bool force_rebuild,
+                                  hydra::ProcessPool* process_pool, FileContentCache* file_cache ) {
 
     hydra::MallocAllocator heap_allocator;
 
-    char* text = hydra::file_read_text( input_filename, &heap_allocator, nullptr );
+    // Cached text is owned by the cache.
+    const FileContent* cached_content = file_cache ? file_cache->read( input_filename ) : nullptr;
+    char* text = file_cache ? ( cached_content ? cached_content->text : nullptr ) : hydra::file_read_text( input_filename, &heap_allocator, nullptr );
     if ( !text ) {
         HYDRA_LOG( "Error compiling file %s: file not found.\n", input_filename );
         return false;
     }
 
-#if defined(HY_STB)
-    set_rand_seed( k_hfx_random_seed );
-    size_t source_file_hash = hash_string( text, k_hfx_random_seed );
-#else
-    size_t source_file_hash = 0;
-#endif // HY_STB
+    // Header magic identifies the source content and the options used to generate the binary,
+    // so that touching the file or checking it out again does not trigger a compilation.
+    const u64 source_file_hash = hydra::hash_bytes( text, strlen( text ), k_hfx_random_seed );
 
-    hydra::FileTime file_time = hydra::file_last_write_time( input_filename );
+    char binary_header_magic[ 32 ];
+    memset( binary_header_magic, 0, 32 );
+    memcpy( binary_header_magic, &source_file_hash, sizeof( u64 ) );
+    memcpy( &binary_header_magic[ sizeof( u64 ) ], &options, sizeof( u32 ) );
+    // Binaries with an older layout are generated again.
+    const u32 blueprint_version = ShaderEffectBlueprint::k_version;
+    memcpy( &binary_header_magic[ sizeof( u64 ) + sizeof( u32 ) ], &blueprint_version, sizeof( u32 ) );
 
     // Check if the binary was generated from the same file.
     // If so do not compile.
     if ( !force_rebuild && hydra::file_exists( output_filename ) ) {
 
-#if defined HFX_V2
-        static const u32 binary_header_size = 32 + sizeof( hydra::BlobHeader );
-        char binary_header_magic[ binary_header_size ];
+        char saved_header_magic[ 32 ];
+        memset( saved_header_magic, 0, 32 );
 
         hydra::FileHandle file;
         hydra::file_open( output_filename, "rb", &file );
-        
-        fread( binary_header_magic, binary_header_size, 1, file );
-        hydra::file_close( file );
-
-        // Get the file time from the header
-        hydra::FileTime saved_filetime;
-        memcpy( &saved_filetime, binary_header_magic + sizeof(hydra::BlobHeader), sizeof( hydra::FileTime ) );
-
-        if ( file_time.dwHighDateTime == saved_filetime.dwHighDateTime &&
-             file_time.dwLowDateTime == saved_filetime.dwLowDateTime ) {
-
-            hfree( text, &heap_allocator );
-            // TODO memory (not anymore) Allocator still has allocations from hfx_memory.
+#if defined HFX_V2
+        static const u32 binary_header_size = 32 + sizeof( hydra::BlobHeader );
+        char binary_header[ binary_header_size ];
 
-            return false;
+        if ( file && fread( binary_header, binary_header_size, 1, file ) == 1 ) {
+            memcpy( saved_header_magic, binary_header + sizeof( hydra::BlobHeader ), 32 );
         }
 #else
         ShaderEffectFile::Header file_header;
 
-        hydra::FileHandle file;
-        hydra::file_open( output_filename, "rb", &file );
-        fread( &file_header, sizeof( ShaderEffectFile::Header ), 1, file );
+        if ( file && fread( &file_header, sizeof( ShaderEffectFile::Header ), 1, file ) == 1 ) {
+            memcpy( saved_header_magic, file_header.binary_header_magic, 32 );
+        }
+#endif // HFX_V2
         hydra::file_close( file );
 
-        // Get the file time from the header
-        hydra::FileTime saved_filetime;
-        memcpy( &saved_filetime, file_header.binary_header_magic, sizeof( hydra::FileTime ) );
+        // Included files are checked through the dependency file.
+        char dependency_filename[ 512 ];
+        snprintf( dependency_filename, 512, "%s.hfxdeps", output_filename );
 
-        if ( file_time.dwHighDateTime == saved_filetime.dwHighDateTime &&
-             file_time.dwLowDateTime == saved_filetime.dwLowDateTime ) {
+        if ( memcmp( binary_header_magic, saved_header_magic, 32 ) == 0 && dependency_file_check( dependency_filename, nullptr, file_cache, &heap_allocator ) ) {
 
-            hfree( text, &heap_allocator );
+            if ( file_cache == nullptr ) {
+                hfree( text, &heap_allocator );
+            }
             // TODO memory (not anymore) Allocator still has allocations from hfx_memory.
 
             return false;
         }
-#endif // HFX_V2            
     }
 
     Lexer lexer;
@@ -3455,7 +4224,8 @@ bool hfx_compile( const char* input_filename, const char* output_filename, u32 o
 
     if ( !hydra::directory_exists( output_path ) ) {
         hprint( "Output directory does not exists, creating it.\n", output_path );
-        if ( !hydra::directory_create( output_path ) ) {
+        // Another file compiled concurrently could have created it in the meantime.
+        if ( !hydra::directory_create( output_path ) && !hydra::directory_exists( output_path ) ) {
             hprint( "Problems creating output path %s. Quitting.\n", output_path );
             return false;
         }
@@ -3468,17 +4238,23 @@ bool hfx_compile( const char* input_filename, const char* output_filename, u32 o
     hprint( "S %s\n", text );
 #endif 
 
+    // Record all the files consumed to generate the output.
+    hydra::Array<Dependency> dependencies;
+    dependencies.init( &heap_allocator, 16 );
+
     Parser parser;
     parser_init( &parser, &lexer, &heap_allocator, input_path, input_filename, output_path );
+    parser.dependencies = &dependencies;
+    parser.file_cache = file_cache;
+    parser_add_dependency( &parser, input_filename );
+
     parser_generate_ast( &parser );
 
     CodeGenerator code_generator;
     code_generator_init( &code_generator, &parser, 256 * 1024, 9 );
 
-    // Cache source file time
-    memcpy( code_generator.binary_header_magic, &file_time, sizeof( hydra::FileTime ) );
     // Init header magic
-    memcpy( &code_generator.binary_header_magic[sizeof( hydra::FileTime )], &source_file_hash, sizeof( size_t ) );
+    memcpy( code_generator.binary_header_magic, binary_header_magic, 32 );
 
     // Prepare environment for compilation.
     hydra::StringBuffer& filename_buffer = code_generator.string_buffers[0];
@@ -3496,6 +4272,16 @@ bool hfx_compile( const char* input_filename, const char* output_filename, u32 o
     code_generator.source_folder_path = code_generator.path_buffer.append_use_f( "%s", input_path );
     code_generator.destination_folder_path = code_generator.path_buffer.append_use_f( "%s", output_path );
 
+    if ( ( options & CompileOptions_No_Cache ) == 0 ) {
+        char* shader_cache_path = code_generator.path_buffer.append_use_f( "%s\\hfx_cache", output_path );
+        // Folder can be created concurrently by another compilation.
+        if ( hydra::directory_exists( shader_cache_path ) || hydra::directory_create( shader_cache_path ) || hydra::directory_exists( shader_cache_path ) ) {
+            code_generator.shader_cache_path = code_generator.path_buffer.append_use_f( "%s\\", shader_cache_path );
+        } else {
+            hprint( "Cannot create shader cache folder %s, compiling without cache.\n", shader_cache_path );
+        }
+    }
+
     // Clear buffer to be used inside compilation.
     filename_buffer.clear();
 
@@ -3507,18 +4293,39 @@ bool hfx_compile( const char* input_filename, const char* output_filename, u32 o
         code_generator.options |= CompileOptions_SpirV;
     }
 
+    // Shader stages are compiled by external processes running concurrently.
+    hydra::ProcessPool local_process_pool;
+    if ( process_pool == nullptr ) {
+        local_process_pool.init( &heap_allocator );
+        process_pool = &local_process_pool;
+    }
+    code_generator.process_pool = process_pool;
+
+    bool generated = true;
     if ( (options & CompileOptions_Embedded) == CompileOptions_Embedded ) {
         //hfx::code_generator_generate_embedded_file( &code_generator, output_filename );
         // Test new hfx binary
-        hfx::code_generator_generate_embedded_file_v2( &code_generator, output_filename );
+        generated = hfx::code_generator_generate_embedded_file_v2( &code_generator, output_filename );
     }
     else {
         hfx::code_generator_output_shader_files( &code_generator, output_filename );
     }
     
+    if ( process_pool == &local_process_pool ) {
+        local_process_pool.shutdown();
+    }
+
+    // Without a dependency file the output is considered out of date, so failed compilations are retried.
+    if ( generated ) {
+        dependency_file_write( output_filename, input_filename, options, cpp_generated_folder, dependencies );
+    }
+    dependencies.shutdown();
+
     hfx::parser_terminate( &parser );
     hfx::code_generator_terminate( &code_generator );
-    hfree( text, &heap_allocator );
+    if ( file_cache == nullptr ) {
+        hfree( text, &heap_allocator );
+    }
 
     // Optional: init the shader effect if present
     // TODO memory: this is causing memory leaks.
@@ -3532,6 +4339,707 @@ bool hfx_compile( const char* input_filename, const char* output_filename, u32 o
     return true;
 }
 
+//
+//
+bool hfx_compile( const char* input_filename, const char* output_filename, u32 options, cstring cpp_generated_folder, bool force_rebuild ) {
+    return hfx_compile_internal( input_filename, output_filename, options, cpp_generated_folder, force_rebuild, nullptr, nullptr );
+}
+
+//
+//
+struct CompileBatchContext {
+    CompileRequest*                 requests;
+    u32                             num_requests;
+    hydra::ProcessPool*             process_pool;
+
+    volatile i32                    next_request;
+    volatile i32                    compiled_count;
+}; // struct CompileBatchContext
+
+//
+//
+static void hfx_compile_batch_worker( void* user_data ) {
+    CompileBatchContext* context = ( CompileBatchContext* )user_data;
+
+    for ( ;; ) {
+        const i32 request_index = hydra::atomic_increment( &context->next_request ) - 1;
+        if ( request_index >= ( i32 )context->num_requests ) {
+            break;
+        }
+
+        CompileRequest& request = context->requests[ request_index ];
+        request.compiled = hfx_compile_internal( request.input_filename, request.output_filename, request.options, request.cpp_generated_folder,
+                                                 request.force_rebuild, context->process_pool, nullptr );
+        if ( request.compiled ) {
+            hydra::atomic_increment( &context->compiled_count );
+        }
+    }
+}
+
+//
+//
+u32 hfx_compile_batch( CompileRequest* requests, u32 num_requests, u32 max_processes ) {
+    if ( num_requests == 0 ) {
+        return 0;
+    }
+
+    hydra::MallocAllocator heap_allocator;
+
+    // Synchronous log is not thread safe: use the asynchronous one while compiling.
+    hydra::LogService* log_service = hydra::LogService::instance();
+    const bool enable_async_log = !log_service->async_enabled;
+    if ( enable_async_log ) {
+        hydra::LogConfiguration log_configuration;
+        log_configuration.allocator = &heap_allocator;
+        log_service->init( &log_configuration );
+    }
+
+    hydra::ProcessPool process_pool;
+    process_pool.init( &heap_allocator, max_processes );
+
+    CompileBatchContext context;
+    context.requests = requests;
+    context.num_requests = num_requests;
+    context.process_pool = &process_pool;
+    context.next_request = 0;
+    context.compiled_count = 0;
+
+    // Parsing and code generation run on their own threads, the calling thread included.
+    // Concurrent compiler processes are bounded by the pool.
+    static constexpr u32 k_max_compile_threads = 16;
+    u32 num_threads = hydra::min( num_requests, process_pool.num_workers );
+    num_threads = hydra::min( num_threads, k_max_compile_threads );
+
+    hydra::Thread threads[ k_max_compile_threads ];
+    for ( u32 i = 1; i < num_threads; ++i ) {
+        hydra::thread_create( threads[ i ], hfx_compile_batch_worker, &context, "hfx_compile" );
+    }
+
+    hfx_compile_batch_worker( &context );
+
+    for ( u32 i = 1; i < num_threads; ++i ) {
+        hydra::thread_join( threads[ i ] );
+    }
+
+    process_pool.shutdown();
+
+    if ( enable_async_log ) {
+        log_service->shutdown();
+    }
+
+    return ( u32 )context.compiled_count;
+}
+
+//
+//
+u32 hfx_build_outdated( cstring output_folder, u32 max_processes ) {
+
+    hydra::MallocAllocator heap_allocator;
+
+    char path_buffer[ 512 ];
+    snprintf( path_buffer, 512, "%s\\*.hfxdeps", output_folder );
+
+    hydra::StringArray dependency_filenames;
+    dependency_filenames.init( 4096, &heap_allocator );
+    hydra::file_find_files_in_path( path_buffer, dependency_filenames );
+
+    const u32 num_outputs = ( u32 )dependency_filenames.get_string_count();
+
+    hydra::Array<DependencyFile> outdated_files;
+    outdated_files.init( &heap_allocator, num_outputs );
+
+    hydra::FlatHashMapIterator* it = dependency_filenames.begin_string_iteration();
+    while ( dependency_filenames.has_next_string( it ) ) {
+        cstring dependency_filename = dependency_filenames.get_next_string( it );
+        snprintf( path_buffer, 512, "%s\\%s", output_folder, dependency_filename );
+
+        DependencyFile& dependency_file = outdated_files.push_use();
+        memset( &dependency_file, 0, sizeof( DependencyFile ) );
+
+        if ( dependency_file_check( path_buffer, &dependency_file, nullptr, &heap_allocator ) || dependency_file.input_filename[ 0 ] == 0 ) {
+            outdated_files.pop();
+        }
+    }
+
+    hprint( "HFX: %u of %u outputs to rebuild in %s.\n", outdated_files.size, num_outputs, output_folder );
+
+    hydra::Array<CompileRequest> requests;
+    requests.init( &heap_allocator, outdated_files.size );
+
+    for ( u32 i = 0; i < outdated_files.size; ++i ) {
+        const DependencyFile& dependency_file = outdated_files[ i ];
+
+        CompileRequest& request = requests.push_use();
+        request = CompileRequest();
+        request.input_filename = dependency_file.input_filename;
+        request.output_filename = dependency_file.output_filename;
+        request.options = dependency_file.options;
+        request.cpp_generated_folder = dependency_file.cpp_generated_folder[ 0 ] ? dependency_file.cpp_generated_folder : nullptr;
+        // Already known to be out of date.
+        request.force_rebuild = true;
+    }
+
+    const u32 compiled = hfx_compile_batch( requests.data, requests.size, max_processes );
+
+    snprintf( path_buffer, 512, "%s\\%s", output_folder, k_layout_table_filename );
+    if ( compiled || !hydra::file_exists( path_buffer ) ) {
+        hfx_generate_layout_table( output_folder, path_buffer );
+    }
+
+    requests.shutdown();
+    outdated_files.shutdown();
+    dependency_filenames.shutdown();
+
+    return compiled;
+}
+
+//
+//
+u32 hfx_generate_layout_table( cstring output_folder, cstring table_filename ) {
+
+    hydra::MallocAllocator heap_allocator;
+
+    char path_buffer[ 512 ];
+    snprintf( path_buffer, 512, "%s\\*.hfxdeps", output_folder );
+
+    hydra::StringArray dependency_filenames;
+    dependency_filenames.init( 4096, &heap_allocator );
+    hydra::file_find_files_in_path( path_buffer, dependency_filenames );
+
+    // Outputs are kept loaded until the table is written, layouts point into them.
+    hydra::Array<hydra::FileReadResult> outputs;
+    outputs.init( &heap_allocator, 16 );
+    hydra::Array<const ResourceLayoutBlueprint*> unique_layouts;
+    unique_layouts.init( &heap_allocator, 64 );
+    hydra::FlatHashMap<u64, u32> hash_to_layout;
+    hash_to_layout.init( &heap_allocator, 64 );
+    hash_to_layout.set_default_value( u32_max );
+
+    u32 total_layouts = 0;
+    u32 total_bindings = 0;
+
+    hydra::FlatHashMapIterator* it = dependency_filenames.begin_string_iteration();
+    while ( dependency_filenames.has_next_string( it ) ) {
+        cstring dependency_filename = dependency_filenames.get_next_string( it );
+        // Dependency file is written next to the output, as 'output_filename.hfxdeps'.
+        snprintf( path_buffer, 512, "%s\\%s", output_folder, dependency_filename );
+        char* extension = strstr( path_buffer, ".hfxdeps" );
+        if ( extension ) {
+            *extension = 0;
+        }
+
+        hydra::FileReadResult output = hydra::file_read_binary( path_buffer, &heap_allocator );
+        if ( output.size < sizeof( ShaderEffectBlueprint ) || ( ( hydra::BlobHeader* )output.data )->version != ShaderEffectBlueprint::k_version ) {
+            hprint( "HFX: skipping %s for layout table, missing or old binary.\n", path_buffer );
+            if ( output.data ) {
+                hfree( output.data, &heap_allocator );
+            }
+            continue;
+        }
+        outputs.push( output );
+
+        const ShaderEffectBlueprint* blueprint = ( const ShaderEffectBlueprint* )output.data;
+        for ( u32 p = 0; p < blueprint->passes.size; ++p ) {
+            const ShaderPassBlueprint& pass = blueprint->passes[ p ];
+
+            for ( u32 l = 0; l < pass.resource_layouts.size; ++l ) {
+                const ResourceLayoutBlueprint& layout = pass.resource_layouts[ l ];
+                ++total_layouts;
+
+                if ( hash_to_layout.get( layout.hash ) == u32_max ) {
+                    hash_to_layout.insert( layout.hash, unique_layouts.size );
+                    unique_layouts.push( &layout );
+                    total_bindings += layout.bindings.size;
+                }
+            }
+        }
+    }
+
+    hydra::BlobSerializer blob;
+    blob.is_reading = false;
+    const sizet blob_size = sizeof( ResourceLayoutTableBlueprint ) + unique_layouts.size * sizeof( ResourceLayoutBlueprint ) + total_bindings * sizeof( ResourceBinding );
+    ResourceLayoutTableBlueprint* table = blob.write_and_prepare<ResourceLayoutTableBlueprint>( &heap_allocator, ResourceLayoutTableBlueprint::k_version, blob_size );
+
+    blob.allocate_and_set( table->layouts, unique_layouts.size );
+    for ( u32 l = 0; l < unique_layouts.size; ++l ) {
+        const ResourceLayoutBlueprint& source_layout = *unique_layouts[ l ];
+        ResourceLayoutBlueprint& layout = table->layouts[ l ];
+
+        blob.allocate_and_set<ResourceBinding>( layout.bindings, source_layout.bindings.size, ( void* )source_layout.bindings.get() );
+        layout.creation = source_layout.creation;
+        layout.hash = source_layout.hash;
+    }
+
+    hydra::file_write_binary( table_filename, blob.blob_memory, blob.allocated_offset );
+    hprint( "HFX: layout table %s, %u unique layouts from %u pass layouts in %u files.\n", table_filename, unique_layouts.size, total_layouts, outputs.size );
+
+    const u32 unique_count = unique_layouts.size;
+
+    blob.shutdown();
+    for ( u32 i = 0; i < outputs.size; ++i ) {
+        hfree( outputs[ i ].data, &heap_allocator );
+    }
+    outputs.shutdown();
+    unique_layouts.shutdown();
+    hash_to_layout.shutdown();
+    dependency_filenames.shutdown();
+
+    return unique_count;
+}
+
+// FileContentCache ///////////////////////////////////////////////////////
+
+//
+// Paths are case insensitive and can use both separators.
+static u64 file_content_path_hash( cstring path ) {
+    char normalized_path[ 512 ];
+    u32 length = 0;
+    for ( ; path[ length ] && length < 511; ++length ) {
+        const char c = path[ length ];
+        normalized_path[ length ] = c == '/' ? '\\' : ( char )tolower( c );
+    }
+
+    return hydra::hash_bytes( normalized_path, length );
+}
+
+void FileContentCache::init( hydra::Allocator* allocator_ ) {
+    allocator = allocator_;
+    mutex.init();
+
+    files.init( allocator, 64 );
+    files.set_default_value( nullptr );
+    retired.init( allocator, 16 );
+
+    hits = misses = 0;
+}
+
+void FileContentCache::shutdown() {
+    invalidate_all();
+    release_retired();
+
+    files.shutdown();
+    retired.shutdown();
+    mutex.shutdown();
+}
+
+const FileContent* FileContentCache::read( cstring path ) {
+    const u64 key = file_content_path_hash( path );
+    {
+        hydra::ScopedLock lock( mutex );
+        FileContent* content = files.get( key );
+        if ( content ) {
+            ++hits;
+            return content;
+        }
+    }
+
+    // Read outside of the lock, if the same file is read concurrently the first inserted is kept.
+    hydra::FileReadResult file = hydra::file_read_binary( path, allocator );
+    if ( file.data == nullptr ) {
+        return nullptr;
+    }
+
+    FileContent* content = ( FileContent* )halloca( sizeof( FileContent ) + file.size + 1, allocator );
+    content->text = ( char* )( content + 1 );
+    content->hash = hydra::hash_bytes( file.data, file.size );
+
+    // Same line endings conversion of a text mode read.
+    u32 text_size = 0;
+    for ( sizet i = 0; i < file.size; ++i ) {
+        if ( file.data[ i ] == '\r' && i + 1 < file.size && file.data[ i + 1 ] == '\n' ) {
+            continue;
+        }
+        content->text[ text_size++ ] = file.data[ i ];
+    }
+    content->text[ text_size ] = 0;
+    content->text_size = text_size;
+
+    hfree( file.data, allocator );
+
+    hydra::ScopedLock lock( mutex );
+    FileContent* existing_content = files.get( key );
+    if ( existing_content ) {
+        hfree( content, allocator );
+        ++hits;
+        return existing_content;
+    }
+
+    files.insert( key, content );
+    ++misses;
+
+    return content;
+}
+
+void FileContentCache::invalidate( cstring path ) {
+    const u64 key = file_content_path_hash( path );
+
+    hydra::ScopedLock lock( mutex );
+    FileContent* content = files.get( key );
+    if ( content ) {
+        files.remove( key );
+        retired.push( content );
+    }
+}
+
+void FileContentCache::invalidate_all() {
+    hydra::ScopedLock lock( mutex );
+
+    hydra::FlatHashMapIterator it = files.iterator_begin();
+    while ( it.is_valid() ) {
+        retired.push( files.get( it ) );
+        files.iterator_advance( it );
+    }
+    files.clear();
+}
+
+void FileContentCache::release_retired() {
+    hydra::ScopedLock lock( mutex );
+
+    for ( u32 i = 0; i < retired.size; ++i ) {
+        hfree( retired[ i ], allocator );
+    }
+    retired.clear();
+}
+
+// CompileServer //////////////////////////////////////////////////////////
+
+//
+// Files consumed by an output the last time it was found up to date.
+struct CompiledOutput {
+
+    hydra::Array<Dependency>        dependencies;
+
+}; // struct CompiledOutput
+
+//
+//
+static u64 compile_request_key( const CompileRequest& request ) {
+    u64 key = hydra::hash_bytes( ( void* )request.input_filename, strlen( request.input_filename ), request.options );
+    key = hydra::hash_bytes( ( void* )request.output_filename, strlen( request.output_filename ), key );
+    if ( request.cpp_generated_folder ) {
+        key = hydra::hash_bytes( ( void* )request.cpp_generated_folder, strlen( request.cpp_generated_folder ), key );
+    }
+    return key;
+}
+
+//
+// Only files notified as changed are read again from disk. Called without the server lock, on a copy of the dependencies.
+static bool compiled_output_is_up_to_date( const hydra::Array<Dependency>& dependencies, FileContentCache& file_cache ) {
+    for ( u32 i = 0; i < dependencies.size; ++i ) {
+        const Dependency& dependency = dependencies[ i ];
+        const FileContent* content = file_cache.read( dependency.path );
+        if ( content == nullptr || content->hash != dependency.hash ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+//
+static void compile_server_execute( CompileServer& server, CompileRequest& request ) {
+    const u64 key = compile_request_key( request );
+
+    if ( !request.force_rebuild ) {
+        // Snapshot the dependencies under the lock, files can be read from disk while checking them.
+        hydra::Array<Dependency> known_dependencies;
+        bool known_output = false;
+        {
+            hydra::ScopedLock lock( server.mutex );
+            CompiledOutput* output = server.outputs.get( key );
+            if ( output ) {
+                known_output = true;
+                known_dependencies.init( &server.heap_allocator, output->dependencies.size );
+                for ( u32 i = 0; i < output->dependencies.size; ++i ) {
+                    known_dependencies.push( output->dependencies[ i ] );
+                }
+            }
+        }
+
+        if ( known_output ) {
+            request.up_to_date = compiled_output_is_up_to_date( known_dependencies, server.file_cache );
+            known_dependencies.shutdown();
+        }
+    }
+
+    if ( request.up_to_date ) {
+        hydra::atomic_increment( &server.up_to_date_count );
+        return;
+    }
+
+    request.compiled = hfx_compile_internal( request.input_filename, request.output_filename, request.options, request.cpp_generated_folder,
+                                             request.force_rebuild, &server.process_pool, &server.file_cache );
+    if ( request.compiled ) {
+        hydra::atomic_increment( &server.compiled_count );
+    }
+
+    // Dependency file is written only by successful compilations, and it is valid also when the output on disk was up to date.
+    char dependency_filename[ 512 ];
+    snprintf( dependency_filename, 512, "%s.hfxdeps", request.output_filename );
+
+    hydra::Array<Dependency> dependencies;
+    dependencies.init( &server.heap_allocator, 16 );
+    const bool valid_dependencies = dependency_file_check( dependency_filename, nullptr, &server.file_cache, &server.heap_allocator, &dependencies );
+
+    hydra::ScopedLock lock( server.mutex );
+    CompiledOutput* output = server.outputs.get( key );
+    if ( valid_dependencies ) {
+        if ( output == nullptr ) {
+            output = hallocat( CompiledOutput, &server.heap_allocator );
+            server.outputs.insert( key, output );
+        }
+        else {
+            output->dependencies.shutdown();
+        }
+        output->dependencies = dependencies;
+    }
+    else {
+        // Compiled again at the next request.
+        dependencies.shutdown();
+        if ( output ) {
+            output->dependencies.shutdown();
+            hfree( output, &server.heap_allocator );
+            server.outputs.remove( key );
+        }
+    }
+}
+
+//
+//
+static void compile_server_worker( void* user_data ) {
+    CompileServer* server = ( CompileServer* )user_data;
+
+    for ( ;; ) {
+        CompileRequest* request = nullptr;
+        {
+            hydra::ScopedLock lock( server->mutex );
+            while ( server->running && server->queue_head == server->queue.size ) {
+                server->work_available.wait( server->mutex );
+            }
+
+            if ( !server->running ) {
+                break;
+            }
+
+            request = server->queue[ server->queue_head++ ];
+            if ( server->queue_head == server->queue.size ) {
+                server->queue.clear();
+                server->queue_head = 0;
+            }
+        }
+
+        compile_server_execute( *server, *request );
+
+        // Notified under the lock, so wait_all cannot miss it between its check and its wait.
+        if ( hydra::atomic_decrement( &server->pending_requests ) == 0 ) {
+            hydra::ScopedLock lock( server->mutex );
+            server->all_done.notify_all();
+        }
+    }
+}
+
+void CompileServer::init( u32 num_threads_, u32 max_processes ) {
+    mutex.init();
+    work_available.init();
+    all_done.init();
+
+    file_cache.init( &heap_allocator );
+    process_pool.init( &heap_allocator, max_processes );
+
+    queue.init( &heap_allocator, 64 );
+    queue_head = 0;
+    outputs.init( &heap_allocator, 64 );
+    outputs.set_default_value( nullptr );
+
+    pending_requests = 0;
+    up_to_date_count = 0;
+    compiled_count = 0;
+
+    // Synchronous log is not thread safe: use the asynchronous one while the server is alive.
+    hydra::LogService* log_service = hydra::LogService::instance();
+    owns_async_log = !log_service->async_enabled;
+    if ( owns_async_log ) {
+        hydra::LogConfiguration log_configuration;
+        log_configuration.allocator = &heap_allocator;
+        log_service->init( &log_configuration );
+    }
+
+    num_threads = num_threads_ ? num_threads_ : process_pool.num_workers;
+    num_threads = hydra::min( num_threads, k_max_threads );
+
+    hydra::atomic_store_release( &running, 1 );
+    for ( u32 i = 0; i < num_threads; ++i ) {
+        hydra::thread_create( threads[ i ], compile_server_worker, this, "hfx_compile_server" );
+    }
+}
+
+void CompileServer::shutdown() {
+    wait_all();
+
+    {
+        hydra::ScopedLock lock( mutex );
+        hydra::atomic_store_release( &running, 0 );
+        work_available.notify_all();
+    }
+    for ( u32 i = 0; i < num_threads; ++i ) {
+        hydra::thread_join( threads[ i ] );
+    }
+    num_threads = 0;
+
+    hydra::FlatHashMapIterator it = outputs.iterator_begin();
+    while ( it.is_valid() ) {
+        CompiledOutput* output = outputs.get( it );
+        output->dependencies.shutdown();
+        hfree( output, &heap_allocator );
+
+        outputs.iterator_advance( it );
+    }
+    outputs.shutdown();
+    queue.shutdown();
+
+    process_pool.shutdown();
+    file_cache.shutdown();
+
+    if ( owns_async_log ) {
+        hydra::LogService::instance()->shutdown();
+    }
+
+    all_done.shutdown();
+    work_available.shutdown();
+    mutex.shutdown();
+}
+
+void CompileServer::submit( CompileRequest* request ) {
+    request->compiled = false;
+    request->up_to_date = false;
+
+    hydra::ScopedLock lock( mutex );
+    queue.push( request );
+    hydra::atomic_increment( &pending_requests );
+    work_available.notify_one();
+}
+
+void CompileServer::wait_all() {
+    hydra::ScopedLock lock( mutex );
+    while ( hydra::atomic_add( &pending_requests, 0 ) > 0 ) {
+        all_done.wait( mutex );
+    }
+
+    // Retired file contents can be used only by running compilations.
+    file_cache.release_retired();
+}
+
+u32 CompileServer::compile( CompileRequest* requests, u32 num_requests ) {
+    for ( u32 i = 0; i < num_requests; ++i ) {
+        submit( &requests[ i ] );
+    }
+
+    wait_all();
+
+    u32 compiled = 0;
+    for ( u32 i = 0; i < num_requests; ++i ) {
+        compiled += requests[ i ].compiled ? 1 : 0;
+    }
+    return compiled;
+}
+
+void CompileServer::file_changed( cstring path ) {
+    file_cache.invalidate( path );
+
+    hydra::ScopedLock lock( mutex );
+    if ( pending_requests == 0 ) {
+        file_cache.release_retired();
+    }
+}
+
+void CompileServer::invalidate_all() {
+    file_cache.invalidate_all();
+
+    hydra::ScopedLock lock( mutex );
+    if ( pending_requests == 0 ) {
+        file_cache.release_retired();
+    }
+}
+
+void CompileServer::print_statistics() {
+    hprint( "HFX compile server: %d compiled, %d up to date. File cache: %u files, %u hits, %u misses.\n",
+            compiled_count, up_to_date_count, ( u32 )file_cache.files.size, file_cache.hits, file_cache.misses );
+}
+
+//
+//
+bool hfx_validate( cstring binary_filename, bool print_breakdown ) {
+    hydra::MallocAllocator heap_allocator;
+
+    hydra::FileReadResult file = hydra::file_read_binary( binary_filename, &heap_allocator );
+    if ( file.data == nullptr ) {
+        hprint( "HFX validation error: cannot read %s\n", binary_filename );
+        return false;
+    }
+
+    const bool valid = shader_effect_blueprint_validate( file.data, file.size, binary_filename, print_breakdown );
+    hfree( file.data, &heap_allocator );
+
+    return valid;
+}
+
+//
+//
+u32 hfx_validate_folder( cstring folder, cstring file_pattern, bool print_breakdown ) {
+    hydra::MallocAllocator heap_allocator;
+
+    char path_buffer[ 512 ];
+    snprintf( path_buffer, 512, "%s\\%s", folder, file_pattern );
+
+    hydra::StringArray filenames;
+    filenames.init( 64 * 1024, &heap_allocator );
+    hydra::file_find_files_in_path( path_buffer, filenames );
+
+    // Reuse the same memory for all the files.
+    hydra::Array<char> file_memory;
+    file_memory.init( &heap_allocator, 64 * 1024 );
+
+    const i64 start_ticks = hydra::time_now();
+    u32 num_files = 0;
+    u32 num_invalid = 0;
+
+    hydra::FlatHashMapIterator* it = filenames.begin_string_iteration();
+    while ( filenames.has_next_string( it ) ) {
+        cstring filename = filenames.get_next_string( it );
+        // Dependency files share the output name.
+        if ( strstr( filename, ".hfxdeps" ) ) {
+            continue;
+        }
+
+        snprintf( path_buffer, 512, "%s\\%s", folder, filename );
+        ++num_files;
+
+        FILE* file = fopen( path_buffer, "rb" );
+        bool valid = false;
+        if ( file ) {
+            fseek( file, 0, SEEK_END );
+            const sizet file_size = ( sizet )ftell( file );
+            fseek( file, 0, SEEK_SET );
+
+            file_memory.set_size( ( u32 )file_size );
+            valid = ( file_size == 0 || fread( file_memory.data, file_size, 1, file ) == 1 ) && shader_effect_blueprint_validate( file_memory.data, file_size, path_buffer, print_breakdown );
+            fclose( file );
+        }
+        else {
+            hprint( "HFX validation error: cannot read %s\n", path_buffer );
+        }
+
+        num_invalid += valid ? 0 : 1;
+    }
+
+    hprint( "HFX: validated %u files in %s, %u invalid, %.2f ms.\n", num_files, folder, num_invalid, hydra::time_delta_milliseconds( start_ticks, hydra::time_now() ) );
+
+    file_memory.shutdown();
+    filenames.shutdown();
+
+    return num_invalid;
+}
+
 //
 // Inspect and print informations about HFX binary file.
 void hfx_inspect( const char* binary_filename ) {
@@ -3973,56 +5481,259 @@ const hydra::gfx::ResourceLayoutCreation::Binding* shader_effect_pass_get_layout
 
 // ShaderPassBlueprint ////////////////////////////////////////////////////
 void ShaderPassBlueprint::fill_pipeline( hydra::gfx::PipelineCreation& out_pipeline ) {
+    out_pipeline = pipeline;
+}
+
+void ShaderPassBlueprint::fill_resource_layout( hydra::gfx::ResourceLayoutCreation& creation, u32 index ) {
+    creation = resource_layouts[ index ].creation;
+}
+
+void ShaderPassBlueprint::resolve_pointers() {
+
+    pipeline.name = name;
+    pipeline.shaders.name = name;
 
-    // Shader
-    hydra::gfx::ShaderStateCreation& shader_creation = out_pipeline.shaders;
-    const u32 shader_count = shaders.size;
+    for ( u32 s = 0; s < shaders.size; ++s ) {
+        pipeline.shaders.stages[ s ].code = ( cstring )shaders[ s ].code.get();
+    }
 
-    shader_creation.reset().set_spv_input( is_spirv ).set_name( name );
-    for ( u32 s = 0; s < shader_count; ++s ) {
-        hfx::ShaderCodeBlueprint& shader_code = shaders[ s ];
-        shader_creation.add_stage( ( cstring )shader_code.code.data.get(), shader_code.code.size, ( hydra::gfx::ShaderStage::Enum )shader_code.stage );
+    for ( u32 l = 0; l < resource_layouts.size; ++l ) {
+        resource_layouts[ l ].resolve_pointers();
+    }
+}
+
+// ResourceLayoutBlueprint ////////////////////////////////////////////////
+void ResourceLayoutBlueprint::resolve_pointers() {
+    for ( u32 b = 0; b < creation.num_bindings; ++b ) {
+        creation.bindings[ b ].name = bindings[ b ].name;
+    }
+}
+
+// ShaderEffectBlueprint //////////////////////////////////////////////////
+u32 ShaderEffectBlueprint::get_variant_pass_index( u32 pass_index, u32 variant_key ) const {
+    const ShaderPassBlueprint& pass = passes[ pass_index ];
+    // Variant count is a power of two.
+    return pass.variant_passes.size ? pass.variant_passes[ variant_key & ( pass.variant_passes.size - 1 ) ] : pass_index;
+}
+
+void ShaderEffectBlueprint::resolve_pointers() {
+    for ( u32 p = 0; p < passes.size; ++p ) {
+        passes[ p ].resolve_pointers();
+    }
+}
+
+// ResourceLayoutTableBlueprint ///////////////////////////////////////////
+void ResourceLayoutTableBlueprint::resolve_pointers() {
+    for ( u32 l = 0; l < layouts.size; ++l ) {
+        layouts[ l ].resolve_pointers();
+    }
+}
+
+// Blueprint validation ///////////////////////////////////////////////////
+
+//
+//
+struct BlueprintValidator {
+
+    const char*                     begin;
+    const char*                     end;
+    cstring                         name;
+    u32                             errors;
+
+}; // struct BlueprintValidator
+
+static const u32                    k_spirv_magic = 0x07230203;
+static const u32                    k_spirv_header_size = 5 * sizeof( u32 );
+
+//
+//
+static void validator_error( BlueprintValidator& validator, cstring format, ... ) {
+    char message[ 512 ];
+    va_list args;
+    va_start( args, format );
+    vsnprintf( message, 512, format, args );
+    va_end( args );
+
+    hprint( "HFX validation error in %s: %s\n", validator.name, message );
+    ++validator.errors;
+}
+
+//
+//
+static bool validator_check_range( BlueprintValidator& validator, const void* memory, u64 size ) {
+    const char* start = ( const char* )memory;
+    return start >= validator.begin && start <= validator.end && size <= ( u64 )( validator.end - start );
+}
+
+//
+// Pointer is checked without dereferencing it, the array struct itself must be already validated.
+template <typename T>
+static bool validator_check_array( BlueprintValidator& validator, const hydra::RelativeArray<T>& array, cstring what ) {
+    if ( array.size == 0 ) {
+        return true;
+    }
+
+    if ( array.data.is_null() ) {
+        validator_error( validator, "%s has %u elements and null data", what, array.size );
+        return false;
+    }
+
+    const char* data = ( const char* )&array.data.offset + array.data.offset;
+    if ( !validator_check_range( validator, data, ( u64 )array.size * sizeof( T ) ) ) {
+        validator_error( validator, "%s is out of bounds (offset %d, %u elements)", what, array.data.offset, array.size );
+        return false;
+    }
+    return true;
+}
+
+//
+//
+static bool validator_check_string( BlueprintValidator& validator, const char* text, u32 max_length, cstring what ) {
+    if ( memchr( text, 0, max_length ) == nullptr ) {
+        validator_error( validator, "%s is not null terminated", what );
+        return false;
+    }
+    return true;
+}
+
+//
+//
+static void validator_check_pass( BlueprintValidator& validator, const ShaderEffectBlueprint& blueprint, u32 pass_index, bool print_breakdown ) {
+    const ShaderPassBlueprint& pass = blueprint.passes[ pass_index ];
+    if ( !validator_check_string( validator, pass.name, ArraySize( pass.name ), "pass name" ) ) {
+        return;
+    }
+
+    cstring pass_name = pass.name;
+    u64 code_size = 0;
+    u64 layouts_size = 0;
+
+    // Shaders
+    if ( validator_check_array( validator, pass.shaders, "shaders" ) ) {
+        if ( pass.shaders.size > hydra::gfx::k_max_shader_stages ) {
+            validator_error( validator, "pass %s has %u shaders, max is %u", pass_name, pass.shaders.size, hydra::gfx::k_max_shader_stages );
+        }
+
+        for ( u32 s = 0; s < pass.shaders.size; ++s ) {
+            const ShaderCodeBlueprint& shader = pass.shaders[ s ];
+            if ( shader.stage >= hydra::gfx::ShaderStage::Count ) {
+                validator_error( validator, "pass %s shader %u has invalid stage %u", pass_name, s, shader.stage );
+            }
+
+            if ( !validator_check_array( validator, shader.code, "shader code" ) ) {
+                continue;
+            }
+            code_size += shader.code.size;
+
+            if ( shader.code.size == 0 ) {
+                validator_error( validator, "pass %s shader %u has no code", pass_name, s );
+            }
+            else if ( pass.is_spirv ) {
+                u32 magic = 0;
+                if ( shader.code.size < k_spirv_header_size || ( shader.code.size % sizeof( u32 ) ) != 0 ) {
+                    validator_error( validator, "pass %s shader %u has invalid SPIR-V size %u", pass_name, s, shader.code.size );
+                }
+                else if ( memcpy( &magic, shader.code.get(), sizeof( u32 ) ), magic != k_spirv_magic ) {
+                    validator_error( validator, "pass %s shader %u has invalid SPIR-V magic 0x%08x", pass_name, s, magic );
+                }
+            }
+
+            if ( s < hydra::gfx::k_max_shader_stages && pass.pipeline.shaders.stages[ s ].code_size != shader.code.size ) {
+                validator_error( validator, "pass %s shader %u baked size %u differs from code size %u", pass_name, s, pass.pipeline.shaders.stages[ s ].code_size, shader.code.size );
+            }
+        }
+
+        if ( pass.pipeline.shaders.stages_count != pass.shaders.size ) {
+            validator_error( validator, "pass %s baked stages count %u differs from shaders count %u", pass_name, pass.pipeline.shaders.stages_count, pass.shaders.size );
+        }
+    }
+
+    // Render state
+    if ( pass.render_state.is_not_null() && !validator_check_range( validator, ( const char* )&pass.render_state.offset + pass.render_state.offset, sizeof( RenderStateBlueprint ) ) ) {
+        validator_error( validator, "pass %s render state is out of bounds", pass_name );
     }
 
     // Vertex input
-    if ( vertex_streams.size ) {
+    validator_check_array( validator, pass.vertex_streams, "vertex streams" );
+    validator_check_array( validator, pass.vertex_attributes, "vertex attributes" );
+    if ( pass.vertex_streams.size > hydra::gfx::k_max_vertex_streams || pass.vertex_attributes.size > hydra::gfx::k_max_vertex_attributes ) {
+        validator_error( validator, "pass %s has too many vertex streams (%u) or attributes (%u)", pass_name, pass.vertex_streams.size, pass.vertex_attributes.size );
+    }
+
+    // Resource layouts
+    if ( validator_check_array( validator, pass.resource_layouts, "resource layouts" ) ) {
+        if ( pass.resource_layouts.size > hydra::gfx::k_max_resource_layouts || pass.pipeline.num_active_layouts != pass.resource_layouts.size ) {
+            validator_error( validator, "pass %s has %u layouts, baked %u, max %u", pass_name, pass.resource_layouts.size, pass.pipeline.num_active_layouts, hydra::gfx::k_max_resource_layouts );
+        }
 
-        hydra::gfx::VertexInputCreation& vertex_input = out_pipeline.vertex_input;
+        for ( u32 l = 0; l < pass.resource_layouts.size; ++l ) {
+            const ResourceLayoutBlueprint& layout = pass.resource_layouts[ l ];
+            if ( !validator_check_array( validator, layout.bindings, "layout bindings" ) ) {
+                continue;
+            }
+            layouts_size += sizeof( ResourceLayoutBlueprint ) + layout.bindings.size * sizeof( ResourceBinding );
 
-        vertex_input.num_vertex_attributes = vertex_attributes.size;
-        vertex_input.num_vertex_streams = vertex_streams.size;
+            if ( layout.bindings.size > hydra::gfx::k_max_resources_per_list || layout.creation.num_bindings != layout.bindings.size ) {
+                validator_error( validator, "pass %s layout %u has %u bindings, baked %u, max %u", pass_name, l, layout.bindings.size, layout.creation.num_bindings, hydra::gfx::k_max_resources_per_list );
+                continue;
+            }
 
-        memcpy( ( void* )vertex_input.vertex_attributes, vertex_attributes.get(), sizeof( const hydra::gfx::VertexAttribute ) * vertex_attributes.size );
-        memcpy( ( void* )vertex_input.vertex_streams, vertex_streams.get(), sizeof( const hydra::gfx::VertexStream ) * vertex_streams.size );
+            for ( u32 b = 0; b < layout.bindings.size; ++b ) {
+                validator_check_string( validator, layout.bindings[ b ].name, ArraySize( layout.bindings[ b ].name ), "binding name" );
+            }
+        }
     }
 
-    // Render States
-    if ( render_state.is_not_null() ) {
-        memcpy( &out_pipeline.rasterization, render_state.get(), sizeof( hydra::gfx::RasterizationCreation ) + sizeof( hydra::gfx::DepthStencilCreation ) + sizeof( hydra::gfx::BlendStateCreation ) );
+    // Variants
+    if ( validator_check_array( validator, pass.variant_passes, "variant passes" ) ) {
+        if ( pass.variant_passes.size & ( pass.variant_passes.size - 1 ) ) {
+            validator_error( validator, "pass %s variant count %u is not a power of two", pass_name, pass.variant_passes.size );
+        }
+
+        for ( u32 v = 0; v < pass.variant_passes.size; ++v ) {
+            if ( pass.variant_passes[ v ] >= blueprint.passes.size ) {
+                validator_error( validator, "pass %s variant %u points to pass %u, passes are %u", pass_name, v, pass.variant_passes[ v ], blueprint.passes.size );
+            }
+        }
     }
 
-    out_pipeline.name = name;
-    out_pipeline.num_active_layouts = resource_layouts.size;
+    if ( print_breakdown ) {
+        hprint( "  pass %-32s shaders %u, code %8llu bytes, layouts %u (%llu bytes), vertex streams %u attributes %u, variants %u\n",
+                pass_name, pass.shaders.size, code_size, pass.resource_layouts.size, layouts_size, pass.vertex_streams.size, pass.vertex_attributes.size, pass.variant_passes.size );
+    }
 }
 
-void ShaderPassBlueprint::fill_resource_layout( hydra::gfx::ResourceLayoutCreation& creation, u32 index ) {
+//
+//
+bool shader_effect_blueprint_validate( const char* memory, sizet size, cstring name, bool print_breakdown ) {
+    BlueprintValidator validator{ memory, memory + size, name, 0 };
+
+    if ( memory == nullptr || size < sizeof( ShaderEffectBlueprint ) ) {
+        validator_error( validator, "size %llu is smaller than the header", ( u64 )size );
+        return false;
+    }
+
+    const ShaderEffectBlueprint& blueprint = *( const ShaderEffectBlueprint* )memory;
+    if ( blueprint.header.version != ShaderEffectBlueprint::k_version ) {
+        validator_error( validator, "version %u, expected %u", blueprint.header.version, ShaderEffectBlueprint::k_version );
+        return false;
+    }
 
-    creation.reset();
+    validator_check_array( validator, blueprint.name, "shader name" );
 
-    hfx::ResourceLayoutBlueprint& rlb = resource_layouts[ index ];
-    creation.num_bindings = rlb.bindings.size;
+    if ( !validator_check_array( validator, blueprint.passes, "passes" ) ) {
+        return false;
+    }
 
-    for ( u32 i = 0; i < creation.num_bindings; ++i ) {
-        hydra::gfx::ResourceLayoutCreation::Binding& out_binding = creation.bindings[ i ];
-        ResourceBinding& in_binding = rlb.bindings[ i ];
-        //strcpy( out_binding.name, in_binding.name );
+    if ( print_breakdown ) {
+        hprint( "%s: %llu bytes, %u passes, header %llu bytes\n", name, ( u64 )size, blueprint.passes.size, ( u64 )( sizeof( ShaderEffectBlueprint ) + blueprint.passes.size * sizeof( ShaderPassBlueprint ) ) );
+    }
 
-        out_binding.start = in_binding.start;
-        out_binding.count = in_binding.count;
-        out_binding.type = in_binding.type;
-        out_binding.name = in_binding.name;
+    for ( u32 p = 0; p < blueprint.passes.size; ++p ) {
+        validator_check_pass( validator, blueprint, p, print_breakdown );
     }
-    //memcpy( creation.bindings, rlb.bindings.get(), sizeof( hydra::gfx::ResourceLayoutCreation::Binding ) * creation.num_bindings );
+
+    return validator.errors == 0;
 }
 
 } // namespace hfx
\ No newline at end of file
@@ -1,6 +1,6 @@
 
 //
-// Hydra HFX v0.54
+// Hydra HFX v0.63
 //
 //      Source code     : https://www.github.com/jorenjoestar/
 //
@@ -9,6 +9,15 @@
 //
 // Revision history //////////////////////
 //
+//      0.63  (2021/12/29): + Generated C++ headers assert struct offsets against reflection, fix padding and emit field tables with an update helper writing only changed fields.
+//      0.62  (2021/12/28): + Added shader_effect_blueprint_validate, hfx_validate and hfx_validate_folder to check binaries bounds, SPIR-V code and print size breakdowns.
+//      0.61  (2021/12/27): + Added CompileServer, a resident compiler caching file contents and output dependencies in memory. + Parser can read files through a FileContentCache.
+//      0.60  (2021/12/26): + Layout hash is canonical, ignoring names and counts. + Added hfx_generate_layout_table to write the unique layouts of a build, updated by hfx_build_outdated.
+//      0.59  (2021/12/25): + BREAKING: PipelineCreation and ResourceLayoutCreation are baked in the binary, with a layout hash to share equal layouts. + Added ShaderEffectBlueprint::resolve_pointers.
+//      0.58  (2021/12/24): + Added pass 'variants' declaration, expanded at compile time in one pass per variant key. + Identical shader binaries are shared between passes. + Added ShaderEffectBlueprint::get_variant_pass_index.
+//      0.57  (2021/12/23): + hfx_compile writes a dependency file next to each output, listing all the consumed files with their content hash. + Added hfx_build_outdated.
+//      0.56  (2021/12/22): + Added content addressed cache of compiled shader stages. + Binary is rebuilt when the source content changes instead of its file time.
+//      0.55  (2021/12/21): + Shader stages are compiled concurrently by a process pool, sources and outputs go through pipes. + Added hfx_compile_batch.
 //      0.54  (2021/12/03): + Added support for uint2 and uint4 as vertex formats.
 //      0.53  (2021/11/16): + BREAKING: changed 'textureXDRW' to 'imageXD' for resource layour declarations to better reflect the underlying data. + Added support for images.
 //      0.52  (2021/11/07): + Added custom ResourceBinding class to store data inside hfx file. ResourceLayout was losing it after creation because was using temporary data.
@@ -62,6 +71,28 @@
 //      uint32_t options = hfx::CompileOptions_OpenGL | hfx::CompileOptions_Embedded;
 //      hfx::hfx_compile( "simple.hfx", "simple.bhfx", options );
 //
+// 2. To declare permutations of a pass, list the keywords in the pass:
+//      pass Opaque {
+//          variants = ( ALPHA_TEST, SKINNED )
+//          ...
+//      }
+//    Each keyword is defined in the shader code when its bit is set in the variant key.
+//    Variants are appended after the declared passes and retrieved with:
+//      u32 pass_index = hfx_blueprint->get_variant_pass_index( pass_Opaque, Opaque::variant_ALPHA_TEST | Opaque::variant_SKINNED );
+//
+// 3. Creation structs are baked in the binary, after reading it only pointers need to be resolved:
+//      hfx::ShaderEffectBlueprint* hfx_blueprint = blob_serializer.read<hfx::ShaderEffectBlueprint>( allocator, hfx::ShaderEffectBlueprint::k_version, size, memory );
+//      hfx_blueprint->resolve_pointers();
+//      const hydra::gfx::ResourceLayoutCreation& layout_creation = hfx_blueprint->passes[ 0 ].resource_layouts[ 0 ].creation;
+//
+// 4. Editors can keep a compile server alive, notifying it of the modified files:
+//      hfx::CompileServer server;
+//      server.init();
+//      server.compile( requests, num_requests );   // Unchanged outputs return without reading from disk.
+//      server.file_changed( "shaders\\common.h" );
+//      server.compile( requests, num_requests );
+//      server.shutdown();
+//
 //
 // API Documentation /////////////////////
 //
@@ -109,6 +140,7 @@
 #include "kernel/hash_map.hpp"
 #include "kernel/relative_data_structures.hpp"
 #include "kernel/blob.hpp"
+#include "kernel/process.hpp"
 
 #include "graphics/gpu_resources.hpp"
 
@@ -117,6 +149,10 @@
 #define HFX_COMPILER
 #define HFX_V2
 
+namespace hydra {
+    struct ProcessPool;
+} // namespace hydra
+
 namespace hfx {
 
     typedef hydra::StringView                                   StringRef;
@@ -175,8 +211,11 @@ namespace hfx {
     //
     struct ResourceLayoutBlueprint {
 
+        void                        resolve_pointers();
+
         hydra::RelativeArray<ResourceBinding> bindings;
-        u64                         hash;   // Used for fast retrieval in runtime.
+        hydra::gfx::ResourceLayoutCreation creation;    // Baked at compile time, binding names are set by resolve_pointers.
+        u64                         hash;   // Used for fast retrieval in runtime. Names are not hashed, equal hashes can share the same layout.
 
     }; // struct ResourceLayoutBlueprint
 
@@ -187,6 +226,8 @@ namespace hfx {
         void                        fill_pipeline( hydra::gfx::PipelineCreation& out_pipeline );
         void                        fill_resource_layout( hydra::gfx::ResourceLayoutCreation& creation, u32 index );
 
+        void                        resolve_pointers();
+
         char                        name[ 32 ];
         char                        stage_name[ 32 ];
 
@@ -202,21 +243,53 @@ namespace hfx {
         
         hydra::RelativeArray<ResourceLayoutBlueprint> resource_layouts;
 
+        hydra::RelativeArray<u16>   variant_passes;         // Pass index for each variant key. Only in passes declaring variants.
+        u16                         variant_key;
+
+        hydra::gfx::PipelineCreation pipeline;              // Baked at compile time. Shader code and names are set by resolve_pointers, layouts and render pass at runtime.
+
     }; // struct ShaderPassBlueprint
 
     //
     //
     struct ShaderEffectBlueprint : public hydra::Blob {
 
+        u32                         get_variant_pass_index( u32 pass_index, u32 variant_key ) const;   // Bits outside the declared variants are ignored.
+
+        // Baked creation structs contain absolute pointers: call once after reading the blob, before using them.
+        // Only a few pointers per pass are written, the blob memory can be used directly.
+        void                        resolve_pointers();
+
         char                        binary_header_magic[ 32 ];
 
         hydra::RelativeString       name;
         hydra::RelativeArray<ShaderPassBlueprint> passes;
 
-        static constexpr u32        k_version = 0;
+        static constexpr u32        k_version = 2;
 
     }; // struct ShaderEffectBlueprint
 
+    //
+    // Unique resource layouts of all the shaders in a build, written by hfx_generate_layout_table.
+    // Creating them upfront lets all the passes with the same layout share it.
+    struct ResourceLayoutTableBlueprint : public hydra::Blob {
+
+        void                        resolve_pointers();
+
+        hydra::RelativeArray<ResourceLayoutBlueprint> layouts;
+
+        static constexpr u32        k_version = 1;
+
+    }; // struct ResourceLayoutTableBlueprint
+
+    static const char*              k_layout_table_filename = "hfx_layouts.bin";
+
+    //
+    // Check that every relative pointer and array of the blob is inside its memory, that SPIR-V code is well formed
+    // and that the baked creation structs match the blob data. Reads only, before resolve_pointers, without allocations.
+    // Errors are printed, optionally with the size breakdown of each pass.
+    bool                            shader_effect_blueprint_validate( const char* memory, sizet size, cstring name, bool print_breakdown );
+
 
 
     // OLDER VERSION //////////////////////////////////////////////////////
@@ -330,6 +403,7 @@ namespace hfx {
         CompileOptions_Output_Files = 1 << 4,               // Output intermediate files for inspection.
         CompileOptions_Reflection_CPP = 1 << 5,             // Generate .h/.cpp for constants.
         CompileOptions_Reflection_Reload = 1 << 6,          // Slower reflection using variants and blobs of memory.
+        CompileOptions_No_Cache     = 1 << 7,               // Do not read or write the compiled shader stages cache.
 
         CompileOptions_VulkanStandard = CompileOptions_Vulkan | CompileOptions_Embedded | CompileOptions_Reflection_CPP
     }; // enum CompileOptions
@@ -337,8 +411,130 @@ namespace hfx {
     //
     // Main compile function. Input_filename is the hfx input file, output_filename can be either a file or a folder, options dictate the behaviour.
     // Optionally specify an output shader effect file.
+    // Compiled stages are cached in the 'hfx_cache' folder next to the output, keyed by the hash of their final code:
+    // a stage is sent to the external compiler only if its code, one of its includes or the target changed.
+    // The output is up to date if the hash of every file listed in its dependency file, 'output_filename.hfxdeps', did not change.
     bool                            hfx_compile( const char* input_filename, const char* output_filename, u32 options, cstring cpp_generated_folder, bool force_rebuild = false );
 
+    //
+    // Input of the batch compilation, same parameters as hfx_compile.
+    struct CompileRequest {
+        cstring                     input_filename      = nullptr;
+        cstring                     output_filename     = nullptr;
+        u32                         options             = 0;
+        cstring                     cpp_generated_folder = nullptr;
+        bool                        force_rebuild       = false;
+
+        bool                        compiled            = false;        // Output: hfx_compile result.
+        bool                        up_to_date          = false;        // Output: set by the CompileServer when nothing had to be read or compiled.
+    }; // struct CompileRequest
+
+    //
+    // Compile multiple files concurrently. All the shader stages share the same bounded pool of compiler processes,
+    // max_processes 0 means one per logical processor. Returns the number of compiled files.
+    u32                             hfx_compile_batch( CompileRequest* requests, u32 num_requests, u32 max_processes = 0 );
+
+    //
+    // Walk the dependency files found in output_folder and rebuild concurrently only the outputs with a changed dependency,
+    // for example all the effects including an edited shared header. Returns the number of compiled files.
+    // The layout table of the folder is regenerated when something was compiled.
+    u32                             hfx_build_outdated( cstring output_folder, u32 max_processes = 0 );
+
+    //
+    // Collect the layouts of all the outputs with a dependency file in output_folder, deduplicated by hash,
+    // and write them in a ResourceLayoutTableBlueprint. Returns the number of unique layouts.
+    u32                             hfx_generate_layout_table( cstring output_folder, cstring table_filename );
+
+    // Compile server ///////////////////////////////////////////////////////////////////
+
+    //
+    // Content of a file read by the compiler. Text is null terminated with line endings converted
+    // as a text mode read does, hash is of the raw content as written in the dependency files.
+    struct FileContent {
+
+        char*                       text;
+        u64                         hash;
+        u32                         text_size;
+
+    }; // struct FileContent
+
+    //
+    // Thread safe cache of the files read by the compiler, keyed by the normalized path.
+    struct FileContentCache {
+
+        void                        init( hydra::Allocator* allocator );
+        void                        shutdown();
+
+        const FileContent*          read( cstring path );           // Null if the file cannot be read. Valid until the content is retired and released.
+        void                        invalidate( cstring path );     // Retire the content, the next read goes to disk.
+        void                        invalidate_all();
+        void                        release_retired();              // Call only when no reader is running.
+
+        hydra::Allocator*           allocator           = nullptr;
+        hydra::Mutex                mutex;
+
+        hydra::FlatHashMap<u64, FileContent*> files;
+        hydra::Array<FileContent*>  retired;                        // Can still be used by running compilations.
+
+        u32                         hits                = 0;
+        u32                         misses              = 0;
+
+    }; // struct FileContentCache
+
+    struct CompiledOutput;
+
+    //
+    // Resident compiler for editors and tools, running in process.
+    // Keeps in memory the content of the hfx files and includes, and the dependencies of every output it handled:
+    // requests for an output whose files were not notified as changed return without touching the filesystem.
+    // Requests are compiled concurrently by the server threads, sharing a single pool of compiler processes.
+    struct CompileServer {
+
+        void                        init( u32 num_threads = 0, u32 max_processes = 0 );    // 0 means one per logical processor.
+        void                        shutdown();
+
+        void                        submit( CompileRequest* request );  // Request must live until wait_all returns.
+        void                        wait_all();
+        u32                         compile( CompileRequest* requests, u32 num_requests );  // Submit and wait, returns the number of compiled files.
+
+        void                        file_changed( cstring path );       // Call when a source or include file is modified, for example from a file watcher.
+        void                        invalidate_all();
+
+        void                        print_statistics();
+
+        static constexpr u32        k_max_threads       = 16;
+
+        hydra::MallocAllocator      heap_allocator;
+        hydra::Mutex                mutex;
+        hydra::ConditionVariable    work_available;                     // Signaled by submit and shutdown.
+        hydra::ConditionVariable    all_done;                           // Signaled when pending_requests reaches zero.
+
+        FileContentCache            file_cache;
+        hydra::ProcessPool          process_pool;
+
+        hydra::Array<CompileRequest*> queue;                            // Guarded by mutex.
+        u32                         queue_head          = 0;
+        hydra::FlatHashMap<u64, CompiledOutput*> outputs;               // Guarded by mutex.
+
+        hydra::Thread               threads[ k_max_threads ];
+        u32                         num_threads         = 0;
+
+        volatile i32                pending_requests    = 0;
+        volatile u32                running             = 0;
+        bool                        owns_async_log      = false;
+
+        volatile i32                up_to_date_count    = 0;
+        volatile i32                compiled_count      = 0;
+
+    }; // struct CompileServer
+
+    //
+    // Validate binaries with shader_effect_blueprint_validate. The folder version is meant for CI steps:
+    // it validates all the files matching the pattern, reusing the same memory, and returns the number of invalid files.
+    // Only blueprint binaries (.bhfx2) can be validated, legacy .bhfx files have a different layout.
+    bool                            hfx_validate( cstring binary_filename, bool print_breakdown = true );
+    u32                             hfx_validate_folder( cstring folder, cstring file_pattern = "*.bhfx2", bool print_breakdown = false );
+
     void                            hfx_inspect( const char* binary_filename );
     void                            hfx_inspect_imgui( ShaderEffectFile& bhfx_file );
 
@@ -440,6 +636,12 @@ namespace hfx {
         std::vector<uint16_t>       options_offsets;
         ComputeDispatch             compute_dispatch;
 
+        std::vector<StringRef>      variant_keywords;               // Defines enabled by the bits of the variant key.
+        u32                         variant_key         = 0;
+        u32                         variant_first_pass  = 0;        // Index of the first expanded variant, key 1. Set in the declaring pass.
+
+        static constexpr u32        k_max_variant_keywords = 8;
+
         std::vector<const ResourceList*> resource_lists;         // List used by the pass
         const VertexLayout*         vertex_layout;
         const RenderState*          render_state;
@@ -477,6 +679,15 @@ namespace hfx {
     //
     // Parser ///////////////////////////////////////////////////////////////////
 
+    //
+    // File read to generate an output, with the hash of its content.
+    struct Dependency {
+
+        char                        path[ 512 ];
+        u64                         hash;
+
+    }; // struct Dependency
+
     //
     //
     struct Parser {
@@ -484,6 +695,9 @@ namespace hfx {
         Lexer*                      lexer       = nullptr;
         hydra::Allocator*           allocator   = nullptr;
 
+        hydra::Array<Dependency>*   dependencies = nullptr;         // Optional, filled with the included files. Shared with the parsers of included hfx.
+        FileContentCache*           file_cache  = nullptr;          // Optional, files are read from it instead of disk. Shared with the parsers of included hfx.
+
         StringBuffer                string_buffer;
         Shader                      shader;
 
@@ -498,6 +712,8 @@ namespace hfx {
     void                            parser_terminate( Parser* parser );
 
     void                            parser_generate_ast( Parser* parser );
+    void                            parser_expand_pass_variants( Parser* parser );
+    void                            parser_add_dependency( const Parser* parser, cstring path );
 
     const CodeFragment*             find_code_fragment( const Parser* parser, const StringRef& name );
     const ResourceList*             find_resource_list( const Parser* parser, const StringRef& name );
@@ -530,6 +746,7 @@ namespace hfx {
     void                            declaration_pass_vertex_layout( Parser* parser, Pass& pass );
     void                            declaration_pass_render_states( Parser* parser, Pass& pass );
     void                            declaration_pass_options( Parser* parser, Pass& pass );
+    void                            declaration_pass_variants( Parser* parser, Pass& pass );
     void                            declaration_pass_dispatch( Parser* parser, Pass& pass );
     void                            declaration_includes( Parser* parser );
     void                            declaration_render_states( Parser* parser );
@@ -567,6 +784,9 @@ namespace hfx {
         cstring                     shader_binaries_path;           // Path of the shader compiler used, if needed.
         cstring                     cpp_generated_folder;
 
+        hydra::ProcessPool*         process_pool    = nullptr;      // Runs the external compilers concurrently.
+        cstring                     shader_cache_path = nullptr;    // Folder of the compiled stages cache, null to disable it.
+
         char                        binary_header_magic[32];        // Memory used in individual headers when generating binary files.
 
         u32                         options;                        // CompileOption flags cache.
@@ -1,5 +1,6 @@
 #include "graphics/render_graph.hpp"
 #include "graphics/renderer.hpp"
+#include "graphics/command_buffer.hpp"
 
 #include "kernel/file.hpp"
 #include "kernel/time.hpp"
@@ -46,6 +47,7 @@ void RenderGraphBuilder::init( hydra::Allocator* allocator_, cstring file_path )
             RenderGraphNode node;
             node.reset().type = RenderGraphNodeType_Stage;
             node.blueprint_index = u16( is );
+            node.name = string_id_intern( render_stage_blueprint.name.c_str() );
 
             stage_node_index = add_node( node );
 
@@ -65,6 +67,7 @@ void RenderGraphBuilder::init( hydra::Allocator* allocator_, cstring file_path )
                 RenderGraphNode node;
                 node.reset().type = RenderGraphNodeType_Texture;
                 node.blueprint_index = u16( texture_blueprint_index );
+                node.name = string_id_intern( texture.name.c_str() );
 
                 texture_node_index = add_node( node );
 
@@ -86,6 +89,7 @@ void RenderGraphBuilder::init( hydra::Allocator* allocator_, cstring file_path )
                 RenderGraphNode node;
                 node.reset().type = RenderGraphNodeType_Texture;
                 node.blueprint_index = u16( render_stage_blueprint.output_ds_index );
+                node.name = string_id_intern( texture.name.c_str() );
 
                 texture_node_index = add_node( node );
 
@@ -110,6 +114,7 @@ void RenderGraphBuilder::init( hydra::Allocator* allocator_, cstring file_path )
                 RenderGraphNode node;
                 node.reset().type = RenderGraphNodeType_Texture;
                 node.blueprint_index = u16( texture_blueprint_index );
+                node.name = string_id_intern( texture.name.c_str() );
 
                 texture_node_index = add_node( node );
 
@@ -148,14 +153,12 @@ void RenderGraphBuilder::setup( hydra::gfx::Renderer* gfx, RenderFeature** featu
         switch ( node.type ) {
             case RenderGraphNodeType_Stage:
             {
-                const RenderStageBlueprint& render_stage_blueprint = rgb->stages[ node.blueprint_index ];
-                hprint( "Stage %s\n", render_stage_blueprint.name.c_str() );
+                hprint( "Stage %s\n", node.name.c_str() );
                 break;
             }
             case RenderGraphNodeType_Texture:
             {
-                const RenderGraphTextureBlueprint& texture_blueprint = rgb->textures[ node.blueprint_index ];
-                hprint( "Texture %s\n", texture_blueprint.name.c_str() );
+                hprint( "Texture %s\n", node.name.c_str() );
                 break;
             }
             default:
@@ -298,21 +301,177 @@ u16 RenderGraphBuilder::add_node( RenderGraphNode& node ) {
 }
 
 // RenderGraph ////////////////////////////////////////////////////////////
-void RenderGraph::init( hydra::Allocator* allocator_ ) {
+// RenderGraph ////////////////////////////////////////////////////////////
+
+//
+// Recording thread, waits for a new frame request and records the stages assigned to it.
+struct RenderGraphWorker {
+
+    hydra::Thread               thread;
+
+    RenderGraph*                graph           = nullptr;
+    u32                         thread_index    = 0;
+    u32                         frame_done      = 0;
+
+}; // struct RenderGraphWorker
+
+//
+// Each thread records a contiguous range of stages in a single command buffer, so that
+// queueing the command buffers in thread order keeps the stage order.
+static void render_graph_record_stages( RenderGraph* graph, u32 thread_index ) {
+
+    const u32 num_stages = graph->stages.size;
+    const u32 first_stage = num_stages * thread_index / graph->num_recording_threads;
+    const u32 last_stage = num_stages * ( thread_index + 1 ) / graph->num_recording_threads;
+
+    CommandBuffer* command_buffer = graph->thread_command_buffers[ thread_index ];
+    for ( u32 is = first_stage; is < last_stage; ++is ) {
+        u64 stage_sort_key = graph->frame_sort_key + sort_key_stage( is );
+        command_buffer->set_sort_key( stage_sort_key );
+        graph->frame_renderer->draw( graph->stages[ is ], stage_sort_key, command_buffer );
+    }
+}
+
+static void render_graph_worker( void* user_data ) {
+    RenderGraphWorker* worker = ( RenderGraphWorker* )user_data;
+    RenderGraph* graph = worker->graph;
+
+    while ( true ) {
+        {
+            hydra::ScopedLock lock( graph->worker_mutex );
+            while ( graph->workers_running && graph->frame_requested == worker->frame_done ) {
+                graph->work_available.wait( graph->worker_mutex );
+            }
+
+            if ( !graph->workers_running ) {
+                return;
+            }
+
+            worker->frame_done = graph->frame_requested;
+        }
+
+        render_graph_record_stages( graph, worker->thread_index );
+
+        hydra::ScopedLock lock( graph->worker_mutex );
+        if ( --graph->workers_pending == 0 ) {
+            graph->work_done.notify_one();
+        }
+    }
+}
+
+void RenderGraph::init( hydra::Allocator* allocator_, u32 num_recording_threads_, bool deferred_ ) {
     allocator = allocator_;
     stages.init( allocator, 8 );
+
+    num_recording_threads = num_recording_threads_ ? num_recording_threads_ : 1;
+    num_recording_threads = num_recording_threads > k_max_recording_threads ? k_max_recording_threads : num_recording_threads;
+    thread_command_buffers.init( allocator, num_recording_threads, num_recording_threads );
+
+    deferred = deferred_;
+    deferred_streams.init( allocator, deferred ? num_recording_threads : 0, deferred ? num_recording_threads : 0 );
+    for ( u32 i = 0; i < deferred_streams.size; ++i ) {
+        new ( &deferred_streams[ i ] ) DeferredCommandStream();
+        deferred_streams[ i ].init( allocator, 64 * 1024 );
+    }
+
+    const u32 num_workers = num_recording_threads - 1;
+    if ( num_workers ) {
+        worker_mutex.init();
+        work_available.init();
+        work_done.init();
+        workers_running = true;
+
+        workers = ( RenderGraphWorker* )hallocam( sizeof( RenderGraphWorker ) * num_workers, allocator );
+
+        for ( u32 i = 0; i < num_workers; ++i ) {
+            RenderGraphWorker* worker = new ( &workers[ i ] ) RenderGraphWorker();
+            worker->graph = this;
+            worker->thread_index = i + 1;
+
+            hydra::thread_create( worker->thread, render_graph_worker, worker, "hydra_render_graph" );
+        }
+    }
 }
 
 void RenderGraph::shutdown() {
+    const u32 num_workers = num_recording_threads - 1;
+    if ( num_workers ) {
+        {
+            hydra::ScopedLock lock( worker_mutex );
+            workers_running = false;
+            work_available.notify_all();
+        }
+
+        for ( u32 i = 0; i < num_workers; ++i ) {
+            hydra::thread_join( workers[ i ].thread );
+        }
+
+        hfree( workers, allocator );
+        workers = nullptr;
+
+        work_done.shutdown();
+        work_available.shutdown();
+        worker_mutex.shutdown();
+    }
+
+    for ( u32 i = 0; i < deferred_streams.size; ++i ) {
+        deferred_streams[ i ].shutdown();
+    }
+    deferred_streams.shutdown();
+
+    thread_command_buffers.shutdown();
     stages.shutdown();
 }
 
-void RenderGraph::render( hydra::gfx::Renderer* gfx, u64 sort_key, hydra::gfx::CommandBuffer* command_buffer ) {
+CommandBuffer* RenderGraph::render( hydra::gfx::Renderer* gfx, u64 sort_key, hydra::gfx::CommandBuffer* command_buffer ) {
 
-    for ( u32 is = 0; is < stages.size; ++is ) {
-        RenderStage* stage = stages[ is ];
-        gfx->draw( stage, sort_key, command_buffer );
+    if ( num_recording_threads == 1 && !deferred ) {
+        for ( u32 is = 0; is < stages.size; ++is ) {
+            u64 stage_sort_key = sort_key + sort_key_stage( is );
+            gfx->draw( stages[ is ], stage_sort_key, command_buffer );
+        }
+        return command_buffer;
     }
+
+    Device* gpu = gfx->gpu;
+    gpu->queue_command_buffer( command_buffer );
+
+    // Acquire all command buffers on this thread, so that the submission order follows the stage order.
+    // Thread 0 uses three buffers of its pool (command_buffer, its stages and the continuation), the others one.
+    for ( u32 t = 0; t < num_recording_threads; ++t ) {
+        thread_command_buffers[ t ] = gpu->get_command_buffer( t, QueueType::Graphics, true );
+        if ( deferred ) {
+            thread_command_buffers[ t ]->set_deferred( &deferred_streams[ t ] );
+        }
+    }
+    CommandBuffer* continuation_command_buffer = gpu->get_command_buffer( 0, QueueType::Graphics, true );
+
+    frame_renderer = gfx;
+    frame_sort_key = sort_key;
+
+    // Deferred recording on a single thread has no workers, and no synchronization objects to wake them.
+    const u32 num_workers = num_recording_threads - 1;
+    if ( num_workers ) {
+        hydra::ScopedLock lock( worker_mutex );
+        ++frame_requested;
+        workers_pending = num_workers;
+        work_available.notify_all();
+    }
+
+    render_graph_record_stages( this, 0 );
+
+    if ( num_workers ) {
+        hydra::ScopedLock lock( worker_mutex );
+        while ( workers_pending ) {
+            work_done.wait( worker_mutex );
+        }
+    }
+
+    for ( u32 t = 0; t < num_recording_threads; ++t ) {
+        gpu->queue_command_buffer( thread_command_buffers[ t ] );
+    }
+
+    return continuation_command_buffer;
 }
 
 
@@ -5,6 +5,8 @@
 #include "kernel/hash_map.hpp"
 #include "kernel/relative_data_structures.hpp"
 #include "kernel/blob.hpp"
+#include "kernel/string_id.hpp"
+#include "kernel/thread.hpp"
 
 #include "graphics/gpu_enum.hpp"
 
@@ -12,6 +14,7 @@ namespace hydra {
 namespace gfx {
 
 struct CommandBuffer;
+struct DeferredCommandStream;
 struct Renderer;
 struct RenderFeature;
 struct RenderGraphNode;
@@ -20,6 +23,7 @@ struct RenderGraphBlob;
 struct RenderStage;
 struct ResourceManager;
 struct RenderView;
+struct RenderGraphWorker;
 
 
 enum RenderGraphNodeType : u8 {
@@ -38,6 +42,8 @@ struct RenderGraphNode {
     RenderGraphNodeType         type;
     u32                         blueprint_index;
 
+    StringId                    name;
+
     // Indices to other nodes.
     u16                         inputs[ 16 ];
     u16                         outputs[ 16 ];
@@ -91,14 +97,38 @@ struct RenderGraphBuilder {
 //
 struct RenderGraph {
 
-    void                        init( hydra::Allocator* allocator );
+    // When deferred, stages are recorded in DeferredCommandStreams and sorted by key at present.
+    void                        init( hydra::Allocator* allocator, u32 num_recording_threads = 1, bool deferred = false );
     void                        shutdown();
 
-    void                        render( Renderer* gfx, u64 sort_key, CommandBuffer* command_buffer );
+    // Stage i records its commands starting from sort_key + sort_key_stage( i ).
+    // With one recording thread and no deferred streams stages are recorded in command_buffer, which is returned.
+    // Otherwise stages are split in contiguous ranges, one per recording thread, each recorded in a single command buffer.
+    // command_buffer and the thread command buffers are queued in stage order; the returned command buffer
+    // follows all the stages and must be queued by the caller once done with it.
+    // Features rendered on more threads can only read shared state and allocate dynamic memory.
+    CommandBuffer*              render( Renderer* gfx, u64 sort_key, CommandBuffer* command_buffer );
 
     hydra::Array<RenderStage*>  stages;
+    hydra::Array<CommandBuffer*> thread_command_buffers;
+    hydra::Array<DeferredCommandStream> deferred_streams;   // One per recording thread, empty when not deferred.
     hydra::Allocator*           allocator   = nullptr;
 
+    RenderGraphWorker*          workers     = nullptr;  // One less than recording threads, the calling thread records too.
+    u32                         num_recording_threads = 1;
+    bool                        deferred    = false;
+
+    // Frame request, workers sleep on work_available and the calling thread on work_done. Only initialized with workers.
+    hydra::Mutex                worker_mutex;
+    hydra::ConditionVariable    work_available;
+    hydra::ConditionVariable    work_done;
+    u32                         frame_requested = 0;
+    u32                         workers_pending = 0;
+    bool                        workers_running = false;
+
+    Renderer*                   frame_renderer  = nullptr;
+    u64                         frame_sort_key  = 0;
+
 }; // struct RenderGraph
 
 // Blueprints ////////////////////////////////////////////////////////////
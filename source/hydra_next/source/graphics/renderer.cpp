@@ -1,5 +1,5 @@
 
-//  Hydra Rendering - v0.46
+//  Hydra Rendering - v0.48
 
 #include "graphics/renderer.hpp"
 
@@ -14,6 +14,7 @@
 #include "imgui/imgui.h"
 
 #include <cmath>
+#include <string.h>
 
 #include "external/stb_image.h"
 
@@ -103,36 +104,33 @@ struct RenderViewLoader : public hydra::ResourceLoader {
  
 //
 //
-void pipeline_create( Device& gpu, hfx::ShaderEffectFile* hfx, hfx::ShaderEffectBlueprint* hfx_blueprint, u32 pass_index, const RenderPassOutput& pass_output, PipelineHandle& out_pipeline, ResourceLayoutHandle* out_layouts, u32 num_layouts ) {
+void pipeline_create( Renderer& renderer, hfx::ShaderEffectFile* hfx, hfx::ShaderEffectBlueprint* hfx_blueprint, u32 pass_index, const RenderPassOutput& pass_output, PipelineHandle& out_pipeline, ResourceLayoutHandle* out_layouts, u64* out_layout_hashes, u32 num_layouts ) {
 
+    Device& gpu = *renderer.gpu;
     hydra::gfx::PipelineCreation render_pipeline;
 
     // Default to new hfx v2
     if ( hfx_blueprint ) {
-        hfx::ShaderPassBlueprint& pass = hfx_blueprint->passes[ pass_index ];
+        const hfx::ShaderPassBlueprint& pass = hfx_blueprint->passes[ pass_index ];
 
-        pass.fill_pipeline( render_pipeline );
-
-        // TODO: future test to check files differences.
-        //if ( memcmp( &render_pipeline, &render_pipeline2, sizeof( hydra::gfx::PipelineCreation ) ) != 0 )
-            //hprint( "What ?\n" );
-
-        hydra::gfx::ResourceLayoutCreation rll_creation{};
+        // Creation structs are baked in the binary, only runtime handles are added.
+        render_pipeline = pass.pipeline;
+        num_layouts = hydra::min( num_layouts, pass.resource_layouts.size );
 
         for ( u32 i = 0; i < num_layouts; i++ ) {
+            const hfx::ResourceLayoutBlueprint& layout = pass.resource_layouts[ i ];
+            out_layouts[ i ] = renderer.create_resource_layout( layout.creation, layout.hash );
+            out_layout_hashes[ i ] = layout.hash;
 
-            pass.fill_resource_layout( rll_creation, i );
-            out_layouts[ i ] = gpu.create_resource_layout( rll_creation );
-
-            // TODO: improve
-            // num active layout is already set to the max, so using add_rll breaks.
             render_pipeline.resource_layout[ i ] = out_layouts[ i ];
         }
+        render_pipeline.num_active_layouts = num_layouts;
 
         // Cache render pass output
         render_pipeline.render_pass = pass_output;
 
-        out_pipeline = gpu.create_pipeline( render_pipeline );
+        // Compiled in background, draws using it are skipped until it is ready.
+        out_pipeline = gpu.create_pipeline_async( render_pipeline );
     }
     else {
 #if defined (HFX_V2)
@@ -147,6 +145,7 @@ void pipeline_create( Device& gpu, hfx::ShaderEffectFile* hfx, hfx::ShaderEffect
 
             hfx::shader_effect_get_resource_list_layout( *hfx, pass_index, i, rll_creation );
             out_layouts[ i ] = gpu.create_resource_layout( rll_creation );
+            out_layout_hashes[ i ] = 0;
 
             // TODO: improve
             // num active layout is already set to the max, so using add_rll breaks.
@@ -354,7 +353,7 @@ Buffer* Renderer::create_buffer( const BufferCreation& creation ) {
     if ( buffer ) {
         BufferHandle handle = gpu->create_buffer( creation );
         buffer->handle = handle;
-        buffer->name = creation.name;
+        buffer->name = string_id_intern( creation.name );
         gpu->query_buffer( handle, buffer->desc );
 
         if ( creation.name != nullptr ) {
@@ -392,7 +391,7 @@ Texture* Renderer::create_texture( const TextureCreation& creation ) {
     if ( texture ) {
         TextureHandle handle = gpu->create_texture( creation );
         texture->handle = handle;
-        texture->name = creation.name;
+        texture->name = string_id_intern( creation.name );
         gpu->query_texture( handle, texture->desc );
 
         if ( creation.name != nullptr ) {
@@ -414,7 +413,7 @@ Texture* Renderer::create_texture( cstring name, cstring filename ) {
         texture->handle = handle;
         gpu->query_texture( handle, texture->desc );
         texture->references = 1;
-        texture->name = name;
+        texture->name = string_id_intern( name );
 
         resource_cache.textures.insert( hash_calculate( name ), texture );
 
@@ -428,7 +427,7 @@ Sampler* Renderer::create_sampler( const SamplerCreation& creation ) {
     if ( sampler ) {
         SamplerHandle handle = gpu->create_sampler( creation );
         sampler->handle = handle;
-        sampler->name = creation.name;
+        sampler->name = string_id_intern( creation.name );
         gpu->query_sampler( handle, sampler->desc );
 
         if ( creation.name != nullptr ) {
@@ -447,8 +446,8 @@ RenderStage* Renderer::create_stage( const RenderStageCreation& creation ) {
     if ( stage ) {
         // TODO: allocator
         stage->features.init( gpu->allocator, 1 );
-        stage->name = creation.name;
-        stage->name_hash = hydra::hash_calculate( creation.name );
+        stage->name = string_id_intern( creation.name );
+        stage->name_hash = stage->name.hash;
         stage->type = creation.type;
         stage->resize = creation.resize;
         stage->clear = creation.clear;
@@ -508,7 +507,7 @@ Shader* Renderer::create_shader( const ShaderCreation& creation ) {
         // Copy hfx header.
         shader->hfx_binary = creation.hfx_;
         shader->hfx_binary_v2 = creation.hfx_blueprint;
-        shader->name = creation.hfx_blueprint->name.c_str();
+        shader->name = string_id_intern( creation.hfx_blueprint->name.c_str() );
 
         const u32 num_passes = shader->hfx_binary ? shader->hfx_binary->header->num_passes : shader->hfx_binary_v2->passes.size;
         // First create arrays
@@ -520,7 +519,7 @@ Shader* Renderer::create_shader( const ShaderCreation& creation ) {
 
         for ( uint32_t i = 0; i < num_passes; ++i ) {
             ShaderPass& pass = shader->passes[ i ];
-            pipeline_create( *gpu, creation.hfx_, creation.hfx_blueprint, i, creation.outputs[ i ], pass.pipeline, &pass.resource_layout, 1 );
+            pipeline_create( *this, creation.hfx_, creation.hfx_blueprint, i, creation.outputs[ i ], pass.pipeline, &pass.resource_layout, &pass.resource_layout_hash, 1 );
         }
 
         if ( creation.hfx_blueprint->name.c_str() != nullptr ) {
@@ -547,7 +546,7 @@ Material* Renderer::create_material( const MaterialCreation& creation ) {
         u32 num_passes = material->shader->get_num_passes();
         // First create arrays
         material->passes.init( gpu->allocator, num_passes, num_passes );
-        material->name = creation.name;
+        material->name = string_id_intern( creation.name );
         
         // Cache pipelines and resources
         for ( uint32_t i = 0; i < num_passes; ++i ) {
@@ -556,7 +555,8 @@ Material* Renderer::create_material( const MaterialCreation& creation ) {
             pass.pipeline = shader_pass.pipeline;
             // Set layout internally
             creation.resource_lists[ i ].set_layout( shader_pass.resource_layout );
-            pass.resource_list = gpu->create_resource_list( creation.resource_lists[ i ] );
+            // Materials with the same resources share the resource list.
+            pass.resource_list = gpu->create_resource_list_cached( creation.resource_lists[ i ] );
 
             material->shader->get_compute_dispatches( i, pass.compute_dispatch );
         }
@@ -581,7 +581,7 @@ RenderView* Renderer::create_render_view( Camera* camera, cstring name, u32 widt
     RenderView* render_view = render_views.obtain();
 
     render_view->camera = camera;
-    render_view->name = name;
+    render_view->name = string_id_intern( name );
     render_view->width = u16( width_ );
     render_view->height = u16( height_ );
     render_view->dependant_render_stages.init( gpu->allocator, num_stages + 2, stages_ ? num_stages : 0 );
@@ -658,7 +658,7 @@ void Renderer::destroy_stage( RenderStage* stage ) {
 
     stage->features.shutdown();
 
-    resource_cache.stages.remove( hash_calculate( stage->name ) );
+    resource_cache.stages.remove( stage->name.hash );
     stages.release( stage );
 }
 
@@ -677,12 +677,12 @@ void Renderer::destroy_shader( Shader* shader ) {
     for ( uint32_t i = 0; i < passes; ++i ) {
         ShaderPass& pass = shader->passes[ i ];
         gpu->destroy_pipeline( pass.pipeline );
-        gpu->destroy_resource_layout( pass.resource_layout );
+        destroy_resource_layout( pass.resource_layout, pass.resource_layout_hash );
     }
 
     shader->passes.shutdown();
 
-    resource_cache.shaders.remove( hash_calculate( shader->hfx_binary_v2->name.c_str() ) );
+    resource_cache.shaders.remove( shader->name.hash );
     
     hfree( shader->hfx_binary_v2, gpu->allocator );
     shaders.release( shader );
@@ -700,12 +700,12 @@ void Renderer::destroy_material( Material* material ) {
 
     for ( uint32_t i = 0; i < material->passes.size; ++i ) {
         MaterialPass& pass = material->passes[ i ];
-        gpu->destroy_resource_list( pass.resource_list );
+        gpu->destroy_resource_list_cached( pass.resource_list );
     }
 
     material->passes.shutdown();
     
-    resource_cache.materials.remove( hash_calculate( material->name ) );
+    resource_cache.materials.remove( material->name.hash );
     materials.release( material );
 }
 
@@ -721,10 +721,116 @@ void Renderer::destroy_render_view( RenderView* render_view ) {
 
     render_view->dependant_render_stages.shutdown();
 
-    resource_cache.render_views.remove( hash_calculate( render_view->name ) );
+    resource_cache.render_views.remove( render_view->name.hash );
     render_views.release( render_view );
 }
 
+//
+// Same canonical form used for the layout hash: names and counts are ignored, missing binding points are the binding index.
+static bool resource_layout_equals( const ResourceLayoutCreation& a, const ResourceLayoutCreation& b ) {
+    if ( a.set_index != b.set_index || a.num_bindings != b.num_bindings ) {
+        return false;
+    }
+
+    for ( u32 i = 0; i < a.num_bindings; ++i ) {
+        const ResourceLayoutCreation::Binding& binding_a = a.bindings[ i ];
+        const ResourceLayoutCreation::Binding& binding_b = b.bindings[ i ];
+        const u16 start_a = binding_a.start == u16_max ? ( u16 )i : binding_a.start;
+        const u16 start_b = binding_b.start == u16_max ? ( u16 )i : binding_b.start;
+        if ( binding_a.type != binding_b.type || start_a != start_b ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ResourceLayoutHandle Renderer::create_resource_layout( const ResourceLayoutCreation& creation, u64 hash ) {
+    SharedResourceLayout* shared_layout = resource_cache.resource_layouts.get( hash );
+    if ( shared_layout ) {
+        if ( resource_layout_equals( shared_layout->creation, creation ) ) {
+            ++shared_layout->references;
+            return shared_layout->handle;
+        }
+
+        // Hash collision: the layout is owned by the caller, destroy_resource_layout recognizes it by handle.
+        hprint( "Resource layout hash collision %llx, creating an unshared layout.\n", hash );
+        return gpu->create_resource_layout( creation );
+    }
+
+    // Copy the names after the struct: they come from the shader blob, that can be unloaded before the layout.
+    sizet names_size = creation.name ? strlen( creation.name ) + 1 : 0;
+    for ( u32 i = 0; i < creation.num_bindings; ++i ) {
+        names_size += creation.bindings[ i ].name ? strlen( creation.bindings[ i ].name ) + 1 : 0;
+    }
+
+    shared_layout = ( SharedResourceLayout* )halloca( sizeof( SharedResourceLayout ) + names_size, gpu->allocator );
+    shared_layout->creation = creation;
+
+    char* names = ( char* )( shared_layout + 1 );
+    if ( creation.name ) {
+        const sizet length = strlen( creation.name ) + 1;
+        memcpy( names, creation.name, length );
+        shared_layout->creation.name = names;
+        names += length;
+    }
+    for ( u32 i = 0; i < creation.num_bindings; ++i ) {
+        cstring name = creation.bindings[ i ].name;
+        if ( name ) {
+            const sizet length = strlen( name ) + 1;
+            memcpy( names, name, length );
+            shared_layout->creation.bindings[ i ].name = names;
+            names += length;
+        }
+    }
+
+    shared_layout->handle = gpu->create_resource_layout( shared_layout->creation );
+    shared_layout->references = 1;
+    resource_cache.resource_layouts.insert( hash, shared_layout );
+
+    return shared_layout->handle;
+}
+
+bool Renderer::load_resource_layout_table( cstring filename ) {
+    hydra::FileReadResult frr = hydra::file_read_binary( filename, gpu->allocator );
+    if ( frr.size == 0 ) {
+        return false;
+    }
+
+    if ( ( ( hydra::BlobHeader* )frr.data )->version != hfx::ResourceLayoutTableBlueprint::k_version ) {
+        hprint( "Layout table %s has a different version, skipping.\n", filename );
+        hfree( frr.data, gpu->allocator );
+        return false;
+    }
+
+    // Shared layouts copy the binding names, the table memory is not needed after creation.
+    hfx::ResourceLayoutTableBlueprint* layout_table = ( hfx::ResourceLayoutTableBlueprint* )frr.data;
+    layout_table->resolve_pointers();
+
+    for ( u32 l = 0; l < layout_table->layouts.size; ++l ) {
+        const hfx::ResourceLayoutBlueprint& layout = layout_table->layouts[ l ];
+        create_resource_layout( layout.creation, layout.hash );
+    }
+
+    hprint( "Created %u shared resource layouts from %s.\n", layout_table->layouts.size, filename );
+    hfree( frr.data, gpu->allocator );
+    return true;
+}
+
+void Renderer::destroy_resource_layout( ResourceLayoutHandle layout, u64 hash ) {
+    // Layouts not coming from the cache, or not shared because of a hash collision, are owned by the caller.
+    SharedResourceLayout* shared_layout = hash ? resource_cache.resource_layouts.get( hash ) : nullptr;
+    if ( !shared_layout || shared_layout->handle.index != layout.index ) {
+        gpu->destroy_resource_layout( layout );
+        return;
+    }
+
+    if ( --shared_layout->references == 0 ) {
+        gpu->destroy_resource_layout( shared_layout->handle );
+        resource_cache.resource_layouts.remove( hash );
+        hfree( shared_layout, gpu->allocator );
+    }
+}
+
 void* Renderer::dynamic_allocate( Buffer* buffer ) {
     MapBufferParameters cb_map = { buffer->handle, 0, 0 };
     return gpu->map_buffer( cb_map );
@@ -744,6 +850,32 @@ void Renderer::unmap_buffer( Buffer* buffer ) {
     }
 }
 
+u32 Renderer::update_constants( Buffer* buffer, const void* data, void* shadow, const ShaderConstantField* fields, u32 num_fields ) {
+
+    const u32 size = buffer->desc.size;
+
+    if ( buffer->desc.parent_handle.index != k_invalid_index ) {
+        // Dynamic buffers: memory from the previous frame is not reused.
+        void* gpu_data = dynamic_allocate( buffer );
+        if ( !gpu_data ) {
+            return 0;
+        }
+        memcpy( gpu_data, data, size );
+        memcpy( shadow, data, size );
+        return size;
+    }
+
+    void* gpu_data = map_buffer( buffer, 0, size );
+    if ( !gpu_data ) {
+        return 0;
+    }
+
+    const u32 written_bytes = shader_constants_copy_dirty( data, shadow, gpu_data, fields, num_fields );
+    unmap_buffer( buffer );
+
+    return written_bytes;
+}
+
 bool Renderer::resize_stage( RenderStage* stage, u32 new_width, u32 new_height ) {
 
     if ( !stage->resize.resize )
@@ -1168,6 +1300,7 @@ Resource* ShaderLoader::create_from_file( cstring name, cstring filename, Resour
     hydra::FileReadResult frr = hydra::file_read_binary( filename, renderer->gpu->allocator );
     if ( frr.size ) {
         hfx::ShaderEffectBlueprint* hfx = bs.read<hfx::ShaderEffectBlueprint>( renderer->gpu->allocator, hfx::ShaderEffectBlueprint::k_version, frr.size, frr.data );
+        hfx->resolve_pointers();
 
         RenderPassOutput rpo[ 8 ];
 
@@ -1311,6 +1444,7 @@ void ResourceCache::init( Allocator* allocator ) {
     shaders.init( allocator, 16 );
     materials.init( allocator, 16 );
     render_views.init( allocator, 16 );
+    resource_layouts.init( allocator, 16 );
 }
 
 void ResourceCache::shutdown( Renderer* renderer ) {
@@ -1360,6 +1494,13 @@ void ResourceCache::shutdown( Renderer* renderer ) {
         renderer->destroy_render_view( view );
     }
 
+    // Layouts created from the layout table have no other owner.
+    for ( it = resource_layouts.iterator_begin(); it.is_valid(); resource_layouts.iterator_advance( it ) ) {
+        SharedResourceLayout* shared_layout = resource_layouts.get( it );
+        renderer->gpu->destroy_resource_layout( shared_layout->handle );
+        hfree( shared_layout, renderer->gpu->allocator );
+    }
+
     textures.shutdown();
     buffers.shutdown();
     samplers.shutdown();
@@ -1367,6 +1508,7 @@ void ResourceCache::shutdown( Renderer* renderer ) {
     shaders.shutdown();
     materials.shutdown();
     render_views.shutdown();
+    resource_layouts.shutdown();
 }
 
 } // namespace graphics
@@ -1,6 +1,6 @@
 #pragma once
 
-//  Hydra Rendering - v0.46
+//  Hydra Rendering - v0.49
 //
 //  High level rendering implementation based on Hydra Graphics library.
 //
@@ -14,6 +14,9 @@
 //
 // Revision history //////////////////////
 //
+//      0.49 (2021/12/29): + Added update of constant buffers writing only the fields changed since the last update.
+//      0.48 (2021/12/26): + Added loading of the HFX layout table, to create all the unique resource layouts upfront.
+//      0.47 (2021/12/25): + Pipelines are created from the creation structs baked in HFX binaries. + Resource layouts with the same hash are shared between shaders.
 //      0.39 (2021/11/07): + Added ShaderPass and MaterialPass to remove too many arrays in Shaders and Materials.
 //      0.38 (2021/10/23): + Added buffer, shader and material new creation methods with just parameter for convenience.
 //      0.37 (2021/10/21): + Added methods to remove the need to access GPUDevice directly.
@@ -187,6 +190,7 @@ struct ShaderPass {
 
     PipelineHandle                  pipeline;
     ResourceLayoutHandle            resource_layout;
+    u64                             resource_layout_hash = 0;   // Non zero when shared through the ResourceCache.
 }; // struct ShaderPass
 
 //
@@ -392,6 +396,17 @@ struct RenderStage : public hydra::Resource {
 
 //
 //
+//
+// Resource layout shared by all the shaders with the same layout hash.
+// Binding names are copied after the struct, in the same allocation, so they outlive the first shader.
+struct SharedResourceLayout {
+
+    ResourceLayoutCreation          creation;               // Compared on hash hits, names point into the owned storage.
+    ResourceLayoutHandle            handle;
+    u32                             references;
+
+}; // struct SharedResourceLayout
+
 struct ResourceCache {
 
     void                            init( Allocator* allocator );
@@ -404,6 +419,7 @@ struct ResourceCache {
     FlatHashMap<u64, Shader*>       shaders;
     FlatHashMap<u64, Material*>     materials;
     FlatHashMap<u64, RenderView*>   render_views;    
+    FlatHashMap<u64, SharedResourceLayout*> resource_layouts;
 
 }; // struct ResourceCache
 
@@ -456,6 +472,9 @@ struct Renderer : public Service {
 
     RenderView*                 create_render_view( Camera* camera, cstring name, u32 width, u32 height, RenderStage** stages, u32 num_stages );
 
+    ResourceLayoutHandle        create_resource_layout( const ResourceLayoutCreation& creation, u64 hash );    // Returns the existing layout with the same hash and bindings, if any.
+    bool                        load_resource_layout_table( cstring filename );     // Create all the layouts of a table generated by hfx, shared until shutdown.
+
     void                        destroy_buffer( Buffer* buffer );
     void                        destroy_texture( Texture* texture );
     void                        destroy_sampler( Sampler* sampler );
@@ -463,6 +482,7 @@ struct Renderer : public Service {
     void                        destroy_shader( Shader* shader );
     void                        destroy_material( Material* material );
     void                        destroy_render_view( RenderView* render_view );
+    void                        destroy_resource_layout( ResourceLayoutHandle layout, u64 hash );
 
     // Update resources
     void*                       dynamic_allocate( Buffer* buffer );     // Used for dynamic buffers, no need to unmap.
@@ -470,12 +490,16 @@ struct Renderer : public Service {
     void*                       map_buffer( Buffer* buffer, u32 offset = 0, u32 size = 0 );
     void                        unmap_buffer( Buffer* buffer );
 
+    // Write the fields of data that differ from shadow, using the field table generated by hfx. Shadow is updated as well.
+    // Dynamic buffers get new memory each frame, so they are always written entirely. Returns the bytes written.
+    u32                         update_constants( Buffer* buffer, const void* data, void* shadow, const ShaderConstantField* fields, u32 num_fields );
+
     bool                        resize_stage( RenderStage* stage, u32 new_width, u32 new_height );
     bool                        resize_view( RenderView* view, u32 new_width, u32 new_height );
 
     void                        reload_resource_list( Material* material, u32 index );
 
-    CommandBuffer*              get_command_buffer( QueueType::Enum type, bool begin )  { return gpu->get_command_buffer( type, begin ); }
+    CommandBuffer*              get_command_buffer( u32 thread_index, QueueType::Enum type, bool begin )  { return gpu->get_command_buffer( thread_index, type, begin ); }
     void                        queue_command_buffer( hydra::gfx::CommandBuffer* commands ) { gpu->queue_command_buffer( commands ); }
 
     // Draw
@@ -26,11 +26,8 @@ void SpriteBatch::init( hydra::gfx::Renderer* renderer, Allocator* allocator ) {
 
     using namespace hydra::gfx;
 
-    BufferCreation vbc = { BufferType::Vertex_mask, ResourceUsageType::Dynamic, sizeof( SpriteGPUData ) * k_max_sprites, nullptr, "sprites_batch_vb" };
-    sprite_instance_vb = renderer->create_buffer( vbc );
-
-    vbc.set_name( "sprite_batch_cb" ).set( BufferType::Constant_mask, ResourceUsageType::Dynamic, sizeof( SpriteConstants ) );
-    sprite_cb = renderer->create_buffer( vbc );
+    BufferCreation cbc = { BufferType::Constant_mask, ResourceUsageType::Dynamic, sizeof( SpriteConstants ), nullptr, "sprite_batch_cb" };
+    sprite_cb = renderer->create_buffer( cbc );
 
     current_pipeline.index = k_invalid_pipeline.index;
     current_resource_list.index = k_invalid_list.index;
@@ -38,7 +35,6 @@ void SpriteBatch::init( hydra::gfx::Renderer* renderer, Allocator* allocator ) {
 
 void SpriteBatch::shutdown( hydra::gfx::Renderer* renderer ) {
     renderer->destroy_buffer( sprite_cb );
-    renderer->destroy_buffer( sprite_instance_vb );
 
     draw_batches.shutdown();
 }
@@ -69,9 +65,12 @@ void SpriteBatch::begin( hydra::gfx::Renderer& renderer, hydra::gfx::Camera& cam
         renderer.unmap_buffer( sprite_cb );
     }
 
-    // Map sprite instance data
+    // Sprite instance data is allocated from the dynamic allocator each frame.
     num_sprites = 0;
-    gpu_data = ( SpriteGPUData* )renderer.map_buffer( sprite_instance_vb );
+    DynamicAllocation instances = renderer.gpu->dynamic_allocate( sizeof( SpriteGPUData ) * k_max_sprites, BufferType::Vertex_mask );
+    instance_buffer = instances.buffer;
+    instance_offset = instances.offset;
+    gpu_data = ( SpriteGPUData* )instances.data;
 }
 
 void SpriteBatch::end( hydra::gfx::Renderer& renderer ) {
@@ -82,7 +81,6 @@ void SpriteBatch::end( hydra::gfx::Renderer& renderer ) {
 
     set( k_invalid_pipeline, k_invalid_list );
 
-    renderer.unmap_buffer( sprite_instance_vb );
     gpu_data = nullptr;
 }
 
@@ -123,7 +121,7 @@ void SpriteBatch::draw( hydra::gfx::CommandBuffer* commands, u64& sort_key ) {
 
         DrawBatch& batch = draw_batches[ i ];
         if ( batch.count ) {
-            commands->bind_vertex_buffer( sort_key++, sprite_instance_vb->handle, 0, 0 );
+            commands->bind_vertex_buffer( sort_key++, instance_buffer, 0, instance_offset );
             commands->bind_pipeline( sort_key++, batch.pipeline );
             commands->bind_resource_list( sort_key++, &batch.resource_list, 1, 0, 0 );
             commands->draw( sort_key++, TopologyType::Triangle, 0, 6, batch.offset, batch.count);
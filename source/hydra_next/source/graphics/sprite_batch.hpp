@@ -63,8 +63,9 @@ struct SpriteBatch {
     Array<DrawBatch>                draw_batches;
 
     hydra::gfx::Buffer*             sprite_cb;
-    hydra::gfx::Buffer*             sprite_instance_vb;
 
+    hydra::gfx::BufferHandle        instance_buffer;                // Ring or overflow page of the dynamic allocator.
+    u32                             instance_offset = 0;
     SpriteGPUData*                  gpu_data        = nullptr;
     u32                             num_sprites     = 0;
     u32                             previous_offset = 0;
@@ -0,0 +1,873 @@
+//
+//  Hydra Data Format - v0.03
+
+#include "kernel/data_format.hpp"
+#include "kernel/lexer.hpp"
+#include "kernel/file.hpp"
+#include "kernel/log.hpp"
+#include "kernel/memory.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace hdf {
+
+static cstring s_primitive_types_names = "6int32 7uint32 6int16 7uint16 5int8 6uint8 6int64 7uint64 6float 7double 5bool 7string";
+
+void Parser::init( Parser* parser, Lexer* lexer, hydra::Allocator* allocator ) {
+
+    parser->lexer = lexer;
+    parser->allocator = allocator;
+    parser->attributes = Attributes();
+
+    // Members point to their type, so types can never be reallocated.
+    parser->types.init( allocator, k_max_types );
+
+    // Use a single string with run-length encoding of names.
+    char* names = (char*)s_primitive_types_names;
+
+    const u32 k_primitive_types = Type::Primitive_None;
+    for ( u32 i = 0; i < k_primitive_types; ++i ) {
+        Type primitive_type {};
+
+        primitive_type.type = Type::Types_Primitive;
+        primitive_type.names.init( allocator, 0 );
+        primitive_type.types.init( allocator, 0 );
+        primitive_type.members.init( allocator, 0 );
+        // Get the length encoded as first character of the name and remove the space (length - 1)
+        const u32 length = names[0] - '0';
+        primitive_type.name.length = length - 1;
+        // Skip first character and let this string point into the master one.
+        primitive_type.name.text = ++names;
+        primitive_type.primitive_type = ( Type::PrimitiveTypes )i;
+        // Advance to next name
+        names += length;
+
+        parser->types.push( primitive_type );
+    }
+}
+
+void Parser::shutdown( Parser* parser ) {
+
+    for ( u32 i = 0; i < parser->types.size; ++i ) {
+        Type& type = parser->types[ i ];
+        type.names.shutdown();
+        type.types.shutdown();
+        type.members.shutdown();
+    }
+
+    parser->types.shutdown();
+}
+
+void Parser::generate_ast( Parser* parser ) {
+
+    // Read source text until the end.
+        // The main body can be a list of declarations.
+    bool parsing = true;
+
+    while ( parsing ) {
+
+        Token token;
+        lexer_next_token( parser->lexer, token );
+
+        switch ( token.type ) {
+
+            case Token::Token_Identifier:
+            {
+                identifier( parser, token );
+                break;
+            }
+
+            case Token::Token_OpenBracket:
+            {
+                declaration_attributes( parser, parser->attributes );
+                break;
+            }
+
+            case Token::Type::Token_EndOfStream:
+            {
+                parsing = false;
+                break;
+            }
+
+            default:
+            {
+                break;
+            }
+        }
+    }
+}
+
+void Parser::identifier( Parser* parser, const Token& token ) {
+
+    // Scan the name to know which
+    for ( u32 i = 0; i < token.text.length; ++i ) {
+        char c = *( token.text.text + i );
+
+        switch ( c ) {
+            case 's':
+            {
+                if ( lexer_expect_keyword( token.text, 6, "struct" ) ) {
+                    declaration_struct( parser );
+                    return;
+                }
+
+                break;
+            }
+
+            case 'e':
+            {
+                if ( lexer_expect_keyword( token.text, 4, "enum" ) ) {
+                    declaration_enum( parser );
+                    return;
+                }
+                break;
+            }
+
+        }
+    }
+}
+
+const Type* Parser::find_type( Parser* parser, const hydra::StringView& name ) {
+
+    const u32 types_count = ( u32 )parser->types.size;
+    for ( u32 i = 0; i < types_count; ++i ) {
+        const Type* type = &parser->types[ i ];
+        if ( hydra::StringView::equals( name, type->name ) ) {
+            return type;
+        }
+    }
+    return nullptr;
+}
+
+void Parser::add_type( Parser* parser, const Type& type ) {
+
+    if ( parser->types.size >= k_max_types ) {
+        char name_buffer[ 256 ];
+        hydra::StringView::copy_to( type.name, name_buffer, 256 );
+        hprint( "HDF error: too many types, cannot add %s.\n", name_buffer );
+
+        Type discarded_type = type;
+        discarded_type.names.shutdown();
+        discarded_type.types.shutdown();
+        discarded_type.members.shutdown();
+        return;
+    }
+
+    parser->types.push( type );
+}
+
+//
+// Parses '[ attribute, attribute( value ) ]', after the open bracket.
+void Parser::declaration_attributes( Parser* parser, Attributes& attributes ) {
+
+    Token token;
+    while ( !lexer_equals_token( parser->lexer, token, Token::Token_CloseBracket ) ) {
+
+        if ( token.type == Token::Token_EndOfStream ) {
+            return;
+        }
+
+        if ( token.type != Token::Token_Identifier ) {
+            continue;
+        }
+
+        if ( lexer_expect_keyword( token.text, 4, "blob" ) ) {
+            attributes.blob = true;
+        }
+        else if ( lexer_expect_keyword( token.text, 3, "soa" ) ) {
+            attributes.soa = true;
+        }
+        else if ( lexer_expect_keyword( token.text, 7, "version" ) ) {
+            if ( !lexer_expect_token( parser->lexer, token, Token::Token_OpenParen ) ) {
+                return;
+            }
+            if ( !lexer_expect_token( parser->lexer, token, Token::Token_Number ) ) {
+                return;
+            }
+            attributes.version = ( u32 )atoi( token.text.text );
+
+            if ( !lexer_expect_token( parser->lexer, token, Token::Token_CloseParen ) ) {
+                return;
+            }
+        }
+        else {
+            char name_buffer[ 256 ];
+            hydra::StringView::copy_to( token.text, name_buffer, 256 );
+            hprint( "HDF error: unknown attribute %s at line %u.\n", name_buffer, parser->lexer->line );
+        }
+    }
+}
+
+void Parser::declaration_struct( Parser* parser ) {
+
+    // Attributes are consumed by this declaration.
+    const Attributes struct_attributes = parser->attributes;
+    parser->attributes = Attributes();
+
+    // name
+    Token token;
+    if ( !lexer_expect_token( parser->lexer, token, Token::Token_Identifier ) ) {
+        return;
+    }
+
+    // Cache name string
+    hydra::StringView name = token.text;
+
+    if ( !lexer_expect_token( parser->lexer, token, Token::Token_OpenBrace ) ) {
+        return;
+    }
+
+    // Add new type
+    Type type {};
+    type.name = name;
+    type.type = Type::Types_Struct;
+    type.names.init( parser->allocator, 8 );
+    type.types.init( parser->allocator, 8 );
+    type.members.init( parser->allocator, 8 );
+    type.exportable = true;
+    type.blob = struct_attributes.blob;
+
+    Attributes member_attributes;
+
+    // Parse struct internals
+    while ( !lexer_equals_token( parser->lexer, token, Token::Token_CloseBrace ) ) {
+
+        if ( token.type == Token::Token_EndOfStream || parser->lexer->error ) {
+            break;
+        }
+
+        if ( token.type == Token::Token_OpenBracket ) {
+            declaration_attributes( parser, member_attributes );
+        }
+        else if ( token.type == Token::Token_Identifier ) {
+            declaration_variable( parser, token.text, type, member_attributes );
+            member_attributes = Attributes();
+        }
+    }
+
+    add_type( parser, type );
+}
+
+//
+// Parses 'type name;', 'type name[ count ];' or 'type name[];'.
+void Parser::declaration_variable( Parser* parser, const hydra::StringView& type_name, Type& type, const Attributes& attributes ) {
+    const Type* variable_type = find_type( parser, type_name );
+    Token token;
+    // Name
+    if ( !lexer_expect_token( parser->lexer, token, Token::Token_Identifier ) ) {
+        return;
+    }
+
+    // Cache name string
+    hydra::StringView name = token.text;
+
+    if ( !variable_type ) {
+        char name_buffer[ 256 ];
+        hydra::StringView::copy_to( type_name, name_buffer, 256 );
+        hprint( "HDF error: unknown type %s at line %u. Types must be declared before use.\n", name_buffer, parser->lexer->line );
+    }
+
+    Member member;
+    member.version = attributes.version;
+
+    lexer_next_token( parser->lexer, token );
+    if ( token.type == Token::Token_OpenBracket ) {
+        lexer_next_token( parser->lexer, token );
+        if ( token.type == Token::Token_Number ) {
+            member.array_count = ( u32 )atoi( token.text.text );
+            lexer_next_token( parser->lexer, token );
+        }
+        else {
+            member.array_count = Member::k_dynamic_array;
+        }
+
+        if ( !lexer_check_token( parser->lexer, token, Token::Token_CloseBracket ) ) {
+            return;
+        }
+        lexer_next_token( parser->lexer, token );
+    }
+
+    if ( !lexer_check_token( parser->lexer, token, Token::Token_Semicolon ) ) {
+        return;
+    }
+
+    // Structure of arrays is supported only for dynamic arrays of structs.
+    if ( attributes.soa ) {
+        if ( variable_type && variable_type->type == Type::Types_Struct && member.array_count == Member::k_dynamic_array ) {
+            member.soa = true;
+            // Types are stored in a non growing array, the const cast just marks the type to output the container.
+            const_cast<Type*>( variable_type )->soa_container = true;
+        }
+        else {
+            char name_buffer[ 256 ];
+            hydra::StringView::copy_to( name, name_buffer, 256 );
+            hprint( "HDF error: [soa] member %s must be a dynamic array of structs.\n", name_buffer );
+        }
+    }
+
+    type.version = member.version > type.version ? member.version : type.version;
+
+    type.types.push( variable_type );
+    type.names.push( name );
+    type.members.push( member );
+}
+
+
+void Parser::declaration_enum( Parser* parser ) {
+    parser->attributes = Attributes();
+
+    Token token;
+    // Name
+    if ( !lexer_expect_token( parser->lexer, token, Token::Token_Identifier ) ) {
+        return;
+    }
+
+    // Cache name string
+    hydra::StringView name = token.text;
+
+    // Optional ': type' for the enum
+    lexer_next_token( parser->lexer, token );
+    if ( token.type == Token::Token_Colon ) {
+        // Skip to open brace
+        lexer_next_token( parser->lexer, token );
+        // Token now contains type_name
+        lexer_next_token( parser->lexer, token );
+        // Token now contains open brace.
+    }
+
+    if ( token.type != Token::Token_OpenBrace ) {
+        return;
+    }
+
+    // Add new type
+    Type type {};
+    type.name = name;
+    type.type = Type::Types_Enum;
+    type.names.init( parser->allocator, 8 );
+    type.types.init( parser->allocator, 0 );
+    type.members.init( parser->allocator, 0 );
+    type.exportable = true;
+
+    // Parse struct internals
+    while ( !lexer_equals_token( parser->lexer, token, Token::Token_CloseBrace ) ) {
+
+        if ( token.type == Token::Token_EndOfStream ) {
+            break;
+        }
+
+        if ( token.type == Token::Token_Identifier ) {
+            type.names.push( token.text );
+        }
+    }
+
+    add_type( parser, type );
+}
+
+// Code Generator ///////////////////////////
+
+static cstring s_primitive_type_cpp[] = { "int32_t", "uint32_t", "int16_t", "uint16_t", "int8_t", "uint8_t", "int64_t", "uint64_t", "float", "double", "bool", "const char*" };
+static cstring s_primitive_type_imgui[] = { "ImGuiDataType_S32", "ImGuiDataType_U32", "ImGuiDataType_S16", "ImGuiDataType_U16", "ImGuiDataType_S8", "ImGuiDataType_U8", "ImGuiDataType_S64", "ImGuiDataType_U64", "ImGuiDataType_Float", "ImGuiDataType_Double" };
+
+static const u32 k_soa_column_alignment = 64;
+
+void CodeGenerator::init( CodeGenerator* code_generator, const Parser* parser, u32 buffer_size, hydra::Allocator* allocator ) {
+
+    code_generator->parser = parser;
+
+    for ( u32 i = 0; i < ArraySize( code_generator->string_buffers ); i++ ) {
+        code_generator->string_buffers[ i ].init( buffer_size, allocator );
+    }
+}
+
+void CodeGenerator::shutdown( CodeGenerator* code_generator ) {
+
+    for ( u32 i = 0; i < ArraySize( code_generator->string_buffers ); i++ ) {
+        code_generator->string_buffers[ i ].shutdown();
+    }
+}
+
+bool CodeGenerator::generate_code( CodeGenerator* code_generator, cstring filename ) {
+
+    // Create file
+    hydra::FileHandle output_file = nullptr;
+    hydra::file_open( filename, "w", &output_file );
+
+    if ( !output_file ) {
+        hprint( "HDF error: cannot open output file %s. Aborting.\n", filename );
+        return false;
+    }
+
+    const Parser& parser = *code_generator->parser;
+    const u32 types_count = ( u32 )parser.types.size;
+
+    // Dynamic arrays need the hydra containers.
+    // Nested structs are serialized with the version of the root blob, so all the blobs use the highest version.
+    bool has_dynamic_arrays = false;
+    code_generator->data_version = 0;
+    for ( u32 i = 0; i < types_count; ++i ) {
+        const Type& type = parser.types[ i ];
+        code_generator->data_version = type.version > code_generator->data_version ? type.version : code_generator->data_version;
+        for ( u32 m = 0; m < type.members.size; ++m ) {
+            has_dynamic_arrays = has_dynamic_arrays || ( type.members[ m ].array_count == Member::k_dynamic_array && !type.members[ m ].soa );
+        }
+    }
+
+    fprintf( output_file, "\n#pragma once\n#include <stdint.h>\n" );
+    if ( code_generator->generate_blob_code ) {
+        fprintf( output_file, "#include <string.h>\n#include \"kernel/blob_serialization.hpp\"\n" );
+    }
+    else if ( has_dynamic_arrays ) {
+        fprintf( output_file, "#include \"kernel/array.hpp\"\n" );
+    }
+    fprintf( output_file, "\n// This file is autogenerated!\n\n" );
+
+    for ( u32 i = 0; i < types_count; ++i ) {
+        const Type& type = parser.types[i];
+
+        if ( !type.exportable )
+            continue;
+
+        switch ( type.type ) {
+            case Type::Types_Struct:
+            {
+                output_cpp_struct( code_generator, output_file, type );
+
+                // Element types are declared before the structs using them, and so are their containers.
+                if ( type.soa_container ) {
+                    output_cpp_soa( code_generator, output_file, type );
+                }
+                break;
+            }
+
+            case Type::Types_Enum:
+            {
+                output_cpp_enum( code_generator, output_file, type );
+                break;
+            }
+
+            case Type::Types_Command:
+            {
+                //output_cpp_command( code_generator, output_file, type );
+                break;
+            }
+
+            default:
+            {
+                break;
+            }
+        }
+    }
+
+    hydra::file_close( output_file );
+    return true;
+}
+
+//
+// Writes the C++ type of a single element in type_buffer.
+static void member_element_type( CodeGenerator* code_generator, const Type& member_type, char* type_buffer ) {
+
+    switch ( member_type.type ) {
+        case Type::Types_Primitive:
+        {
+            const bool blob_string = member_type.primitive_type == Type::Primitive_String && code_generator->generate_blob_code;
+            strcpy_s( type_buffer, 256, blob_string ? "hydra::RelativeString" : s_primitive_type_cpp[ member_type.primitive_type ] );
+            break;
+        }
+
+        case Type::Types_Enum:
+        {
+            hydra::StringView::copy_to( member_type.name, type_buffer, 240 );
+            strcat_s( type_buffer, 256, "::Enum" );
+            break;
+        }
+
+        default:
+        {
+            hydra::StringView::copy_to( member_type.name, type_buffer, 256 );
+            break;
+        }
+    }
+}
+
+//
+// Enums have no BlobSerializer overload, so they are serialized as raw memory.
+static void output_serialize_member( hydra::StringBuffer& serialize_code, const Type& member_type, const Member& member, cstring member_name, cstring tabs ) {
+
+    if ( member.array_count != 0 && member.array_count != Member::k_dynamic_array ) {
+        serialize_code.append_f( "%sfor ( uint32_t i = 0; i < %u; ++i ) {\n", tabs, member.array_count );
+        if ( member_type.type == Type::Types_Enum ) {
+            serialize_code.append_f( "%s\tserialize_memory( &data->%s[ i ], sizeof( data->%s[ i ] ) );\n", tabs, member_name, member_name );
+        }
+        else {
+            serialize_code.append_f( "%s\tserialize( &data->%s[ i ] );\n", tabs, member_name );
+        }
+        serialize_code.append_f( "%s}\n", tabs );
+    }
+    else if ( member_type.type == Type::Types_Enum && member.array_count == 0 ) {
+        serialize_code.append_f( "%sserialize_memory( &data->%s, sizeof( data->%s ) );\n", tabs, member_name, member_name );
+    }
+    else {
+        serialize_code.append_f( "%sserialize( &data->%s );\n", tabs, member_name );
+    }
+}
+
+void CodeGenerator::output_cpp_struct( CodeGenerator* code_generator, FILE* output, const Type& type ) {
+    cstring tabs = "";
+
+    code_generator->string_buffers[ 0 ].clear();
+    code_generator->string_buffers[ 1 ].clear();
+
+    hydra::StringBuffer& ui_code = code_generator->string_buffers[ 0 ];
+    hydra::StringBuffer& serialize_code = code_generator->string_buffers[ 1 ];
+
+    const bool blob = code_generator->generate_blob_code;
+
+    char name_buffer[256], member_name_buffer[256], member_type_buffer[256];
+    hydra::StringView::copy_to( type.name, name_buffer, 256 );
+
+    if ( code_generator->generate_imgui_code ) {
+        ui_code.append( "\n\tvoid reflectMembers() {\n" );
+    }
+
+    if ( blob ) {
+        serialize_code.append_f( "namespace hydra {\n\ntemplate<>\ninline void BlobSerializer::serialize<%s>( %s* data ) {\n", name_buffer, name_buffer );
+    }
+
+    if ( blob && type.blob ) {
+        fprintf( output, "%sstruct %s : public hydra::Blob {\n\n", tabs, name_buffer );
+    }
+    else {
+        fprintf( output, "%sstruct %s {\n\n", tabs, name_buffer );
+    }
+
+    const u32 members_count = ( u32 )type.types.size;
+    for ( u32 i = 0; i < members_count; ++i ) {
+        if ( !type.types[ i ] ) {
+            continue;
+        }
+
+        const Type& member_type = *type.types[i];
+        const Member& member = type.members[ i ];
+
+        hydra::StringView::copy_to( type.names[ i ], member_name_buffer, 256 );
+        member_element_type( code_generator, member_type, member_type_buffer );
+
+        // Translate type name based on output language.
+        if ( member.array_count == Member::k_dynamic_array ) {
+            if ( member.soa ) {
+                fprintf( output, "%s\t%sSoA %s;\n", tabs, member_type_buffer, member_name_buffer );
+            }
+            else {
+                fprintf( output, "%s\t%s<%s> %s;\n", tabs, blob ? "hydra::RelativeArray" : "hydra::Array", member_type_buffer, member_name_buffer );
+            }
+        }
+        else if ( member.array_count ) {
+            fprintf( output, "%s\t%s %s[ %u ];\n", tabs, member_type_buffer, member_name_buffer, member.array_count );
+        }
+        else {
+            fprintf( output, "%s\t%s %s;\n", tabs, member_type_buffer, member_name_buffer );
+        }
+
+        // Versioned members are zeroed when reading older data.
+        if ( blob ) {
+            if ( member.version ) {
+                serialize_code.append_f( "\tif ( serializer_version >= %u ) {\n", member.version );
+                output_serialize_member( serialize_code, member_type, member, member_name_buffer, "\t\t" );
+                serialize_code.append_f( "\t}\n\telse {\n\t\tmemset( &data->%s, 0, sizeof( data->%s ) );\n\t}\n", member_name_buffer, member_name_buffer );
+            }
+            else {
+                output_serialize_member( serialize_code, member_type, member, member_name_buffer, "\t" );
+            }
+        }
+
+        if ( !code_generator->generate_imgui_code ) {
+            continue;
+        }
+
+        if ( member.array_count == Member::k_dynamic_array ) {
+            ui_code.append_f( "\t\tImGui::Text( \"%s[ %%u ]\", %s.%s );\n", member_name_buffer, member_name_buffer, member.soa ? ( blob ? "count()" : "count" ) : "size" );
+            continue;
+        }
+        if ( member.array_count ) {
+            ui_code.append_f( "\t\tImGui::Text( \"%s[ %u ]\" );\n", member_name_buffer, member.array_count );
+            continue;
+        }
+
+        switch ( member_type.type ) {
+            case Type::Types_Primitive:
+            {
+                switch ( member_type.primitive_type ) {
+                    case Type::Primitive_Int8:
+                    case Type::Primitive_Uint8:
+                    case Type::Primitive_Int16:
+                    case Type::Primitive_Uint16:
+                    case Type::Primitive_Int32:
+                    case Type::Primitive_Uint32:
+                    case Type::Primitive_Int64:
+                    case Type::Primitive_Uint64:
+                    case Type::Primitive_Float:
+                    case Type::Primitive_Double:
+                    {
+                        ui_code.append_f( "\t\tImGui::InputScalar( \"%s\", %s, &%s );\n", member_name_buffer, s_primitive_type_imgui[member_type.primitive_type], member_name_buffer );
+
+                        break;
+                    }
+
+                    case Type::Primitive_Bool:
+                    {
+                        ui_code.append_f( "\t\tImGui::Checkbox( \"%s\", &%s );\n", member_name_buffer, member_name_buffer );
+                        break;
+                    }
+
+                    case Type::Primitive_String:
+                    {
+                        ui_code.append_f( "\t\tImGui::Text( \"%s: %%s\", %s%s );\n", member_name_buffer, member_name_buffer, blob ? ".c_str()" : "" );
+                        break;
+                    }
+
+                    default:
+                    {
+                        break;
+                    }
+                }
+
+                break;
+            }
+
+            case Type::Types_Struct:
+            {
+                ui_code.append_f( "\t\tImGui::Text(\"%s\");\n", member_name_buffer );
+                ui_code.append_f( "\t\t%s.reflectMembers();\n", member_name_buffer );
+
+                break;
+            }
+
+            case Type::Types_Enum:
+            {
+                hydra::StringView::copy_to( member_type.name, member_type_buffer, 256 );
+                ui_code.append_f( "\t\tImGui::Combo( \"%s\", (int32_t*)&%s, %s::s_value_names, %s::Count );\n", member_name_buffer, member_name_buffer, member_type_buffer, member_type_buffer );
+
+                break;
+            }
+
+            default:
+            {
+                break;
+            }
+        }
+    }
+
+    if ( blob && type.blob ) {
+        fprintf( output, "\n%s\tstatic constexpr uint32_t k_version = %u;\n", tabs, code_generator->data_version );
+    }
+
+    if ( code_generator->generate_imgui_code ) {
+        ui_code.append( "\t}" );
+        ui_code.append_f( "\n\n\tvoid reflectUI() {\n\t\tImGui::Begin(\"%s\");\n\t\treflectMembers();\n\t\tImGui::End();\n\t}\n", name_buffer );
+
+        fprintf( output, "%s\n", ui_code.data );
+    }
+
+    fprintf( output, "\n%s}; // struct %s\n\n", tabs, name_buffer );
+
+    if ( blob ) {
+        serialize_code.append( "}\n\n} // namespace hydra\n\n" );
+        fprintf( output, "%s", serialize_code.data );
+    }
+}
+
+//
+// Structure of arrays container: one column per member, so a member of all the elements can be processed with SIMD.
+// Blob version uses relative arrays and can be mapped from disk, the other version has all the columns in a single
+// memory block set by the user, each column aligned to a cache line.
+void CodeGenerator::output_cpp_soa( CodeGenerator* code_generator, FILE* output, const Type& type ) {
+
+    code_generator->string_buffers[ 0 ].clear();
+    code_generator->string_buffers[ 1 ].clear();
+    code_generator->string_buffers[ 2 ].clear();
+
+    hydra::StringBuffer& serialize_code = code_generator->string_buffers[ 0 ];
+    hydra::StringBuffer& set_code = code_generator->string_buffers[ 1 ];
+    hydra::StringBuffer& size_code = code_generator->string_buffers[ 2 ];
+
+    const bool blob = code_generator->generate_blob_code;
+
+    char name_buffer[ 256 ], member_name_buffer[ 256 ], member_type_buffer[ 256 ], first_member_name[ 256 ];
+    hydra::StringView::copy_to( type.name, name_buffer, 256 );
+    first_member_name[ 0 ] = 0;
+
+    fprintf( output, "struct %sSoA {\n\n", name_buffer );
+
+    if ( blob ) {
+        serialize_code.append_f( "namespace hydra {\n\ntemplate<>\ninline void BlobSerializer::serialize<%sSoA>( %sSoA* data ) {\n", name_buffer, name_buffer );
+        set_code.append( "#if defined HYDRA_BLOB_WRITE\n\tvoid allocate( hydra::BlobSerializer& blob, uint32_t count ) {\n" );
+    }
+    else {
+        size_code.append_f( "\tstatic uint32_t memory_size( uint32_t capacity ) {\n\t\tconst uint32_t k_alignment = %u;\n\t\tuint32_t total_size = 0;\n", k_soa_column_alignment );
+        set_code.append_f( "\tvoid set( void* memory, uint32_t capacity_ ) {\n\t\tconst uint32_t k_alignment = %u;\n\t\tchar* column = ( char* )memory;\n\t\tcapacity = capacity_;\n\t\tcount = 0;\n", k_soa_column_alignment );
+    }
+
+    const u32 members_count = ( u32 )type.types.size;
+    for ( u32 i = 0; i < members_count; ++i ) {
+        if ( !type.types[ i ] ) {
+            continue;
+        }
+
+        const Type& member_type = *type.types[ i ];
+        const Member& member = type.members[ i ];
+
+        hydra::StringView::copy_to( type.names[ i ], member_name_buffer, 256 );
+
+        // Columns are arrays of a single element type.
+        if ( member.array_count != 0 || ( member_type.type == Type::Types_Primitive && member_type.primitive_type == Type::Primitive_String && blob ) ) {
+            hprint( "HDF: member %s of %s cannot be a structure of arrays column, skipped.\n", member_name_buffer, name_buffer );
+            continue;
+        }
+
+        member_element_type( code_generator, member_type, member_type_buffer );
+
+        if ( first_member_name[ 0 ] == 0 ) {
+            strcpy_s( first_member_name, 256, member_name_buffer );
+        }
+
+        if ( blob ) {
+            fprintf( output, "\thydra::RelativeArray<%s> %s;\n", member_type_buffer, member_name_buffer );
+
+            if ( member.version ) {
+                serialize_code.append_f( "\tif ( serializer_version >= %u ) {\n\t\tserialize( &data->%s );\n\t}\n", member.version, member_name_buffer );
+                serialize_code.append_f( "\telse {\n\t\tmemset( &data->%s, 0, sizeof( data->%s ) );\n\t}\n", member_name_buffer, member_name_buffer );
+            }
+            else {
+                serialize_code.append_f( "\tserialize( &data->%s );\n", member_name_buffer );
+            }
+            set_code.append_f( "\t\tblob.allocate_and_set( %s, count );\n", member_name_buffer );
+        }
+        else {
+            fprintf( output, "\t%s* %s;\n", member_type_buffer, member_name_buffer );
+
+            size_code.append_f( "\t\ttotal_size += ( ( uint32_t )sizeof( %s ) * capacity + k_alignment - 1 ) & ~( k_alignment - 1 );\n", member_type_buffer );
+            set_code.append_f( "\t\t%s = ( %s* )column;\n", member_name_buffer, member_type_buffer );
+            set_code.append_f( "\t\tcolumn += ( ( uint32_t )sizeof( %s ) * capacity + k_alignment - 1 ) & ~( k_alignment - 1 );\n", member_type_buffer );
+        }
+    }
+
+    if ( blob ) {
+        set_code.append( "\t}\n#endif // HYDRA_BLOB_WRITE\n" );
+        fprintf( output, "\n\tuint32_t count() const { return %s%s; }\n\n%s", first_member_name, first_member_name[ 0 ] ? ".size" : "0", set_code.data );
+    }
+    else {
+        size_code.append( "\t\treturn total_size;\n\t}\n" );
+        set_code.append( "\t}\n" );
+        fprintf( output, "\n\tuint32_t count = 0;\n\tuint32_t capacity = 0;\n\n" );
+        fprintf( output, "\t// Memory must be aligned to %u bytes.\n%s\n%s", k_soa_column_alignment, size_code.data, set_code.data );
+    }
+
+    fprintf( output, "\n}; // struct %sSoA\n\n", name_buffer );
+
+    if ( blob ) {
+        serialize_code.append( "}\n\n} // namespace hydra\n\n" );
+        fprintf( output, "%s", serialize_code.data );
+    }
+}
+
+//
+//
+void CodeGenerator::output_cpp_enum( CodeGenerator* code_generator, FILE* output, const Type& type ) {
+
+    // Empty enum: skip output.
+    const u32 values_count = ( u32 )type.names.size;
+    if ( values_count == 0 )
+        return;
+
+    code_generator->string_buffers[ 0 ].clear();
+    code_generator->string_buffers[ 1 ].clear();
+    code_generator->string_buffers[ 2 ].clear();
+
+    hydra::StringBuffer& values = code_generator->string_buffers[ 0 ];
+    hydra::StringBuffer& value_names = code_generator->string_buffers[ 1 ];
+    hydra::StringBuffer& value_masks = code_generator->string_buffers[ 2 ];
+
+    for ( u32 v = 0; v < values_count; ++v ) {
+        cstring separator = v == 0 ? "" : ", ";
+
+        values.append( separator );
+        values.append( type.names[ v ] );
+
+        value_names.append( separator );
+        value_names.append( "\"" );
+        value_names.append( type.names[ v ] );
+        value_names.append( "\"" );
+
+        value_masks.append( separator );
+        value_masks.append( type.names[ v ] );
+        value_masks.append_f( "_mask = 1 << %u", v );
+    }
+
+    values.append( ", Count" );
+    value_names.append( ", \"Count\"" );
+    value_masks.append_f( ", Count_mask = 1 << %u", values_count );
+
+    char name_buffer[ 256 ];
+    hydra::StringView::copy_to( type.name, name_buffer, 256 );
+
+    fprintf( output, "namespace %s {\n", name_buffer );
+
+    fprintf( output, "\tenum Enum {\n" );
+    fprintf( output, "\t\t%s\n", values.data );
+    fprintf( output, "\t};\n" );
+
+    // Write the mask
+    fprintf( output, "\n\tenum Mask {\n" );
+    fprintf( output, "\t\t%s\n", value_masks.data );
+    fprintf( output, "\t};\n" );
+
+    // Write the string values
+    fprintf( output, "\n\tstatic const char* s_value_names[] = {\n" );
+    fprintf( output, "\t\t%s\n", value_names.data );
+    fprintf( output, "\t};\n" );
+
+    fprintf( output, "\n\tstatic const char* ToString( Enum e ) {\n" );
+    fprintf( output, "\t\treturn s_value_names[(int)e];\n" );
+    fprintf( output, "\t}\n" );
+
+    fprintf( output, "} // namespace %s\n\n", name_buffer );
+}
+
+// API ////////////////////////////////////
+
+bool hdf_generate( cstring input_filename, cstring output_filename, u32 options, hydra::Allocator* allocator ) {
+
+    char* text = hydra::file_read_text( input_filename, allocator, nullptr );
+    if ( !text ) {
+        hprint( "HDF error: cannot read file %s.\n", input_filename );
+        return false;
+    }
+
+    Lexer lexer;
+    lexer_init( &lexer, text, nullptr );
+
+    Parser parser;
+    Parser::init( &parser, &lexer, allocator );
+    Parser::generate_ast( &parser );
+
+    CodeGenerator code_generator;
+    code_generator.generate_blob_code = ( options & GenerateOptions_Blob ) != 0;
+    code_generator.generate_imgui_code = ( options & GenerateOptions_ImGui ) != 0;
+    CodeGenerator::init( &code_generator, &parser, 64 * 1024, allocator );
+
+    const bool result = !lexer.error && CodeGenerator::generate_code( &code_generator, output_filename );
+    if ( lexer.error ) {
+        hprint( "HDF error: parsing %s failed at line %u.\n", input_filename, lexer.error_line );
+    }
+
+    CodeGenerator::shutdown( &code_generator );
+    Parser::shutdown( &parser );
+    lexer_terminate( &lexer );
+
+    hfree( text, allocator );
+
+    return result;
+}
+
+} // namespace hdf
@@ -0,0 +1,158 @@
+#pragma once
+
+//
+//  Hydra Data Format - v0.03
+//
+//  Parser and code generator using Hydra Data Format schema.
+//
+//      Source code     : https://www.github.com/jorenjoestar/
+//
+//      Created         : 2020/05/23, 23.36
+//
+//
+// Revision history //////////////////////
+//
+//      0.03  (2021/12/30): + Moved to HydraNext, using hydra::Array, StringBuffer and the HydraNext lexer. + Added hdf_generate.
+//      0.02  (2021/12/29): + Ported struct, enum and ImGui code generation. + Added string type, arrays and attributes.
+//                          + Added BlobSerializer code generation with versioned members. + Added structure of arrays containers.
+//      0.01  (2020/05/23): + Initial version. Code coming from CodeGenerator.h file.
+//
+// Syntax ////////////////////////////////
+//
+//      Members can be fixed arrays 'float weights[ 4 ];' or dynamic arrays 'Entity entities[];'.
+//      Attributes in square brackets precede a declaration:
+//          [blob]          on a struct, makes it the root of a blob (derives from hydra::Blob).
+//          [version(N)]    on a member, the member exists only in data of version N or later.
+//                          Nested structs are serialized with the version of the blob, so blob roots
+//                          use the highest version of all the members in the file.
+//          [soa]           on a dynamic array of structs, stores it as a structure of arrays.
+//                          A 'NameSoA' container is generated for the element struct.
+//
+// Example ///////////////////////////////
+//
+//      hdf::hdf_generate( "SimpleData.hdf", "generated/simple_data.h", hdf::GenerateOptions_Blob, allocator );
+
+#include "kernel/array.hpp"
+#include "kernel/string.hpp"
+
+#include <stdio.h>
+
+// Forward declarations
+struct Lexer;
+struct Token;
+
+namespace hdf {
+
+    //
+    //
+    enum GenerateOptions {
+        GenerateOptions_Blob        = 1 << 0,   // RelativeArray/RelativeString members and BlobSerializer specializations.
+        GenerateOptions_ImGui       = 1 << 1,   // reflectMembers/reflectUI methods.
+    }; // enum GenerateOptions
+
+    //
+    // Per member data of struct types, parallel to Type::names and Type::types.
+    struct Member {
+
+        static const u32            k_dynamic_array     = 0xffffffff;
+
+        u32                         array_count         = 0;    // 0 if not an array, k_dynamic_array if dynamic.
+        u32                         version             = 0;    // Data version that added the member.
+        bool                        soa                 = false;
+
+    }; // struct Member
+
+    //
+    //
+    struct Attributes {
+
+        u32                         version             = 0;
+        bool                        blob                = false;
+        bool                        soa                 = false;
+
+    }; // struct Attributes
+
+    //
+    //
+    struct Type {
+
+        enum Types {
+            Types_Primitive, Types_Enum, Types_Struct, Types_Command, Types_None
+        };
+
+        enum PrimitiveTypes {
+            Primitive_Int32, Primitive_Uint32, Primitive_Int16, Primitive_Uint16, Primitive_Int8, Primitive_Uint8, Primitive_Int64, Primitive_Uint64, Primitive_Float, Primitive_Double, Primitive_Bool, Primitive_String, Primitive_None
+        };
+
+        Types                       type;
+        PrimitiveTypes              primitive_type;
+        hydra::StringView           name;
+
+        hydra::Array<hydra::StringView> names;
+        hydra::Array<const Type*>   types;
+        hydra::Array<Member>        members;
+
+        u32                         version             = 0;        // Highest member version.
+        bool                        exportable          = true;
+        bool                        blob                = false;    // Root of a blob.
+        bool                        soa_container       = false;    // Used in a [soa] member, generate the SoA container.
+
+    }; // struct Type
+
+    //
+    //
+    struct Parser {
+
+        static const u32            k_max_types         = 256;      // Types are referenced by pointer, so the array never grows.
+
+        Lexer*                      lexer               = nullptr;
+        hydra::Allocator*           allocator           = nullptr;
+        hydra::Array<Type>          types;
+
+        Attributes                  attributes;                     // Parsed and waiting for the next declaration.
+
+        static void                 init( Parser* parser, Lexer* lexer, hydra::Allocator* allocator );
+        static void                 shutdown( Parser* parser );
+
+        static void                 generate_ast( Parser* parser );
+
+        static void                 identifier( Parser* parser, const Token& token );
+        static const Type*          find_type( Parser* parser, const hydra::StringView& name );
+
+        static void                 declaration_attributes( Parser* parser, Attributes& attributes );
+        static void                 declaration_struct( Parser* parser );
+        static void                 declaration_enum( Parser* parser );
+        static void                 declaration_variable( Parser* parser, const hydra::StringView& type_name, Type& type, const Attributes& attributes );
+
+        static void                 add_type( Parser* parser, const Type& type );
+
+    }; // struct Parser
+
+    //
+    //
+    struct CodeGenerator {
+
+        const Parser*               parser              = nullptr;
+
+        hydra::StringBuffer         string_buffers[ 3 ];
+
+        bool                        generate_imgui_code = false;
+        bool                        generate_blob_code  = false;    // RelativeArray/RelativeString members and BlobSerializer specializations.
+
+        u32                         data_version        = 0;        // Highest member version, used by all the blob roots.
+
+        static void                 init( CodeGenerator* code_generator, const Parser* parser, u32 buffer_size, hydra::Allocator* allocator );
+        static void                 shutdown( CodeGenerator* code_generator );
+
+        static bool                 generate_code( CodeGenerator* code_generator, cstring filename );
+
+        static void                 output_cpp_struct( CodeGenerator* code_generator, FILE* output, const Type& type );
+        static void                 output_cpp_soa( CodeGenerator* code_generator, FILE* output, const Type& type );
+        static void                 output_cpp_enum( CodeGenerator* code_generator, FILE* output, const Type& type );
+
+    }; // struct CodeGenerator
+
+    // Parse input_filename and write the generated C++ header in output_filename. Options are GenerateOptions flags.
+    bool                            hdf_generate( cstring input_filename, cstring output_filename, u32 options, hydra::Allocator* allocator );
+
+} // namespace hdf
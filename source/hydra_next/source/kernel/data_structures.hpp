@@ -56,7 +56,7 @@ namespace hydra {
             hprint( "Resource pool has unfreed resources.\n" );
 
             for ( u32 i = 0; i < free_indices_head; ++i ) {
-                hprint( "\tResource %u, %s\n", free_indices[ i ], get( free_indices[ i ] )->name );
+                hprint( "\tResource %u, %s\n", free_indices[ i ], get( free_indices[ i ] )->name.c_str() );
             }
         }
         ResourcePool::shutdown();
@@ -95,6 +95,12 @@ bool file_delete( cstring path ) {
 #endif
 }
 
+bool file_rename( cstring old_path, cstring new_path ) {
+#if defined(_WIN64)
+    return MoveFileExA( old_path, new_path, MOVEFILE_REPLACE_EXISTING ) != 0;
+#endif // _WIN64
+}
+
 
 bool directory_exists( cstring path ) {
 #if defined(_WIN64)
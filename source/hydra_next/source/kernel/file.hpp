@@ -54,6 +54,7 @@ namespace hydra {
     void                            file_close( FileHandle file );
     sizet                           file_write( uint8_t* memory, u32 element_size, u32 count, FileHandle file );
     bool                            file_delete( cstring path );
+    bool                            file_rename( cstring old_path, cstring new_path );          // Replaces new_path if existing, atomically on the same volume.
 
     FileTime                        file_last_write_time( cstring filename );
 
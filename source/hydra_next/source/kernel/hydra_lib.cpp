@@ -1,5 +1,5 @@
 
-// Hydra Lib - v0.36
+// Hydra Lib - v0.41
 
 #include "hydra_lib.hpp"
 
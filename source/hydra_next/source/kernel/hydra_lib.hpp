@@ -1,7 +1,7 @@
 #pragma once
 
 //
-// Hydra Lib - v0.36
+// Hydra Lib - v0.41
 //
 // Header to track different core libraries within Hydra framework.
 //
@@ -13,11 +13,17 @@
 //
 // array.hpp, assert.hpp/.cpp, bit.hpp/.cpp, blob_serialization.hpp/.cpp, data_structures.hpp/.cpp,
 // file.hpp/.cpp, hash_map.hpp, log.hpp/.cpp, memory.hpp/.cpp, memory_utils.hpp, numerics.hpp/.cpp,
-// platform.hpp, primitive_types.hpp, process.hpp/.cpp, relative_data_structures.hpp, service.hpp/.cpp,
-// service_manager.hpp/.cpp, string.hpp/.cpp, time.hpp/.cpp .
+// platform.hpp, primitive_types.hpp, process.hpp/.cpp, profiler.hpp/.cpp, relative_data_structures.hpp, service.hpp/.cpp,
+// service_manager.hpp/.cpp, string.hpp/.cpp, string_id.hpp/.cpp, thread.hpp/.cpp, time.hpp/.cpp .
 //
 // Revision history //////////////////////
 //
+//      0.41 (2021/12/22): + Added file_rename.
+//      0.40 (2021/12/21): + Added ProcessPool to run external processes concurrently with output captured in memory. + Added thread_hardware_concurrency.
+//      0.39 (2021/12/20): + Added CPUProfiler with per-thread event rings, per frame aggregation and Chrome trace export.
+//      0.38 (2021/12/18): + Added asynchronous log mode with per-thread rings, rate limiting and dropped messages counter.
+//      0.37 (2021/12/17): + Added StringIdService to intern strings once and use compact ids with precomputed hash.
+//                         + Added thread primitives (mutex, atomics, threads). + Resource names are now StringId.
 //      0.36 (2021/12/14): + Moved ColorUint class to kernel layer.
 //      0.35 (2021/12/09): + Added back/front and push_use methods to Array class.
 //      0.34 (2021/12/02): + Added resource and resource manager classes.
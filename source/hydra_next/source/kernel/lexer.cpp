@@ -1,15 +1,17 @@
-// Hydra Lexer 0.02
+// Hydra Lexer 0.03
 
 #include "lexer.hpp"
 
 #include <Windows.h>
+#include <math.h>
+#include <stdint.h>
 
 //
 // DataBuffer ///////////////////////////////////////////////////////////////////
 
 //
 //
-void data_buffer_init( DataBuffer* data_buffer, uint32_t max_entries, uint32_t buffer_size ) {
+void data_buffer_init( DataBuffer* data_buffer, uint32_t max_entries, sizet buffer_size ) {
     data_buffer->data = (char*)malloc( buffer_size );
     data_buffer->current_size = 0;
     data_buffer->buffer_size = buffer_size;
@@ -24,6 +26,9 @@ void data_buffer_init( DataBuffer* data_buffer, uint32_t max_entries, uint32_t b
 void data_buffer_terminate( DataBuffer* data_buffer ) {
     free( data_buffer->data );
     free( data_buffer->entries );
+
+    data_buffer->data = nullptr;
+    data_buffer->entries = nullptr;
 }
 
 //
@@ -33,44 +38,140 @@ void data_buffer_reset( DataBuffer* data_buffer ) {
     data_buffer->current_entries = 0;
 }
 
+//
+// Grow entries and data storage to fit a new value of the given size.
+static bool data_buffer_reserve( DataBuffer* data_buffer, sizet size ) {
+
+    if ( data_buffer->current_entries >= data_buffer->max_entries ) {
+        const uint32_t new_max_entries = data_buffer->max_entries ? data_buffer->max_entries * 2 : 256;
+        DataBuffer::Entry* new_entries = (DataBuffer::Entry*)realloc( data_buffer->entries, sizeof( DataBuffer::Entry ) * new_max_entries );
+        if ( !new_entries )
+            return false;
+
+        data_buffer->entries = new_entries;
+        data_buffer->max_entries = new_max_entries;
+    }
+
+    if ( data_buffer->current_size + size > data_buffer->buffer_size ) {
+        sizet new_buffer_size = data_buffer->buffer_size ? data_buffer->buffer_size * 2 : 1024;
+        while ( data_buffer->current_size + size > new_buffer_size )
+            new_buffer_size *= 2;
+
+        char* new_data = (char*)realloc( data_buffer->data, new_buffer_size );
+        if ( !new_data )
+            return false;
+
+        data_buffer->data = new_data;
+        data_buffer->buffer_size = new_buffer_size;
+    }
+
+    return true;
+}
+
 //
 //
-uint32_t data_buffer_add( DataBuffer* data_buffer, double data ) {
+template <typename T>
+static uint32_t data_buffer_add_typed( DataBuffer* data_buffer, T data, DataBuffer::Type::Enum type ) {
 
-    if ( data_buffer->current_entries >= data_buffer->max_entries )
+    if ( !data_buffer_reserve( data_buffer, sizeof( T ) ) )
         return k_invalid_entry;
 
-    if ( data_buffer->current_size + sizeof( double ) >= data_buffer->buffer_size )
-        return k_invalid_entry;
+    // Keep values naturally aligned so they can be read in place.
+    const sizet aligned_offset = ( data_buffer->current_size + sizeof( T ) - 1 ) & ~( sizeof( T ) - 1 );
+    if ( aligned_offset != data_buffer->current_size ) {
+        data_buffer->current_size = aligned_offset;
+        if ( !data_buffer_reserve( data_buffer, sizeof( T ) ) )
+            return k_invalid_entry;
+    }
 
     // Init entry
     DataBuffer::Entry& entry = data_buffer->entries[data_buffer->current_entries++];
     entry.offset = data_buffer->current_size;
+    entry.type = type;
     // Copy data
-    memcpy( &data_buffer->data[data_buffer->current_size], &data, sizeof( double ) );
-    data_buffer->current_size += sizeof( double );
+    memcpy( &data_buffer->data[data_buffer->current_size], &data, sizeof( T ) );
+    data_buffer->current_size += sizeof( T );
 
     return data_buffer->current_entries - 1;
 }
 
+uint32_t data_buffer_add( DataBuffer* data_buffer, i32 data ) {
+    return data_buffer_add_typed( data_buffer, data, DataBuffer::Type::I32 );
+}
+
+uint32_t data_buffer_add( DataBuffer* data_buffer, u32 data ) {
+    return data_buffer_add_typed( data_buffer, data, DataBuffer::Type::U32 );
+}
+
+uint32_t data_buffer_add( DataBuffer* data_buffer, f32 data ) {
+    return data_buffer_add_typed( data_buffer, data, DataBuffer::Type::F32 );
+}
+
+uint32_t data_buffer_add( DataBuffer* data_buffer, f64 data ) {
+    return data_buffer_add_typed( data_buffer, data, DataBuffer::Type::F64 );
+}
+
+uint32_t data_buffer_add( DataBuffer* data_buffer, i64 data ) {
+    return data_buffer_add_typed( data_buffer, data, DataBuffer::Type::I64 );
+}
+
 //
 //
-void data_buffer_get_current( const DataBuffer& data_buffer, float& value ) {
-    uint32_t current_index = data_buffer.current_entries - 1;
-    data_buffer_get( data_buffer, current_index, value );
+DataBuffer::Type::Enum data_buffer_get_type( const DataBuffer& data_buffer, uint32_t entry_index ) {
+    if ( entry_index >= data_buffer.current_entries )
+        return DataBuffer::Type::Count;
+
+    return (DataBuffer::Type::Enum)data_buffer.entries[entry_index].type;
 }
 
 //
 //
-void data_buffer_get( const DataBuffer& data_buffer, uint32_t entry_index, float& value ) {
-    value = 0.0f;
+template <typename T>
+static void data_buffer_get_typed( const DataBuffer& data_buffer, uint32_t entry_index, T& value ) {
+    value = T( 0 );
     if ( entry_index >= data_buffer.current_entries )
         return;
 
     const DataBuffer::Entry& entry = data_buffer.entries[entry_index];
-    double* value_data = (double*)&data_buffer.data[entry.offset];
+    const char* value_data = &data_buffer.data[entry.offset];
 
-    value = (float)(*value_data);
+    switch ( entry.type ) {
+        case DataBuffer::Type::I32:
+            value = (T)( *(const i32*)value_data );
+            break;
+        case DataBuffer::Type::U32:
+            value = (T)( *(const u32*)value_data );
+            break;
+        case DataBuffer::Type::F32:
+            value = (T)( *(const f32*)value_data );
+            break;
+        case DataBuffer::Type::F64:
+            value = (T)( *(const f64*)value_data );
+            break;
+        case DataBuffer::Type::I64:
+            value = (T)( *(const i64*)value_data );
+            break;
+    }
+}
+
+void data_buffer_get( const DataBuffer& data_buffer, uint32_t entry_index, i32& value ) {
+    data_buffer_get_typed( data_buffer, entry_index, value );
+}
+
+void data_buffer_get( const DataBuffer& data_buffer, uint32_t entry_index, u32& value ) {
+    data_buffer_get_typed( data_buffer, entry_index, value );
+}
+
+void data_buffer_get( const DataBuffer& data_buffer, uint32_t entry_index, f32& value ) {
+    data_buffer_get_typed( data_buffer, entry_index, value );
+}
+
+void data_buffer_get( const DataBuffer& data_buffer, uint32_t entry_index, f64& value ) {
+    data_buffer_get_typed( data_buffer, entry_index, value );
+}
+
+void data_buffer_get( const DataBuffer& data_buffer, uint32_t entry_index, i64& value ) {
+    data_buffer_get_typed( data_buffer, entry_index, value );
 }
 
 //
@@ -242,7 +343,7 @@ void lexer_parse_number( Lexer* lexer ) {
             ++lexer->position;
     }
     // 3. Decimal part (until the point)
-    int32_t decimal_part = 0;
+    int64_t decimal_part = 0;
     if ( *lexer->position > '0' && *lexer->position <= '9' ) {
         decimal_part = (*lexer->position - '0');
         ++lexer->position;
@@ -256,11 +357,13 @@ void lexer_parse_number( Lexer* lexer ) {
 
     }
     // 4. Fractional part
-    int32_t fractional_part = 0;
-    int32_t fractional_divisor = 1;
+    bool is_floating_point = false;
+    int64_t fractional_part = 0;
+    int64_t fractional_divisor = 1;
 
     if ( *lexer->position == '.' ) {
         ++lexer->position;
+        is_floating_point = true;
 
         while ( is_number( *lexer->position ) ) {
 
@@ -272,13 +375,52 @@ void lexer_parse_number( Lexer* lexer ) {
     }
 
     // 5. Exponent (if present)
+    int32_t exponent = 0;
     if ( *lexer->position == 'e' || *lexer->position == 'E' ) {
         ++lexer->position;
+        is_floating_point = true;
+
+        int32_t exponent_sign = 1;
+        if ( *lexer->position == '-' || *lexer->position == '+' ) {
+            exponent_sign = *lexer->position == '-' ? -1 : 1;
+            ++lexer->position;
+        }
+
+        while ( is_number( *lexer->position ) ) {
+            exponent = (exponent * 10) + (*lexer->position - '0');
+            ++lexer->position;
+        }
+        exponent *= exponent_sign;
+    }
+
+    // 6. Single precision suffix (0.1f)
+    bool is_single_precision = false;
+    if ( *lexer->position == 'f' || *lexer->position == 'F' ) {
+        ++lexer->position;
+        is_floating_point = true;
+        is_single_precision = true;
     }
 
-    double parsed_number = (double)sign * (decimal_part + ((double)fractional_part / fractional_divisor));
-    if ( lexer->data_buffer )
-        data_buffer_add( lexer->data_buffer, parsed_number );
+    if ( !lexer->data_buffer )
+        return;
+
+    if ( is_floating_point ) {
+        double parsed_number = (double)sign * ((double)decimal_part + ((double)fractional_part / fractional_divisor));
+        if ( exponent )
+            parsed_number *= pow( 10.0, exponent );
+
+        if ( is_single_precision )
+            data_buffer_add( lexer->data_buffer, (float)parsed_number );
+        else
+            data_buffer_add( lexer->data_buffer, parsed_number );
+    }
+    else {
+        const int64_t parsed_number = sign * decimal_part;
+        if ( parsed_number >= INT32_MIN && parsed_number <= INT32_MAX )
+            data_buffer_add( lexer->data_buffer, (int32_t)parsed_number );
+        else
+            data_buffer_add( lexer->data_buffer, (i64)parsed_number );
+    }
 }
 
 //
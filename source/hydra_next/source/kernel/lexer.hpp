@@ -1,7 +1,7 @@
 #pragma once
 
 //
-// Hydra Lexer v0.02
+// Hydra Lexer v0.03
 //
 //      Source code     : https://www.github.com/jorenjoestar/
 //
@@ -10,10 +10,13 @@
 //
 // Revision history //////////////////////
 //
+//      0.03  (2021/12/16): + Typed DataBuffer (i32/u32/f32/f64/i64) with 64-bit entries and growable storage.
+//                          + Numbers are parsed directly to integer or floating point types. + Added DataBuffer export to RelativeArray.
 //      0.02  (2021/06/10): + Updated to new HydraNext framework.
 //      0.01  (2021/02/03): + Initial tracking of version. + Added lexer_goto_line and lexer_next_line. + Added possibility to use lexer without data_buffer.
 
 #include "kernel/string.hpp"
+#include "kernel/blob_serialization.hpp"
 
 typedef hydra::StringView           StringRef;
 
@@ -24,12 +27,19 @@ static const uint32_t               k_invalid_entry = 0xffffffff;
 
 //
 // DataBuffer class used to store data from the lexer. Used mostly for numbers.
+// Values are stored with their native type and both entries and data grow on demand.
 struct DataBuffer {
 
+    struct Type {
+        enum Enum : uint8_t {
+            I32, U32, F32, F64, I64, Count
+        };
+    }; // struct Type
+
     struct Entry {
 
-        uint32_t                    offset              : 30;
-        uint32_t                    type                : 2;
+        uint64_t                    offset              : 56;
+        uint64_t                    type                : 8;
 
     }; // struct Entry
 
@@ -38,20 +48,39 @@ struct DataBuffer {
     uint32_t                        current_entries     = 0;
 
     char*                           data                = nullptr;
-    uint32_t                        buffer_size         = 1024;
-    uint32_t                        current_size        = 0;
+    sizet                           buffer_size         = 1024;
+    sizet                           current_size        = 0;
 
 }; // struct DataBuffer
 
 
-void                                data_buffer_init( DataBuffer* data_buffer, uint32_t max_entries, uint32_t buffer_size );
+void                                data_buffer_init( DataBuffer* data_buffer, uint32_t max_entries, sizet buffer_size );
 void                                data_buffer_terminate( DataBuffer* data_buffer );
 
 void                                data_buffer_reset( DataBuffer* data_buffer );
 
-uint32_t                            data_buffer_add( DataBuffer* data_buffer, double data );
-void                                data_buffer_get_current( const DataBuffer& data_buffer, float& value );
-void                                data_buffer_get( const DataBuffer& data_buffer, uint32_t entry_index, float& value );
+uint32_t                            data_buffer_add( DataBuffer* data_buffer, i32 data );
+uint32_t                            data_buffer_add( DataBuffer* data_buffer, u32 data );
+uint32_t                            data_buffer_add( DataBuffer* data_buffer, f32 data );
+uint32_t                            data_buffer_add( DataBuffer* data_buffer, f64 data );
+uint32_t                            data_buffer_add( DataBuffer* data_buffer, i64 data );
+
+DataBuffer::Type::Enum              data_buffer_get_type( const DataBuffer& data_buffer, uint32_t entry_index );
+
+// Getters convert from the stored type to the requested one.
+void                                data_buffer_get( const DataBuffer& data_buffer, uint32_t entry_index, i32& value );
+void                                data_buffer_get( const DataBuffer& data_buffer, uint32_t entry_index, u32& value );
+void                                data_buffer_get( const DataBuffer& data_buffer, uint32_t entry_index, f32& value );
+void                                data_buffer_get( const DataBuffer& data_buffer, uint32_t entry_index, f64& value );
+void                                data_buffer_get( const DataBuffer& data_buffer, uint32_t entry_index, i64& value );
+
+template <typename T>
+void                                data_buffer_get_current( const DataBuffer& data_buffer, T& value );
+
+// Copy num_entries values starting from first_entry into a blob array, converting them to T.
+template <typename T>
+void                                data_buffer_export( const DataBuffer& data_buffer, uint32_t first_entry, uint32_t num_entries,
+                                                        hydra::BlobSerializer* serializer, hydra::RelativeArray<T>& out_array );
 
 //
 // Token class, used to classify character groups.
@@ -143,6 +172,31 @@ bool                                is_number( char c );
 // Inlines ///////////////////////////////////////////////////////////////
 //
 
+//
+//
+template <typename T>
+inline void data_buffer_get_current( const DataBuffer& data_buffer, T& value ) {
+    data_buffer_get( data_buffer, data_buffer.current_entries - 1, value );
+}
+
+//
+//
+template <typename T>
+inline void data_buffer_export( const DataBuffer& data_buffer, uint32_t first_entry, uint32_t num_entries,
+                                hydra::BlobSerializer* serializer, hydra::RelativeArray<T>& out_array ) {
+
+    if ( first_entry + num_entries > data_buffer.current_entries ) {
+        num_entries = first_entry < data_buffer.current_entries ? data_buffer.current_entries - first_entry : 0;
+    }
+
+    serializer->allocate_and_set( out_array, num_entries );
+
+    T* values = out_array.get();
+    for ( uint32_t i = 0; i < num_entries; ++i ) {
+        data_buffer_get( data_buffer, first_entry + i, values[ i ] );
+    }
+}
+
 //
 //
 inline bool is_end_of_line( char c ) {
@@ -1,10 +1,15 @@
 #include "log.hpp"
+#include "memory.hpp"
+#include "time.hpp"
 
+#if defined(_WIN64)
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
+#endif // _WIN64
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
 
 namespace hydra {
 
@@ -17,33 +22,809 @@ static void output_console( char* log_buffer_ ) {
     printf( "%s", log_buffer_ );
 }
 
+#if defined(_WIN64)
 static void output_visual_studio( char* log_buffer_ ) {
     OutputDebugStringA( log_buffer_ );
 }
+#endif // _WIN64
+
+static void output_all( char* text, PrintCallback callback ) {
+    output_console( text );
+#if defined(_MSC_VER)
+    output_visual_studio( text );
+#endif // _MSC_VER
+
+    if ( callback )
+        callback( text );
+}
+
+// Asynchronous records ///////////////////////////////////////////////////
+
+//
+// Records are 8 bytes aligned and never split across the end of the ring:
+// a padding record fills the remaining space when wrapping.
+enum LogRecordType : u32 {
+    LogRecordType_Format = 0,
+    LogRecordType_Padding,
+    LogRecordType_Repeated,
+}; // enum LogRecordType
+
+struct LogRecordHeader {
+    u32                         size;       // Total size including header.
+    u32                         type;
+    cstring                     format;
+}; // struct LogRecordHeader
+
+static constexpr u32            k_max_record_size       = 1024;
+static constexpr u32            k_max_string_argument   = 256;
+static constexpr u32            k_rate_limit_entries    = 32;
+static constexpr i32            k_max_dropped_count     = 0x7fff0000;  // Saturate well before overflow.
+static constexpr i64            k_rate_limit_window     = 1000000;     // Microseconds.
+static constexpr u32            k_consumer_wait_ms      = 250;         // Upper bound to report suppressed messages of expired windows.
+
+//
+// Written by the producer. The consumer only takes the suppressed count of expired windows.
+struct LogRateLimit {
+    cstring volatile            format;
+    volatile i64                window_start;
+    u32                         count;
+    volatile i32                suppressed;
+}; // struct LogRateLimit
+
+//
+// Single producer (owning thread), single consumer (log thread).
+struct LogRing {
+    u8*                         data;
+    u32                         capacity;
+    u32                         mask;
+
+    volatile u32                write_offset;   // Written only by the producer.
+    volatile u32                read_offset;    // Written only by the consumer.
+    volatile i32                dropped;
+    volatile u32                owned;          // Cleared when the producer thread exits, the ring is then reused.
+
+    u32                         generation;
+
+    LogRateLimit                rate_limits[ k_rate_limit_entries ];
+}; // struct LogRing
+
+static void log_release_thread_ring( LogRing* ring, u32 generation );
+
+//
+// Per-thread ring, given back to the service when the thread exits.
+struct LogThreadRing {
+    ~LogThreadRing()                                    { log_release_thread_ring( ring, generation ); }
+
+    LogRing*                    ring        = nullptr;
+    u32                         generation  = 0;
+}; // struct LogThreadRing
+
+static thread_local LogThreadRing s_thread_ring;
+
+//
+// Counts a producer for its lifetime: shutdown frees the rings only when no thread is inside the asynchronous path.
+struct LogProducerScope {
+    LogProducerScope( LogService* log_ ) : log( log_ )  { atomic_increment( &log->active_producers ); }
+    ~LogProducerScope()                                 { atomic_decrement( &log->active_producers ); }
+
+    LogService*                 log;
+}; // struct LogProducerScope
+
+static inline u32 align_record( u32 size ) {
+    return ( size + 7 ) & ~7u;
+}
+
+//
+// Parsed printf conversion specification.
+struct FormatSpecification {
+    cstring                     flags_start;
+    u32                         flags_length;
+    char                        conversion;
+    u8                          length_modifier;    // 0 none, 1 hh, 2 h, 3 l, 4 ll, 5 L, 6 size types (z, j, t, I, I64)
+    bool                        width_star;
+    bool                        precision_star;
+    bool                        has_precision;
+    i32                         width;
+    i32                         precision;
+}; // struct FormatSpecification
+
+//
+// Parses the specification starting after a '%' character.
+static cstring format_parse_specification( cstring p, FormatSpecification& spec ) {
+    spec.flags_start = p;
+    spec.length_modifier = 0;
+    spec.width_star = spec.precision_star = spec.has_precision = false;
+    spec.width = spec.precision = 0;
+
+    while ( *p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0' )
+        ++p;
+    spec.flags_length = ( u32 )( p - spec.flags_start );
+
+    if ( *p == '*' ) {
+        spec.width_star = true;
+        ++p;
+    } else {
+        while ( *p >= '0' && *p <= '9' ) {
+            spec.width = spec.width * 10 + ( *p - '0' );
+            ++p;
+        }
+    }
+
+    if ( *p == '.' ) {
+        spec.has_precision = true;
+        ++p;
+        if ( *p == '*' ) {
+            spec.precision_star = true;
+            ++p;
+        } else {
+            while ( *p >= '0' && *p <= '9' ) {
+                spec.precision = spec.precision * 10 + ( *p - '0' );
+                ++p;
+            }
+        }
+    }
+
+    switch ( *p ) {
+        case 'h': ++p; spec.length_modifier = 2; if ( *p == 'h' ) { ++p; spec.length_modifier = 1; } break;
+        case 'l': ++p; spec.length_modifier = 3; if ( *p == 'l' ) { ++p; spec.length_modifier = 4; } break;
+        case 'L': ++p; spec.length_modifier = 5; break;
+        case 'z': case 'j': case 't': ++p; spec.length_modifier = 6; break;
+        case 'I':
+        {
+            ++p;
+            spec.length_modifier = 6;
+            if ( p[ 0 ] == '6' && p[ 1 ] == '4' ) {
+                p += 2;
+            } else if ( p[ 0 ] == '3' && p[ 1 ] == '2' ) {
+                p += 2;
+                spec.length_modifier = 0;
+            }
+            break;
+        }
+    }
+
+    spec.conversion = *p;
+    if ( *p )
+        ++p;
+    return p;
+}
+
+//
+// Encodes the arguments following the format in a compact binary form.
+// Integers and pointers are widened to 64 bits, floating points to double and strings are copied.
+static u32 format_encode_arguments( cstring format, va_list args, u8* out, u32 out_size ) {
+    u32 offset = 0;
+
+    #define LOG_WRITE_VALUE( value ) { if ( offset + 8 > out_size ) return offset; memcpy( out + offset, &value, 8 ); offset += 8; }
+
+    for ( cstring p = format; *p; ) {
+        if ( *p++ != '%' )
+            continue;
+
+        if ( *p == '%' ) {
+            ++p;
+            continue;
+        }
+
+        FormatSpecification spec;
+        p = format_parse_specification( p, spec );
+
+        if ( spec.width_star ) {
+            i64 value = va_arg( args, int );
+            LOG_WRITE_VALUE( value );
+        }
+        if ( spec.precision_star ) {
+            i64 value = va_arg( args, int );
+            LOG_WRITE_VALUE( value );
+        }
+
+        switch ( spec.conversion ) {
+            case 'd': case 'i': case 'c':
+            {
+                i64 value;
+                switch ( spec.length_modifier ) {
+                    case 3: value = va_arg( args, long ); break;
+                    case 4: value = va_arg( args, long long ); break;
+                    case 6: value = va_arg( args, intptr_t ); break;
+                    default: value = va_arg( args, int ); break;
+                }
+                LOG_WRITE_VALUE( value );
+                break;
+            }
+            case 'u': case 'o': case 'x': case 'X':
+            {
+                u64 value;
+                switch ( spec.length_modifier ) {
+                    case 3: value = va_arg( args, unsigned long ); break;
+                    case 4: value = va_arg( args, unsigned long long ); break;
+                    case 6: value = va_arg( args, sizet ); break;
+                    default: value = va_arg( args, unsigned int ); break;
+                }
+                LOG_WRITE_VALUE( value );
+                break;
+            }
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            {
+                f64 value = spec.length_modifier == 5 ? ( f64 )va_arg( args, long double ) : va_arg( args, f64 );
+                LOG_WRITE_VALUE( value );
+                break;
+            }
+            case 'p':
+            {
+                u64 value = ( u64 )( uintptr_t )va_arg( args, void* );
+                LOG_WRITE_VALUE( value );
+                break;
+            }
+            case 'n':
+            {
+                // Not supported: consume the argument.
+                va_arg( args, void* );
+                break;
+            }
+            case 's':
+            {
+                cstring string = spec.length_modifier == 3 ? "(wide string)" : va_arg( args, cstring );
+                if ( spec.length_modifier == 3 )
+                    va_arg( args, void* );
+                if ( string == nullptr )
+                    string = "(null)";
+
+                u32 length = ( u32 )strlen( string );
+                if ( length > k_max_string_argument )
+                    length = k_max_string_argument;
+                if ( offset + 4 + length > out_size )
+                    return offset;
+
+                memcpy( out + offset, &length, 4 );
+                memcpy( out + offset + 4, string, length );
+                offset += align_record( 4 + length );
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    #undef LOG_WRITE_VALUE
+
+    return offset;
+}
+
+//
+// Formats an encoded record into text, one conversion at a time.
+static u32 format_decode_arguments( cstring format, const u8* arguments, u32 arguments_size, char* out, u32 out_size ) {
+    u32 written = 0;
+    u32 offset = 0;
+
+    #define LOG_READ_VALUE( value ) { if ( offset + 8 > arguments_size ) { memset( &value, 0, 8 ); } else { memcpy( &value, arguments + offset, 8 ); offset += 8; } }
+
+    for ( cstring p = format; *p && written + 1 < out_size; ) {
+        if ( *p != '%' ) {
+            out[ written++ ] = *p++;
+            continue;
+        }
+        ++p;
+
+        if ( *p == '%' ) {
+            out[ written++ ] = '%';
+            ++p;
+            continue;
+        }
+
+        FormatSpecification spec;
+        p = format_parse_specification( p, spec );
+
+        i64 width = spec.width, precision = spec.precision;
+        if ( spec.width_star )
+            LOG_READ_VALUE( width );
+        if ( spec.precision_star )
+            LOG_READ_VALUE( precision );
+
+        // Rebuild a single specification with normalized length modifier.
+        char specification[ 64 ];
+        u32 length = 0;
+        specification[ length++ ] = '%';
+        memcpy( specification + length, spec.flags_start, spec.flags_length );
+        length += spec.flags_length;
+        if ( spec.width_star || spec.width )
+            length += snprintf( specification + length, sizeof( specification ) - length, "%d", ( i32 )width );
+        if ( spec.has_precision )
+            length += snprintf( specification + length, sizeof( specification ) - length, ".%d", ( i32 )precision );
+
+        const u32 remaining = out_size - written;
+        i32 result = 0;
+
+        switch ( spec.conversion ) {
+            case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+            {
+                i64 value;
+                LOG_READ_VALUE( value );
+                specification[ length++ ] = 'l';
+                specification[ length++ ] = 'l';
+                specification[ length++ ] = spec.conversion;
+                specification[ length ] = 0;
+                result = snprintf( out + written, remaining, specification, value );
+                break;
+            }
+            case 'c':
+            {
+                i64 value;
+                LOG_READ_VALUE( value );
+                specification[ length++ ] = 'c';
+                specification[ length ] = 0;
+                result = snprintf( out + written, remaining, specification, ( int )value );
+                break;
+            }
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            {
+                f64 value;
+                LOG_READ_VALUE( value );
+                specification[ length++ ] = spec.conversion;
+                specification[ length ] = 0;
+                result = snprintf( out + written, remaining, specification, value );
+                break;
+            }
+            case 'p':
+            {
+                u64 value;
+                LOG_READ_VALUE( value );
+                specification[ length++ ] = 'p';
+                specification[ length ] = 0;
+                result = snprintf( out + written, remaining, specification, ( void* )( uintptr_t )value );
+                break;
+            }
+            case 's':
+            {
+                u32 string_length = 0;
+                if ( offset + 4 <= arguments_size ) {
+                    memcpy( &string_length, arguments + offset, 4 );
+                }
+                if ( offset + 4 + string_length > arguments_size ) {
+                    string_length = 0;
+                }
+
+                char string[ k_max_string_argument + 1 ];
+                memcpy( string, arguments + offset + 4, string_length );
+                string[ string_length ] = 0;
+                offset += align_record( 4 + string_length );
+
+                specification[ length++ ] = 's';
+                specification[ length ] = 0;
+                result = snprintf( out + written, remaining, specification, string );
+                break;
+            }
+            default:
+                break;
+        }
+
+        if ( result > 0 ) {
+            written += ( ( u32 )result < remaining ) ? ( u32 )result : remaining - 1;
+        }
+    }
+
+    #undef LOG_READ_VALUE
+
+    out[ written ] = 0;
+    return written;
+}
+
+//
+//
+static bool log_ring_write( LogRing* ring, LogRecordType type, cstring format, const u8* payload, u32 payload_size ) {
+    const u32 record_size = align_record( sizeof( LogRecordHeader ) + payload_size );
+
+    const u32 write = ring->write_offset;
+    const u32 read = atomic_load_acquire( &ring->read_offset );
+    const u32 free_space = ring->capacity - ( write - read );
+
+    // Records are contiguous: if the end of the ring is reached, pad and wrap.
+    const u32 position = write & ring->mask;
+    const u32 contiguous = ring->capacity - position;
+    const u32 padding = record_size > contiguous ? contiguous : 0;
+
+    if ( record_size + padding > free_space ) {
+        if ( ring->dropped < k_max_dropped_count )
+            atomic_increment( &ring->dropped );
+        return false;
+    }
+
+    if ( padding ) {
+        LogRecordHeader* padding_header = ( LogRecordHeader* )( ring->data + position );
+        padding_header->size = padding;
+        padding_header->type = LogRecordType_Padding;
+    }
+
+    LogRecordHeader* header = ( LogRecordHeader* )( ring->data + ( ( write + padding ) & ring->mask ) );
+    header->size = record_size;
+    header->type = type;
+    header->format = format;
+    memcpy( header + 1, payload, payload_size );
+
+    atomic_store_release( &ring->write_offset, write + padding + record_size );
+    return true;
+}
+
+//
+// Atomically takes the suppressed count, as both the producer and the consumer can report it.
+static i32 log_take_suppressed( volatile i32* suppressed ) {
+    i32 value = *suppressed;
+    while ( value && !atomic_compare_exchange( suppressed, value, 0 ) ) {
+        value = *suppressed;
+    }
+    return value;
+}
+
+//
+//
+static void log_output_suppressed( cstring format, u32 count, PrintCallback callback ) {
+    snprintf( log_buffer, k_string_buffer_size, "[log] previous message suppressed %u times: %s", count, format );
+    output_all( log_buffer, callback );
+}
+
+//
+// Reports suppressed messages of the windows expired before 'now', or of all the windows if 'now' is 0.
+// Called by the consumer while the producer could still be writing: the format is checked again after
+// taking the count and if the entry was reused meanwhile the count is given back to the new window.
+static void log_ring_flush_rate_limits( LogRing* ring, i64 now, PrintCallback callback ) {
+    for ( u32 i = 0; i < k_rate_limit_entries; ++i ) {
+        LogRateLimit& entry = ring->rate_limits[ i ];
+        if ( entry.suppressed == 0 || ( now && now - entry.window_start <= k_rate_limit_window ) ) {
+            continue;
+        }
+
+        cstring format = entry.format;
+        const i32 suppressed = log_take_suppressed( &entry.suppressed );
+        if ( suppressed == 0 ) {
+            continue;
+        }
+
+        if ( entry.format != format ) {
+            atomic_add( &entry.suppressed, suppressed );
+            continue;
+        }
+
+        log_output_suppressed( format, suppressed, callback );
+    }
+}
+
+//
+// Returns true if at least one record was output.
+static bool log_ring_consume( LogRing* ring, PrintCallback callback ) {
+    bool consumed = false;
+
+    const i32 dropped = ring->dropped;
+    if ( dropped ) {
+        atomic_add( &ring->dropped, -dropped );
+        snprintf( log_buffer, k_string_buffer_size, "[log] %d messages dropped, log ring full.\n", dropped );
+        output_all( log_buffer, callback );
+        consumed = true;
+    }
+
+    u32 read = ring->read_offset;
+    const u32 write = atomic_load_acquire( &ring->write_offset );
+
+    while ( read != write ) {
+        const LogRecordHeader* header = ( const LogRecordHeader* )( ring->data + ( read & ring->mask ) );
+
+        switch ( header->type ) {
+            case LogRecordType_Format:
+            {
+                format_decode_arguments( header->format, ( const u8* )( header + 1 ), header->size - sizeof( LogRecordHeader ), log_buffer, k_string_buffer_size );
+                output_all( log_buffer, callback );
+                break;
+            }
+            case LogRecordType_Repeated:
+            {
+                u32 count;
+                memcpy( &count, header + 1, sizeof( u32 ) );
+                log_output_suppressed( header->format, count, callback );
+                break;
+            }
+            default:
+                break;
+        }
+
+        read += header->size;
+        consumed = true;
+    }
+
+    atomic_store_release( &ring->read_offset, read );
+    return consumed;
+}
+
+//
+//
+static bool log_has_pending_records( LogService* log ) {
+    const u32 num_rings = atomic_load_acquire( &log->num_rings );
+    for ( u32 i = 0; i < num_rings; ++i ) {
+        LogRing* ring = log->rings[ i ];
+        if ( atomic_load_acquire( &ring->write_offset ) != ring->read_offset || ring->dropped ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//
+// Sleeps when all the rings are empty: producers wake it up after writing a record.
+// The wait is bounded to report the suppressed messages of expired rate limit windows.
+static void log_consumer_thread( void* user_data ) {
+    LogService* log = ( LogService* )user_data;
+
+    i64 last_rate_limit_flush = time_now();
+
+    while ( log->consumer_running ) {
+        bool consumed = false;
+
+        const u32 num_rings = atomic_load_acquire( &log->num_rings );
+        for ( u32 i = 0; i < num_rings; ++i ) {
+            consumed |= log_ring_consume( log->rings[ i ], log->print_callback );
+        }
+
+        const i64 now = time_now();
+        if ( log->max_repeats_per_second && now - last_rate_limit_flush > k_rate_limit_window / 4 ) {
+            for ( u32 i = 0; i < num_rings; ++i ) {
+                log_ring_flush_rate_limits( log->rings[ i ], now, log->print_callback );
+            }
+            last_rate_limit_flush = now;
+        }
+
+        if ( consumed ) {
+            continue;
+        }
+
+        ScopedLock lock( log->consumer_mutex );
+        // Full barrier: either the producer sees the flag or the check below sees its record.
+        atomic_increment( &log->consumer_sleeping );
+        if ( log->consumer_running && !log_has_pending_records( log ) ) {
+            log->consumer_wake.wait_for( log->consumer_mutex, k_consumer_wait_ms );
+        }
+        atomic_decrement( &log->consumer_sleeping );
+    }
+}
+
+//
+//
+static void log_wake_consumer( LogService* log ) {
+    if ( atomic_add( &log->consumer_sleeping, 0 ) ) {
+        ScopedLock lock( log->consumer_mutex );
+        log->consumer_wake.notify_one();
+    }
+}
+
+//
+//
+static LogRing* log_get_thread_ring( LogService* log ) {
+    if ( s_thread_ring.ring && s_thread_ring.generation == log->generation ) {
+        return s_thread_ring.ring;
+    }
+
+    ScopedLock lock( log->rings_mutex );
+
+    // Reuse the ring of an exited thread. Pending records stay in place and are consumed as usual.
+    LogRing* ring = nullptr;
+    for ( u32 i = 0; i < log->num_rings; ++i ) {
+        if ( atomic_load_acquire( &log->rings[ i ]->owned ) == 0 ) {
+            ring = log->rings[ i ];
+            memset( ring->rate_limits, 0, sizeof( ring->rate_limits ) );
+            break;
+        }
+    }
+
+    if ( ring == nullptr ) {
+        if ( log->num_rings >= LogService::k_max_rings ) {
+            return nullptr;
+        }
+
+        ring = ( LogRing* )halloca( sizeof( LogRing ) + log->ring_size, log->allocator );
+        memset( ring, 0, sizeof( LogRing ) );
+        ring->data = ( u8* )( ring + 1 );
+        ring->capacity = log->ring_size;
+        ring->mask = log->ring_size - 1;
+        ring->generation = log->generation;
+
+        log->rings[ log->num_rings ] = ring;
+        atomic_store_release( &log->num_rings, log->num_rings + 1 );
+    }
+
+    atomic_store_release( &ring->owned, 1 );
+
+    s_thread_ring.ring = ring;
+    s_thread_ring.generation = log->generation;
+    return ring;
+}
+
+//
+// Called at thread exit. Rings of a previous init were already freed by shutdown.
+static void log_release_thread_ring( LogRing* ring, u32 generation ) {
+    if ( ring == nullptr ) {
+        return;
+    }
+
+    LogService* log = LogService::instance();
+    LogProducerScope producer( log );
+    if ( atomic_load_acquire( &log->async_enabled ) && generation == log->generation ) {
+        atomic_store_release( &ring->owned, 0 );
+    }
+}
+
+//
+// Returns false if the message must be suppressed.
+static bool log_rate_limit( LogRing* ring, cstring format, u32 max_repeats_per_second ) {
+    if ( max_repeats_per_second == 0 ) {
+        return true;
+    }
+
+    LogRateLimit& entry = ring->rate_limits[ ( ( uintptr_t )format >> 3 ) % k_rate_limit_entries ];
+    const i64 now = time_now();
+
+    if ( entry.format != format || now - entry.window_start > k_rate_limit_window ) {
+        // Report suppressed messages of the previous window, if the consumer did not already.
+        const u32 suppressed = ( u32 )log_take_suppressed( &entry.suppressed );
+        if ( suppressed ) {
+            log_ring_write( ring, LogRecordType_Repeated, entry.format, ( const u8* )&suppressed, sizeof( u32 ) );
+        }
+
+        entry.window_start = now;
+        entry.format = format;
+        entry.count = 0;
+    }
+
+    if ( entry.count >= max_repeats_per_second ) {
+        atomic_increment( &entry.suppressed );
+        return false;
+    }
+
+    ++entry.count;
+    return true;
+}
+
+// LogService /////////////////////////////////////////////////////////////
 
 LogService* LogService::instance() {
     return &s_log_service;
 }
 
+void LogService::init( void* configuration ) {
+    if ( async_enabled || configuration == nullptr ) {
+        return;
+    }
+
+    LogConfiguration* log_configuration = ( LogConfiguration* )configuration;
+    allocator = log_configuration->allocator ? log_configuration->allocator : &MemoryService::instance()->system_allocator;
+    max_repeats_per_second = log_configuration->max_repeats_per_second;
+
+    // Round up to a power of two, needed for masking. Minimum size fits the biggest record.
+    ring_size = 4096;
+    while ( ring_size < log_configuration->ring_size )
+        ring_size <<= 1;
+
+    rings_mutex.init();
+    consumer_mutex.init();
+    consumer_wake.init();
+    consumer_sleeping = 0;
+    num_rings = 0;
+    dropped_no_ring = 0;
+    active_producers = 0;
+    ++generation;
+
+    consumer_running = 1;
+    thread_create( consumer_thread, log_consumer_thread, this, "hydra_log" );
+
+    atomic_store_release( &async_enabled, 1 );
+}
+
+void LogService::shutdown() {
+    if ( !async_enabled ) {
+        return;
+    }
+
+    flush();
+
+    atomic_store_release( &async_enabled, 0 );
+    // Producers that passed the check before the store can still be writing: the read-modify-write
+    // is a full barrier, so the store above is visible before the counter is read.
+    while ( atomic_add( &active_producers, 0 ) != 0 ) {
+        thread_yield();
+    }
+
+    {
+        ScopedLock lock( consumer_mutex );
+        consumer_running = 0;
+        consumer_wake.notify_one();
+    }
+    thread_join( consumer_thread );
+
+    // Output what has been written after the flush, then the suppressed messages of the current windows.
+    for ( u32 i = 0; i < num_rings; ++i ) {
+        log_ring_consume( rings[ i ], print_callback );
+        log_ring_flush_rate_limits( rings[ i ], 0, print_callback );
+        hfree( rings[ i ], allocator );
+    }
+    num_rings = 0;
+
+    if ( dropped_no_ring ) {
+        print_format( "[log] %d messages dropped, no log ring available.\n", dropped_no_ring );
+    }
+
+    consumer_wake.shutdown();
+    consumer_mutex.shutdown();
+    rings_mutex.shutdown();
+}
+
 void LogService::print_format( cstring format, ... ) {
     va_list args;
 
     va_start( args, format );
-    vsnprintf_s( log_buffer, ArraySize( log_buffer ), format, args );
-    log_buffer[ ArraySize( log_buffer ) - 1 ] = '\0';
+    print_format_args( format, args );
     va_end( args );
+}
+
+//
+// Returns false if the asynchronous mode is disabled, the message is then printed synchronously.
+static bool log_print_async( LogService* log, cstring format, va_list args ) {
+    if ( !atomic_load_acquire( &log->async_enabled ) ) {
+        return false;
+    }
+
+    LogProducerScope producer( log );
+    // Shutdown can start between the first check and the registration of the producer.
+    if ( !atomic_load_acquire( &log->async_enabled ) ) {
+        return false;
+    }
+
+    LogRing* ring = log_get_thread_ring( log );
+    if ( ring == nullptr ) {
+        if ( log->dropped_no_ring < k_max_dropped_count )
+            atomic_increment( &log->dropped_no_ring );
+        return true;
+    }
+
+    if ( !log_rate_limit( ring, format, log->max_repeats_per_second ) ) {
+        return true;
+    }
+
+    u8 payload[ k_max_record_size ];
+    const u32 payload_size = format_encode_arguments( format, args, payload, k_max_record_size );
+    log_ring_write( ring, LogRecordType_Format, format, payload, payload_size );
+    log_wake_consumer( log );
+    return true;
+}
+
+void LogService::print_format_args( cstring format, va_list args ) {
+
+    if ( log_print_async( this, format, args ) ) {
+        return;
+    }
 
-    output_console( log_buffer );
 #if defined(_MSC_VER)
-    output_visual_studio( log_buffer );
+    vsnprintf_s( log_buffer, ArraySize( log_buffer ), format, args );
+#else
+    vsnprintf( log_buffer, ArraySize( log_buffer ), format, args );
 #endif // _MSC_VER
+    log_buffer[ ArraySize( log_buffer ) - 1 ] = '\0';
+
+    output_all( log_buffer, print_callback );
+}
+
+void LogService::flush() {
+    if ( !async_enabled ) {
+        return;
+    }
 
-    if ( print_callback )
-      print_callback( log_buffer );
+    // Wait for the consumer to reach the current write position of all rings.
+    const u32 rings_count = atomic_load_acquire( &num_rings );
+    for ( u32 i = 0; i < rings_count; ++i ) {
+        LogRing* ring = rings[ i ];
+        const u32 write = atomic_load_acquire( &ring->write_offset );
+        while ( ( i32 )( write - atomic_load_acquire( &ring->read_offset ) ) > 0 ) {
+            thread_sleep( 1 );
+        }
+    }
 }
 
 void LogService::set_callback( PrintCallback callback ) {
     print_callback = callback;
 }
 
-} // namespace hydra
\ No newline at end of file
+} // namespace hydra
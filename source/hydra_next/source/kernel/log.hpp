@@ -3,21 +3,67 @@
 #include "kernel/platform.hpp"
 #include "kernel/primitive_types.hpp"
 #include "kernel/service.hpp"
+#include "kernel/thread.hpp"
+
+#include <stdarg.h>
 
 namespace hydra {
 
+    struct Allocator;
+    struct LogRing;
+
     typedef void                        ( *PrintCallback )( const char* );  // Additional callback for printing
 
+    //
+    // Passing a configuration to LogService::init enables the asynchronous mode:
+    // producers encode format pointer and arguments in a per-thread ring buffer
+    // and a background thread formats and outputs them.
+    struct LogConfiguration {
+
+        Allocator*                      allocator               = nullptr;
+        u32                             ring_size               = 64 * 1024;    // Bytes per producer thread. Rounded up to a power of two.
+        u32                             max_repeats_per_second  = 32;           // Rate limit for the same format string, 0 to disable.
+
+    }; // struct LogConfiguration
+
     struct LogService : public Service {
 
         hy_declare_service( LogService );
 
+        void                            init( void* configuration ) override;   // Starts the asynchronous mode.
+        void                            shutdown() override;                    // Flushes pending records and goes back to synchronous mode.
+
         void                            print_format( cstring format, ... );
+        void                            print_format_args( cstring format, va_list args );
+
+        void                            flush();                                // Wait until all the queued records are output.
 
         void                            set_callback( PrintCallback callback );
 
         PrintCallback                   print_callback = nullptr;
 
+        // Asynchronous mode
+        static constexpr u32            k_max_rings             = 32;
+
+        LogRing*                        rings[ k_max_rings ];
+        u32                             num_rings               = 0;
+        Mutex                           rings_mutex;
+
+        Thread                          consumer_thread;
+        Mutex                           consumer_mutex;
+        ConditionVariable               consumer_wake;                          // Signaled by producers when the consumer sleeps.
+        Allocator*                      allocator               = nullptr;
+
+        u32                             ring_size               = 0;
+        u32                             max_repeats_per_second  = 0;
+        u32                             generation              = 0;            // Invalidates per-thread rings between init/shutdown.
+
+        volatile u32                    async_enabled           = 0;
+        volatile i32                    consumer_running        = 0;
+        volatile i32                    consumer_sleeping       = 0;
+        volatile i32                    dropped_no_ring         = 0;            // Records dropped because all rings are taken.
+        volatile i32                    active_producers        = 0;            // Threads writing into a ring, shutdown waits for them.
+
         static constexpr cstring        k_name = "hydra_log_service";
     };
 
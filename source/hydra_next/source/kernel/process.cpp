@@ -1,10 +1,24 @@
 #include "process.hpp"
 #include "log.hpp"
+#include "memory.hpp"
+#include "assert.hpp"
 
 #include <stdio.h>
+#include <string.h>
 
+#if defined(_WIN64)
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
+#else
+#include <spawn.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+extern char** environ;
+#endif // _WIN64
 
 namespace hydra {
 
@@ -110,4 +124,373 @@ cstring process_get_output() {
 
 #endif // WIN64
 
+// Process job ////////////////////////////////////////////////////////////
+
+//
+// Grow the job output, keeping it always null terminated.
+static void process_output_append( ProcessJob& job, u32& capacity, const char* data, u32 size, Allocator* allocator ) {
+    if ( job.output_size + size + 1 > capacity ) {
+        u32 new_capacity = capacity ? capacity * 2 : 4096;
+        while ( new_capacity < job.output_size + size + 1 )
+            new_capacity *= 2;
+
+        char* new_output = ( char* )halloca( new_capacity, allocator );
+        if ( job.output ) {
+            memcpy( new_output, job.output, job.output_size );
+            hfree( job.output, allocator );
+        }
+        job.output = new_output;
+        capacity = new_capacity;
+    }
+
+    memcpy( job.output + job.output_size, data, size );
+    job.output_size += size;
+    job.output[ job.output_size ] = 0;
+}
+
+#if defined(_WIN64)
+
+// Inheritable pipe handles created by a thread would leak into processes created at the same time by other threads,
+// keeping their pipes open and the reads blocked. Creation is serialized and the child ends closed before unlocking.
+static SRWLOCK      s_process_creation_lock = SRWLOCK_INIT;
+
+void process_execute_job( ProcessJob& job, Allocator* allocator ) {
+    HANDLE handle_stdin_pipe_read = NULL;
+    HANDLE handle_stdin_pipe_write = NULL;
+    HANDLE handle_stdout_pipe_read = NULL;
+    HANDLE handle_stdout_pipe_write = NULL;
+
+    SECURITY_ATTRIBUTES security_attributes = { sizeof( SECURITY_ATTRIBUTES ), NULL, TRUE };
+    PROCESS_INFORMATION process_info = {};
+
+    job.output_size = 0;
+    job.exit_code = -1;
+    job.launched = false;
+
+    AcquireSRWLockExclusive( &s_process_creation_lock );
+
+    if ( CreatePipe( &handle_stdin_pipe_read, &handle_stdin_pipe_write, &security_attributes, 0 ) &&
+         CreatePipe( &handle_stdout_pipe_read, &handle_stdout_pipe_write, &security_attributes, 0 ) ) {
+        // Parent ends must not be inherited.
+        SetHandleInformation( handle_stdin_pipe_write, HANDLE_FLAG_INHERIT, 0 );
+        SetHandleInformation( handle_stdout_pipe_read, HANDLE_FLAG_INHERIT, 0 );
+
+        STARTUPINFOA startup_info = {};
+        startup_info.cb = sizeof( startup_info );
+        startup_info.dwFlags = STARTF_USESHOWWINDOW | STARTF_USESTDHANDLES;
+        startup_info.hStdInput = handle_stdin_pipe_read;
+        startup_info.hStdError = handle_stdout_pipe_write;
+        startup_info.hStdOutput = handle_stdout_pipe_write;
+        startup_info.wShowWindow = SW_HIDE;
+
+        job.launched = CreateProcessA( job.process_fullpath, ( char* )job.arguments, 0, 0, TRUE, CREATE_NO_WINDOW, 0, job.working_directory, &startup_info, &process_info ) != 0;
+    }
+
+    if ( handle_stdin_pipe_read )
+        CloseHandle( handle_stdin_pipe_read );
+    if ( handle_stdout_pipe_write )
+        CloseHandle( handle_stdout_pipe_write );
+
+    ReleaseSRWLockExclusive( &s_process_creation_lock );
+
+    if ( !job.launched ) {
+        char error_buffer[ k_process_log_buffer ];
+        error_buffer[ 0 ] = 0;
+        win32_get_error( error_buffer, k_process_log_buffer );
+
+        hprint( "Execute process error.\n Exe: \"%s\" - Args: \"%s\" - Work_dir: \"%s\"\n", job.process_fullpath, job.arguments, job.working_directory );
+        hprint( "Message: %s\n", error_buffer );
+
+        if ( handle_stdin_pipe_write )
+            CloseHandle( handle_stdin_pipe_write );
+        if ( handle_stdout_pipe_read )
+            CloseHandle( handle_stdout_pipe_read );
+        return;
+    }
+
+    CloseHandle( process_info.hThread );
+
+    // Send input, closing the pipe signals the end of it.
+    u32 input_written = 0;
+    while ( input_written < job.input_size ) {
+        DWORD bytes_written = 0;
+        if ( !WriteFile( handle_stdin_pipe_write, job.input + input_written, job.input_size - input_written, &bytes_written, nullptr ) )
+            break;
+        input_written += bytes_written;
+    }
+    CloseHandle( handle_stdin_pipe_write );
+
+    // Read all the output until the process closes its end.
+    u32 output_capacity = 0;
+    char read_buffer[ 4096 ];
+    DWORD bytes_read = 0;
+    while ( ReadFile( handle_stdout_pipe_read, read_buffer, sizeof( read_buffer ), &bytes_read, nullptr ) && bytes_read > 0 ) {
+        process_output_append( job, output_capacity, read_buffer, bytes_read, allocator );
+    }
+    CloseHandle( handle_stdout_pipe_read );
+
+    WaitForSingleObject( process_info.hProcess, INFINITE );
+
+    DWORD process_exit_code = 0;
+    GetExitCodeProcess( process_info.hProcess, &process_exit_code );
+    CloseHandle( process_info.hProcess );
+
+    job.exit_code = ( i32 )process_exit_code;
+}
+
+#else
+
+//
+// Split a command line in arguments, honoring double quotes. Writes into the arguments copy.
+static u32 process_split_arguments( char* arguments, char** out_argv, u32 max_arguments ) {
+    u32 count = 0;
+    char* current = arguments;
+
+    while ( *current && count < max_arguments - 1 ) {
+        while ( *current == ' ' || *current == '\t' )
+            ++current;
+        if ( *current == 0 )
+            break;
+
+        const bool quoted = *current == '"';
+        if ( quoted )
+            ++current;
+
+        out_argv[ count++ ] = current;
+        while ( *current && ( quoted ? *current != '"' : ( *current != ' ' && *current != '\t' ) ) )
+            ++current;
+
+        if ( *current )
+            *current++ = 0;
+    }
+
+    out_argv[ count ] = nullptr;
+    return count;
+}
+
+void process_execute_job( ProcessJob& job, Allocator* allocator ) {
+    job.output_size = 0;
+    job.exit_code = -1;
+    job.launched = false;
+
+    // Close on exec: other children spawned concurrently must not inherit these pipes.
+    // dup2 in the file actions clears the flag on the standard handles.
+    int stdin_pipe[ 2 ];
+    int stdout_pipe[ 2 ];
+    if ( pipe2( stdin_pipe, O_CLOEXEC ) != 0 ) {
+        return;
+    }
+    if ( pipe2( stdout_pipe, O_CLOEXEC ) != 0 ) {
+        close( stdin_pipe[ 0 ] );
+        close( stdin_pipe[ 1 ] );
+        return;
+    }
+
+    posix_spawn_file_actions_t file_actions;
+    posix_spawn_file_actions_init( &file_actions );
+    posix_spawn_file_actions_adddup2( &file_actions, stdin_pipe[ 0 ], STDIN_FILENO );
+    posix_spawn_file_actions_adddup2( &file_actions, stdout_pipe[ 1 ], STDOUT_FILENO );
+    posix_spawn_file_actions_adddup2( &file_actions, stdout_pipe[ 1 ], STDERR_FILENO );
+#if defined(__GLIBC__)
+    if ( job.working_directory && job.working_directory[ 0 ] ) {
+        posix_spawn_file_actions_addchdir_np( &file_actions, job.working_directory );
+    }
+#endif // __GLIBC__
+
+    // Same command line convention as Windows: the first argument is the process name.
+    static constexpr u32 k_max_arguments = 128;
+    char* argv[ k_max_arguments ];
+    const sizet arguments_length = job.arguments ? strlen( job.arguments ) : 0;
+    char* arguments_copy = ( char* )halloca( arguments_length + 1, allocator );
+    memcpy( arguments_copy, job.arguments ? job.arguments : "", arguments_length + 1 );
+    if ( process_split_arguments( arguments_copy, argv, k_max_arguments ) == 0 ) {
+        argv[ 0 ] = ( char* )job.process_fullpath;
+        argv[ 1 ] = nullptr;
+    }
+
+    pid_t pid = 0;
+    job.launched = posix_spawn( &pid, job.process_fullpath, &file_actions, nullptr, argv, environ ) == 0;
+
+    posix_spawn_file_actions_destroy( &file_actions );
+    hfree( arguments_copy, allocator );
+
+    close( stdin_pipe[ 0 ] );
+    close( stdout_pipe[ 1 ] );
+
+    if ( !job.launched ) {
+        hprint( "Execute process error.\n Exe: \"%s\" - Args: \"%s\" - Work_dir: \"%s\"\n", job.process_fullpath, job.arguments, job.working_directory );
+
+        close( stdin_pipe[ 1 ] );
+        close( stdout_pipe[ 0 ] );
+        return;
+    }
+
+    // A child exiting before reading its input would raise SIGPIPE: block it on this thread and get EPIPE instead.
+    sigset_t pipe_signal, previous_mask;
+    sigemptyset( &pipe_signal );
+    sigaddset( &pipe_signal, SIGPIPE );
+    pthread_sigmask( SIG_BLOCK, &pipe_signal, &previous_mask );
+
+    u32 input_written = 0;
+    while ( input_written < job.input_size ) {
+        const ssize_t bytes_written = write( stdin_pipe[ 1 ], job.input + input_written, job.input_size - input_written );
+        if ( bytes_written < 0 ) {
+            if ( errno == EINTR )
+                continue;
+            break;
+        }
+        input_written += ( u32 )bytes_written;
+    }
+    close( stdin_pipe[ 1 ] );
+
+    // Consume a SIGPIPE raised by the writes, if any, before restoring the mask.
+    timespec no_wait = { 0, 0 };
+    while ( sigtimedwait( &pipe_signal, nullptr, &no_wait ) > 0 ) {
+    }
+    pthread_sigmask( SIG_SETMASK, &previous_mask, nullptr );
+
+    u32 output_capacity = 0;
+    char read_buffer[ 4096 ];
+    for ( ;; ) {
+        const ssize_t bytes_read = read( stdout_pipe[ 0 ], read_buffer, sizeof( read_buffer ) );
+        if ( bytes_read < 0 && errno == EINTR )
+            continue;
+        if ( bytes_read <= 0 )
+            break;
+
+        process_output_append( job, output_capacity, read_buffer, ( u32 )bytes_read, allocator );
+    }
+    close( stdout_pipe[ 0 ] );
+
+    int status = 0;
+    while ( waitpid( pid, &status, 0 ) < 0 && errno == EINTR ) {
+    }
+
+    job.exit_code = WIFEXITED( status ) ? WEXITSTATUS( status ) : -1;
+}
+
+#endif // _WIN64
+
+// ProcessPool ////////////////////////////////////////////////////////////
+
+//
+//
+static void process_pool_worker( void* user_data ) {
+    ProcessPool* pool = ( ProcessPool* )user_data;
+
+    for ( ;; ) {
+        ProcessJob* job = nullptr;
+        {
+            ScopedLock lock( pool->mutex );
+            while ( pool->running && pool->queue_head == pool->queue.size ) {
+                pool->job_available.wait( pool->mutex );
+            }
+
+            if ( !pool->running ) {
+                break;
+            }
+
+            job = pool->queue[ pool->queue_head++ ];
+
+            // Reuse the queue memory once everything has been consumed.
+            if ( pool->queue_head == pool->queue.size ) {
+                pool->queue.clear();
+                pool->queue_head = 0;
+            }
+        }
+
+        atomic_store_release( &job->status, ProcessJob::Status_Running );
+        process_execute_job( *job, pool->allocator );
+
+        // Completed under the lock, so wait and wait_all cannot miss it between their check and their wait.
+        ScopedLock lock( pool->mutex );
+        atomic_store_release( &job->status, ProcessJob::Status_Done );
+        --pool->pending_jobs;
+        pool->job_done.notify_all();
+    }
+}
+
+void ProcessPool::init( Allocator* allocator_, u32 max_processes ) {
+    allocator = allocator_;
+
+    mutex.init();
+    job_available.init();
+    job_done.init();
+    queue.init( allocator, 64 );
+    queue_head = 0;
+    pending_jobs = 0;
+
+    num_workers = max_processes ? max_processes : thread_hardware_concurrency();
+    num_workers = num_workers > k_max_workers ? k_max_workers : num_workers;
+
+    // Each worker owns at most one child process at a time: this bounds the concurrent processes.
+    running = true;
+    for ( u32 i = 0; i < num_workers; ++i ) {
+        thread_create( workers[ i ], process_pool_worker, this, "hydra_process" );
+    }
+}
+
+void ProcessPool::shutdown() {
+    wait_all();
+
+    {
+        ScopedLock lock( mutex );
+        running = false;
+        job_available.notify_all();
+    }
+    for ( u32 i = 0; i < num_workers; ++i ) {
+        thread_join( workers[ i ] );
+    }
+    num_workers = 0;
+
+    queue.shutdown();
+    job_done.shutdown();
+    job_available.shutdown();
+    mutex.shutdown();
+}
+
+ProcessJob* ProcessPool::submit( cstring working_directory, cstring process_fullpath, cstring arguments, const char* input, u32 input_size ) {
+    ProcessJob* job = ( ProcessJob* )halloca( sizeof( ProcessJob ), allocator );
+    *job = ProcessJob{};
+    job->working_directory = working_directory;
+    job->process_fullpath = process_fullpath;
+    job->arguments = arguments;
+    job->input = input;
+    job->input_size = input_size;
+
+    ScopedLock lock( mutex );
+    queue.push( job );
+    ++pending_jobs;
+    job_available.notify_one();
+
+    return job;
+}
+
+void ProcessPool::wait( ProcessJob* job ) {
+    ScopedLock lock( mutex );
+    while ( !job->is_done() ) {
+        job_done.wait( mutex );
+    }
+}
+
+void ProcessPool::wait_all() {
+    ScopedLock lock( mutex );
+    while ( pending_jobs != 0 ) {
+        job_done.wait( mutex );
+    }
+}
+
+void ProcessPool::release( ProcessJob* job ) {
+    if ( job == nullptr ) {
+        return;
+    }
+
+    hy_assertm( job->is_done(), "Releasing a job still in flight!" );
+
+    if ( job->output ) {
+        hfree( job->output, allocator );
+    }
+    hfree( job, allocator );
+}
+
 } // namespace hydra
\ No newline at end of file
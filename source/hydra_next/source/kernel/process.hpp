@@ -1,10 +1,85 @@
 #pragma once
 
 #include "kernel/primitive_types.hpp"
+#include "kernel/thread.hpp"
+#include "kernel/array.hpp"
 
 namespace hydra {
 
+    struct Allocator;
+
     bool                            process_execute( cstring working_directory, cstring process_fullpath, cstring arguments, cstring search_error_string = "" );
     cstring                         process_get_output();
 
+    // Process pool ///////////////////////////////////////////////////////
+
+    //
+    // External process executed by a ProcessPool.
+    // All the strings and the input memory are owned by the caller and must live until the job is done.
+    struct ProcessJob {
+
+        bool                        is_done() const                     { return atomic_load_acquire( &status ) == Status_Done; }
+        bool                        succeeded() const                   { return launched && exit_code == 0; }
+
+        enum Status : u32 {
+            Status_Queued = 0,
+            Status_Running,
+            Status_Done
+        }; // enum Status
+
+        cstring                     working_directory   = nullptr;
+        cstring                     process_fullpath    = nullptr;
+        cstring                     arguments           = nullptr;      // Full command line, first argument is the process name.
+
+        const char*                 input               = nullptr;      // Optional, written to the process stdin.
+        u32                         input_size          = 0;
+
+        char*                       output              = nullptr;      // stdout and stderr, null terminated. Allocated from the pool allocator.
+        u32                         output_size         = 0;
+
+        i32                         exit_code           = -1;
+        bool                        launched            = false;        // False if the process could not be created.
+
+        volatile u32                status              = Status_Queued;
+
+    }; // struct ProcessJob
+
+    //
+    // Executes external processes concurrently, with at most max_processes children alive at once.
+    // Output is collected in memory through pipes instead of files.
+    // Input is written entirely before reading the output: tools that read their whole input before
+    // writing (like glslangValidator --stdin) are fine.
+    // Outputs are allocated by the worker threads, so the allocator must be thread safe (like MallocAllocator).
+    struct ProcessPool {
+
+        void                        init( Allocator* allocator, u32 max_processes = 0 );    // 0 means one process per logical processor.
+        void                        shutdown();
+
+        ProcessJob*                 submit( cstring working_directory, cstring process_fullpath, cstring arguments,
+                                            const char* input = nullptr, u32 input_size = 0 );
+        void                        wait( ProcessJob* job );
+        void                        wait_all();
+        void                        release( ProcessJob* job );         // Free job and output, job must be done.
+
+        static constexpr u32        k_max_workers       = 64;
+
+        Allocator*                  allocator           = nullptr;
+        Mutex                       mutex;
+        ConditionVariable           job_available;                      // Signaled on submit and shutdown.
+        ConditionVariable           job_done;                           // Signaled when a job completes.
+
+        Array<ProcessJob*>          queue;                              // Guarded by mutex.
+        u32                         queue_head          = 0;
+
+        Thread                      workers[ k_max_workers ];
+        u32                         num_workers         = 0;
+
+        u32                         pending_jobs        = 0;            // Guarded by mutex.
+        bool                        running             = false;        // Guarded by mutex.
+
+    }; // struct ProcessPool
+
+    // Execute a process and wait for it, filling the job output and exit code. Used by the pool workers.
+    void                            process_execute_job( ProcessJob& job, Allocator* allocator );
+
 } // namespace hydra
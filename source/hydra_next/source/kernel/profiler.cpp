@@ -0,0 +1,731 @@
+#include "profiler.hpp"
+
+#include "kernel/memory.hpp"
+#include "kernel/hash_map.hpp"
+#include "kernel/numerics.hpp"
+#include "kernel/color.hpp"
+#include "kernel/file.hpp"
+#include "kernel/log.hpp"
+
+#if defined(_WIN64)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <intrin.h>
+#else
+#include <time.h>
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif // __x86_64__
+#endif // _WIN64
+
+#if defined HYDRA_IMGUI
+#include "imgui/imgui.h"
+#endif // HYDRA_IMGUI
+
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+
+namespace hydra {
+
+static CPUProfiler      s_cpu_profiler;
+
+// Time source ////////////////////////////////////////////////////////////
+
+//
+// rdtsc is used on x64: it is invariant on all the CPUs we care about and much cheaper
+// than the OS timers. Other platforms fall back to the monotonic clock in nanoseconds.
+static inline u64 profiler_ticks() {
+#if defined(_WIN64) || defined(__x86_64__)
+    return __rdtsc();
+#else
+    timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return ( u64 )now.tv_sec * 1000000000ull + ( u64 )now.tv_nsec;
+#endif // _WIN64 || __x86_64__
+}
+
+//
+// OS timer used as reference to calibrate the ticks.
+static f64 profiler_reference_microseconds() {
+#if defined(_WIN64)
+    LARGE_INTEGER frequency, time;
+    QueryPerformanceFrequency( &frequency );
+    QueryPerformanceCounter( &time );
+    return ( f64 )time.QuadPart * 1000000.0 / ( f64 )frequency.QuadPart;
+#else
+    timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return ( f64 )now.tv_sec * 1000000.0 + ( f64 )now.tv_nsec / 1000.0;
+#endif // _WIN64
+}
+
+//
+//
+static f64 profiler_calibrate() {
+#if defined(_WIN64) || defined(__x86_64__)
+    const f64 reference_start = profiler_reference_microseconds();
+    const u64 ticks_start = profiler_ticks();
+
+    thread_sleep( 20 );
+
+    const f64 reference_elapsed = profiler_reference_microseconds() - reference_start;
+    const u64 ticks_elapsed = profiler_ticks() - ticks_start;
+
+    return reference_elapsed > 0.0 ? ( f64 )ticks_elapsed / reference_elapsed : 1.0;
+#else
+    return 1000.0;
+#endif // _WIN64 || __x86_64__
+}
+
+// Per-thread rings ///////////////////////////////////////////////////////
+
+//
+// A null name marks an end event.
+struct CPUProfilerEvent {
+    u64                         ticks;
+    cstring                     name;
+}; // struct CPUProfilerEvent
+
+//
+// Single producer (owning thread), single consumer (thread calling new_frame).
+// Indices grow monotonically and are masked when accessing the events.
+struct CPUProfilerRing {
+    CPUProfilerEvent*           events;
+    u32                         mask;
+
+    volatile u32                write_index;    // Written only by the producer.
+    volatile u32                read_index;     // Written only by the consumer.
+    volatile u32                owned;          // Cleared when the producer thread exits, the ring is then reused.
+
+    // Producer only
+    u32                         open_depth;     // Begins written and not yet closed.
+    u32                         skip_depth;     // Begins dropped, their ends must be dropped as well.
+
+    // Consumer only
+    CPUProfilerEvent            open_scopes[ CPUProfiler::k_max_depth ];
+    u32                         num_open_scopes;
+
+    u32                         thread_id;
+    cstring                     thread_name;
+}; // struct CPUProfilerRing
+
+static void profiler_release_thread_ring( CPUProfilerRing* ring, u32 generation );
+
+//
+// Per-thread ring, given back to the profiler when the thread exits.
+struct CPUProfilerThreadRing {
+    ~CPUProfilerThreadRing()                            { profiler_release_thread_ring( ring, generation ); }
+
+    CPUProfilerRing*            ring        = nullptr;
+    u32                         generation  = 0;
+}; // struct CPUProfilerThreadRing
+
+static thread_local CPUProfilerThreadRing s_thread_ring;
+
+//
+//
+static CPUProfilerRing* profiler_get_thread_ring( CPUProfiler* profiler ) {
+    if ( s_thread_ring.ring && s_thread_ring.generation == profiler->generation ) {
+        return s_thread_ring.ring;
+    }
+
+    ScopedLock lock( profiler->rings_mutex );
+
+    // Reuse the ring of an exited thread. Pending events stay in place and are consumed as usual.
+    CPUProfilerRing* ring = nullptr;
+    for ( u32 i = 0; i < profiler->num_rings; ++i ) {
+        if ( atomic_load_acquire( &profiler->rings[ i ]->owned ) == 0 ) {
+            ring = profiler->rings[ i ];
+            ring->skip_depth = 0;
+            ring->thread_name = nullptr;
+            break;
+        }
+    }
+
+    if ( ring == nullptr ) {
+        if ( profiler->num_rings >= CPUProfiler::k_max_rings ) {
+            return nullptr;
+        }
+
+        ring = ( CPUProfilerRing* )halloca( sizeof( CPUProfilerRing ) + sizeof( CPUProfilerEvent ) * profiler->ring_size, profiler->allocator );
+        memset( ring, 0, sizeof( CPUProfilerRing ) );
+        ring->events = ( CPUProfilerEvent* )( ring + 1 );
+        ring->mask = profiler->ring_size - 1;
+
+        profiler->rings[ profiler->num_rings ] = ring;
+        atomic_store_release( &profiler->num_rings, profiler->num_rings + 1 );
+    }
+
+    ring->thread_id = thread_current_id();
+    atomic_store_release( &ring->owned, 1 );
+
+    s_thread_ring.ring = ring;
+    s_thread_ring.generation = profiler->generation;
+    return ring;
+}
+
+//
+// Called at thread exit. Scopes still open are closed, the ring always has room for their end events.
+// As for shutdown, the profiled threads must exit before the profiler is shut down.
+static void profiler_release_thread_ring( CPUProfilerRing* ring, u32 generation ) {
+    CPUProfiler* profiler = CPUProfiler::instance();
+    if ( ring == nullptr || !atomic_load_acquire( &profiler->enabled ) || generation != profiler->generation ) {
+        return;
+    }
+
+    for ( ; ring->open_depth; --ring->open_depth ) {
+        CPUProfilerEvent& event = ring->events[ ring->write_index & ring->mask ];
+        event.ticks = profiler_ticks();
+        event.name = nullptr;
+        atomic_store_release( &ring->write_index, ring->write_index + 1 );
+    }
+
+    atomic_store_release( &ring->owned, 0 );
+}
+
+//
+// Statistics are keyed by the name content, the same literal can have different addresses in different units.
+static void profiler_update_statistics( CPUProfiler* profiler, const CPUScope& scope ) {
+    const u64 name_hash = hash_calculate( scope.name );
+    u32 index = profiler->name_to_statistics->get( name_hash );
+    if ( index == u32_max ) {
+        index = profiler->statistics.size;
+        profiler->name_to_statistics->insert( name_hash, index );
+
+        CPUScopeStatistics& new_stats = profiler->statistics.push_use();
+        new_stats.name = scope.name;
+        new_stats.count = 0;
+        new_stats.total_ms = 0.0;
+        new_stats.min_ms = DBL_MAX;
+        new_stats.max_ms = 0.0;
+    }
+
+    const f64 duration_ms = profiler->ticks_to_milliseconds( scope.end_ticks - scope.begin_ticks );
+
+    CPUScopeStatistics& stats = profiler->statistics[ index ];
+    ++stats.count;
+    stats.total_ms += duration_ms;
+    stats.min_ms = duration_ms < stats.min_ms ? duration_ms : stats.min_ms;
+    stats.max_ms = duration_ms > stats.max_ms ? duration_ms : stats.max_ms;
+}
+
+//
+//
+static void profiler_add_scope( CPUProfiler* profiler, const CPUScope& scope ) {
+    profiler_update_statistics( profiler, scope );
+
+    if ( profiler->capturing ) {
+        profiler->captured_scopes.push( scope );
+    }
+
+    if ( !profiler->paused ) {
+        u16& active = profiler->per_frame_active[ profiler->current_frame ];
+        if ( active < CPUProfiler::k_max_frame_scopes ) {
+            profiler->frame_scopes[ profiler->current_frame * CPUProfiler::k_max_frame_scopes + active ] = scope;
+            ++active;
+        }
+    }
+}
+
+//
+//
+static void profiler_write_json_string( FileHandle file, cstring string ) {
+    for ( cstring c = string; *c; ++c ) {
+        if ( *c == '"' || *c == '\\' ) {
+            fputc( '\\', file );
+        }
+        fputc( *c, file );
+    }
+}
+
+#if defined HYDRA_IMGUI
+//
+// Same color for the same name, following statistics order.
+static u32 profiler_scope_color( CPUProfiler* profiler, const CPUScope& scope ) {
+    const u32 index = profiler->name_to_statistics->get( hash_calculate( scope.name ) );
+    return hydra::Color::get_distinct_color( index == u32_max ? 0 : index );
+}
+#endif // HYDRA_IMGUI
+
+//
+// Produces the completed scopes of a ring, in end order.
+static void profiler_consume_ring( CPUProfiler* profiler, CPUProfilerRing* ring, u32 ring_index ) {
+    const u32 write_index = atomic_load_acquire( &ring->write_index );
+    u32 read_index = ring->read_index;
+
+    for ( ; read_index != write_index; ++read_index ) {
+        const CPUProfilerEvent& event = ring->events[ read_index & ring->mask ];
+
+        if ( event.name ) {
+            // The producer never exceeds k_max_depth, the check is only defensive.
+            if ( ring->num_open_scopes < CPUProfiler::k_max_depth ) {
+                ring->open_scopes[ ring->num_open_scopes ] = event;
+            }
+            ++ring->num_open_scopes;
+            continue;
+        }
+
+        if ( ring->num_open_scopes == 0 ) {
+            continue;
+        }
+
+        --ring->num_open_scopes;
+        if ( ring->num_open_scopes >= CPUProfiler::k_max_depth ) {
+            continue;
+        }
+
+        const CPUProfilerEvent& begin = ring->open_scopes[ ring->num_open_scopes ];
+
+        CPUScope scope;
+        scope.name = begin.name;
+        scope.begin_ticks = begin.ticks;
+        scope.end_ticks = event.ticks;
+        scope.thread_index = ( u16 )ring_index;
+        scope.depth = ( u16 )ring->num_open_scopes;
+
+        profiler_add_scope( profiler, scope );
+    }
+
+    atomic_store_release( &ring->read_index, read_index );
+}
+
+// CPUProfiler ////////////////////////////////////////////////////////////
+CPUProfiler* CPUProfiler::instance() {
+    return &s_cpu_profiler;
+}
+
+void CPUProfiler::init( void* configuration ) {
+
+    CPUProfilerConfiguration default_configuration;
+    CPUProfilerConfiguration* profiler_configuration = configuration ? ( CPUProfilerConfiguration* )configuration : &default_configuration;
+
+    allocator = profiler_configuration->allocator ? profiler_configuration->allocator : &MemoryService::instance()->system_allocator;
+    max_frames = profiler_configuration->max_frames > 0 ? profiler_configuration->max_frames : 1;
+
+    // Round up to a power of two, needed for masking. Minimum size leaves room for the maximum depth.
+    ring_size = 256;
+    while ( ring_size < profiler_configuration->ring_size )
+        ring_size <<= 1;
+
+    ticks_per_microsecond = profiler_calibrate();
+
+    frame_scopes = ( CPUScope* )halloca( sizeof( CPUScope ) * max_frames * k_max_frame_scopes, allocator );
+    per_frame_active = ( u16* )halloca( sizeof( u16 ) * max_frames, allocator );
+    frame_durations = ( f32* )halloca( sizeof( f32 ) * max_frames, allocator );
+    memset( per_frame_active, 0, sizeof( u16 ) * max_frames );
+    memset( frame_durations, 0, sizeof( f32 ) * max_frames );
+    current_frame = 0;
+    frame_count = 0;
+
+    statistics.init( allocator, 64 );
+    name_to_statistics = ( FlatHashMap<u64, u32>* )halloca( sizeof( FlatHashMap<u64, u32> ), allocator );
+    name_to_statistics->init( allocator, 64 );
+    name_to_statistics->set_default_value( u32_max );
+
+    captured_scopes.init( allocator, 1024 );
+    capturing = false;
+    paused = false;
+    dropped_events = 0;
+
+    rings_mutex.init();
+    num_rings = 0;
+    ++generation;
+
+    start_ticks = last_frame_ticks = profiler_ticks();
+
+    atomic_store_release( &enabled, 1 );
+}
+
+void CPUProfiler::shutdown() {
+    if ( !enabled ) {
+        return;
+    }
+
+    // All the profiled threads must be done at this point: rings are freed.
+    atomic_store_release( &enabled, 0 );
+
+    for ( u32 i = 0; i < num_rings; ++i ) {
+        hfree( rings[ i ], allocator );
+    }
+    num_rings = 0;
+
+    if ( dropped_events ) {
+        hprint( "[profiler] %d events dropped, increase the ring size.\n", dropped_events );
+    }
+
+    captured_scopes.shutdown();
+    statistics.shutdown();
+    name_to_statistics->shutdown();
+    hfree( name_to_statistics, allocator );
+    name_to_statistics = nullptr;
+
+    hfree( frame_scopes, allocator );
+    hfree( per_frame_active, allocator );
+    hfree( frame_durations, allocator );
+
+    rings_mutex.shutdown();
+}
+
+void CPUProfiler::begin_scope( cstring name ) {
+    if ( !enabled ) {
+        return;
+    }
+
+    CPUProfilerRing* ring = profiler_get_thread_ring( this );
+    if ( ring == nullptr ) {
+        atomic_increment( &dropped_events );
+        return;
+    }
+
+    // Always leave room for the end events of the open scopes, so that a written begin is always closed.
+    const u32 used = ring->write_index - atomic_load_acquire( &ring->read_index );
+    const u32 free = ring->mask + 1 - used;
+    if ( ring->skip_depth || ring->open_depth >= k_max_depth || free < ring->open_depth + 2 ) {
+        ++ring->skip_depth;
+        atomic_increment( &dropped_events );
+        return;
+    }
+
+    CPUProfilerEvent& event = ring->events[ ring->write_index & ring->mask ];
+    event.name = name;
+    event.ticks = profiler_ticks();
+
+    ++ring->open_depth;
+    atomic_store_release( &ring->write_index, ring->write_index + 1 );
+}
+
+void CPUProfiler::end_scope() {
+    if ( !enabled ) {
+        return;
+    }
+
+    CPUProfilerRing* ring = profiler_get_thread_ring( this );
+    if ( ring == nullptr ) {
+        return;
+    }
+
+    if ( ring->skip_depth ) {
+        --ring->skip_depth;
+        return;
+    }
+
+    if ( ring->open_depth == 0 ) {
+        return;
+    }
+
+    CPUProfilerEvent& event = ring->events[ ring->write_index & ring->mask ];
+    event.ticks = profiler_ticks();
+    event.name = nullptr;
+
+    --ring->open_depth;
+    atomic_store_release( &ring->write_index, ring->write_index + 1 );
+}
+
+void CPUProfiler::set_thread_name( cstring name ) {
+    if ( !enabled ) {
+        return;
+    }
+
+    CPUProfilerRing* ring = profiler_get_thread_ring( this );
+    if ( ring ) {
+        ring->thread_name = name;
+    }
+}
+
+void CPUProfiler::new_frame() {
+    if ( !enabled ) {
+        return;
+    }
+
+    const u64 frame_ticks = profiler_ticks();
+
+    // Start a new history entry, unless paused.
+    if ( !paused ) {
+        current_frame = ( current_frame + 1 ) % max_frames;
+        per_frame_active[ current_frame ] = 0;
+    }
+
+    const u32 ring_count = atomic_load_acquire( &num_rings );
+    for ( u32 i = 0; i < ring_count; ++i ) {
+        profiler_consume_ring( this, rings[ i ], i );
+    }
+
+    // Frame duration is tracked as a statistic as well, to have it in the headless report.
+    CPUScope frame_scope { "Frame", last_frame_ticks, frame_ticks, 0, 0 };
+    profiler_update_statistics( this, frame_scope );
+
+    if ( !paused ) {
+        frame_durations[ current_frame ] = ( f32 )ticks_to_milliseconds( frame_ticks - last_frame_ticks );
+    }
+
+    last_frame_ticks = frame_ticks;
+    ++frame_count;
+}
+
+void CPUProfiler::capture_begin() {
+    captured_scopes.clear();
+    capturing = true;
+}
+
+void CPUProfiler::capture_end() {
+    capturing = false;
+}
+
+//
+// Trace event format: https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+bool CPUProfiler::export_chrome_trace( cstring filename ) {
+    FileHandle file = nullptr;
+    file_open( filename, "w", &file );
+    if ( !file ) {
+        hprint( "[profiler] Cannot open file %s for writing.\n", filename );
+        return false;
+    }
+
+    fprintf( file, "{\"traceEvents\":[\n" );
+
+    bool first = true;
+    for ( u32 i = 0; i < num_rings; ++i ) {
+        const CPUProfilerRing* ring = rings[ i ];
+        if ( ring->thread_name == nullptr ) {
+            continue;
+        }
+
+        fprintf( file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"", first ? "" : ",\n", ring->thread_id );
+        profiler_write_json_string( file, ring->thread_name );
+        fprintf( file, "\"}}" );
+        first = false;
+    }
+
+    for ( u32 i = 0; i < captured_scopes.size; ++i ) {
+        const CPUScope& scope = captured_scopes[ i ];
+
+        fprintf( file, "%s{\"name\":\"", first ? "" : ",\n" );
+        profiler_write_json_string( file, scope.name );
+        fprintf( file, "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}",
+                 ticks_to_microseconds( scope.begin_ticks - start_ticks ), ticks_to_microseconds( scope.end_ticks - scope.begin_ticks ),
+                 rings[ scope.thread_index ]->thread_id );
+        first = false;
+    }
+
+    fprintf( file, "\n],\"displayTimeUnit\":\"ms\"}\n" );
+    file_close( file );
+
+    return true;
+}
+
+void CPUProfiler::print_statistics() {
+    hprint( "[profiler] %u frames, %u scopes captured, %d events dropped.\n", frame_count, captured_scopes.size, dropped_events );
+    hprint( "%-40s %10s %12s %10s %10s %10s\n", "Name", "Count", "Total ms", "Avg ms", "Min ms", "Max ms" );
+
+    for ( u32 i = 0; i < statistics.size; ++i ) {
+        const CPUScopeStatistics& stats = statistics[ i ];
+        hprint( "%-40s %10llu %12.4f %10.4f %10.4f %10.4f\n", stats.name, stats.count, stats.total_ms,
+                stats.count ? stats.total_ms / stats.count : 0.0, stats.min_ms, stats.max_ms );
+    }
+}
+
+void CPUProfiler::reset_statistics() {
+    statistics.clear();
+    name_to_statistics->clear();
+    frame_count = 0;
+}
+
+f64 CPUProfiler::ticks_to_milliseconds( u64 ticks ) const {
+    return ( f64 )ticks / ( ticks_per_microsecond * 1000.0 );
+}
+
+f64 CPUProfiler::ticks_to_microseconds( u64 ticks ) const {
+    return ( f64 )ticks / ticks_per_microsecond;
+}
+
+void ProfilerTimeline::reset_timings() {
+    min_time = FLT_MAX;
+    max_time = -FLT_MAX;
+    average_time = 0.f;
+}
+
+#if defined HYDRA_IMGUI
+//
+//
+static f32 profiler_timeline_frame_time( void* user_data, u32 frame_index ) {
+    const CPUProfiler* profiler = ( const CPUProfiler* )user_data;
+    return profiler->frame_durations[ frame_index ];
+}
+
+//
+// Frame time in grey, top level scopes of the first thread stacked on top.
+static void profiler_timeline_draw_frame( void* user_data, u32 frame_index, f32 x, f32 bottom, f32 width, f32 pixels_per_ms ) {
+    CPUProfiler* profiler = ( CPUProfiler* )user_data;
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+
+    f32 rect_height = profiler->frame_durations[ frame_index ] * pixels_per_ms;
+    draw_list->AddRectFilled( { x, bottom - rect_height }, { x + width, bottom }, 0xff404040 );
+
+    f32 stacked_height = 0.f;
+    const CPUScope* scopes = &profiler->frame_scopes[ frame_index * CPUProfiler::k_max_frame_scopes ];
+    for ( u32 j = 0; j < profiler->per_frame_active[ frame_index ]; ++j ) {
+        const CPUScope& scope = scopes[ j ];
+        if ( scope.depth != 0 || scope.thread_index != 0 ) {
+            continue;
+        }
+
+        rect_height = ( f32 )profiler->ticks_to_milliseconds( scope.end_ticks - scope.begin_ticks ) * pixels_per_ms;
+        draw_list->AddRectFilled( { x, bottom - stacked_height - rect_height },
+                                  { x + width, bottom - stacked_height }, profiler_scope_color( profiler, scope ) );
+        stacked_height += rect_height;
+    }
+}
+
+//
+//
+static void profiler_timeline_draw_legend( void* user_data, u32 frame_index, f32 x, f32 y ) {
+    CPUProfiler* profiler = ( CPUProfiler* )user_data;
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+
+    static char buf[ 128 ];
+
+    const CPUScope* scopes = &profiler->frame_scopes[ frame_index * CPUProfiler::k_max_frame_scopes ];
+    for ( u32 j = 0; j < profiler->per_frame_active[ frame_index ]; ++j ) {
+        const CPUScope& scope = scopes[ j ];
+
+        draw_list->AddRectFilled( { x, y }, { x + 8, y + 8 }, profiler_scope_color( profiler, scope ) );
+
+        sprintf( buf, "[%u](%u)-%s %2.4f", scope.thread_index, scope.depth, scope.name, profiler->ticks_to_milliseconds( scope.end_ticks - scope.begin_ticks ) );
+        draw_list->AddText( { x + 12 + scope.depth * 8.f, y }, 0xffffffff, buf );
+
+        y += 16;
+    }
+}
+
+void CPUProfiler::imgui_draw() {
+    if ( !enabled ) {
+        return;
+    }
+
+    timeline.frame_time = profiler_timeline_frame_time;
+    timeline.draw_frame = profiler_timeline_draw_frame;
+    timeline.draw_legend = profiler_timeline_draw_legend;
+    timeline.user_data = this;
+    timeline.max_frames = max_frames;
+
+    // Timings of the frames in the history only.
+    timeline.reset_timings();
+    timeline.draw( current_frame );
+
+    ImGui::Checkbox( "Pause", &paused );
+    ImGui::SameLine();
+    if ( capturing ) {
+        if ( ImGui::Button( "Stop capture" ) ) {
+            capture_end();
+            export_chrome_trace( "cpu_trace.json" );
+        }
+        ImGui::SameLine();
+        ImGui::Text( "%u scopes", captured_scopes.size );
+    } else if ( ImGui::Button( "Capture" ) ) {
+        capture_begin();
+    }
+}
+
+// ProfilerTimeline ///////////////////////////////////////////////////////
+
+void ProfilerTimeline::draw( u32 newest_frame ) {
+    if ( max_frames == 0 ) {
+        return;
+    }
+
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    ImVec2 cursor_pos = ImGui::GetCursorScreenPos();
+    ImVec2 canvas_size = ImGui::GetContentRegionAvail();
+    f32 widget_height = canvas_size.y - 100;
+
+    f32 graph_width = canvas_size.x - legend_width;
+    u32 rect_width = ceilu32( graph_width / max_frames );
+    i32 rect_x = ceili32( graph_width - rect_width );
+    const f32 pixels_per_ms = widget_height / max_duration;
+
+    f64 new_average = 0.0;
+
+    static char buf[ 128 ];
+
+    const ImVec2 mouse_pos = ImGui::GetIO().MousePos;
+    i32 selected_frame = -1;
+
+    // Draw time reference lines
+    sprintf( buf, "%3.4fms", max_duration );
+    draw_list->AddText( { cursor_pos.x, cursor_pos.y }, 0xff0000ff, buf );
+    draw_list->AddLine( { cursor_pos.x + rect_width, cursor_pos.y }, { cursor_pos.x + graph_width, cursor_pos.y }, 0xff0000ff );
+
+    sprintf( buf, "%3.4fms", max_duration / 2.f );
+    draw_list->AddText( { cursor_pos.x, cursor_pos.y + widget_height / 2.f }, 0xff00ffff, buf );
+    draw_list->AddLine( { cursor_pos.x + rect_width, cursor_pos.y + widget_height / 2.f }, { cursor_pos.x + graph_width, cursor_pos.y + widget_height / 2.f }, 0xff00ffff );
+
+    // Draw graph
+    for ( u32 i = 0; i < max_frames; ++i ) {
+        u32 frame_index = ( newest_frame + max_frames - i ) % max_frames;
+
+        f32 frame_x = cursor_pos.x + rect_x;
+        // Clamp values to not destroy the frame data
+        f32 time = clamp( frame_time( user_data, frame_index ), 0.00001f, 1000.f );
+
+        new_average += time;
+        min_time = hydra::min( min_time, time );
+        max_time = hydra::max( max_time, time );
+
+        draw_frame( user_data, frame_index, frame_x, cursor_pos.y + widget_height, ( f32 )rect_width, pixels_per_ms );
+
+        if ( mouse_pos.x >= frame_x && mouse_pos.x < frame_x + rect_width &&
+             mouse_pos.y >= cursor_pos.y && mouse_pos.y < cursor_pos.y + widget_height ) {
+            draw_list->AddRectFilled( { frame_x, cursor_pos.y + widget_height },
+                                      { frame_x + rect_width, cursor_pos.y }, 0x0fffffff );
+
+            ImGui::SetTooltip( "(%u): %f", frame_index, time );
+
+            selected_frame = frame_index;
+        }
+
+        draw_list->AddLine( { frame_x, cursor_pos.y + widget_height }, { frame_x, cursor_pos.y }, 0x0fffffff );
+
+        rect_x -= rect_width;
+    }
+
+    average_time = ( f32 )( new_average / max_frames );
+
+    // Draw legend of the selected frame, default to the newest one.
+    draw_legend( user_data, selected_frame == -1 ? newest_frame : ( u32 )selected_frame, cursor_pos.x + graph_width, cursor_pos.y );
+
+    ImGui::Dummy( { canvas_size.x, widget_height } );
+
+    ImGui::SetNextItemWidth( 100.f );
+    ImGui::LabelText( "", "Max %3.4fms", max_time );
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth( 100.f );
+    ImGui::LabelText( "", "Min %3.4fms", min_time );
+    ImGui::SameLine();
+    ImGui::LabelText( "", "Ave %3.4fms", average_time );
+
+    static const char* items[] = { "200ms", "100ms", "66ms", "33ms", "16ms", "8ms", "4ms" };
+    static const float max_durations[] = { 200.f, 100.f, 66.f, 33.f, 16.f, 8.f, 4.f };
+
+    // Selection follows the current value, so that each timeline keeps its own.
+    int max_duration_index = 4;
+    for ( u32 i = 0; i < ArraySize( max_durations ); ++i ) {
+        if ( max_durations[ i ] == max_duration ) {
+            max_duration_index = ( int )i;
+        }
+    }
+    if ( ImGui::Combo( "Graph Max", &max_duration_index, items, IM_ARRAYSIZE( items ) ) ) {
+        max_duration = max_durations[ max_duration_index ];
+    }
+
+    ImGui::Separator();
+}
+#else
+void CPUProfiler::imgui_draw() {
+}
+
+void ProfilerTimeline::draw( u32 newest_frame ) {
+}
+#endif // HYDRA_IMGUI
+
+} // namespace hydra
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "kernel/platform.hpp"
+#include "kernel/primitive_types.hpp"
+#include "kernel/service.hpp"
+#include "kernel/thread.hpp"
+#include "kernel/array.hpp"
+
+namespace hydra {
+
+    struct Allocator;
+    struct CPUProfilerRing;
+
+    template <typename K, typename V>
+    struct FlatHashMap;
+
+    //
+    // Completed scope, produced when the matching end event is consumed.
+    struct CPUScope {
+
+        cstring                     name;
+        u64                         begin_ticks;
+        u64                         end_ticks;
+        u16                         thread_index;
+        u16                         depth;
+
+    }; // struct CPUScope
+
+    //
+    // Accumulated timings for all the scopes with the same name.
+    struct CPUScopeStatistics {
+
+        cstring                     name;
+        u64                         count;
+        f64                         total_ms;
+        f64                         min_ms;
+        f64                         max_ms;
+
+    }; // struct CPUScopeStatistics
+
+    //
+    // Frame history graph shared by the CPU and GPU profilers: time references, one column per frame with the
+    // newest on the right, tooltip of the hovered frame and timings. The owner draws the content of the columns
+    // and the legend of the selected frame through the callbacks, on the current window draw list.
+    struct ProfilerTimeline {
+
+        typedef f32                 ( *FrameTimeFunction )( void* user_data, u32 frame_index );      // Milliseconds.
+        typedef void                ( *DrawFrameFunction )( void* user_data, u32 frame_index, f32 x, f32 bottom, f32 width, f32 pixels_per_ms );
+        typedef void                ( *DrawLegendFunction )( void* user_data, u32 frame_index, f32 x, f32 y );
+
+        void                        draw( u32 newest_frame );
+        void                        reset_timings();
+
+        FrameTimeFunction           frame_time          = nullptr;
+        DrawFrameFunction           draw_frame          = nullptr;
+        DrawLegendFunction          draw_legend         = nullptr;
+        void*                       user_data           = nullptr;
+
+        u32                         max_frames          = 0;
+        f32                         legend_width        = 250.f;
+        f32                         max_duration        = 16.666f;      // Milliseconds at the top of the graph.
+
+        // Accumulated by draw until reset_timings.
+        f32                         min_time            = 0.f;
+        f32                         max_time            = 0.f;
+        f32                         average_time        = 0.f;
+
+    }; // struct ProfilerTimeline
+
+    struct CPUProfilerConfiguration {
+
+        Allocator*                  allocator           = nullptr;
+        u32                         max_frames          = 100;          // Frames kept in the history shown by imgui_draw.
+        u32                         ring_size           = 8192;         // Events per producer thread. Rounded up to a power of two.
+
+    }; // struct CPUProfilerConfiguration
+
+    //
+    // Scoped CPU profiler. Each thread writes begin/end events in its own ring buffer,
+    // new_frame consumes them on the calling thread and aggregates the completed scopes.
+    // Works without ImGui: statistics can be printed and captures exported as Chrome trace_event JSON.
+    struct CPUProfiler : public Service {
+
+        hy_declare_service( CPUProfiler );
+
+        void                        init( void* configuration ) override;
+        void                        shutdown() override;
+
+        void                        begin_scope( cstring name );        // Name must be a string that outlives the profiler, like a literal.
+        void                        end_scope();
+
+        void                        set_thread_name( cstring name );    // Optional name for the calling thread, used in the trace export.
+
+        void                        new_frame();                        // Consume events from all threads. Call once per frame from a single thread.
+
+        void                        capture_begin();                    // Keep all scopes until capture_end, for exporting.
+        void                        capture_end();
+        bool                        export_chrome_trace( cstring filename );   // Load in chrome://tracing or ui.perfetto.dev.
+
+        void                        print_statistics();
+        void                        reset_statistics();
+
+        f64                         ticks_to_milliseconds( u64 ticks ) const;
+        f64                         ticks_to_microseconds( u64 ticks ) const;
+
+        void                        imgui_draw();
+
+        static constexpr u32        k_max_rings         = 32;
+        static constexpr u32        k_max_depth         = 32;
+        static constexpr u32        k_max_frame_scopes  = 64;           // Scopes per frame kept in the history.
+
+        Allocator*                  allocator           = nullptr;
+
+        CPUProfilerRing*            rings[ k_max_rings ];
+        u32                         num_rings           = 0;
+        Mutex                       rings_mutex;
+        u32                         generation          = 0;            // Invalidates per-thread rings between init/shutdown.
+        u32                         ring_size           = 0;
+        volatile u32                enabled             = 0;
+
+        f64                         ticks_per_microsecond = 1.0;
+        u64                         start_ticks         = 0;
+        u64                         last_frame_ticks    = 0;
+
+        // Frame history
+        CPUScope*                   frame_scopes        = nullptr;      // max_frames * k_max_frame_scopes
+        u16*                        per_frame_active    = nullptr;
+        f32*                        frame_durations     = nullptr;      // Milliseconds.
+        u32                         max_frames          = 0;
+        u32                         current_frame       = 0;
+        u32                         frame_count         = 0;
+
+        // Statistics and capture
+        Array<CPUScopeStatistics>   statistics;
+        FlatHashMap<u64, u32>*      name_to_statistics  = nullptr;
+        Array<CPUScope>             captured_scopes;
+        bool                        capturing           = false;
+
+        ProfilerTimeline            timeline;
+        bool                        paused              = false;
+
+        volatile i32                dropped_events      = 0;            // Ring full or no ring available.
+
+        static constexpr cstring    k_name = "hydra_cpu_profiler";
+
+    }; // struct CPUProfiler
+
+    //
+    // RAII helper, use through hy_cpu_profile_scope.
+    struct CPUProfileScope {
+
+        CPUProfileScope( cstring name )                                 { CPUProfiler::instance()->begin_scope( name ); }
+        ~CPUProfileScope()                                              { CPUProfiler::instance()->end_scope(); }
+
+    }; // struct CPUProfileScope
+
+    #define hy_cpu_profile_scope(name)      hydra::CPUProfileScope HY_UNIQUE_SUFFIX(cpu_profile_scope_)( name );
+
+} // namespace hydra
@@ -3,6 +3,7 @@
 #include "kernel/primitive_types.hpp"
 #include "kernel/assert.hpp"
 #include "kernel/hash_map.hpp"
+#include "kernel/string_id.hpp"
 
 namespace hydra {
 
@@ -16,7 +17,8 @@ struct Resource {
     void            remove_reference()  { hy_assert( references != 0 ); --references; }
 
     u64             references  = 0;
-    cstring         name        = nullptr;
+    StringId        name;
+
 
 }; // struct Resource
 
@@ -0,0 +1,191 @@
+#include "string_id.hpp"
+
+#include "kernel/memory.hpp"
+#include "kernel/hash_map.hpp"
+#include "kernel/assert.hpp"
+
+#include <string.h>
+
+namespace hydra {
+
+static StringIdService s_string_id_service;
+
+// StringId ///////////////////////////////////////////////////////////////
+cstring StringId::c_str() const {
+    return s_string_id_service.get_string( *this );
+}
+
+// StringIdService ////////////////////////////////////////////////////////
+StringIdService* StringIdService::instance() {
+    return &s_string_id_service;
+}
+
+void StringIdService::init( Allocator* allocator_, u32 page_size_ ) {
+
+    allocator = allocator_;
+    page_size = page_size_;
+
+    mutex.init();
+
+    hash_to_index = ( FlatHashMap<u64, u32>* )halloca( sizeof( FlatHashMap<u64, u32> ), allocator );
+    hash_to_index->init( allocator, 1024 );
+    hash_to_index->set_default_value( StringId::k_invalid_index );
+
+    num_pages = 0;
+    current_page_offset = page_size;    // Forces a page allocation on the first intern.
+    num_strings = 0;
+
+    memset( string_chunks, 0, sizeof( string_chunks ) );
+}
+
+void StringIdService::shutdown() {
+
+    for ( u32 i = 0; i < num_pages; ++i ) {
+        hfree( pages[ i ], allocator );
+    }
+    num_pages = 0;
+
+    for ( u32 i = 0; i < k_max_chunks; ++i ) {
+        if ( string_chunks[ i ] ) {
+            hfree( string_chunks[ i ], allocator );
+            string_chunks[ i ] = nullptr;
+        }
+    }
+    num_strings = 0;
+
+    hash_to_index->shutdown();
+    hfree( hash_to_index, allocator );
+    hash_to_index = nullptr;
+
+    mutex.shutdown();
+}
+
+StringId StringIdService::intern( cstring string ) {
+    return intern( string, strlen( string ) );
+}
+
+StringId StringIdService::intern( cstring string, sizet length ) {
+
+    StringId id;
+    if ( string == nullptr ) {
+        return id;
+    }
+
+    hy_assertm( hash_to_index, "StringIdService not initialized!" );
+
+    // Hash outside of the lock.
+    id.hash = hash_bytes( ( void* )string, length );
+
+    ScopedLock lock( mutex );
+
+    // Probe consecutive keys to resolve the (unlikely) hash collisions.
+    u64 key = id.hash;
+    for ( ;; ) {
+        const u32 existing_index = hash_to_index->get( key );
+        if ( existing_index == StringId::k_invalid_index ) {
+            break;
+        }
+
+        cstring existing = get_string( { id.hash, existing_index } );
+        if ( strncmp( existing, string, length ) == 0 && existing[ length ] == 0 ) {
+            id.index = existing_index;
+            return id;
+        }
+        ++key;
+    }
+
+    // Reserve the index table slot first: a full table must not waste arena memory.
+    const u32 new_index = num_strings;
+    const u32 chunk_index = new_index / k_strings_per_chunk;
+    hy_assertm( chunk_index < k_max_chunks, "StringIdService string table full!" );
+    if ( chunk_index >= k_max_chunks ) {
+        return id;
+    }
+
+    if ( string_chunks[ chunk_index ] == nullptr ) {
+        string_chunks[ chunk_index ] = ( cstring* )halloca( sizeof( cstring ) * k_strings_per_chunk, allocator );
+    }
+
+    // Copy string into the arena.
+    const u32 required_size = ( u32 )length + 1;
+    if ( current_page_offset + required_size > page_size ) {
+        hy_assertm( num_pages < k_max_pages, "StringIdService arena full!" );
+        if ( num_pages >= k_max_pages ) {
+            return id;
+        }
+
+        // Strings bigger than a page get their own dedicated page.
+        const u32 new_page_size = required_size > page_size ? required_size : page_size;
+        pages[ num_pages++ ] = ( char* )halloca( new_page_size, allocator );
+        current_page_offset = 0;
+    }
+
+    char* interned_string = pages[ num_pages - 1 ] + current_page_offset;
+    memcpy( interned_string, string, length );
+    interned_string[ length ] = 0;
+    current_page_offset += required_size;
+
+    // Add to index table.
+    string_chunks[ chunk_index ][ new_index % k_strings_per_chunk ] = interned_string;
+
+    hash_to_index->insert( key, new_index );
+
+    // Publish the string so that lock-free readers can see it.
+    atomic_store_release( &num_strings, new_index + 1 );
+
+    id.index = new_index;
+    return id;
+}
+
+StringId StringIdService::find( cstring string ) {
+
+    StringId id;
+    if ( string == nullptr || hash_to_index == nullptr ) {
+        return id;
+    }
+
+    const sizet length = strlen( string );
+    const u64 hash = hash_bytes( ( void* )string, length );
+
+    ScopedLock lock( mutex );
+
+    u64 key = hash;
+    for ( ;; ) {
+        const u32 existing_index = hash_to_index->get( key );
+        if ( existing_index == StringId::k_invalid_index ) {
+            return id;
+        }
+
+        cstring existing = get_string( { hash, existing_index } );
+        if ( strcmp( existing, string ) == 0 ) {
+            id.hash = hash;
+            id.index = existing_index;
+            return id;
+        }
+        ++key;
+    }
+}
+
+cstring StringIdService::get_string( StringId id ) const {
+    // Empty string for invalid ids, so that they can always be printed.
+    if ( id.index >= atomic_load_acquire( &num_strings ) ) {
+        return "";
+    }
+
+    return string_chunks[ id.index / k_strings_per_chunk ][ id.index % k_strings_per_chunk ];
+}
+
+u32 StringIdService::get_string_count() const {
+    return atomic_load_acquire( &num_strings );
+}
+
+// Convenience methods ////////////////////////////////////////////////////
+StringId string_id_intern( cstring string ) {
+    return s_string_id_service.intern( string );
+}
+
+cstring string_id_c_str( StringId id ) {
+    return s_string_id_service.get_string( id );
+}
+
+} // namespace hydra
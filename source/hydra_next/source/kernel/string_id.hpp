@@ -0,0 +1,75 @@
+#pragma once
+
+#include "kernel/primitive_types.hpp"
+#include "kernel/service.hpp"
+#include "kernel/thread.hpp"
+
+namespace hydra {
+
+    struct Allocator;
+
+    template <typename K, typename V>
+    struct FlatHashMap;
+
+    //
+    // Compact handle to an interned string. The same string always returns the same id,
+    // so comparisons are a single integer compare and the hash can be used directly as a key.
+    struct StringId {
+
+        bool                        is_valid() const                    { return index != k_invalid_index; }
+        cstring                     c_str() const;
+
+        bool                        operator==( const StringId& other ) const { return index == other.index; }
+        bool                        operator!=( const StringId& other ) const { return index != other.index; }
+
+        u64                         hash                = 0;            // Same as hash_calculate( cstring ).
+        u32                         index               = k_invalid_index;
+
+        static constexpr u32        k_invalid_index     = 0xffffffff;
+
+    }; // struct StringId
+
+    //
+    // Thread-safe service storing each string once in a growable arena.
+    // Strings and ids are never moved or freed until shutdown.
+    struct StringIdService : public Service {
+
+        hy_declare_service( StringIdService );
+
+        void                        init( Allocator* allocator, u32 page_size = 64 * 1024 );
+        void                        shutdown();
+
+        StringId                    intern( cstring string );
+        StringId                    intern( cstring string, sizet length );
+        StringId                    find( cstring string );                            // Does not insert, returns an invalid id if missing.
+
+        cstring                     get_string( StringId id ) const;                  // Empty string for invalid ids, never null.
+        u32                         get_string_count() const;
+
+        // Arena pages: strings are appended, a new page is allocated when full.
+        static constexpr u32        k_max_pages         = 256;
+        // Index -> string table, split in fixed chunks so lookups never need a lock.
+        static constexpr u32        k_strings_per_chunk = 4096;
+        static constexpr u32        k_max_chunks        = 256;
+
+        Mutex                       mutex;
+        Allocator*                  allocator           = nullptr;
+        FlatHashMap<u64, u32>*      hash_to_index       = nullptr;      // Note: trying to avoid bringing the hash map header.
+
+        char*                       pages[ k_max_pages ];
+        u32                         num_pages           = 0;
+        u32                         page_size           = 0;
+        u32                         current_page_offset = 0;
+
+        cstring*                    string_chunks[ k_max_chunks ];
+        u32                         num_strings         = 0;
+
+        static constexpr cstring    k_name = "hydra_string_id_service";
+
+    }; // struct StringIdService
+
+    // Convenience methods using the global service.
+    StringId                        string_id_intern( cstring string );
+    cstring                         string_id_c_str( StringId id );
+
+} // namespace hydra
@@ -0,0 +1,329 @@
+#include "thread.hpp"
+#include "assert.hpp"
+
+#if defined(_WIN64)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <intrin.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#endif // _WIN64
+
+namespace hydra {
+
+// Mutex and ConditionVariable //////////////////////////////////////////////
+#if defined(_WIN64)
+
+static_assert( sizeof( SRWLOCK ) <= sizeof( Mutex::storage ), "Mutex storage too small!" );
+
+void Mutex::init() {
+    InitializeSRWLock( ( SRWLOCK* )storage );
+}
+
+void Mutex::shutdown() {
+    // Nothing to do for SRW locks.
+}
+
+void Mutex::lock() {
+    AcquireSRWLockExclusive( ( SRWLOCK* )storage );
+}
+
+void Mutex::unlock() {
+    ReleaseSRWLockExclusive( ( SRWLOCK* )storage );
+}
+
+bool Mutex::try_lock() {
+    return TryAcquireSRWLockExclusive( ( SRWLOCK* )storage ) != 0;
+}
+
+static_assert( sizeof( CONDITION_VARIABLE ) <= sizeof( ConditionVariable::storage ), "ConditionVariable storage too small!" );
+
+void ConditionVariable::init() {
+    InitializeConditionVariable( ( CONDITION_VARIABLE* )storage );
+}
+
+void ConditionVariable::shutdown() {
+    // Nothing to do for condition variables.
+}
+
+void ConditionVariable::wait( Mutex& mutex ) {
+    SleepConditionVariableSRW( ( CONDITION_VARIABLE* )storage, ( SRWLOCK* )mutex.storage, INFINITE, 0 );
+}
+
+bool ConditionVariable::wait_for( Mutex& mutex, u32 milliseconds ) {
+    return SleepConditionVariableSRW( ( CONDITION_VARIABLE* )storage, ( SRWLOCK* )mutex.storage, milliseconds, 0 ) != 0;
+}
+
+void ConditionVariable::notify_one() {
+    WakeConditionVariable( ( CONDITION_VARIABLE* )storage );
+}
+
+void ConditionVariable::notify_all() {
+    WakeAllConditionVariable( ( CONDITION_VARIABLE* )storage );
+}
+
+#else
+
+static_assert( sizeof( pthread_mutex_t ) <= sizeof( Mutex::storage ), "Mutex storage too small!" );
+
+void Mutex::init() {
+    pthread_mutex_init( ( pthread_mutex_t* )storage, nullptr );
+}
+
+void Mutex::shutdown() {
+    pthread_mutex_destroy( ( pthread_mutex_t* )storage );
+}
+
+void Mutex::lock() {
+    pthread_mutex_lock( ( pthread_mutex_t* )storage );
+}
+
+void Mutex::unlock() {
+    pthread_mutex_unlock( ( pthread_mutex_t* )storage );
+}
+
+bool Mutex::try_lock() {
+    return pthread_mutex_trylock( ( pthread_mutex_t* )storage ) == 0;
+}
+
+static_assert( sizeof( pthread_cond_t ) <= sizeof( ConditionVariable::storage ), "ConditionVariable storage too small!" );
+
+void ConditionVariable::init() {
+    pthread_cond_init( ( pthread_cond_t* )storage, nullptr );
+}
+
+void ConditionVariable::shutdown() {
+    pthread_cond_destroy( ( pthread_cond_t* )storage );
+}
+
+void ConditionVariable::wait( Mutex& mutex ) {
+    pthread_cond_wait( ( pthread_cond_t* )storage, ( pthread_mutex_t* )mutex.storage );
+}
+
+bool ConditionVariable::wait_for( Mutex& mutex, u32 milliseconds ) {
+    // Condition variables initialized with default attributes use the realtime clock.
+    timespec deadline;
+    clock_gettime( CLOCK_REALTIME, &deadline );
+    deadline.tv_sec += milliseconds / 1000;
+    deadline.tv_nsec += ( milliseconds % 1000 ) * 1000000L;
+    if ( deadline.tv_nsec >= 1000000000L ) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    return pthread_cond_timedwait( ( pthread_cond_t* )storage, ( pthread_mutex_t* )mutex.storage, &deadline ) != ETIMEDOUT;
+}
+
+void ConditionVariable::notify_one() {
+    pthread_cond_signal( ( pthread_cond_t* )storage );
+}
+
+void ConditionVariable::notify_all() {
+    pthread_cond_broadcast( ( pthread_cond_t* )storage );
+}
+
+#endif // _WIN64
+
+// Atomics ////////////////////////////////////////////////////////////////
+#if defined(_WIN64)
+
+i32 atomic_increment( volatile i32* value ) {
+    return InterlockedIncrement( ( volatile LONG* )value );
+}
+
+i32 atomic_decrement( volatile i32* value ) {
+    return InterlockedDecrement( ( volatile LONG* )value );
+}
+
+i32 atomic_add( volatile i32* value, i32 amount ) {
+    return InterlockedExchangeAdd( ( volatile LONG* )value, amount );
+}
+
+i64 atomic_add( volatile i64* value, i64 amount ) {
+    return InterlockedExchangeAdd64( ( volatile LONG64* )value, amount );
+}
+
+bool atomic_compare_exchange( volatile i32* value, i32 expected, i32 desired ) {
+    return InterlockedCompareExchange( ( volatile LONG* )value, desired, expected ) == expected;
+}
+
+// On x64 aligned loads and stores are atomic: the barrier only prevents compiler reordering.
+u32 atomic_load_acquire( const volatile u32* value ) {
+    const u32 result = *value;
+    _ReadWriteBarrier();
+    return result;
+}
+
+void atomic_store_release( volatile u32* value, u32 new_value ) {
+    _ReadWriteBarrier();
+    *value = new_value;
+}
+
+u64 atomic_load_acquire( const volatile u64* value ) {
+    const u64 result = *value;
+    _ReadWriteBarrier();
+    return result;
+}
+
+void atomic_store_release( volatile u64* value, u64 new_value ) {
+    _ReadWriteBarrier();
+    *value = new_value;
+}
+
+#else
+
+i32 atomic_increment( volatile i32* value ) {
+    return __atomic_add_fetch( value, 1, __ATOMIC_SEQ_CST );
+}
+
+i32 atomic_decrement( volatile i32* value ) {
+    return __atomic_sub_fetch( value, 1, __ATOMIC_SEQ_CST );
+}
+
+i32 atomic_add( volatile i32* value, i32 amount ) {
+    return __atomic_fetch_add( value, amount, __ATOMIC_SEQ_CST );
+}
+
+i64 atomic_add( volatile i64* value, i64 amount ) {
+    return __atomic_fetch_add( value, amount, __ATOMIC_SEQ_CST );
+}
+
+bool atomic_compare_exchange( volatile i32* value, i32 expected, i32 desired ) {
+    return __atomic_compare_exchange_n( value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST );
+}
+
+u32 atomic_load_acquire( const volatile u32* value ) {
+    return __atomic_load_n( value, __ATOMIC_ACQUIRE );
+}
+
+void atomic_store_release( volatile u32* value, u32 new_value ) {
+    __atomic_store_n( value, new_value, __ATOMIC_RELEASE );
+}
+
+u64 atomic_load_acquire( const volatile u64* value ) {
+    return __atomic_load_n( value, __ATOMIC_ACQUIRE );
+}
+
+void atomic_store_release( volatile u64* value, u64 new_value ) {
+    __atomic_store_n( value, new_value, __ATOMIC_RELEASE );
+}
+
+#endif // _WIN64
+
+// Thread /////////////////////////////////////////////////////////////////
+#if defined(_WIN64)
+
+static DWORD WINAPI thread_entry_point( LPVOID parameter ) {
+    Thread* thread = ( Thread* )parameter;
+    thread->function( thread->user_data );
+    return 0;
+}
+
+bool thread_create( Thread& thread, ThreadFunction function, void* user_data, cstring name ) {
+    thread.function = function;
+    thread.user_data = user_data;
+    thread.name = name;
+    thread.handle = CreateThread( NULL, 0, thread_entry_point, &thread, 0, NULL );
+
+    return thread.handle != nullptr;
+}
+
+void thread_join( Thread& thread ) {
+    if ( thread.handle == nullptr ) {
+        return;
+    }
+
+    WaitForSingleObject( ( HANDLE )thread.handle, INFINITE );
+    CloseHandle( ( HANDLE )thread.handle );
+    thread.handle = nullptr;
+}
+
+void thread_sleep( u32 milliseconds ) {
+    Sleep( milliseconds );
+}
+
+void thread_yield() {
+    SwitchToThread();
+}
+
+u32 thread_current_id() {
+    return GetCurrentThreadId();
+}
+
+u32 thread_hardware_concurrency() {
+    SYSTEM_INFO system_info;
+    GetSystemInfo( &system_info );
+    return system_info.dwNumberOfProcessors > 0 ? system_info.dwNumberOfProcessors : 1;
+}
+
+#else
+
+static void* thread_entry_point( void* parameter ) {
+    Thread* thread = ( Thread* )parameter;
+    thread->function( thread->user_data );
+    return nullptr;
+}
+
+bool thread_create( Thread& thread, ThreadFunction function, void* user_data, cstring name ) {
+    thread.function = function;
+    thread.user_data = user_data;
+    thread.name = name;
+
+    pthread_t pthread;
+    if ( pthread_create( &pthread, nullptr, thread_entry_point, &thread ) != 0 ) {
+        thread.handle = nullptr;
+        return false;
+    }
+#if defined(__linux__)
+    if ( name ) {
+        // Linux limits thread names to 16 characters including the terminator.
+        char short_name[ 16 ];
+        strncpy( short_name, name, 15 );
+        short_name[ 15 ] = 0;
+        pthread_setname_np( pthread, short_name );
+    }
+#endif // __linux__
+
+    thread.handle = ( void* )pthread;
+    return true;
+}
+
+void thread_join( Thread& thread ) {
+    if ( thread.handle == nullptr ) {
+        return;
+    }
+
+    pthread_join( ( pthread_t )thread.handle, nullptr );
+    thread.handle = nullptr;
+}
+
+void thread_sleep( u32 milliseconds ) {
+    usleep( milliseconds * 1000 );
+}
+
+void thread_yield() {
+    sched_yield();
+}
+
+u32 thread_current_id() {
+#if defined(__linux__)
+    return ( u32 )syscall( SYS_gettid );
+#else
+    return ( u32 )( uintptr_t )pthread_self();
+#endif // __linux__
+}
+
+u32 thread_hardware_concurrency() {
+    const long count = sysconf( _SC_NPROCESSORS_ONLN );
+    return count > 0 ? ( u32 )count : 1;
+}
+
+#endif // _WIN64
+
+} // namespace hydra
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "kernel/primitive_types.hpp"
+
+namespace hydra {
+
+    // Mutex //////////////////////////////////////////////////////////////
+
+    //
+    // Lightweight mutex wrapping the platform primitive (SRWLOCK on Windows, pthread_mutex_t elsewhere).
+    struct Mutex {
+
+        void                        init();
+        void                        shutdown();
+
+        void                        lock();
+        void                        unlock();
+        bool                        try_lock();
+
+        u64                         storage[ 8 ];       // Opaque platform storage, avoids including platform headers.
+
+    }; // struct Mutex
+
+    //
+    //
+    struct ScopedLock {
+
+        ScopedLock( Mutex& mutex_ ) : mutex( mutex_ ) { mutex.lock(); }
+        ~ScopedLock()                                  { mutex.unlock(); }
+
+        Mutex&                      mutex;
+
+    }; // struct ScopedLock
+
+    //
+    // Condition variable used with a Mutex (CONDITION_VARIABLE on Windows, pthread_cond_t elsewhere).
+    // Wakes can be spurious: always wait in a loop checking the condition.
+    struct ConditionVariable {
+
+        void                        init();
+        void                        shutdown();
+
+        void                        wait( Mutex& mutex );   // Mutex must be locked, it is locked again on return.
+        bool                        wait_for( Mutex& mutex, u32 milliseconds );    // As wait, returns false on timeout.
+        void                        notify_one();
+        void                        notify_all();
+
+        u64                         storage[ 8 ];       // Opaque platform storage, avoids including platform headers.
+
+    }; // struct ConditionVariable
+
+    // Atomics ////////////////////////////////////////////////////////////
+
+    i32                             atomic_increment( volatile i32* value );                    // Returns the incremented value.
+    i32                             atomic_decrement( volatile i32* value );                    // Returns the decremented value.
+    i32                             atomic_add( volatile i32* value, i32 amount );              // Returns the previous value.
+    i64                             atomic_add( volatile i64* value, i64 amount );              // Returns the previous value.
+    bool                            atomic_compare_exchange( volatile i32* value, i32 expected, i32 desired );
+
+    u32                             atomic_load_acquire( const volatile u32* value );
+    void                            atomic_store_release( volatile u32* value, u32 new_value );
+    u64                             atomic_load_acquire( const volatile u64* value );
+    void                            atomic_store_release( volatile u64* value, u64 new_value );
+
+    // Thread /////////////////////////////////////////////////////////////
+
+    typedef void                    ( *ThreadFunction )( void* user_data );
+
+    //
+    // Thread data must outlive the thread itself, as it is used to start the function.
+    struct Thread {
+
+        void*                       handle              = nullptr;
+        ThreadFunction              function            = nullptr;
+        void*                       user_data           = nullptr;
+        cstring                     name                = nullptr;
+
+    }; // struct Thread
+
+    bool                            thread_create( Thread& thread, ThreadFunction function, void* user_data, cstring name );
+    void                            thread_join( Thread& thread );
+
+    void                            thread_sleep( u32 milliseconds );
+    void                            thread_yield();
+    u32                             thread_current_id();
+    u32                             thread_hardware_concurrency();      // Number of logical processors, at least 1.
+
+} // namespace hydra
@@ -0,0 +1,485 @@
+// Headless tests of the graphics layer, built with HYDRA_NULL: no window, surface or GPU are needed.
+// Returns the number of failed checks, so that the build can run it after linking.
+
+#include "graphics/gpu_device.hpp"
+#include "graphics/gpu_device_null.hpp"
+#include "graphics/command_buffer.hpp"
+#include "graphics/gpu_profiler.hpp"
+#include "graphics/renderer.hpp"
+#include "graphics/render_graph.hpp"
+
+#include "kernel/memory.hpp"
+#include "kernel/log.hpp"
+#include "kernel/time.hpp"
+#include "kernel/string_id.hpp"
+#include "kernel/hash_map.hpp"
+
+using namespace hydra;
+using namespace hydra::gfx;
+
+static u32          s_checks        = 0;
+static u32          s_failed_checks = 0;
+
+#define hy_test_check( condition ) test_check( condition, #condition, __FILE__, __LINE__ )
+
+static void test_check( bool condition, cstring text, cstring file, i32 line ) {
+    ++s_checks;
+    if ( !condition ) {
+        ++s_failed_checks;
+        hprint( "%s(%d): check failed: %s\n", file, line, text );
+    }
+}
+
+//
+// Draws of the recorded stream, in order. first_vertex is the first argument of the null draw command.
+static u32 test_read_draws( CommandBuffer* command_buffer, u32* out_first_vertices, u32 max_draws ) {
+    u32 num_draws = 0;
+
+    const u8* stream = command_buffer->stream.data;
+    const u8* stream_end = stream + command_buffer->stream.size;
+    while ( stream < stream_end ) {
+        const NullCommandHeader* header = ( const NullCommandHeader* )stream;
+        if ( header->type == NullCommandType::Draw && num_draws < max_draws ) {
+            out_first_vertices[ num_draws++ ] = *( const u32* )( header + 1 );
+        }
+
+        stream += sizeof( NullCommandHeader ) + header->size;
+    }
+
+    return num_draws;
+}
+
+static u32 test_count_commands( CommandBuffer* command_buffer, NullCommandType::Enum type ) {
+    u32 count = 0;
+
+    const u8* stream = command_buffer->stream.data;
+    const u8* stream_end = stream + command_buffer->stream.size;
+    while ( stream < stream_end ) {
+        const NullCommandHeader* header = ( const NullCommandHeader* )stream;
+        count += header->type == type ? 1 : 0;
+
+        stream += sizeof( NullCommandHeader ) + header->size;
+    }
+
+    return count;
+}
+
+static PipelineHandle test_create_pipeline( Device& gpu, cstring name ) {
+    PipelineCreation pipeline_creation;
+    pipeline_creation.shaders.set_name( name ).add_stage( nullptr, 0, ShaderStage::Vertex );
+    pipeline_creation.name = name;
+
+    return gpu.create_pipeline( pipeline_creation );
+}
+
+// Deferred replay //////////////////////////////////////////////////////////////
+
+//
+// Two streams recorded out of order are merged by key, and repeated binds are removed.
+static void test_deferred_replay( Device& gpu, Allocator* allocator ) {
+
+    hprint( "Test: deferred replay sort and bind filtering.\n" );
+
+    PipelineHandle pipeline_a = test_create_pipeline( gpu, "Test_Pipeline_A" );
+    PipelineHandle pipeline_b = test_create_pipeline( gpu, "Test_Pipeline_B" );
+
+    DeferredCommandStream streams[ 2 ];
+    streams[ 0 ].init( allocator, 4096 );
+    streams[ 1 ].init( allocator, 4096 );
+
+    CommandBuffer* command_buffers[ 2 ];
+    for ( u32 i = 0; i < 2; ++i ) {
+        command_buffers[ i ] = gpu.get_command_buffer( i, QueueType::Graphics, true );
+        command_buffers[ i ]->set_deferred( &streams[ i ] );
+    }
+
+    // Stage 1 is recorded first, in the first stream. Sequences use more than one byte,
+    // and keys of the first stream are recorded backwards.
+    u64 stage_1 = sort_key_stage( 1 );
+    command_buffers[ 0 ]->bind_pipeline( stage_1 + 0x300, pipeline_b );
+    command_buffers[ 0 ]->draw( stage_1 + 0x301, TopologyType::Triangle, 6, 3, 0, 1 );
+    command_buffers[ 0 ]->bind_pipeline( stage_1 + 0x100, pipeline_a );
+    command_buffers[ 0 ]->draw( stage_1 + 0x101, TopologyType::Triangle, 4, 3, 0, 1 );
+    command_buffers[ 0 ]->bind_pipeline( stage_1 + 0x200, pipeline_a );
+    command_buffers[ 0 ]->draw( stage_1 + 0x201, TopologyType::Triangle, 5, 3, 0, 1 );
+
+    // Stage 0 in the second stream: same pipeline bound three times.
+    u64 stage_0 = sort_key_stage( 0 );
+    for ( u32 i = 0; i < 3; ++i ) {
+        command_buffers[ 1 ]->bind_pipeline( stage_0 + i * 2, pipeline_a );
+        command_buffers[ 1 ]->draw( stage_0 + i * 2 + 1, TopologyType::Triangle, 1 + i, 3, 0, 1 );
+    }
+
+    // Commands with the same key keep the order of the streams.
+    command_buffers[ 0 ]->draw( sort_key_stage( 2 ), TopologyType::Triangle, 7, 3, 0, 1 );
+    command_buffers[ 1 ]->draw( sort_key_stage( 2 ), TopologyType::Triangle, 8, 3, 0, 1 );
+
+    DeferredCommandStream* stream_pointers[ 2 ] = { &streams[ 0 ], &streams[ 1 ] };
+    Array<DeferredCommandKey> sort_keys, sort_scratch;
+    sort_keys.init( allocator, 64 );
+    sort_scratch.init( allocator, 64 );
+
+    CommandBuffer* target = gpu.get_command_buffer( 0, QueueType::Graphics, true );
+    DeferredReplayStats stats;
+    deferred_commands_replay( target, stream_pointers, 2, sort_keys, sort_scratch, stats );
+
+    hy_test_check( stats.num_streams == 2 );
+    hy_test_check( stats.recorded_commands == 14 );
+    // Pipeline A stays bound from the first bind of stage 0 to the bind of B in stage 1.
+    hy_test_check( stats.removed_pipeline_binds == 4 );
+    hy_test_check( stats.replayed_commands == 10 );
+
+    u32 first_vertices[ 16 ];
+    const u32 num_draws = test_read_draws( target, first_vertices, 16 );
+    hy_test_check( num_draws == 8 );
+    for ( u32 i = 0; i < num_draws; ++i ) {
+        hy_test_check( first_vertices[ i ] == i + 1 );
+    }
+
+    // Pipeline A is bound once for stages 0 and 1, then B.
+    hy_test_check( test_count_commands( target, NullCommandType::BindPipeline ) == 2 );
+    hy_test_check( target->bind_stats.issued_pipelines == 2 );
+
+    sort_scratch.shutdown();
+    sort_keys.shutdown();
+
+    for ( u32 i = 0; i < 2; ++i ) {
+        command_buffers[ i ]->set_deferred( nullptr );
+        streams[ i ].shutdown();
+    }
+
+    gpu.destroy_pipeline( pipeline_a );
+    gpu.destroy_pipeline( pipeline_b );
+}
+
+// Dynamic allocator ////////////////////////////////////////////////////////////
+
+//
+// Small ring: constants fail when it is full, vertex data goes in overflow pages, and both are
+// given back when the device would have waited for the frame.
+static void test_dynamic_allocator( Device& gpu ) {
+
+    hprint( "Test: dynamic allocator overflow.\n" );
+
+    DynamicAllocator ring;
+    ring.init( &gpu, 4096, 256, 256 );
+
+    ring.begin_frame( 0 );
+
+    DynamicAllocation constants[ 3 ];
+    for ( u32 i = 0; i < 3; ++i ) {
+        constants[ i ] = ring.allocate( 1000, BufferType::Constant_mask );
+        hy_test_check( constants[ i ].data != nullptr );
+        hy_test_check( constants[ i ].buffer.index == ring.buffer.index );
+        hy_test_check( ( constants[ i ].offset & 255 ) == 0 );
+    }
+
+    // 1024 bytes left: constants can't overflow and fail, vertices go in a page.
+    DynamicAllocation failed = ring.allocate( 2048, BufferType::Constant_mask );
+    hy_test_check( failed.data == nullptr );
+
+    DynamicAllocation vertices = ring.allocate( 2048, BufferType::Vertex_mask );
+    hy_test_check( vertices.data != nullptr );
+    hy_test_check( vertices.buffer.index != ring.buffer.index );
+    hy_test_check( ring.pages.size == 1 );
+
+    ring.end_frame( 0 );
+
+    hy_test_check( ring.last_frame_stats.allocations == 4 );
+    hy_test_check( ring.last_frame_stats.failed_allocations == 1 );
+    hy_test_check( ring.last_frame_stats.overflow_allocations == 1 );
+    hy_test_check( ring.last_frame_stats.overflow_bytes == 2048 );
+
+    // Frame 0 is still in flight: its memory and page are not reused.
+    ring.begin_frame( 1 );
+
+    DynamicAllocation last_constants = ring.allocate( 1000, BufferType::Constant_mask );
+    hy_test_check( last_constants.data != nullptr );
+    hy_test_check( ring.allocate( 16, BufferType::Constant_mask ).data == nullptr );
+
+    vertices = ring.allocate( 2048, BufferType::Vertex_mask );
+    hy_test_check( ring.pages.size == 2 );
+
+    ring.end_frame( 1 );
+    hy_test_check( ring.last_frame_stats.failed_allocations == 1 );
+
+    // Frame 0 is done: the ring space and the page of frame 0 are free again.
+    ring.begin_frame( 0 );
+
+    DynamicAllocation reused = ring.allocate( 3000, BufferType::Constant_mask );
+    hy_test_check( reused.data != nullptr );
+    hy_test_check( reused.offset == 0 );
+
+    vertices = ring.allocate( 2048, BufferType::Vertex_mask );
+    hy_test_check( vertices.data != nullptr );
+    hy_test_check( ring.pages.size == 2 );
+
+    ring.end_frame( 0 );
+    hy_test_check( ring.last_frame_stats.failed_allocations == 0 );
+
+    ring.shutdown();
+}
+
+// Resource list cache //////////////////////////////////////////////////////////
+
+//
+// Lists with the same contents are shared and ref-counted, removing a list keeps the lists
+// that collided with it reachable.
+static void test_resource_list_cache( Device& gpu ) {
+
+    hprint( "Test: resource list cache references.\n" );
+
+    ResourceLayoutCreation layout_creation;
+    layout_creation.add_binding( { ResourceType::Constants, 0, 1, "Local" } ).set_name( "Test_Layout" );
+    ResourceLayoutHandle layout = gpu.create_resource_layout( layout_creation );
+
+    BufferHandle buffers[ 3 ];
+    for ( u32 i = 0; i < 3; ++i ) {
+        BufferCreation buffer_creation;
+        buffer_creation.set( BufferType::Constant_mask, ResourceUsageType::Immutable, 64 ).set_name( "Test_Buffer" );
+        buffers[ i ] = gpu.create_buffer( buffer_creation );
+    }
+
+    ResourceListCreation list_creations[ 3 ];
+    for ( u32 i = 0; i < 3; ++i ) {
+        list_creations[ i ].reset().set_layout( layout ).buffer( buffers[ i ], 0 ).set_name( "Test_List" );
+    }
+
+    const ResourceListCache& cache = gpu.get_resource_list_cache();
+
+    // Same contents return the same list.
+    ResourceListHandle list_a = gpu.create_resource_list_cached( list_creations[ 0 ] );
+    ResourceListHandle list_a_again = gpu.create_resource_list_cached( list_creations[ 0 ] );
+    hy_test_check( list_a.index == list_a_again.index );
+    hy_test_check( cache.entries[ list_a.index ].references == 2 );
+    hy_test_check( cache.hits == 1 );
+    hy_test_check( cache.num_lists == 1 );
+
+    gpu.destroy_resource_list_cached( list_a );
+    hy_test_check( cache.entries[ list_a.index ].references == 1 );
+    hy_test_check( cache.num_lists == 1 );
+
+    gpu.destroy_resource_list_cached( list_a_again );
+    hy_test_check( cache.entries[ list_a.index ].references == 0 );
+    hy_test_check( cache.num_lists == 0 );
+    hy_test_check( cache.lists.size == 0 );
+
+    // Force a collision: the first list takes the key of the second one, that is stored at the next key.
+    ResourceListCache& writable_cache = gpu.resource_list_cache;
+    const u64 hash_b = list_creations[ 2 ].compute_hash();
+
+    ResourceListHandle list_b = gpu.create_resource_list_cached( list_creations[ 1 ] );
+    writable_cache.lists.remove( writable_cache.entries[ list_b.index ].hash );
+    writable_cache.lists.insert( hash_b, list_b.index );
+    writable_cache.entries[ list_b.index ].hash = hash_b;
+
+    const u32 collisions = cache.collisions;
+    ResourceListHandle list_c = gpu.create_resource_list_cached( list_creations[ 2 ] );
+    hy_test_check( list_c.index != list_b.index );
+    hy_test_check( cache.collisions == collisions + 1 );
+    hy_test_check( cache.entries[ list_c.index ].hash == hash_b + 1 );
+
+    // Removing the first list moves the colliding one back to its own key, where lookups find it.
+    gpu.destroy_resource_list_cached( list_b );
+    hy_test_check( cache.entries[ list_c.index ].hash == hash_b );
+
+    ResourceListHandle list_c_again = gpu.create_resource_list_cached( list_creations[ 2 ] );
+    hy_test_check( list_c_again.index == list_c.index );
+    hy_test_check( cache.entries[ list_c.index ].references == 2 );
+
+    gpu.destroy_resource_list_cached( list_c );
+    gpu.destroy_resource_list_cached( list_c_again );
+    hy_test_check( cache.num_lists == 0 );
+    hy_test_check( cache.lists.size == 0 );
+
+    for ( u32 i = 0; i < 3; ++i ) {
+        gpu.destroy_buffer( buffers[ i ] );
+    }
+    gpu.destroy_resource_layout( layout );
+}
+
+// GPU timestamp statistics /////////////////////////////////////////////////////
+
+//
+// Nearest rank percentiles over the window, for inclusive and self times.
+static void test_timestamp_percentiles( Allocator* allocator ) {
+
+    hprint( "Test: GPU timestamp percentiles.\n" );
+
+    GPUTimestampStatistics statistics;
+    statistics.init( allocator, 100 );
+
+    GPUTimestamp timestamps[ 2 ];
+    memset( timestamps, 0, sizeof( timestamps ) );
+    timestamps[ 0 ].name = string_id_intern( "Test_Frame" );
+    timestamps[ 1 ].name = string_id_intern( "Test_Pass" );
+    timestamps[ 1 ].depth = 1;
+    timestamps[ 1 ].parent_index = 0;
+
+    // Frame i takes i milliseconds, half of them in the pass.
+    for ( u32 i = 1; i <= 100; ++i ) {
+        timestamps[ 0 ].elapsed_ms = i;
+        timestamps[ 1 ].elapsed_ms = i * 0.5;
+        statistics.add_frame( timestamps, 2 );
+    }
+
+    statistics.compute_percentiles();
+
+    hy_test_check( statistics.scopes.size == 2 );
+    const GPUScopeStatistics& frame = statistics.scopes[ 0 ];
+    hy_test_check( frame.num_samples == 100 );
+    hy_test_check( frame.p50 == 50.f );
+    hy_test_check( frame.p95 == 95.f );
+    hy_test_check( frame.p99 == 99.f );
+    hy_test_check( frame.self_p50 == 25.f );
+
+    const GPUScopeStatistics& pass = statistics.scopes[ 1 ];
+    hy_test_check( pass.parent == 0 );
+    hy_test_check( pass.depth == 1 );
+    hy_test_check( pass.p50 == 25.f );
+    hy_test_check( pass.self_p99 == 49.5f );
+
+    // The window keeps the last 100 frames: 51..100 and 50 frames of 200ms.
+    timestamps[ 0 ].elapsed_ms = 200.0;
+    timestamps[ 1 ].elapsed_ms = 100.0;
+    for ( u32 i = 0; i < 50; ++i ) {
+        statistics.add_frame( timestamps, 2 );
+    }
+
+    statistics.compute_percentiles();
+
+    const GPUScopeStatistics& windowed_frame = statistics.scopes[ 0 ];
+    hy_test_check( windowed_frame.num_samples == 100 );
+    hy_test_check( windowed_frame.total_frames == 150 );
+    hy_test_check( windowed_frame.p50 == 100.f );
+    hy_test_check( windowed_frame.p95 == 200.f );
+
+    statistics.shutdown();
+}
+
+// Render graph /////////////////////////////////////////////////////////////////
+
+//
+// Draws once per stage, first_vertex tells the stage in the submitted stream.
+struct TestDrawFeature : public RenderFeature {
+
+    void                            render( Renderer& renderer, u64& sort_key, CommandBuffer* commands, RenderView& render_view, u64 stage_name_hash ) override {
+        commands->draw( sort_key++, TopologyType::Triangle, first_vertex, 3, 0, 1 );
+    }
+
+    u32                             first_vertex = 0;
+
+}; // struct TestDrawFeature
+
+//
+// Stages recorded by the calling thread only, or split across workers, are submitted in stage order.
+static void test_render_graph( Renderer* renderer, Allocator* allocator, u32 num_recording_threads, bool deferred ) {
+
+    hprint( "Test: render graph with %u recording threads, %s.\n", num_recording_threads, deferred ? "deferred" : "immediate" );
+
+    static const u32 k_num_stages = 6;
+
+    Device& gpu = *renderer->gpu;
+
+    RenderView view;
+    TestDrawFeature features[ k_num_stages ];
+    RenderStage stages[ k_num_stages ];
+
+    RenderGraph graph;
+    graph.init( allocator, num_recording_threads, deferred );
+
+    for ( u32 i = 0; i < k_num_stages; ++i ) {
+        features[ i ].first_vertex = i;
+
+        RenderStage& stage = stages[ i ];
+        stage.name = string_id_intern( "Test_Stage" );
+        stage.name_hash = 0;
+        stage.type = RenderPassType::Swapchain;
+        stage.clear.reset();
+        stage.render_view = &view;
+        stage.features.init( allocator, 1 );
+        stage.features.push( &features[ i ] );
+
+        graph.stages.push( &stage );
+    }
+
+    CommandBuffer* command_buffer = gpu.get_command_buffer( 0, QueueType::Graphics, true );
+    CommandBuffer* continuation = graph.render( renderer, sort_key_stage( 0 ), command_buffer );
+    gpu.queue_command_buffer( continuation );
+    gpu.present();
+
+    hy_test_check( graph.num_recording_threads == num_recording_threads );
+    hy_test_check( ( ( GpuDeviceNull& )gpu ).get_last_frame_counters().commands[ NullCommandType::Draw ] == k_num_stages );
+
+    // Deferred streams are replayed in the first thread command buffer, the others are submitted empty.
+    // Otherwise stages are recorded in the given command buffer with one thread, or each thread command
+    // buffer holds its own contiguous range of stages.
+    u32 first_vertices[ k_num_stages ];
+    u32 num_draws = 0;
+    if ( deferred ) {
+        hy_test_check( gpu.deferred_stats.num_streams == num_recording_threads );
+        num_draws = test_read_draws( graph.thread_command_buffers[ 0 ], first_vertices, k_num_stages );
+    }
+    else if ( num_recording_threads == 1 ) {
+        hy_test_check( continuation == command_buffer );
+        num_draws = test_read_draws( command_buffer, first_vertices, k_num_stages );
+    }
+    else {
+        hy_test_check( test_count_commands( command_buffer, NullCommandType::Draw ) == 0 );
+        for ( u32 t = 0; t < num_recording_threads; ++t ) {
+            num_draws += test_read_draws( graph.thread_command_buffers[ t ], first_vertices + num_draws, k_num_stages - num_draws );
+        }
+    }
+
+    hy_test_check( num_draws == k_num_stages );
+    for ( u32 i = 0; i < num_draws; ++i ) {
+        hy_test_check( first_vertices[ i ] == i );
+    }
+
+    for ( u32 i = 0; i < k_num_stages; ++i ) {
+        stages[ i ].features.shutdown();
+    }
+    graph.shutdown();
+
+    gpu.new_frame();
+}
+
+int main( int argc, char** argv ) {
+
+    MemoryService::instance()->init( nullptr );
+    Allocator* allocator = &MemoryService::instance()->system_allocator;
+
+    time_service_init();
+    StringIdService::instance()->init( allocator );
+
+    DeviceCreation device_creation;
+    device_creation.set_window( 64, 64, nullptr ).set_allocator( allocator );
+
+    Device* gpu = Device::instance();
+    gpu->init( device_creation );
+    gpu->new_frame();
+
+    Renderer* renderer = Renderer::instance();
+    RendererCreation renderer_creation{ gpu, allocator };
+    renderer->init( renderer_creation );
+
+    test_deferred_replay( *gpu, allocator );
+    test_dynamic_allocator( *gpu );
+    test_resource_list_cache( *gpu );
+    test_timestamp_percentiles( allocator );
+    test_render_graph( renderer, allocator, 1, false );
+    test_render_graph( renderer, allocator, 1, true );
+    test_render_graph( renderer, allocator, 3, true );
+    test_render_graph( renderer, allocator, 3, false );
+
+    gpu->present();
+    // Shuts the device down too.
+    renderer->shutdown();
+
+    StringIdService::instance()->shutdown();
+    time_service_shutdown();
+    MemoryService::instance()->shutdown();
+
+    hprint( "Null device tests: %u of %u checks failed.\n", s_failed_checks, s_checks );
+    return ( int )s_failed_checks;
+}